@@ -0,0 +1,47 @@
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iostream>
+#include <rwe/cob/CobTranspiler.h>
+#include <rwe/io/cob/Cob.h>
+
+namespace fs = boost::filesystem;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output-dir> <file.cob>..." << std::endl;
+        return 1;
+    }
+
+    fs::path outputDir(argv[1]);
+    fs::create_directories(outputDir);
+
+    for (int i = 2; i < argc; ++i)
+    {
+        fs::path inputPath(argv[i]);
+
+        std::ifstream fh(inputPath.string(), std::ios::binary);
+        if (!fh)
+        {
+            std::cerr << "Failed to open " << inputPath.string() << std::endl;
+            return 1;
+        }
+
+        auto script = rwe::parseCob(fh);
+        auto name = inputPath.stem().string();
+
+        auto outputPath = outputDir / (name + ".cpp");
+        std::ofstream out(outputPath.string(), std::ios::binary);
+        out << rwe::transpileCobScript(script, name);
+        if (!out)
+        {
+            std::cerr << "Failed to write " << outputPath.string() << std::endl;
+            return 1;
+        }
+
+        std::cout << inputPath.string() << " -> " << outputPath.string() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,696 @@
+#include <algorithm>
+#include <array>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp> // not in asio.hpp in old boost versions
+#include <boost/crc.hpp>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <rwe/game/DesyncHistory.h>
+#include <rwe/game/DesyncInvestigation.h>
+#include <rwe/game/GameNetworkService.h>
+#include <rwe/game/LockstepGovernor.h>
+#include <rwe/game/PlayerCommandService.h>
+#include <rwe/game/RelayServer.h>
+#include <rwe/proto/UnitTypeTable.h>
+#include <rwe/proto/serialization.h>
+#include <rwe/sim/GameSimulation.h>
+#include <rwe/sim/SimTicksPerSecond.h>
+#include <spdlog/sinks/null_sink.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rwe
+{
+    struct LinkConditions
+    {
+        /** The probability that a packet is dropped. */
+        float lossRate;
+
+        /** The time every packet takes to arrive. */
+        std::chrono::milliseconds delay;
+
+        /** The most extra time a packet may take on top of the delay, chosen uniformly. */
+        std::chrono::milliseconds jitter;
+    };
+
+    struct LinkStats
+    {
+        unsigned int packetsSent{0};
+        unsigned int packetsDropped{0};
+        std::size_t bytesSent{0};
+    };
+
+    /**
+     * Relays UDP traffic between peers on loopback,
+     * dropping and delaying packets to imitate a poor connection.
+     *
+     * There is a relay socket for each ordered pair of peers.
+     * Peer i sends to peer j by sending to relay (i, j),
+     * which is forwarded out of relay (j, i),
+     * so peer j sees the packet come from the address it has for peer i.
+     */
+    class LoopbackShim
+    {
+    private:
+        struct Relay
+        {
+            boost::asio::ip::udp::socket socket;
+            std::array<char, 1500> receiveBuffer;
+            boost::asio::ip::udp::endpoint currentRemoteEndpoint;
+            LinkStats stats;
+
+            Relay(boost::asio::io_service& ioContext, const boost::asio::ip::udp::endpoint& endpoint) : socket(ioContext, endpoint) {}
+        };
+
+        boost::asio::io_service ioContext;
+        std::thread thread;
+
+        LinkConditions conditions;
+        std::mt19937 rng;
+
+        std::vector<boost::asio::ip::udp::endpoint> peerEndpoints;
+
+        /** Indexed by sending peer, then receiving peer. */
+        std::vector<std::vector<std::unique_ptr<Relay>>> relays;
+
+    public:
+        LoopbackShim(const std::vector<boost::asio::ip::udp::endpoint>& peerEndpoints, const LinkConditions& conditions, unsigned int seed)
+            : conditions(conditions), rng(seed), peerEndpoints(peerEndpoints)
+        {
+            auto relayEndpoint = boost::asio::ip::udp::endpoint(peerEndpoints.front().address(), 0);
+            for (std::size_t i = 0; i < peerEndpoints.size(); ++i)
+            {
+                relays.emplace_back();
+                for (std::size_t j = 0; j < peerEndpoints.size(); ++j)
+                {
+                    relays[i].push_back(std::make_unique<Relay>(ioContext, relayEndpoint));
+                }
+            }
+        }
+
+        ~LoopbackShim()
+        {
+            stop();
+        }
+
+        /** The address that peer `from` should send to in order to reach peer `to`. */
+        boost::asio::ip::udp::endpoint getRelayEndpoint(std::size_t from, std::size_t to) const
+        {
+            return relays[from][to]->socket.local_endpoint();
+        }
+
+        const LinkStats& getLinkStats(std::size_t from, std::size_t to) const
+        {
+            return relays[from][to]->stats;
+        }
+
+        void start()
+        {
+            for (std::size_t i = 0; i < relays.size(); ++i)
+            {
+                for (std::size_t j = 0; j < relays.size(); ++j)
+                {
+                    if (i != j)
+                    {
+                        listen(i, j);
+                    }
+                }
+            }
+
+            thread = std::thread([this]() { ioContext.run(); });
+        }
+
+        /** Link stats may only be read once the shim has stopped. */
+        void stop()
+        {
+            if (thread.joinable())
+            {
+                ioContext.stop();
+                thread.join();
+            }
+        }
+
+    private:
+        void listen(std::size_t from, std::size_t to)
+        {
+            auto& relay = *relays[from][to];
+            relay.socket.async_receive_from(
+                boost::asio::buffer(relay.receiveBuffer.data(), relay.receiveBuffer.size()),
+                relay.currentRemoteEndpoint,
+                [this, &relay, from, to](const auto& error, const auto& bytesTransferred) {
+                    if (!error)
+                    {
+                        forward(from, to, std::string(relay.receiveBuffer.data(), bytesTransferred));
+                    }
+                    listen(from, to);
+                });
+        }
+
+        void forward(std::size_t from, std::size_t to, std::string&& packet)
+        {
+            auto& stats = relays[from][to]->stats;
+            ++stats.packetsSent;
+            stats.bytesSent += packet.size();
+
+            if (std::uniform_real_distribution<float>(0.0f, 1.0f)(rng) < conditions.lossRate)
+            {
+                ++stats.packetsDropped;
+                return;
+            }
+
+            auto jitter = std::uniform_int_distribution<int>(0, conditions.jitter.count())(rng);
+            auto timer = std::make_shared<boost::asio::steady_timer>(ioContext, conditions.delay + std::chrono::milliseconds(jitter));
+            auto payload = std::make_shared<std::string>(std::move(packet));
+            timer->async_wait([this, from, to, timer, payload](const boost::system::error_code& error) {
+                if (error)
+                {
+                    return;
+                }
+
+                boost::system::error_code sendError;
+                relays[to][from]->socket.send_to(boost::asio::buffer(*payload), peerEndpoints[to], 0, sendError);
+            });
+        }
+    };
+
+    /**
+     * One peer in a lockstep game, driven the same way GameScene drives it
+     * but with scripted commands in place of the local player.
+     *
+     * There is no game data to spawn units from,
+     * so commands cannot be applied to the simulation.
+     * Instead every tick's commands are folded into a running checksum
+     * which is combined with the hash of the (empty) simulation,
+     * so peers agree only if they executed the same commands on the same ticks.
+     *
+     * A peer can be told to corrupt its simulation on a given tick
+     * to check that the peers track down the desync.
+     */
+    class HarnessPeer
+    {
+    public:
+        using CommandSet = PlayerCommandService::CommandSet;
+
+    private:
+        PlayerId localPlayerId;
+        unsigned int targetTickCount;
+
+        PlayerCommandService playerCommandService;
+
+        /** The harness has no unit data, so its commands never name unit types. */
+        UnitTypeTable unitTypes;
+
+        std::unique_ptr<GameNetworkService> gameNetworkService;
+        LockstepGovernor lockstepGovernor;
+        GameSimulation simulation;
+
+        boost::crc_32_type commandChecksum;
+        SceneTime sceneTime{0};
+        int millisecondsBuffer{0};
+
+        std::mt19937 rng;
+        CommandSet localPlayerCommandBuffer;
+
+        std::vector<GameHash> tickHashes;
+        unsigned int maxCommandDelayTicks{0};
+
+        std::optional<SceneTime> desyncInjectionTime;
+        DesyncHistory desyncHistory;
+        std::optional<DesyncInvestigation> desyncInvestigation;
+        std::optional<std::string> desyncReport;
+
+    public:
+        HarnessPeer(
+            PlayerId localPlayerId,
+            unsigned int playerCount,
+            int port,
+            const std::vector<GameNetworkService::EndpointInfo>& endpoints,
+            const std::optional<boost::asio::ip::udp::endpoint>& relayEndpoint,
+            unsigned int targetTickCount,
+            unsigned int seed,
+            const std::optional<SceneTime>& desyncInjectionTime)
+            : localPlayerId(localPlayerId),
+              targetTickCount(targetTickCount),
+              simulation(MapTerrain(Grid<unsigned char>(65, 65, 0), 0_ss), 0, 0, 20),
+              rng(seed),
+              desyncInjectionTime(desyncInjectionTime)
+        {
+            for (unsigned int i = 0; i < playerCount; ++i)
+            {
+                GamePlayerInfo info{"Player " + std::to_string(i), GamePlayerType::Human, PlayerColorIndex(i), GamePlayerStatus::Alive, "ARM", Metal(1000), Energy(1000), Metal(1000), Energy(1000), Metal(1000), Energy(1000)};
+                playerCommandService.registerPlayer(simulation.addPlayer(info));
+            }
+
+            gameNetworkService = std::make_unique<GameNetworkService>(localPlayerId, port, endpoints, relayEndpoint, unitTypes, &playerCommandService);
+            tickHashes.reserve(targetTickCount);
+        }
+
+        void start()
+        {
+            gameNetworkService->start();
+        }
+
+        bool isFinished() const
+        {
+            return sceneTime.value >= targetTickCount || desyncReport.has_value();
+        }
+
+        bool isDesyncDetected() const
+        {
+            return desyncInvestigation.has_value();
+        }
+
+        const std::optional<std::string>& getDesyncReport() const
+        {
+            return desyncReport;
+        }
+
+        SceneTime getSceneTime() const
+        {
+            return sceneTime;
+        }
+
+        const std::vector<GameHash>& getTickHashes() const
+        {
+            return tickHashes;
+        }
+
+        const LockstepMetrics& getLockstepMetrics() const
+        {
+            return lockstepGovernor.getMetrics();
+        }
+
+        unsigned int getMaxCommandDelayTicks() const
+        {
+            return maxCommandDelayTicks;
+        }
+
+        const std::vector<PeerLatency>& getPeerLatencies()
+        {
+            return gameNetworkService->getPeerLatencies();
+        }
+
+        void update(int millisecondsElapsed)
+        {
+            millisecondsBuffer += millisecondsElapsed;
+
+            if (!isFinished())
+            {
+                scriptCommands();
+            }
+
+            lockstepGovernor.updateCommandDelay(gameNetworkService->getPeerLatencies());
+            auto targetCommandBufferSize = lockstepGovernor.getCommandDelayTicks();
+            maxCommandDelayTicks = std::max(maxCommandDelayTicks, targetCommandBufferSize);
+
+            auto bufferedCommandCount = playerCommandService.bufferedCommandCount(localPlayerId);
+            if (bufferedCommandCount <= targetCommandBufferSize)
+            {
+                playerCommandService.pushCommands(localPlayerId, localPlayerCommandBuffer);
+                gameNetworkService->submitCommands(sceneTime, localPlayerCommandBuffer);
+                localPlayerCommandBuffer.clear();
+                ++bufferedCommandCount;
+            }
+
+            for (; bufferedCommandCount < targetCommandBufferSize; ++bufferedCommandCount)
+            {
+                playerCommandService.pushCommands(localPlayerId, CommandSet());
+                gameNetworkService->submitCommands(sceneTime, CommandSet());
+            }
+
+            auto averageSceneTime = gameNetworkService->estimateAvergeSceneTime(sceneTime);
+            auto tickInterval = lockstepGovernor.updateTickInterval(sceneTime, averageSceneTime);
+            while (!isFinished() && millisecondsBuffer >= tickInterval)
+            {
+                if (!tryTick())
+                {
+                    lockstepGovernor.onStall(getTimestamp());
+                    millisecondsBuffer = tickInterval;
+                    break;
+                }
+
+                lockstepGovernor.onTick(getTimestamp());
+                millisecondsBuffer -= tickInterval;
+            }
+        }
+
+    private:
+        bool tryTick()
+        {
+            if (desyncInvestigation)
+            {
+                continueDesyncInvestigation();
+                return false;
+            }
+
+            if (auto mismatchTime = playerCommandService.findHashMismatch(); mismatchTime)
+            {
+                auto snapshot = desyncHistory.createSnapshot(localPlayerId, *mismatchTime);
+                gameNetworkService->submitDesyncSnapshot(serializeDesyncSnapshot(snapshot));
+                desyncInvestigation.emplace(std::move(snapshot), gameNetworkService->getRemotePlayerIds(), getTimestamp());
+                return false;
+            }
+
+            auto playerCommands = playerCommandService.tryPopCommands();
+            if (!playerCommands)
+            {
+                return false;
+            }
+
+            sceneTime += SceneTime(1);
+
+            for (const auto& entry : *playerCommands)
+            {
+                auto playerId = entry.first.value;
+                commandChecksum.process_bytes(&playerId, sizeof(playerId));
+                auto encodedCommands = serializeCommandSet(entry.second, unitTypes);
+                commandChecksum.process_bytes(encodedCommands.data(), encodedCommands.size());
+            }
+
+            simulation.tick();
+
+            if (desyncInjectionTime == sceneTime)
+            {
+                simulation.players[0].metal += Metal(1);
+            }
+
+            auto gameHash = desyncHistory.recordTick(sceneTime, simulation, *playerCommands) + GameHash(commandChecksum.checksum());
+            tickHashes.push_back(gameHash);
+            playerCommandService.pushHash(localPlayerId, gameHash);
+            gameNetworkService->submitGameHash(gameHash);
+
+            return true;
+        }
+
+        void continueDesyncInvestigation()
+        {
+            auto now = getTimestamp();
+            while (auto data = gameNetworkService->tryTakeDesyncSnapshot())
+            {
+                desyncInvestigation->addRemoteSnapshot(deserializeDesyncSnapshot(*data), now);
+            }
+
+            if (desyncInvestigation->isFinished(now))
+            {
+                desyncReport = desyncInvestigation->createReport();
+            }
+        }
+
+        /**
+         * Issues the sort of commands a player sends:
+         * occasional orders to groups of units,
+         * and now and then an order to a whole army
+         * that is too big to fit in one packet.
+         */
+        void scriptCommands()
+        {
+            std::uniform_int_distribution<int> actionDist(0, 99);
+            auto action = actionDist(rng);
+            if (action >= 10)
+            {
+                return;
+            }
+
+            auto groupSize = action == 0 ? 200 : std::uniform_int_distribution<int>(1, 24)(rng);
+            auto firstUnit = localPlayerId.value * 1000 + std::uniform_int_distribution<int>(0, 100)(rng);
+            std::uniform_int_distribution<int> positionDist(0, 2047);
+            auto destination = SimVector(intToSimScalar(positionDist(rng)), 0_ss, intToSimScalar(positionDist(rng)));
+
+            for (int i = 0; i < groupSize; ++i)
+            {
+                UnitId unitId(firstUnit + i);
+                switch (action)
+                {
+                    case 1:
+                        localPlayerCommandBuffer.emplace_back(PlayerUnitCommand(unitId, PlayerUnitCommand::Stop()));
+                        break;
+                    case 2:
+                        localPlayerCommandBuffer.emplace_back(PlayerUnitCommand(unitId, PlayerUnitCommand::SetFireOrders{UnitFireOrders::ReturnFire}));
+                        break;
+                    case 3:
+                        localPlayerCommandBuffer.emplace_back(PlayerUnitCommand(unitId, PlayerUnitCommand::IssueOrder(AttackOrder(destination), PlayerUnitCommand::IssueOrder::Immediate)));
+                        break;
+                    default:
+                        localPlayerCommandBuffer.emplace_back(PlayerUnitCommand(unitId, PlayerUnitCommand::IssueOrder(MoveOrder(destination), action % 2 == 0 ? PlayerUnitCommand::IssueOrder::Queued : PlayerUnitCommand::IssueOrder::Immediate)));
+                        break;
+                }
+            }
+        }
+    };
+
+    /** Returns the first tick on which the peers' hashes differ, if any. */
+    std::optional<unsigned int> findHashMismatch(const std::vector<std::unique_ptr<HarnessPeer>>& peers)
+    {
+        const auto& expected = peers.front()->getTickHashes();
+        for (const auto& peer : peers)
+        {
+            const auto& hashes = peer->getTickHashes();
+            auto commonSize = std::min(expected.size(), hashes.size());
+            for (std::size_t t = 0; t < commonSize; ++t)
+            {
+                if (hashes[t] != expected[t])
+                {
+                    return t + 1;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace rwe;
+
+    if (argc > 1 && std::string(argv[1]) == "--help")
+    {
+        std::cerr << "Usage: " << argv[0] << " [peers] [ticks] [loss %] [delay ms] [jitter ms] [seed] [base port] [mesh|relay] [desync tick]" << std::endl;
+        return 1;
+    }
+
+    unsigned int peerCount = argc > 1 ? std::stoul(argv[1]) : 4;
+    unsigned int tickCount = argc > 2 ? std::stoul(argv[2]) : 30 * SimTicksPerSecond;
+    float lossPercent = argc > 3 ? std::stof(argv[3]) : 5.0f;
+    int delayMillis = argc > 4 ? std::stoi(argv[4]) : 30;
+    int jitterMillis = argc > 5 ? std::stoi(argv[5]) : 10;
+    unsigned int seed = argc > 6 ? std::stoul(argv[6]) : 1;
+    int basePort = argc > 7 ? std::stoi(argv[7]) : 29500;
+    std::string topology = argc > 8 ? argv[8] : "mesh";
+    auto desyncInjectionTime = argc > 9 ? std::make_optional(SceneTime(std::stoul(argv[9]))) : std::nullopt;
+
+    if (peerCount < 2)
+    {
+        std::cerr << "At least two peers are needed" << std::endl;
+        return 1;
+    }
+
+    if (topology != "mesh" && topology != "relay")
+    {
+        std::cerr << "Unknown topology: " << topology << std::endl;
+        return 1;
+    }
+    auto useRelay = topology == "relay";
+
+    spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+
+    // The peers bind IPv6 sockets, which see 127.0.0.1 as this v4-mapped address.
+    auto loopback = boost::asio::ip::address_v6::v4_mapped(boost::asio::ip::address_v4::loopback());
+
+    // In relay mode the relay server is one more node on the shim, after the peers,
+    // so the links between it and the peers see the same conditions.
+    auto nodeCount = useRelay ? peerCount + 1 : peerCount;
+    auto relayNode = peerCount;
+
+    std::vector<boost::asio::ip::udp::endpoint> nodeEndpoints;
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        nodeEndpoints.emplace_back(loopback, basePort + i);
+    }
+
+    LoopbackShim shim(nodeEndpoints, LinkConditions{lossPercent / 100.0f, std::chrono::milliseconds(delayMillis), std::chrono::milliseconds(jitterMillis)}, seed);
+
+    std::unique_ptr<RelayServer> relayServer;
+    std::thread relayThread;
+    if (useRelay)
+    {
+        relayServer = std::make_unique<RelayServer>(basePort + relayNode, peerCount);
+    }
+
+    std::vector<std::unique_ptr<HarnessPeer>> peers;
+    for (unsigned int i = 0; i < peerCount; ++i)
+    {
+        std::vector<GameNetworkService::EndpointInfo> endpoints;
+        for (unsigned int j = 0; j < peerCount; ++j)
+        {
+            if (i != j)
+            {
+                endpoints.emplace_back(PlayerId(j), shim.getRelayEndpoint(i, useRelay ? relayNode : j));
+            }
+        }
+
+        auto relayEndpoint = useRelay ? std::make_optional(shim.getRelayEndpoint(i, relayNode)) : std::nullopt;
+        peers.push_back(std::make_unique<HarnessPeer>(PlayerId(i), peerCount, basePort + i, endpoints, relayEndpoint, tickCount, seed * peerCount + i, i == 0 ? desyncInjectionTime : std::nullopt));
+    }
+
+    std::cout << "peers " << peerCount << " (" << topology << "), " << tickCount << " ticks"
+              << ", loss " << std::fixed << std::setprecision(1) << lossPercent << "%"
+              << ", delay " << delayMillis << "ms, jitter " << jitterMillis << "ms, seed " << seed;
+    if (desyncInjectionTime)
+    {
+        std::cout << ", desync at tick " << desyncInjectionTime->value;
+    }
+    std::cout << std::endl;
+
+    shim.start();
+    if (relayServer)
+    {
+        relayThread = std::thread([&relayServer]() { relayServer->run(); });
+    }
+    for (auto& peer : peers)
+    {
+        peer->start();
+    }
+
+    // Run frames at 60fps, like the game does,
+    // giving up if the peers stop making progress.
+    const auto frameInterval = std::chrono::milliseconds(16);
+    const auto progressTimeout = std::chrono::seconds(10);
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto lastFrameTime = startTime;
+    auto lastProgressTime = startTime;
+    auto lastProgressSceneTime = SceneTime(0);
+    auto timedOut = false;
+    while (!std::all_of(peers.begin(), peers.end(), [](const auto& p) { return p->isFinished(); }))
+    {
+        std::this_thread::sleep_until(lastFrameTime + frameInterval);
+        auto now = std::chrono::steady_clock::now();
+        auto millisecondsElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastFrameTime).count();
+        lastFrameTime = now;
+
+        for (auto& peer : peers)
+        {
+            peer->update(static_cast<int>(millisecondsElapsed));
+        }
+
+        auto minSceneTime = (*std::min_element(peers.begin(), peers.end(), [](const auto& a, const auto& b) { return a->getSceneTime() < b->getSceneTime(); }))->getSceneTime();
+        if (minSceneTime > lastProgressSceneTime)
+        {
+            lastProgressSceneTime = minSceneTime;
+            lastProgressTime = now;
+        }
+        else if (now - lastProgressTime > progressTimeout)
+        {
+            timedOut = true;
+            break;
+        }
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    // Wait for the final hashes to arrive,
+    // then stop the shim so that its stats can be read.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    shim.stop();
+    if (relayServer)
+    {
+        relayServer->stop();
+        relayThread.join();
+    }
+
+    // Peers' upstream traffic is counted apart from the relay's.
+    LinkStats peerLinkStats;
+    LinkStats relayLinkStats;
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        auto& totalLinkStats = i == relayNode ? relayLinkStats : peerLinkStats;
+        for (unsigned int j = 0; j < nodeCount; ++j)
+        {
+            const auto& stats = shim.getLinkStats(i, j);
+            totalLinkStats.packetsSent += stats.packetsSent;
+            totalLinkStats.packetsDropped += stats.packetsDropped;
+            totalLinkStats.bytesSent += stats.bytesSent;
+        }
+    }
+    auto totalPacketsSent = peerLinkStats.packetsSent + relayLinkStats.packetsSent;
+    auto totalPacketsDropped = peerLinkStats.packetsDropped + relayLinkStats.packetsDropped;
+
+    auto rttSum = 0.0f;
+    auto rttMax = 0.0f;
+    auto rttCount = 0u;
+    unsigned int stallCount = 0;
+    std::chrono::milliseconds totalStallDuration{0};
+    std::chrono::milliseconds longestStallDuration{0};
+    unsigned int maxCommandDelayTicks = 0;
+    for (auto& peer : peers)
+    {
+        for (const auto& latency : peer->getPeerLatencies())
+        {
+            rttSum += latency.averageRoundTripTime;
+            rttMax = std::max(rttMax, latency.averageRoundTripTime);
+            ++rttCount;
+        }
+
+        const auto& metrics = peer->getLockstepMetrics();
+        stallCount += metrics.stallCount;
+        totalStallDuration += metrics.totalStallDuration;
+        longestStallDuration = std::max(longestStallDuration, metrics.longestStallDuration);
+        maxCommandDelayTicks = std::max(maxCommandDelayTicks, peer->getMaxCommandDelayTicks());
+    }
+
+    auto minTicks = lastProgressSceneTime.value;
+    std::cout << std::fixed << std::setprecision(1)
+              << "ticks/s        " << (minTicks / seconds) << " (nominal " << SimTicksPerSecond << ")" << std::endl
+              << "bandwidth      " << (peerLinkStats.bytesSent / seconds / peerCount / 1024.0) << " kB/s, "
+              << (peerLinkStats.packetsSent / seconds / peerCount) << " packets/s sent per peer, "
+              << (totalPacketsSent == 0 ? 0.0 : (100.0 * totalPacketsDropped) / totalPacketsSent) << "% dropped" << std::endl;
+    if (useRelay)
+    {
+        std::cout << "relay          " << (relayLinkStats.bytesSent / seconds / 1024.0) << " kB/s, "
+                  << (relayLinkStats.packetsSent / seconds) << " packets/s sent" << std::endl;
+    }
+    std::cout << "rtt            avg " << (rttCount == 0 ? 0.0f : rttSum / rttCount) << " ms, max " << rttMax << " ms" << std::endl
+              << "command delay  max " << maxCommandDelayTicks << " ticks (" << (maxCommandDelayTicks * SimMillisecondsPerTick) << " ms)" << std::endl
+              << "stalls         " << stallCount << ", total " << totalStallDuration.count() << " ms, longest " << longestStallDuration.count() << " ms" << std::endl;
+
+    auto failed = false;
+    if (timedOut)
+    {
+        std::cout << "FAILED: peers stopped making progress at tick " << minTicks << std::endl;
+        failed = true;
+    }
+
+    if (std::any_of(peers.begin(), peers.end(), [](const auto& p) { return p->isDesyncDetected(); }))
+    {
+        std::cout << "FAILED: a peer detected a desync from the hashes it received" << std::endl;
+        failed = true;
+    }
+
+    for (unsigned int i = 0; i < peerCount; ++i)
+    {
+        if (const auto& report = peers[i]->getDesyncReport(); report)
+        {
+            std::cout << "desync report of peer " << i << ":" << std::endl
+                      << *report;
+        }
+    }
+
+    if (auto mismatch = findHashMismatch(peers); mismatch)
+    {
+        std::cout << "FAILED: hashes differ from tick " << *mismatch << std::endl;
+        failed = true;
+    }
+
+    if (!failed)
+    {
+        std::cout << "hashes match across " << minTicks << " ticks" << std::endl;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -476,32 +476,6 @@ auto createLoggerInDir(const fs::path& logDir)
     throw std::runtime_error("Failed to create logger");
 }
 
-rwe::PathMapping constructDefaultPathMapping()
-{
-    rwe::PathMapping m;
-
-    m.ai = "ai";
-    m.anims = "anims";
-    m.bitmaps = "bitmaps";
-    m.camps = "camps";
-    m.downloads = "downloads";
-    m.features = "features";
-    m.fonts = "fonts";
-    m.gamedata = "gamedata";
-    m.guis = "guis";
-    m.maps = "maps";
-    m.objects3d = "objects3d";
-    m.palettes = "palettes";
-    m.scripts = "scripts";
-    m.sounds = "sounds";
-    m.textures = "textures";
-    m.unitpics = "unitpics";
-    m.units = "units";
-    m.weapons = "weapons";
-
-    return m;
-}
-
 int main(int argc, char* argv[])
 {
     try
@@ -527,6 +501,8 @@ int main(int argc, char* argv[])
             ("help", "produce help message")
             ("log", po::value<std::string>(), "Sets the log output file path")
             ("state-log", po::value<std::string>(), "Sets the output file for sim-state logs. This is a desync debugging feature.")
+            ("record-replay", po::value<std::string>(), "Records the game to the given replay file, which rwe_replay can play back")
+            ("desync-dump", po::bool_switch(), "Also dumps the full sim state as JSON when a desync is detected")
             ("width", po::value<unsigned int>()->default_value(800), "Sets the window width in pixels")
             ("height", po::value<unsigned int>()->default_value(600), "Sets the window height in pixels")
             ("fullscreen", po::bool_switch(), "Starts the application in fullscreen mode")
@@ -534,6 +510,7 @@ int main(int argc, char* argv[])
             ("data-path", po::value<std::vector<std::string>>(), "Sets the location(s) to search for game data")
             ("map", po::value<std::string>(), "If given, launches straight into a game on the given map")
             ("port", po::value<std::string>()->default_value("1337"), "Network port to bind to")
+            ("relay", po::value<std::string>(), "host:port of an rwe_relay server to send game traffic through instead of to every player")
             ("player", po::value<std::vector<std::string>>(), "type;side;color")
             ("dir-ai", po::value<std::string>()->default_value("ai"), "AI directory name")
             ("dir-anims", po::value<std::string>()->default_value("anims"), "anims directory name")
@@ -591,7 +568,21 @@ int main(int argc, char* argv[])
                 {
                     gameParameters->stateLogFile = vm["state-log"].as<std::string>();
                 }
+                if (vm.count("record-replay"))
+                {
+                    gameParameters->replayFile = vm["record-replay"].as<std::string>();
+                }
+                gameParameters->dumpStateOnDesync = vm["desync-dump"].as<bool>();
                 gameParameters->localNetworkPort = vm["port"].as<std::string>();
+                if (vm.count("relay"))
+                {
+                    auto hostAndPort = rwe::getHostAndPort(vm["relay"].as<std::string>());
+                    if (!hostAndPort)
+                    {
+                        throw std::runtime_error("Invalid relay address format");
+                    }
+                    gameParameters->relayAddress = hostAndPort;
+                }
                 unsigned int playerIndex = 0;
                 if (players.size() > 10)
                 {
@@ -620,7 +611,7 @@ int main(int argc, char* argv[])
             auto screenHeight = vm["height"].as<unsigned int>();
             auto fullscreen = vm["fullscreen"].as<bool>();
 
-            auto pathMapping = constructDefaultPathMapping();
+            auto pathMapping = rwe::constructDefaultPathMapping();
             pathMapping.ai = vm["dir-ai"].as<std::string>();
             pathMapping.anims = vm["dir-anims"].as<std::string>();
             pathMapping.bitmaps = vm["dir-bitmaps"].as<std::string>();
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <rwe/LoadingScene_util.h>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/io/tnt/TntArchive.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathSearcher.h>
+#include <rwe/pathfinding/UnitJumpPointPathFinder.h>
+#include <rwe/pathfinding/UnitPathFinder.h>
+#include <rwe/pathfinding/UnitPerimeterPathFinder.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+#include <rwe/sim/MapTerrain.h>
+#include <rwe/sim/MovementClassCollisionService.h>
+#include <spdlog/sinks/null_sink.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rwe
+{
+    PathCost benchStepCost(const Point& from, const Point& to, const std::optional<Point>& predecessor)
+    {
+        auto direction = pointToDirection(to - from);
+        unsigned int turns = predecessor ? directionDistance(pointToDirection(from - *predecessor), direction) : 0;
+        return PathCost(octileDistance(from, to), turns);
+    }
+
+    PathCost benchEstimate(const Point& from, const Point& goal)
+    {
+        auto distance = octileDistance(from, goal);
+        unsigned int turns = (distance.straight > 0 && distance.diagonal > 0) ? 1 : 0;
+        return PathCost(distance, turns);
+    }
+
+    class BenchGridAStarPathFinder : public GridAStarPathFinder<PathCost>
+    {
+    private:
+        const Grid<char>* grid;
+        Point goal;
+
+    public:
+        BenchGridAStarPathFinder(Workspace* workspace, const Grid<char>* grid, const Point& goal)
+            : GridAStarPathFinder(workspace, grid->getWidth(), grid->getHeight()), grid(grid), goal(goal)
+        {
+        }
+
+    protected:
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+        PathCost estimateCostToGoal(const Point& vertex) override
+        {
+            return benchEstimate(vertex, goal);
+        }
+
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override
+        {
+            for (auto d : Directions)
+            {
+                auto neighbour = vertex + directionToPoint(d);
+                if (grid->tryGetValue(neighbour).value_or(0))
+                {
+                    successors.push(neighbour, costToReach + benchStepCost(vertex, neighbour, predecessor));
+                }
+            }
+        }
+    };
+
+    class BenchHashAStarPathFinder : public AStarPathFinder<Point, PathCost>
+    {
+    private:
+        const Grid<char>* grid;
+        Point goal;
+
+    public:
+        BenchHashAStarPathFinder(const Grid<char>* grid, const Point& goal) : grid(grid), goal(goal)
+        {
+        }
+
+    protected:
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+        PathCost estimateCostToGoal(const Point& vertex) override
+        {
+            return benchEstimate(vertex, goal);
+        }
+
+        std::vector<VertexInfo> getSuccessors(const VertexInfo& info) override
+        {
+            std::optional<Point> predecessor;
+            if (info.predecessor)
+            {
+                predecessor = (*info.predecessor)->vertex;
+            }
+
+            std::vector<VertexInfo> vs;
+            for (auto d : Directions)
+            {
+                auto neighbour = info.vertex + directionToPoint(d);
+                if (grid->tryGetValue(neighbour).value_or(0))
+                {
+                    vs.push_back(VertexInfo{info.costToReach + benchStepCost(info.vertex, neighbour, predecessor), neighbour, &info});
+                }
+            }
+            return vs;
+        }
+    };
+
+    struct BenchMap
+    {
+        Grid<unsigned char> heights;
+        unsigned int seaLevel;
+    };
+
+    /** Rolling hills with the occasional rocky outcrop. */
+    BenchMap generateOpenMap(int size, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> phaseDist(0.0f, 6.28f);
+        std::uniform_real_distribution<float> frequencyDist(0.02f, 0.08f);
+        std::array<std::array<float, 4>, 3> octaves;
+        for (auto& o : octaves)
+        {
+            o = {frequencyDist(rng), frequencyDist(rng), phaseDist(rng), phaseDist(rng)};
+        }
+
+        auto heights = Grid<unsigned char>::from(size, size, [&](const GridCoordinates& c) {
+            auto h = 80.0f;
+            for (const auto& o : octaves)
+            {
+                h += 12.0f * std::sin((c.x * o[0]) + o[2]) * std::cos((c.y * o[1]) + o[3]);
+            }
+            return static_cast<unsigned char>(h);
+        });
+
+        std::bernoulli_distribution rockDist(0.005);
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                if (rockDist(rng))
+                {
+                    heights.set(x, y, 220);
+                }
+            }
+        }
+
+        return BenchMap{std::move(heights), 0};
+    }
+
+    /** A maze of corridors between steep walls, carved by a randomized depth-first search. */
+    BenchMap generateMazeMap(int size, std::mt19937& rng)
+    {
+        const int roomSize = 8;
+        const int wallThickness = 2;
+        const unsigned char floorHeight = 40;
+        const unsigned char wallHeight = 200;
+
+        Grid<unsigned char> heights(size, size, wallHeight);
+        auto rooms = size / roomSize;
+        auto carve = [&](int x, int y, int width, int height) {
+            for (int dy = 0; dy < height; ++dy)
+            {
+                for (int dx = 0; dx < width; ++dx)
+                {
+                    heights.set(x + dx, y + dy, floorHeight);
+                }
+            }
+        };
+
+        Grid<char> visited(rooms, rooms, 0);
+        std::vector<Point> stack{Point(0, 0)};
+        visited.set(0, 0, 1);
+        carve(wallThickness, wallThickness, roomSize - wallThickness, roomSize - wallThickness);
+
+        while (!stack.empty())
+        {
+            auto room = stack.back();
+            std::vector<Point> unvisited;
+            for (const auto& d : {Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1)})
+            {
+                auto next = room + d;
+                if (visited.tryGetValue(next).value_or(1) == 0)
+                {
+                    unvisited.push_back(next);
+                }
+            }
+
+            if (unvisited.empty())
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            std::uniform_int_distribution<std::size_t> choiceDist(0, unvisited.size() - 1);
+            auto next = unvisited[choiceDist(rng)];
+            visited.set(next.x, next.y, 1);
+            stack.push_back(next);
+
+            // the next room, and the wall between it and this one
+            auto topLeft = Point(std::min(room.x, next.x), std::min(room.y, next.y));
+            auto across = Point(std::abs(next.x - room.x), std::abs(next.y - room.y));
+            carve(
+                (topLeft.x * roomSize) + wallThickness,
+                (topLeft.y * roomSize) + wallThickness,
+                ((across.x + 1) * roomSize) - wallThickness,
+                ((across.y + 1) * roomSize) - wallThickness);
+        }
+
+        return BenchMap{std::move(heights), 0};
+    }
+
+    /** Islands with shallow shores in deep water. Some islands are cut off from the rest. */
+    BenchMap generateIslandsMap(int size, std::mt19937& rng)
+    {
+        const unsigned int seaLevel = 40;
+        const float seaBedHeight = 10.0f;
+        const float plateauHeight = 70.0f;
+        const float shoreSlope = 4.0f;
+
+        std::uniform_real_distribution<float> positionDist(0.0f, static_cast<float>(size));
+        std::uniform_real_distribution<float> radiusDist(12.0f, 32.0f);
+        std::vector<std::array<float, 3>> islands((size * size) / 1024);
+        for (auto& island : islands)
+        {
+            island = {positionDist(rng), positionDist(rng), radiusDist(rng)};
+        }
+
+        auto heights = Grid<unsigned char>::from(size, size, [&](const GridCoordinates& c) {
+            auto h = seaBedHeight;
+            for (const auto& island : islands)
+            {
+                auto distance = std::hypot(c.x - island[0], c.y - island[1]);
+                h = std::max(h, seaBedHeight + ((island[2] - distance) * shoreSlope));
+            }
+            return static_cast<unsigned char>(std::min(h, plateauHeight));
+        });
+
+        return BenchMap{std::move(heights), seaLevel};
+    }
+
+    BenchMap loadTntMap(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        TntArchive tnt(&file);
+        Grid<TntTileAttributes> mapAttributes(tnt.getHeader().width, tnt.getHeader().height);
+        tnt.readMapAttributes(mapAttributes.getData());
+        return BenchMap{getHeightGrid(mapAttributes), tnt.getHeader().seaLevel};
+    }
+
+    struct BenchQuery
+    {
+        Point start;
+        Point goal;
+    };
+
+    struct BenchQueryResult
+    {
+        unsigned int expandedVertices;
+        bool partial;
+    };
+
+    struct BenchResult
+    {
+        std::vector<double> latencies;
+        unsigned long long expandedVertices{0};
+        unsigned int partialPaths{0};
+    };
+
+    template <typename F>
+    BenchResult runQueries(const std::vector<BenchQuery>& queries, F findPath)
+    {
+        BenchResult result;
+        result.latencies.reserve(queries.size());
+        for (const auto& q : queries)
+        {
+            auto startTime = std::chrono::steady_clock::now();
+            auto queryResult = findPath(q);
+            result.latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+            result.expandedVertices += queryResult.expandedVertices;
+            result.partialPaths += queryResult.partial ? 1 : 0;
+        }
+        return result;
+    }
+
+    double percentile(std::vector<double> values, double p)
+    {
+        std::sort(values.begin(), values.end());
+        auto index = static_cast<std::size_t>(std::ceil(p * values.size()));
+        return values[std::clamp<std::size_t>(index, 1, values.size()) - 1];
+    }
+
+    void printHeader()
+    {
+        std::cout << std::left << std::setw(12) << "finder"
+                  << std::right << std::setw(6) << "fp"
+                  << std::setw(12) << "nodes/path"
+                  << std::setw(12) << "paths/s"
+                  << std::setw(10) << "partial"
+                  << std::setw(12) << "p50 us"
+                  << std::setw(12) << "p99 us"
+                  << std::endl;
+    }
+
+    void printResult(const std::string& name, unsigned int footprint, const BenchResult& result)
+    {
+        auto count = result.latencies.size();
+        auto seconds = std::accumulate(result.latencies.begin(), result.latencies.end(), 0.0);
+        std::cout << std::left << std::setw(12) << name
+                  << std::right << std::setw(6) << footprint
+                  << std::setw(12) << std::fixed << std::setprecision(0) << (static_cast<double>(result.expandedVertices) / count)
+                  << std::setw(12) << std::setprecision(0) << (count / seconds)
+                  << std::setw(9) << std::setprecision(1) << ((100.0 * result.partialPaths) / count) << "%"
+                  << std::setw(12) << std::setprecision(1) << (percentile(result.latencies, 0.5) * 1000000.0)
+                  << std::setw(12) << std::setprecision(1) << (percentile(result.latencies, 0.99) * 1000000.0)
+                  << std::endl;
+    }
+
+    std::vector<BenchQuery> generateQueries(const Grid<char>& walkable, unsigned int count, std::mt19937& rng)
+    {
+        std::vector<Point> walkablePositions;
+        walkable.forEachIndexed([&](const GridCoordinates& c, char value) {
+            if (value)
+            {
+                walkablePositions.emplace_back(c.x, c.y);
+            }
+        });
+
+        std::vector<BenchQuery> queries;
+        if (walkablePositions.empty())
+        {
+            return queries;
+        }
+
+        std::uniform_int_distribution<std::size_t> positionDist(0, walkablePositions.size() - 1);
+        while (queries.size() < count)
+        {
+            queries.push_back(BenchQuery{walkablePositions[positionDist(rng)], walkablePositions[positionDist(rng)]});
+        }
+        return queries;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace rwe;
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <open|maze|islands|file.tnt> [seed] [queries per footprint] [size]" << std::endl;
+        return 1;
+    }
+
+    std::string mapName(argv[1]);
+    unsigned int seed = argc > 2 ? std::stoul(argv[2]) : 1;
+    unsigned int queryCount = argc > 3 ? std::stoul(argv[3]) : 2000;
+    int mapSize = argc > 4 ? std::stoi(argv[4]) : 256;
+
+    spdlog::create<spdlog::sinks::null_sink_st>("rwe");
+
+    std::mt19937 rng(seed);
+
+    BenchMap map;
+    if (mapName == "open")
+    {
+        map = generateOpenMap(mapSize, rng);
+    }
+    else if (mapName == "maze")
+    {
+        map = generateMazeMap(mapSize, rng);
+    }
+    else if (mapName == "islands")
+    {
+        map = generateIslandsMap(mapSize, rng);
+    }
+    else
+    {
+        map = loadTntMap(mapName);
+    }
+
+    MapTerrain terrain(std::move(map.heights), SimScalar(map.seaLevel));
+    const auto& heights = terrain.getHeightMap();
+
+    // The map is empty of units and buildings.
+    PathFindingSnapshot snapshot(Grid<PathFindingSnapshot::Cell>(heights.getWidth() - 1, heights.getHeight() - 1));
+
+    std::cout << "map " << mapName << " " << heights.getWidth() << "x" << heights.getHeight()
+              << ", seed " << seed << ", " << queryCount << " queries per footprint" << std::endl;
+    printHeader();
+
+    GridAStarWorkspace<PathCost> workspace;
+    PathSearcher searcher;
+    HierarchicalPathGraphs hierarchicalGraphs;
+    MovementClassCollisionService collisionService;
+
+    for (unsigned int footprint = 1; footprint <= 4; ++footprint)
+    {
+        MovementClassId movementClassId(footprint);
+        MovementClassDefinition movementClass{"BENCH" + std::to_string(footprint), footprint, footprint, 0, 22, 18, 18};
+        collisionService.registerMovementClass(movementClassId, computeWalkableGrid(terrain, movementClass));
+        const auto& walkable = collisionService.getGrid(movementClassId);
+
+        auto queries = generateQueries(walkable, queryCount, rng);
+        if (queries.empty())
+        {
+            std::cout << "no walkable positions for footprint " << footprint << std::endl;
+            continue;
+        }
+
+        if (footprint == 1)
+        {
+            // the plain searches that GridAStarPathFinder replaced, for comparison
+            printResult("hash A*", footprint, runQueries(queries, [&](const BenchQuery& q) {
+                BenchHashAStarPathFinder finder(&walkable, q.goal);
+                auto path = finder.findPath(q.start);
+                return BenchQueryResult{static_cast<unsigned int>(path.closedVertices.size()), path.type == AStarPathType::Partial};
+            }));
+
+            printResult("grid A*", footprint, runQueries(queries, [&](const BenchQuery& q) {
+                BenchGridAStarPathFinder finder(&workspace, &walkable, q.goal);
+                auto path = finder.findPath(q.start);
+                return BenchQueryResult{path.expandedVertexCount, path.type == AStarPathType::Partial};
+            }));
+        }
+
+        printResult("unit A*", footprint, runQueries(queries, [&](const BenchQuery& q) {
+            UnitPathFinder finder(&workspace, &snapshot, &collisionService, UnitId(0), movementClassId, footprint, footprint, q.goal);
+            auto path = finder.findPath(q.start);
+            return BenchQueryResult{path.expandedVertexCount, path.type == AStarPathType::Partial};
+        }));
+
+        printResult("unit JPS", footprint, runQueries(queries, [&](const BenchQuery& q) {
+            UnitJumpPointPathFinder finder(&workspace, &snapshot, &collisionService, UnitId(0), movementClassId, footprint, footprint, q.goal);
+            auto path = finder.findPath(q.start);
+            return BenchQueryResult{path.expandedVertexCount, path.type == AStarPathType::Partial};
+        }));
+
+        printResult("perimeter", footprint, runQueries(queries, [&](const BenchQuery& q) {
+            // as if heading to a 4x4 building at the goal
+            auto goalRect = DiscreteRect(q.goal.x, q.goal.y, 4, 4).expandTopLeft(footprint, footprint);
+            UnitPerimeterPathFinder finder(&workspace, &snapshot, &collisionService, UnitId(0), movementClassId, footprint, footprint, goalRect);
+            auto path = finder.findPath(q.start);
+            return BenchQueryResult{path.expandedVertexCount, path.type == AStarPathType::Partial};
+        }));
+
+        // what PathFindingService runs for a new move order,
+        // including hierarchical search for long distances
+        PathSearchContext context{&snapshot, &collisionService, &terrain, &hierarchicalGraphs};
+        printResult("searcher", footprint, runQueries(queries, [&](const BenchQuery& q) {
+            DiscreteRect start(q.start.x, q.start.y, footprint, footprint);
+            DiscreteRect goal(q.goal.x, q.goal.y, footprint, footprint);
+            auto startPosition = PathSearcher::getWorldCenter(terrain, start);
+            auto destination = PathSearcher::getWorldCenter(terrain, goal);
+            PathSearchJob job{UnitId(0), destination, startPosition, start, goal, movementClassId, PathSearchAlgorithm::JumpPoint};
+            auto result = searcher.search(context, job);
+            return BenchQueryResult{result.debugInfo.expandedVertexCount, result.debugInfo.type == AStarPathType::Partial};
+        }));
+    }
+
+    return 0;
+}
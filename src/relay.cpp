@@ -0,0 +1,46 @@
+#include <exception>
+#include <iostream>
+#include <rwe/game/RelayServer.h>
+#include <spdlog/spdlog.h>
+#include <string>
+
+/**
+ * Runs a relay server for a lockstep game,
+ * which peers started with --relay send their commands through
+ * in place of sending them to every other peer.
+ */
+int main(int argc, char* argv[])
+{
+    using namespace rwe;
+
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <port> <player count>" << std::endl;
+        return 1;
+    }
+
+    auto logger = spdlog::stdout_color_mt("rwe");
+    logger->set_level(spdlog::level::info);
+
+    try
+    {
+        auto port = std::stoi(argv[1]);
+        auto playerCount = std::stoul(argv[2]);
+        if (playerCount < 2 || playerCount > 10)
+        {
+            std::cerr << "Player count must be between 2 and 10" << std::endl;
+            return 1;
+        }
+
+        RelayServer relay(port, playerCount);
+        logger->info("Relaying for {} players on port {}", playerCount, port);
+        relay.run();
+    }
+    catch (const std::exception& e)
+    {
+        logger->error("Relay failed: {}", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <boost/interprocess/streams/bufferstream.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <rwe/LoadingScene_util.h>
+#include <rwe/PathMapping.h>
+#include <rwe/game/PlayerCommand_util.h>
+#include <rwe/game/Replay.h>
+#include <rwe/io/ota/ota.h>
+#include <rwe/io/sidedatatdf/SideData.h>
+#include <rwe/io/tdf/tdf.h>
+#include <rwe/io/tnt/TntArchive.h>
+#include <rwe/sim/GameSimulation.h>
+#include <rwe/vfs/CompositeVirtualFileSystem.h>
+#include <spdlog/sinks/null_sink.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rwe
+{
+    static std::string readTextFile(AbstractVirtualFileSystem& vfs, const std::string& path)
+    {
+        auto bytes = vfs.readFile(path);
+        if (!bytes)
+        {
+            throw std::runtime_error("Failed to read " + path);
+        }
+
+        return std::string(bytes->data(), bytes->size());
+    }
+
+    /**
+     * Sets up the simulation as LoadingScene does at the start of a game,
+     * loading only the definitions the simulation needs and no graphics or sounds.
+     */
+    static GameSimulation loadSimulation(AbstractVirtualFileSystem& vfs, const PathMapping& pathMapping, const ReplayHeader& header)
+    {
+        auto ota = parseOta(parseTdfFromString(readTextFile(vfs, "maps/" + header.mapName + ".ota")));
+        const auto& schema = ota.schemas.at(header.schemaIndex);
+
+        auto tntBytes = vfs.readFile("maps/" + header.mapName + ".tnt");
+        if (!tntBytes)
+        {
+            throw std::runtime_error("Failed to load map bytes");
+        }
+        boost::interprocess::bufferstream tntStream(tntBytes->data(), tntBytes->size());
+        TntArchive tnt(&tntStream);
+
+        Grid<TntTileAttributes> mapAttributes(tnt.getHeader().width, tnt.getHeader().height);
+        tnt.readMapAttributes(mapAttributes.getData());
+        MapTerrain terrain(getHeightGrid(mapAttributes), SimScalar(tnt.getHeader().seaLevel));
+
+        auto mapFeatures = getMapFeatures(tnt, mapAttributes, schema);
+
+        GameDefinitionsCallbacks callbacks;
+        callbacks.loadUnitModel = [&](const std::string& objectName) { return loadUnitModelDefinition(vfs, objectName); };
+        callbacks.loadProjectileModel = callbacks.loadUnitModel;
+        auto definitions = loadGameDefinitions(vfs, pathMapping, mapFeatures, callbacks);
+
+        auto simulation = createGameSimulation(
+            std::move(terrain),
+            static_cast<unsigned char>(schema.surfaceMetal),
+            ota.minWindSpeed,
+            ota.maxWindSpeed,
+            std::move(definitions),
+            loadCobScripts(vfs),
+            mapFeatures);
+
+        std::istringstream rngState(header.rngState);
+        rngState >> simulation.rng;
+        if (!rngState)
+        {
+            throw std::runtime_error("Replay has a malformed random number generator state");
+        }
+
+        simulation.pathFindingService.setWorkerThreadCount(std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1);
+
+        std::unordered_map<std::string, SideData> sides;
+        for (auto& side : parseSidesFromSideData(parseTdfFromString(readTextFile(vfs, pathMapping.gamedata + "/SIDEDATA.TDF"))))
+        {
+            std::string name = side.name;
+            sides.insert({std::move(name), std::move(side)});
+        }
+
+        std::vector<PlayerId> playerIds;
+        for (const auto& p : header.players)
+        {
+            auto playerType = p.computer ? GamePlayerType::Computer : GamePlayerType::Human;
+            playerIds.push_back(simulation.addPlayer(GamePlayerInfo{p.name, playerType, p.color, GamePlayerStatus::Alive, p.side, p.metal, p.energy, p.metal, p.energy, p.metal, p.energy}));
+        }
+
+        for (Index i = 0; i < getSize(header.players); ++i)
+        {
+            const auto& p = header.players[i];
+            auto it = sides.find(p.side);
+            if (it == sides.end())
+            {
+                throw std::runtime_error("Unknown side: " + p.side);
+            }
+
+            auto unitId = simulation.trySpawnUnit(it->second.commander, playerIds[i], getStartPosition(simulation.terrain, schema, p.slot), std::nullopt);
+            if (unitId)
+            {
+                auto& unit = simulation.getUnitState(*unitId);
+                unit.finishBuilding(simulation.unitDefinitions.at(unit.unitType));
+            }
+        }
+
+        return simulation;
+    }
+}
+
+/**
+ * Plays back a replay as fast as possible without rendering,
+ * checking that the simulation reproduces the recorded game hashes.
+ * Exits with a non-zero status if it does not.
+ * The time taken per tick makes this a benchmark of the simulation.
+ */
+int main(int argc, char* argv[])
+{
+    using namespace rwe;
+
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <replay file> <data path>..." << std::endl;
+        return 1;
+    }
+
+    spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+
+    auto replayStream = std::make_unique<std::ifstream>(argv[1], std::ios::binary);
+    if (!replayStream->is_open())
+    {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return 1;
+    }
+    ReplayReader reader(std::move(replayStream));
+    const auto& header = reader.getHeader();
+
+    CompositeVirtualFileSystem vfs;
+    for (int i = 2; i < argc; ++i)
+    {
+        addToVfs(vfs, argv[i]);
+    }
+
+    std::cout << "Loading " << header.mapName << " with " << header.players.size() << " players" << std::endl;
+    auto simulation = loadSimulation(vfs, constructDefaultPathMapping(), header);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration tickTime{0};
+    unsigned int hashesChecked = 0;
+
+    auto tick = [&]() {
+        auto start = Clock::now();
+        simulation.tick();
+        tickTime += Clock::now() - start;
+        simulation.events.clear();
+    };
+
+    SceneTime sceneTime(0);
+    while (auto replayTick = reader.readTick())
+    {
+        for (; sceneTime + SceneTime(1) < replayTick->sceneTime; sceneTime += SceneTime(1))
+        {
+            tick();
+        }
+        sceneTime = replayTick->sceneTime;
+
+        for (const auto& [_, playerCommands] : replayTick->commands)
+        {
+            for (const auto& command : playerCommands)
+            {
+                applyPlayerCommand(simulation, command);
+            }
+        }
+
+        tick();
+
+        if (replayTick->gameHash)
+        {
+            auto hash = simulation.computeHash();
+            if (hash != *replayTick->gameHash)
+            {
+                std::cout << "Desync at tick " << sceneTime.value << ": expected hash " << replayTick->gameHash->value << ", got " << hash.value << std::endl;
+                return 1;
+            }
+            ++hashesChecked;
+        }
+    }
+
+    auto seconds = std::chrono::duration<double>(tickTime).count();
+    std::cout << "Played " << sceneTime.value << " ticks in " << seconds << "s ("
+              << (seconds > 0.0 ? sceneTime.value / seconds : 0.0) << " ticks/s, "
+              << (sceneTime.value > 0 ? seconds * 1000000.0 / sceneTime.value : 0.0) << "us/tick)" << std::endl;
+    std::cout << "All " << hashesChecked << " recorded hashes matched" << std::endl;
+
+    return 0;
+}
@@ -34,6 +34,12 @@ namespace rwe
         loadingStatus = Status::Ready;
     }
 
+    void LoadingNetworkService::setUnitTypesChecksum(std::uint32_t checksum)
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        unitTypesChecksum = checksum;
+    }
+
     bool LoadingNetworkService::areAllClientsReady()
     {
         std::scoped_lock<std::mutex> lock(mutex);
@@ -47,6 +53,15 @@ namespace rwe
         {
             std::this_thread::sleep_for(std::chrono::milliseconds(200));
         } while (!areAllClientsReady());
+
+        std::scoped_lock<std::mutex> lock(mutex);
+        for (const auto& p : remoteEndpoints)
+        {
+            if (unitTypesChecksum && p.unitTypesChecksum && *p.unitTypesChecksum != *unitTypesChecksum)
+            {
+                throw std::runtime_error("Player " + std::to_string(p.playerIndex) + " has different unit data");
+            }
+        }
     }
 
     void LoadingNetworkService::start(const std::string& port)
@@ -119,6 +134,11 @@ namespace rwe
             return;
         }
 
+        if (message.loading_status().has_unit_types_checksum())
+        {
+            it->unitTypesChecksum = message.loading_status().unit_types_checksum();
+        }
+
         switch (message.loading_status().status())
         {
             case proto::LoadingStatusMessage_Status_Loading:
@@ -156,6 +176,11 @@ namespace rwe
                 default:
                     throw std::logic_error("Unhandled loading status");
             }
+
+            if (unitTypesChecksum)
+            {
+                innerMessage.set_unit_types_checksum(*unitTypesChecksum);
+            }
         }
 
         auto messageSize = outerMessage.ByteSize();
@@ -5,9 +5,11 @@
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp> // not in asio.hpp in old boost versions
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <network.pb.h>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -28,6 +30,7 @@ namespace rwe
             int playerIndex;
             boost::asio::ip::udp::endpoint endpoint;
             Status status;
+            std::optional<std::uint32_t> unitTypesChecksum;
             PlayerInfo(int playerIndex, const boost::asio::ip::udp::endpoint& endpoint, Status status) : playerIndex(playerIndex), endpoint(endpoint), status(status) {}
         };
 
@@ -37,6 +40,7 @@ namespace rwe
         // state shared between threads
         std::mutex mutex;
         Status loadingStatus{Status::Loading};
+        std::optional<std::uint32_t> unitTypesChecksum;
         std::vector<PlayerInfo> remoteEndpoints;
 
         // state owned by the worker thread
@@ -59,8 +63,15 @@ namespace rwe
 
         void setDoneLoading();
 
+        /** Sets the checksum of our UnitTypeTable, to be compared with those of our peers. */
+        void setUnitTypesChecksum(std::uint32_t checksum);
+
         bool areAllClientsReady();
 
+        /**
+         * Throws std::runtime_error if a peer's unit types differ from ours,
+         * since the peers could not then agree on what their commands mean.
+         */
         void waitForAllToBeReady();
 
         void start(const std::string& port);
@@ -1,23 +1,21 @@
 #include "LoadingScene.h"
+#include <algorithm>
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <rwe/LoadingScene_util.h>
 #include <rwe/atlas_util.h>
-#include <rwe/collections/SimpleVectorMap.h>
 #include <rwe/game/FeatureMediaInfo.h>
 #include <rwe/game/GameNetworkService.h>
 #include <rwe/game/MapTerrainGraphics.h>
+#include <rwe/game/Replay.h>
 #include <rwe/geometry/CollisionMesh.h>
-#include <rwe/io/fbi/io.h>
-#include <rwe/io/featuretdf/io.h>
-#include <rwe/io/moveinfotdf/MovementClassTdf.h>
-#include <rwe/io/moveinfotdf/io.h>
 #include <rwe/io/ota/ota.h>
 #include <rwe/io/tdf/tdf.h>
 #include <rwe/io/tnt/TntArchive.h>
-#include <rwe/io/weapontdf/WeaponTdf.h>
-#include <rwe/sim/FeatureDefinitionId.h>
+#include <rwe/proto/UnitTypeTable.h>
 #include <rwe/ui/UiLabel.h>
 #include <rwe/util/Index.h>
+#include <sstream>
+#include <thread>
 
 namespace rwe
 {
@@ -157,36 +155,36 @@ namespace rwe
         auto ota = parseOta(parseTdfFromString(otaStr));
 
         auto mapInfo = loadMap(mapName, ota, schemaIndex);
-        std::unordered_set<std::string> requiredFeatureNames;
-        for (const auto& f : mapInfo.features)
-        {
-            requiredFeatureNames.insert(f.second);
-        }
-
-        auto dataMaps = loadDefinitions(meshService, requiredFeatureNames);
-
-        auto movementClassCollisionService = createMovementClassCollisionService(mapInfo.terrain, dataMaps.movementClassDatabase);
 
-        GameSimulation simulation(std::move(mapInfo.terrain), mapInfo.surfaceMetal, std::max(0, mapInfo.minWindSpeed), std::min(mapInfo.maxWindSpeed, MaxUtilizableWindSpeed));
+        auto dataMaps = loadDefinitions(meshService, mapInfo.features);
 
-        simulation.unitDefinitions = std::move(dataMaps.unitDefinitions);
-        simulation.weaponDefinitions = std::move(dataMaps.weaponDefinitions);
-        simulation.movementClassDatabase = std::move(dataMaps.movementClassDatabase);
-        simulation.movementClassCollisionService = std::move(movementClassCollisionService);
-        simulation.unitModelDefinitions = dataMaps.modelDefinitions;
-        simulation.unitScriptDefinitions = loadCobScripts(*sceneContext.vfs);
-        simulation.featureDefinitions = std::move(dataMaps.featureDefinitions);
-        simulation.featureNameIndex = std::move(dataMaps.featureNameIndex);
+        auto simulation = createGameSimulation(
+            std::move(mapInfo.terrain),
+            mapInfo.surfaceMetal,
+            mapInfo.minWindSpeed,
+            mapInfo.maxWindSpeed,
+            std::move(dataMaps.definitions),
+            loadCobScripts(*sceneContext.vfs),
+            mapInfo.features);
 
-        for (const auto& [pos, featureName] : mapInfo.features)
+        std::vector<std::string> unitTypeNames;
+        for (const auto& entry : simulation.unitDefinitions)
         {
-            auto featureId = simulation.tryGetFeatureDefinitionId(featureName).value();
-            simulation.addFeature(featureId, pos.x, pos.y);
+            unitTypeNames.push_back(entry.first);
         }
+        UnitTypeTable unitTypes(std::move(unitTypeNames));
+        networkService.setUnitTypesChecksum(unitTypes.computeChecksum());
 
         auto seedSeq = seedFromGameParameters(gameParameters);
         simulation.rng.seed(seedSeq);
 
+        std::ostringstream rngState;
+        rngState << simulation.rng;
+        ReplayHeader replayHeader{mapName, schemaIndex, {}, rngState.str(), unitTypes.getNames()};
+
+        // Leave a core free for the game and render threads.
+        simulation.pathFindingService.setWorkerThreadCount(std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1);
+
         auto minimap = sceneContext.textureService->getMinimap(mapName);
 
         GameCameraState worldCameraState;
@@ -207,6 +205,7 @@ namespace rwe
                 GamePlayerInfo gpi{params->name, playerType, params->color, GamePlayerStatus::Alive, params->side, params->metal, params->energy, params->metal, params->energy, params->metal, params->energy};
                 auto playerId = simulation.addPlayer(gpi);
                 gamePlayers[i] = playerId;
+                replayHeader.players.push_back(ReplayPlayer{static_cast<unsigned int>(i), params->name, playerType == GamePlayerType::Computer, params->side, params->color, params->metal, params->energy});
                 playerCommandService->registerPlayer(playerId);
 
                 if (std::visit(IsHumanVisitor(), params->controller))
@@ -230,7 +229,17 @@ namespace rwe
             throw std::runtime_error("No local player!");
         }
 
-        auto gameNetworkService = std::make_unique<GameNetworkService>(*localPlayerId, std::stoi(gameParameters.localNetworkPort), endpointInfos, playerCommandService.get());
+        std::optional<boost::asio::ip::udp::endpoint> relayEndpoint;
+        if (gameParameters.relayAddress)
+        {
+            boost::asio::io_service ioContext;
+            boost::asio::ip::udp::resolver resolver(ioContext);
+
+            // boost guarantees that resolve returns non-empty
+            relayEndpoint = *resolver.resolve(boost::asio::ip::udp::resolver::query(gameParameters.relayAddress->first, gameParameters.relayAddress->second));
+        }
+
+        auto gameNetworkService = std::make_unique<GameNetworkService>(*localPlayerId, std::stoi(gameParameters.localNetworkPort), endpointInfos, relayEndpoint, unitTypes, playerCommandService.get());
 
         auto minimapDots = sceneContext.textureService->getGafEntry("anims/FX.GAF", "radlogo");
         if (minimapDots->sprites.size() != 10)
@@ -259,6 +268,17 @@ namespace rwe
             stateLogStream = std::ofstream(*gameParameters.stateLogFile, std::ios::binary);
         }
 
+        std::optional<ReplayWriter> replayWriter;
+        if (gameParameters.replayFile)
+        {
+            auto replayStream = std::make_unique<std::ofstream>(*gameParameters.replayFile, std::ios::binary);
+            if (!replayStream->is_open())
+            {
+                throw std::runtime_error("Failed to open replay file " + *gameParameters.replayFile);
+            }
+            replayWriter.emplace(std::move(replayStream), replayHeader);
+        }
+
         auto gameScene = std::make_unique<GameScene>(
             sceneContext,
             std::move(playerCommandService),
@@ -277,7 +297,9 @@ namespace rwe
             consoleFont,
             *localPlayerId,
             audioLookup,
-            std::move(stateLogStream));
+            std::move(stateLogStream),
+            std::move(replayWriter),
+            gameParameters.dumpStateOnDesync);
 
         const auto& schema = ota.schemas.at(schemaIndex);
 
@@ -291,18 +313,7 @@ namespace rwe
                 continue;
             }
 
-            std::string startPosKey("StartPos");
-            startPosKey.append(std::to_string(i + 1));
-
-            auto startPosIt = std::find_if(schema.specials.begin(), schema.specials.end(), [&startPosKey](const OtaSpecial& s) { return s.specialWhat == startPosKey; });
-            if (startPosIt == schema.specials.end())
-            {
-                throw std::runtime_error("Missing key from schema: " + startPosKey);
-            }
-            const auto& startPos = *startPosIt;
-
-            auto worldStartPos = gameScene->getTerrain().topLeftCoordinateToWorld(SimVector(SimScalar(startPos.xPos), 0_ss, SimScalar(startPos.zPos)));
-            worldStartPos.y = gameScene->getTerrain().getHeightAt(worldStartPos.x, worldStartPos.z);
+            auto worldStartPos = getStartPosition(gameScene->getTerrain(), schema, i);
 
             if (*gamePlayers[i] == *localPlayerId)
             {
@@ -354,26 +365,7 @@ namespace rwe
 
         const auto& schema = ota.schemas.at(schemaIndex);
 
-        auto featureNames = getFeatureNames(tnt);
-        std::vector<std::pair<Point, std::string>> features;
-
-        mapAttributes.forEachIndexed([&](auto c, const auto& e) {
-            switch (e.feature)
-            {
-                case TntTileAttributes::FeatureNone:
-                case TntTileAttributes::FeatureUnknown:
-                case TntTileAttributes::FeatureVoid:
-                    break;
-                default:
-                    features.emplace_back(Point(c.x, c.y), featureNames.at(e.feature));
-            }
-        });
-
-        // add features from the OTA schema
-        for (const auto& f : schema.features)
-        {
-            features.emplace_back(Point(f.xPos, f.zPos), f.featureName);
-        }
+        auto features = getMapFeatures(tnt, mapAttributes, schema);
 
         return LoadMapResult{std::move(terrain), static_cast<unsigned char>(schema.surfaceMetal), ota.minWindSpeed, ota.maxWindSpeed, std::move(features), std::move(terrainGraphics)};
     }
@@ -435,7 +427,7 @@ namespace rwe
         return it->second;
     }
 
-    void LoadingScene::loadFeatureMedia(MeshService& meshService, std::unordered_map<std::string, UnitModelDefinition>& modelDefinitions, GameMediaDatabase& gameMediaDatabase, const FeatureTdf& tdf)
+    void LoadingScene::loadFeatureMedia(GameMediaDatabase& gameMediaDatabase, const FeatureTdf& tdf)
     {
         FeatureMediaInfo f;
 
@@ -445,18 +437,8 @@ namespace rwe
 
         if (!tdf.object.empty())
         {
-            auto normalizedObjectName = toUpper(tdf.object);
-
-            if (modelDefinitions.find(normalizedObjectName) == modelDefinitions.end())
-            {
-                auto meshInfo = meshService.loadProjectileMesh(normalizedObjectName);
-                modelDefinitions.insert({normalizedObjectName, std::move(meshInfo.modelDefinition)});
-                for (const auto& m : meshInfo.pieceMeshes)
-                {
-                    gameMediaDatabase.addUnitPieceMesh(normalizedObjectName, m.first, m.second);
-                }
-            }
-            f.renderInfo = FeatureObjectInfo{normalizedObjectName};
+            // the model was loaded by loadGameDefinitions
+            f.renderInfo = FeatureObjectInfo{toUpper(tdf.object)};
         }
         else
         {
@@ -491,73 +473,7 @@ namespace rwe
         gameMediaDatabase.addFeature(std::move(f));
     }
 
-    void LoadingScene::loadFeature(MeshService& meshService, GameMediaDatabase& gameMediaDatabase, const std::unordered_map<std::string, FeatureTdf>& tdfs, DataMaps& dataMaps, const std::string& initialFeatureName)
-    {
-        auto nextId = dataMaps.featureDefinitions.getNextId();
-        std::unordered_map<std::string, FeatureDefinitionId> openSet{{toUpper(initialFeatureName), nextId}};
-        nextId = FeatureDefinitionId(nextId.value + 1);
-        for (std::deque<std::string> featuresToLoad{{initialFeatureName}}; !featuresToLoad.empty(); featuresToLoad.pop_front())
-        {
-            const auto& featureName = featuresToLoad.front();
-
-            const auto& tdf = tdfs.at(toUpper(featureName));
-
-            FeatureDefinition f;
-
-            f.name = featureName;
-
-            f.footprintX = tdf.footprintX;
-            f.footprintZ = tdf.footprintZ;
-            f.height = SimScalar(tdf.height);
-
-            f.reclaimable = tdf.reclaimable;
-            f.autoreclaimable = tdf.autoreclaimable;
-            if (!tdf.featureReclamate.empty())
-            {
-                f.featureReclamate = getFeatureId(nextId, dataMaps.featureNameIndex, featuresToLoad, openSet, tdf.featureReclamate);
-            }
-            f.metal = tdf.metal;
-            f.energy = tdf.energy;
-
-            f.flamable = tdf.flamable;
-            if (!tdf.featureBurnt.empty())
-            {
-                f.featureBurnt = getFeatureId(nextId, dataMaps.featureNameIndex, featuresToLoad, openSet, tdf.featureBurnt);
-            }
-            f.burnMin = tdf.burnMin;
-            f.burnMax = tdf.burnMax;
-            f.sparkTime = tdf.sparkTime;
-            f.spreadChance = tdf.spreadChance;
-            f.burnWeapon = tdf.burnWeapon;
-
-            f.geothermal = tdf.geothermal;
-
-            f.hitDensity = tdf.hitDensity;
-
-            f.reproduce = tdf.reproduce;
-            f.reproduceArea = tdf.reproduceArea;
-
-            f.noDisplayInfo = tdf.noDisplayInfo;
-
-            f.permanent = tdf.permanent;
-
-            f.blocking = tdf.blocking;
-
-            f.indestructible = tdf.indestructible;
-            f.damage = tdf.damage;
-            if (!tdf.featureDead.empty())
-            {
-                f.featureDead = getFeatureId(nextId, dataMaps.featureNameIndex, featuresToLoad, openSet, tdf.featureDead);
-            }
-
-            auto id = dataMaps.featureDefinitions.insert(f);
-            dataMaps.featureNameIndex.insert({toUpper(featureName), id});
-
-            loadFeatureMedia(meshService, dataMaps.modelDefinitions, gameMediaDatabase, tdf);
-        }
-    }
-
-    LoadingScene::DataMaps LoadingScene::loadDefinitions(MeshService& meshService, const std::unordered_set<std::string>& requiredFeatures)
+    LoadingScene::DataMaps LoadingScene::loadDefinitions(MeshService& meshService, const std::vector<std::pair<Point, std::string>>& mapFeatures)
     {
         DataMaps dataMaps;
 
@@ -600,160 +516,73 @@ namespace rwe
             }
         }
 
-        // read movement classes
-        {
-            auto path = sceneContext.pathMapping->gamedata + "/MOVEINFO.TDF";
-            auto bytes = sceneContext.vfs->readFile(path);
-            if (!bytes)
-            {
-                throw std::runtime_error("Failed to read " + path);
-            }
+        // Load the definitions, and the graphics and sounds that go with them.
+        GameDefinitionsCallbacks callbacks;
 
-            std::string movementString(bytes->data(), bytes->size());
-            auto classes = parseMoveInfoTdf(parseTdfFromString(movementString));
-            for (auto& c : classes)
+        callbacks.loadUnitModel = [&](const std::string& objectName) {
+            auto meshInfo = meshService.loadUnitMesh(objectName);
+            for (const auto& m : meshInfo.pieceMeshes)
             {
-                auto movementClassDefinition = parseMovementClassDefinition(c.second);
-                dataMaps.movementClassDatabase.registerMovementClass(movementClassDefinition);
+                dataMaps.gameMediaDatabase.addUnitPieceMesh(objectName, m.first, m.second);
             }
-        }
 
-        // read weapons
-        {
-            auto weaponFiles = sceneContext.vfs->getFileNames(sceneContext.pathMapping->weapons, ".tdf");
+            dataMaps.gameMediaDatabase.addSelectionCollisionMesh(objectName, std::make_shared<CollisionMesh>(std::move(meshInfo.selectionMesh.collisionMesh)));
+            dataMaps.gameMediaDatabase.addSelectionMesh(objectName, std::make_shared<GlMesh>(std::move(meshInfo.selectionMesh.visualMesh)));
 
-            for (const auto& fileName : weaponFiles)
-            {
-                auto bytes = sceneContext.vfs->readFile(sceneContext.pathMapping->weapons + "/" + fileName);
-                if (!bytes)
-                {
-                    throw std::runtime_error("File in listing could not be read: " + fileName);
-                }
+            return std::move(meshInfo.modelDefinition);
+        };
 
-                std::string tdfString(bytes->data(), bytes->size());
-                auto entries = parseWeaponTdf(parseTdfFromString(tdfString));
+        callbacks.loadProjectileModel = [&](const std::string& objectName) {
+            auto meshInfo = meshService.loadProjectileMesh(objectName);
+            for (const auto& m : meshInfo.pieceMeshes)
+            {
+                dataMaps.gameMediaDatabase.addUnitPieceMesh(objectName, m.first, m.second);
+            }
 
-                for (auto& pair : entries)
-                {
-                    auto weaponDefinition = parseWeaponDefinition(pair.second);
-                    auto weaponMediaInfo = parseWeaponMediaInfo(*sceneContext.palette, *sceneContext.guiPalette, pair.second);
+            return std::move(meshInfo.modelDefinition);
+        };
 
-                    preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundStart);
-                    preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundHit);
-                    preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundWater);
+        callbacks.onWeaponLoaded = [&](const std::string& weaponName, const WeaponTdf& tdf) {
+            auto weaponMediaInfo = parseWeaponMediaInfo(*sceneContext.palette, *sceneContext.guiPalette, tdf);
 
-                    if (auto modelRenderType = std::get_if<ProjectileRenderTypeModel>(&weaponMediaInfo.renderType); modelRenderType != nullptr)
-                    {
-                        auto meshInfo = meshService.loadProjectileMesh(modelRenderType->objectName);
-                        dataMaps.modelDefinitions.insert({modelRenderType->objectName, std::move(meshInfo.modelDefinition)});
-                        for (const auto& m : meshInfo.pieceMeshes)
-                        {
-                            dataMaps.gameMediaDatabase.addUnitPieceMesh(modelRenderType->objectName, m.first, m.second);
-                        }
-                    }
+            preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundStart);
+            preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundHit);
+            preloadSound(dataMaps.gameMediaDatabase, weaponMediaInfo.soundWater);
 
-                    if (weaponMediaInfo.explosionAnim)
-                    {
-                        auto anim = sceneContext.textureService->getGafEntry("anims/" + weaponMediaInfo.explosionAnim->gafName + ".gaf", weaponMediaInfo.explosionAnim->animName);
-                        dataMaps.gameMediaDatabase.addSpriteSeries(weaponMediaInfo.explosionAnim->gafName, weaponMediaInfo.explosionAnim->animName, anim);
-                    }
-                    if (weaponMediaInfo.waterExplosionAnim)
-                    {
-                        auto anim = sceneContext.textureService->getGafEntry("anims/" + weaponMediaInfo.waterExplosionAnim->gafName + ".gaf", weaponMediaInfo.waterExplosionAnim->animName);
-                        dataMaps.gameMediaDatabase.addSpriteSeries(weaponMediaInfo.waterExplosionAnim->gafName, weaponMediaInfo.waterExplosionAnim->animName, anim);
-                    }
-
-                    dataMaps.gameMediaDatabase.addWeapon(toUpper(pair.first), std::move(weaponMediaInfo));
-
-                    dataMaps.weaponDefinitions.insert({toUpper(pair.first), std::move(weaponDefinition)});
-                }
+            if (weaponMediaInfo.explosionAnim)
+            {
+                auto anim = sceneContext.textureService->getGafEntry("anims/" + weaponMediaInfo.explosionAnim->gafName + ".gaf", weaponMediaInfo.explosionAnim->animName);
+                dataMaps.gameMediaDatabase.addSpriteSeries(weaponMediaInfo.explosionAnim->gafName, weaponMediaInfo.explosionAnim->animName, anim);
             }
-        }
-
-        std::unordered_set<std::string> requiredFeaturesSet;
-        for (const auto& f : requiredFeatures)
-        {
-            requiredFeaturesSet.insert(toUpper(f));
-        }
-
-        // read unit FBIs
-        {
-            auto fbis = sceneContext.vfs->getFileNames(sceneContext.pathMapping->units, ".fbi");
-
-            for (const auto& fbiName : fbis)
+            if (weaponMediaInfo.waterExplosionAnim)
             {
-                auto bytes = sceneContext.vfs->readFile(sceneContext.pathMapping->units + "/" + fbiName);
-                if (!bytes)
-                {
-                    throw std::runtime_error("File in listing could not be read: " + fbiName);
-                }
-
-                std::string fbiString(bytes->data(), bytes->size());
-                auto fbi = parseUnitFbi(parseTdfFromString(fbiString));
-
-                auto unitDefinition = parseUnitDefinition(fbi, dataMaps.movementClassDatabase);
-                dataMaps.unitDefinitions.insert({toUpper(fbi.unitName), std::move(unitDefinition)});
-
-                // if it's a builder, also attempt to read its gui pages
-                if (fbi.builder)
-                {
-                    auto guiPages = loadBuilderGui(fbi.unitName);
-                    if (guiPages)
-                    {
-                        dataMaps.builderGuisDatabase.addBuilderGui(fbi.unitName, std::move(*guiPages));
-                    }
-
-                    // TODO: if no gui defined, attempt to build it dynamically?
-                    // Need a database of download.tdf mappings first...
-                }
-
-                auto meshInfo = meshService.loadUnitMesh(fbi.objectName);
-                dataMaps.modelDefinitions.insert({toUpper(fbi.objectName), std::move(meshInfo.modelDefinition)});
-                for (const auto& m : meshInfo.pieceMeshes)
-                {
-                    dataMaps.gameMediaDatabase.addUnitPieceMesh(fbi.objectName, m.first, m.second);
-                }
-
-                dataMaps.gameMediaDatabase.addSelectionCollisionMesh(fbi.objectName, std::make_shared<CollisionMesh>(std::move(meshInfo.selectionMesh.collisionMesh)));
-                dataMaps.gameMediaDatabase.addSelectionMesh(fbi.objectName, std::make_shared<GlMesh>(std::move(meshInfo.selectionMesh.visualMesh)));
-
-                if (!fbi.corpse.empty())
-                {
-                    requiredFeaturesSet.insert(toUpper(fbi.corpse));
-                }
+                auto anim = sceneContext.textureService->getGafEntry("anims/" + weaponMediaInfo.waterExplosionAnim->gafName + ".gaf", weaponMediaInfo.waterExplosionAnim->animName);
+                dataMaps.gameMediaDatabase.addSpriteSeries(weaponMediaInfo.waterExplosionAnim->gafName, weaponMediaInfo.waterExplosionAnim->animName, anim);
             }
-        }
-
-        // read feature TDFs
-        {
-            auto files = sceneContext.vfs->getFileNamesRecursive("features", ".tdf");
 
-            std::unordered_map<std::string, FeatureTdf> featureTdfs;
+            dataMaps.gameMediaDatabase.addWeapon(toUpper(weaponName), std::move(weaponMediaInfo));
+        };
 
-            for (const auto& name : files)
+        callbacks.onUnitLoaded = [&](const UnitFbi& fbi) {
+            // if it's a builder, also attempt to read its gui pages
+            if (fbi.builder)
             {
-                auto bytes = sceneContext.vfs->readFile("features/" + name);
-                if (!bytes)
+                auto guiPages = loadBuilderGui(fbi.unitName);
+                if (guiPages)
                 {
-                    throw std::runtime_error("Failed to read feature " + name);
+                    dataMaps.builderGuisDatabase.addBuilderGui(fbi.unitName, std::move(*guiPages));
                 }
 
-                std::string tdfString(bytes->data(), bytes->size());
-
-                auto tdfRoot = parseTdfFromString(tdfString);
-                for (const auto& e : tdfRoot.blocks)
-                {
-                    auto featureTdf = parseFeatureTdf(*e.second);
-                    featureTdfs.insert({toUpper(e.first), featureTdf});
-                }
+                // TODO: if no gui defined, attempt to build it dynamically?
+                // Need a database of download.tdf mappings first...
             }
+        };
 
-            // actually parse and load assets for features that we require
-            for (const auto& featureName : requiredFeaturesSet)
-            {
-                loadFeature(meshService, dataMaps.gameMediaDatabase, featureTdfs, dataMaps, featureName);
-            }
-        }
+        callbacks.onFeatureLoaded = [&](const FeatureTdf& tdf) {
+            loadFeatureMedia(dataMaps.gameMediaDatabase, tdf);
+        };
+
+        dataMaps.definitions = loadGameDefinitions(*sceneContext.vfs, *sceneContext.pathMapping, mapFeatures, callbacks);
 
         // preload smoke
         {
@@ -4,6 +4,7 @@
 #include <rwe/AudioService.h>
 #include <rwe/CursorService.h>
 #include <rwe/LoadingNetworkService.h>
+#include <rwe/LoadingScene_util.h>
 #include <rwe/SceneContext.h>
 #include <rwe/TextureService.h>
 #include <rwe/game/BuilderGuisDatabase.h>
@@ -82,6 +83,11 @@ namespace rwe
         std::array<std::optional<PlayerInfo>, 10> players;
         std::string localNetworkPort{"1337"};
         std::optional<std::string> stateLogFile;
+        std::optional<std::string> replayFile;
+        bool dumpStateOnDesync{false};
+
+        /** If given, the host and port of a relay server that all game traffic goes through. */
+        std::optional<std::pair<std::string, std::string>> relayAddress;
 
         GameParameters(const std::string& mapName, unsigned int schemaIndex);
     };
@@ -143,15 +149,10 @@ namespace rwe
         {
             BuilderGuisDatabase builderGuisDatabase;
             GameMediaDatabase gameMediaDatabase;
-            MovementClassDatabase movementClassDatabase;
-            std::unordered_map<std::string, UnitDefinition> unitDefinitions;
-            std::unordered_map<std::string, UnitModelDefinition> modelDefinitions;
-            std::unordered_map<std::string, WeaponDefinition> weaponDefinitions;
-            SimpleVectorMap<FeatureDefinition, FeatureDefinitionIdTag> featureDefinitions;
-            std::unordered_map<std::string, FeatureDefinitionId> featureNameIndex;
+            GameDefinitions definitions;
         };
 
-        DataMaps loadDefinitions(MeshService& meshService, const std::unordered_set<std::string>& requiredFeatures);
+        DataMaps loadDefinitions(MeshService& meshService, const std::vector<std::pair<Point, std::string>>& mapFeatures);
 
         void preloadSound(GameMediaDatabase& meshDb, const std::string& soundName);
 
@@ -161,7 +162,6 @@ namespace rwe
 
         std::optional<std::vector<std::vector<GuiEntry>>> loadBuilderGui(const std::string& unitName);
 
-        void loadFeature(MeshService& meshService, GameMediaDatabase& gameMediaDatabase, const std::unordered_map<std::string, FeatureTdf>& tdfs, DataMaps& dataMaps, const std::string& initialFeatureName);
-        void loadFeatureMedia(MeshService& meshService, std::unordered_map<std::string, UnitModelDefinition>& modelDefinitions, GameMediaDatabase& gameMediaDatabase, const FeatureTdf& tdf);
+        void loadFeatureMedia(GameMediaDatabase& gameMediaDatabase, const FeatureTdf& tdf);
     };
 }
@@ -1,7 +1,15 @@
 #include "LoadingScene_util.h"
 
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <rwe/io/_3do/_3do.h>
+#include <rwe/io/fbi/io.h>
+#include <rwe/io/featuretdf/io.h>
+#include <rwe/io/moveinfotdf/io.h>
+#include <rwe/io/tdf/tdf.h>
+#include <rwe/mesh_util.h>
 #include <rwe/sim/UnitState.h>
+#include <rwe/util/rwe_string.h>
+#include <rwe/vertex_height.h>
 
 namespace rwe
 {
@@ -498,4 +506,300 @@ namespace rwe
         nextId = FeatureDefinitionId(nextId.value + 1);
         return id;
     }
+
+    void loadFeatureDefinitions(
+        const std::unordered_map<std::string, FeatureTdf>& tdfs,
+        SimpleVectorMap<FeatureDefinition, FeatureDefinitionIdTag>& featureDefinitions,
+        std::unordered_map<std::string, FeatureDefinitionId>& featureNameIndex,
+        const std::string& initialFeatureName,
+        const std::function<void(const FeatureTdf&)>& onFeatureLoaded)
+    {
+        auto nextId = featureDefinitions.getNextId();
+        std::unordered_map<std::string, FeatureDefinitionId> openSet{{toUpper(initialFeatureName), nextId}};
+        nextId = FeatureDefinitionId(nextId.value + 1);
+        for (std::deque<std::string> featuresToLoad{{initialFeatureName}}; !featuresToLoad.empty(); featuresToLoad.pop_front())
+        {
+            const auto& featureName = featuresToLoad.front();
+
+            const auto& tdf = tdfs.at(toUpper(featureName));
+
+            FeatureDefinition f;
+
+            f.name = featureName;
+
+            f.footprintX = tdf.footprintX;
+            f.footprintZ = tdf.footprintZ;
+            f.height = SimScalar(tdf.height);
+
+            f.reclaimable = tdf.reclaimable;
+            f.autoreclaimable = tdf.autoreclaimable;
+            if (!tdf.featureReclamate.empty())
+            {
+                f.featureReclamate = getFeatureId(nextId, featureNameIndex, featuresToLoad, openSet, tdf.featureReclamate);
+            }
+            f.metal = tdf.metal;
+            f.energy = tdf.energy;
+
+            f.flamable = tdf.flamable;
+            if (!tdf.featureBurnt.empty())
+            {
+                f.featureBurnt = getFeatureId(nextId, featureNameIndex, featuresToLoad, openSet, tdf.featureBurnt);
+            }
+            f.burnMin = tdf.burnMin;
+            f.burnMax = tdf.burnMax;
+            f.sparkTime = tdf.sparkTime;
+            f.spreadChance = tdf.spreadChance;
+            f.burnWeapon = tdf.burnWeapon;
+
+            f.geothermal = tdf.geothermal;
+
+            f.hitDensity = tdf.hitDensity;
+
+            f.reproduce = tdf.reproduce;
+            f.reproduceArea = tdf.reproduceArea;
+
+            f.noDisplayInfo = tdf.noDisplayInfo;
+
+            f.permanent = tdf.permanent;
+
+            f.blocking = tdf.blocking;
+
+            f.indestructible = tdf.indestructible;
+            f.damage = tdf.damage;
+            if (!tdf.featureDead.empty())
+            {
+                f.featureDead = getFeatureId(nextId, featureNameIndex, featuresToLoad, openSet, tdf.featureDead);
+            }
+
+            auto id = featureDefinitions.insert(f);
+            featureNameIndex.insert({toUpper(featureName), id});
+
+            onFeatureLoaded(tdf);
+        }
+    }
+
+    SimVector getStartPosition(const MapTerrain& terrain, const OtaSchema& schema, unsigned int slot)
+    {
+        std::string startPosKey("StartPos");
+        startPosKey.append(std::to_string(slot + 1));
+
+        auto startPosIt = std::find_if(schema.specials.begin(), schema.specials.end(), [&startPosKey](const OtaSpecial& s) { return s.specialWhat == startPosKey; });
+        if (startPosIt == schema.specials.end())
+        {
+            throw std::runtime_error("Missing key from schema: " + startPosKey);
+        }
+        const auto& startPos = *startPosIt;
+
+        auto worldStartPos = terrain.topLeftCoordinateToWorld(SimVector(SimScalar(startPos.xPos), 0_ss, SimScalar(startPos.zPos)));
+        worldStartPos.y = terrain.getHeightAt(worldStartPos.x, worldStartPos.z);
+        return worldStartPos;
+    }
+
+    std::vector<std::pair<Point, std::string>> getMapFeatures(TntArchive& tnt, const Grid<TntTileAttributes>& mapAttributes, const OtaSchema& schema)
+    {
+        auto featureNames = getFeatureNames(tnt);
+        std::vector<std::pair<Point, std::string>> features;
+
+        mapAttributes.forEachIndexed([&](auto c, const auto& e) {
+            switch (e.feature)
+            {
+                case TntTileAttributes::FeatureNone:
+                case TntTileAttributes::FeatureUnknown:
+                case TntTileAttributes::FeatureVoid:
+                    break;
+                default:
+                    features.emplace_back(Point(c.x, c.y), featureNames.at(e.feature));
+            }
+        });
+
+        // add features from the OTA schema
+        for (const auto& f : schema.features)
+        {
+            features.emplace_back(Point(f.xPos, f.zPos), f.featureName);
+        }
+
+        return features;
+    }
+
+    std::optional<std::string> getProjectileObjectName(const WeaponTdf& tdf)
+    {
+        switch (tdf.renderType)
+        {
+            case 1:
+            case 3:
+            case 6:
+                if (tdf.model.empty())
+                {
+                    return std::nullopt;
+                }
+                return toUpper(tdf.model);
+            default:
+                return std::nullopt;
+        }
+    }
+
+    UnitModelDefinition loadUnitModelDefinition(AbstractVirtualFileSystem& vfs, const std::string& objectName)
+    {
+        auto bytes = vfs.readFile("objects3d/" + objectName + ".3do");
+        if (!bytes)
+        {
+            throw std::runtime_error("Failed to load object bytes: " + objectName);
+        }
+
+        boost::interprocess::bufferstream s(bytes->data(), bytes->size());
+        auto objects = parse3doObjects(s, s.tellg());
+        assert(objects.size() == 1);
+
+        return createUnitModelDefinition(
+            simScalarFromFixed(findHighestVertex(objects.front()).y),
+            unitMeshFrom3do(objects.front()));
+    }
+
+    static std::string readTextFile(AbstractVirtualFileSystem& vfs, const std::string& path)
+    {
+        auto bytes = vfs.readFile(path);
+        if (!bytes)
+        {
+            throw std::runtime_error("Failed to read " + path);
+        }
+
+        return std::string(bytes->data(), bytes->size());
+    }
+
+    GameDefinitions loadGameDefinitions(
+        AbstractVirtualFileSystem& vfs,
+        const PathMapping& pathMapping,
+        const std::vector<std::pair<Point, std::string>>& mapFeatures,
+        const GameDefinitionsCallbacks& callbacks)
+    {
+        GameDefinitions definitions;
+
+        // read movement classes
+        {
+            auto classes = parseMoveInfoTdf(parseTdfFromString(readTextFile(vfs, pathMapping.gamedata + "/MOVEINFO.TDF")));
+            for (auto& c : classes)
+            {
+                auto movementClassDefinition = parseMovementClassDefinition(c.second);
+                definitions.movementClassDatabase.registerMovementClass(movementClassDefinition);
+            }
+        }
+
+        // read weapons
+        for (const auto& fileName : vfs.getFileNames(pathMapping.weapons, ".tdf"))
+        {
+            auto entries = parseWeaponTdf(parseTdfFromString(readTextFile(vfs, pathMapping.weapons + "/" + fileName)));
+            for (auto& pair : entries)
+            {
+                if (auto objectName = getProjectileObjectName(pair.second); objectName && definitions.modelDefinitions.find(*objectName) == definitions.modelDefinitions.end())
+                {
+                    definitions.modelDefinitions.insert({*objectName, callbacks.loadProjectileModel(*objectName)});
+                }
+
+                if (callbacks.onWeaponLoaded)
+                {
+                    callbacks.onWeaponLoaded(pair.first, pair.second);
+                }
+
+                definitions.weaponDefinitions.insert({toUpper(pair.first), parseWeaponDefinition(pair.second)});
+            }
+        }
+
+        // Build the set in two steps so that the features are visited in the same order by every caller,
+        // since the order decides the features' IDs.
+        std::unordered_set<std::string> mapFeatureNames;
+        for (const auto& f : mapFeatures)
+        {
+            mapFeatureNames.insert(f.second);
+        }
+        std::unordered_set<std::string> requiredFeatures;
+        for (const auto& f : mapFeatureNames)
+        {
+            requiredFeatures.insert(toUpper(f));
+        }
+
+        // read unit FBIs
+        for (const auto& fbiName : vfs.getFileNames(pathMapping.units, ".fbi"))
+        {
+            auto fbi = parseUnitFbi(parseTdfFromString(readTextFile(vfs, pathMapping.units + "/" + fbiName)));
+
+            auto unitDefinition = parseUnitDefinition(fbi, definitions.movementClassDatabase);
+            definitions.unitDefinitions.insert({toUpper(fbi.unitName), std::move(unitDefinition)});
+
+            if (callbacks.onUnitLoaded)
+            {
+                callbacks.onUnitLoaded(fbi);
+            }
+
+            definitions.modelDefinitions.insert({toUpper(fbi.objectName), callbacks.loadUnitModel(fbi.objectName)});
+
+            if (!fbi.corpse.empty())
+            {
+                requiredFeatures.insert(toUpper(fbi.corpse));
+            }
+        }
+
+        // read feature TDFs
+        std::unordered_map<std::string, FeatureTdf> featureTdfs;
+        for (const auto& name : vfs.getFileNamesRecursive(pathMapping.features, ".tdf"))
+        {
+            auto tdfRoot = parseTdfFromString(readTextFile(vfs, pathMapping.features + "/" + name));
+            for (const auto& e : tdfRoot.blocks)
+            {
+                featureTdfs.insert({toUpper(e.first), parseFeatureTdf(*e.second)});
+            }
+        }
+
+        // load the features that we require
+        for (const auto& featureName : requiredFeatures)
+        {
+            loadFeatureDefinitions(featureTdfs, definitions.featureDefinitions, definitions.featureNameIndex, featureName, [&](const FeatureTdf& tdf) {
+                if (!tdf.object.empty())
+                {
+                    auto objectName = toUpper(tdf.object);
+                    if (definitions.modelDefinitions.find(objectName) == definitions.modelDefinitions.end())
+                    {
+                        definitions.modelDefinitions.insert({objectName, callbacks.loadProjectileModel(objectName)});
+                    }
+                }
+
+                if (callbacks.onFeatureLoaded)
+                {
+                    callbacks.onFeatureLoaded(tdf);
+                }
+            });
+        }
+
+        return definitions;
+    }
+
+    GameSimulation createGameSimulation(
+        MapTerrain&& terrain,
+        unsigned char surfaceMetal,
+        int minWindSpeed,
+        int maxWindSpeed,
+        GameDefinitions&& definitions,
+        std::unordered_map<std::string, CobScript>&& scripts,
+        const std::vector<std::pair<Point, std::string>>& mapFeatures)
+    {
+        auto movementClassCollisionService = createMovementClassCollisionService(terrain, definitions.movementClassDatabase);
+
+        GameSimulation simulation(std::move(terrain), surfaceMetal, std::max(0, minWindSpeed), std::min(maxWindSpeed, MaxUtilizableWindSpeed));
+
+        simulation.unitDefinitions = std::move(definitions.unitDefinitions);
+        simulation.weaponDefinitions = std::move(definitions.weaponDefinitions);
+        simulation.movementClassDatabase = std::move(definitions.movementClassDatabase);
+        simulation.movementClassCollisionService = std::move(movementClassCollisionService);
+        simulation.unitModelDefinitions = std::move(definitions.modelDefinitions);
+        simulation.unitScriptDefinitions = std::move(scripts);
+        simulation.featureDefinitions = std::move(definitions.featureDefinitions);
+        simulation.featureNameIndex = std::move(definitions.featureNameIndex);
+
+        for (const auto& [pos, featureName] : mapFeatures)
+        {
+            auto featureId = simulation.tryGetFeatureDefinitionId(featureName).value();
+            simulation.addFeature(featureId, pos.x, pos.y);
+        }
+
+        return simulation;
+    }
 }
@@ -1,21 +1,32 @@
 #pragma once
 
 #include <deque>
+#include <functional>
 #include <rwe/ColorPalette.h>
+#include <rwe/PathMapping.h>
+#include <rwe/collections/SimpleVectorMap.h>
 #include <rwe/game/WeaponMediaInfo.h>
+#include <rwe/grid/Point.h>
 #include <rwe/io/cob/Cob.h>
 #include <rwe/io/fbi/UnitFbi.h>
+#include <rwe/io/featuretdf/FeatureTdf.h>
 #include <rwe/io/moveinfotdf/MovementClassTdf.h>
+#include <rwe/io/ota/ota.h>
 #include <rwe/io/tnt/TntArchive.h>
 #include <rwe/io/weapontdf/WeaponTdf.h>
+#include <rwe/sim/FeatureDefinition.h>
 #include <rwe/sim/FeatureDefinitionId.h>
+#include <rwe/sim/GameSimulation.h>
 #include <rwe/sim/MapTerrain.h>
 #include <rwe/sim/MovementClassCollisionService.h>
 #include <rwe/sim/MovementClassDatabase.h>
+#include <rwe/sim/SimVector.h>
 #include <rwe/sim/UnitDefinition.h>
+#include <rwe/sim/UnitModelDefinition.h>
 #include <rwe/sim/WeaponDefinition.h>
 #include <rwe/vfs/AbstractVirtualFileSystem.h>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace rwe
 {
@@ -52,4 +63,82 @@ namespace rwe
     WeaponMediaInfo parseWeaponMediaInfo(const std::vector<Color>& palette, const std::vector<Color>& guiPalette, const WeaponTdf& tdf);
 
     FeatureDefinitionId getFeatureId(FeatureDefinitionId& nextId, const std::unordered_map<std::string, FeatureDefinitionId>& featureNameIndex, std::deque<std::string>& openQueue, std::unordered_map<std::string, FeatureDefinitionId>& openSet, const std::string& featureName);
+
+    /**
+     * Loads the definition of the named feature
+     * and of any features it can turn into that are not yet loaded,
+     * calling onFeatureLoaded with the TDF of each one.
+     */
+    void loadFeatureDefinitions(
+        const std::unordered_map<std::string, FeatureTdf>& tdfs,
+        SimpleVectorMap<FeatureDefinition, FeatureDefinitionIdTag>& featureDefinitions,
+        std::unordered_map<std::string, FeatureDefinitionId>& featureNameIndex,
+        const std::string& initialFeatureName,
+        const std::function<void(const FeatureTdf&)>& onFeatureLoaded);
+
+    /** Returns the world position at which the player in the given slot starts. */
+    SimVector getStartPosition(const MapTerrain& terrain, const OtaSchema& schema, unsigned int slot);
+
+    /**
+     * Returns the features placed on the map,
+     * first those in the TNT's tile attributes and then those in the OTA schema.
+     */
+    std::vector<std::pair<Point, std::string>> getMapFeatures(TntArchive& tnt, const Grid<TntTileAttributes>& mapAttributes, const OtaSchema& schema);
+
+    /** Returns the upper-case name of the 3DO object that the weapon's projectiles are drawn as, if any. */
+    std::optional<std::string> getProjectileObjectName(const WeaponTdf& tdf);
+
+    /** Loads the simulation's model of the named 3DO object, without creating any meshes. */
+    UnitModelDefinition loadUnitModelDefinition(AbstractVirtualFileSystem& vfs, const std::string& objectName);
+
+    /** The definitions that the simulation of a game is set up with. */
+    struct GameDefinitions
+    {
+        MovementClassDatabase movementClassDatabase;
+        std::unordered_map<std::string, UnitDefinition> unitDefinitions;
+        std::unordered_map<std::string, UnitModelDefinition> modelDefinitions;
+        std::unordered_map<std::string, WeaponDefinition> weaponDefinitions;
+        SimpleVectorMap<FeatureDefinition, FeatureDefinitionIdTag> featureDefinitions;
+        std::unordered_map<std::string, FeatureDefinitionId> featureNameIndex;
+    };
+
+    /**
+     * Callbacks through which loadGameDefinitions hands what it reads to the caller,
+     * so that the game can load graphics and sounds alongside the definitions.
+     * The model loaders are required, the rest may be left empty.
+     */
+    struct GameDefinitionsCallbacks
+    {
+        /** Loads the model of a unit's object. */
+        std::function<UnitModelDefinition(const std::string&)> loadUnitModel;
+
+        /** Loads the model of a projectile's or feature's object, which is loaded only once. */
+        std::function<UnitModelDefinition(const std::string&)> loadProjectileModel;
+
+        std::function<void(const std::string&, const WeaponTdf&)> onWeaponLoaded;
+        std::function<void(const UnitFbi&)> onUnitLoaded;
+        std::function<void(const FeatureTdf&)> onFeatureLoaded;
+    };
+
+    /**
+     * Loads the movement classes, weapons and units,
+     * and the features that are on the map or left behind by units.
+     * The game and headless replay both load through here
+     * so that the definitions, and the IDs given to features, are the same in each.
+     */
+    GameDefinitions loadGameDefinitions(
+        AbstractVirtualFileSystem& vfs,
+        const PathMapping& pathMapping,
+        const std::vector<std::pair<Point, std::string>>& mapFeatures,
+        const GameDefinitionsCallbacks& callbacks);
+
+    /** Creates the simulation of a game from its map and definitions and places the map's features. */
+    GameSimulation createGameSimulation(
+        MapTerrain&& terrain,
+        unsigned char surfaceMetal,
+        int minWindSpeed,
+        int maxWindSpeed,
+        GameDefinitions&& definitions,
+        std::unordered_map<std::string, CobScript>&& scripts,
+        const std::vector<std::pair<Point, std::string>>& mapFeatures);
 }
@@ -2,4 +2,29 @@
 
 namespace rwe
 {
+    PathMapping constructDefaultPathMapping()
+    {
+        PathMapping m;
+
+        m.ai = "ai";
+        m.anims = "anims";
+        m.bitmaps = "bitmaps";
+        m.camps = "camps";
+        m.downloads = "downloads";
+        m.features = "features";
+        m.fonts = "fonts";
+        m.gamedata = "gamedata";
+        m.guis = "guis";
+        m.maps = "maps";
+        m.objects3d = "objects3d";
+        m.palettes = "palettes";
+        m.scripts = "scripts";
+        m.sounds = "sounds";
+        m.textures = "textures";
+        m.unitpics = "unitpics";
+        m.units = "units";
+        m.weapons = "weapons";
+
+        return m;
+    }
 }
@@ -25,4 +25,7 @@ namespace rwe
         std::string units;
         std::string weapons;
     };
+
+    /** Returns the mapping to the directories that the original game uses. */
+    PathMapping constructDefaultPathMapping();
 }
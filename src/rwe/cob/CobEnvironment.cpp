@@ -1,10 +1,16 @@
 #include "CobEnvironment.h"
 #include <cassert>
+#include <rwe/cob/CobNativeScript.h>
 
 namespace rwe
 {
     CobEnvironment::CobEnvironment(const CobScript* script)
-        : _script(script), _statics(script->staticVariableCount)
+        : CobEnvironment(script, findNativeCobScript(*script))
+    {
+    }
+
+    CobEnvironment::CobEnvironment(const CobScript* script, const CobNativeScript* nativeScript)
+        : _script(script), nativeScript(nativeScript), _statics(script->staticVariableCount)
     {
     }
 
@@ -16,6 +22,17 @@ namespace rwe
     void CobEnvironment::setStatic(unsigned int id, int value)
     {
         _statics.at(id) = value;
+        ++staticsVersion;
+    }
+
+    unsigned int CobEnvironment::getStaticsVersion() const
+    {
+        return staticsVersion;
+    }
+
+    unsigned int CobEnvironment::getThreadsVersion() const
+    {
+        return threadsVersion;
     }
 
     const CobScript* CobEnvironment::script()
@@ -41,6 +58,9 @@ namespace rwe
         const auto& functionInfo = _script->functions.at(functionId);
         CobThread thread(functionInfo.name);
         thread.callStack.emplace(functionInfo.address, params);
+#ifdef RWE_COB_PROFILING
+        thread.callStack.top().functionId = functionId;
+#endif
         return thread;
     }
 
@@ -49,7 +69,11 @@ namespace rwe
         const auto& functionInfo = _script->functions.at(functionId);
         auto& thread = threads.emplace_back(std::make_unique<CobThread>(functionInfo.name, signalMask));
         thread->callStack.emplace(functionInfo.address, params);
+#ifdef RWE_COB_PROFILING
+        thread->callStack.top().functionId = functionId;
+#endif
         readyQueue.push_back(thread.get());
+        ++threadsVersion;
         return thread.get();
     }
 
@@ -82,6 +106,7 @@ namespace rwe
         if (it != threads.end())
         {
             threads.erase(it);
+            ++threadsVersion;
         }
     }
 
@@ -96,6 +121,7 @@ namespace rwe
 
                 // delete the thread
                 it = threads.erase(it);
+                ++threadsVersion;
             }
             else
             {
@@ -134,13 +160,7 @@ namespace rwe
             }
         }
 
-        {
-            auto it = std::find_if(sleepingQueue.begin(), sleepingQueue.end(), [thread](const auto& pair) { return pair.second == thread; });
-            if (it != sleepingQueue.end())
-            {
-                sleepingQueue.erase(it);
-            }
-        }
+        sleepingQueue.remove(thread);
 
         {
             auto it = std::find(finishedQueue.begin(), finishedQueue.end(), thread);
@@ -188,12 +208,9 @@ namespace rwe
             }
         }
 
+        if (sleepingQueue.contains(thread))
         {
-            auto it = std::find_if(sleepingQueue.begin(), sleepingQueue.end(), [thread](const auto& pair) { return pair.second == thread; });
-            if (it != sleepingQueue.end())
-            {
-                return true;
-            }
+            return true;
         }
 
         {
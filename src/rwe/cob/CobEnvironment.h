@@ -8,17 +8,22 @@
 #include <rwe/cob/CobPosition.h>
 #include <rwe/cob/CobSfxType.h>
 #include <rwe/cob/CobSleepDuration.h>
+#include <rwe/cob/CobSleepQueue.h>
 #include <rwe/cob/CobSpeed.h>
 #include <rwe/cob/CobThread.h>
 #include <rwe/cob/CobTime.h>
 #include <rwe/cob/CobUnitId.h>
 #include <rwe/io/cob/Cob.h>
+#include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 
 namespace rwe
 {
+    struct CobNativeScript;
+
     class CobEnvironment
     {
     public:
@@ -255,21 +260,60 @@ namespace rwe
 
         using Status = std::variant<SignalStatus, PieceCommandStatus, BlockedStatus, SleepStatus, QueryStatus, SetQueryStatus, FinishedStatus>;
 
+        /** The remembered result of a synchronous call to a query function. */
+        struct QueryCacheEntry
+        {
+            /** The simulation tick on which the query was run. */
+            unsigned int tick;
+
+            /** The statics version at the time the query was run. */
+            unsigned int staticsVersion;
+
+            /** The threads version at the time the query was run. */
+            unsigned int threadsVersion;
+
+            /** The query result, or nullopt if the script has no such function. */
+            std::optional<int> result;
+        };
+
     public:
         const CobScript* const _script;
 
+        /**
+         * The ahead-of-time compiled version of the script, if one is available.
+         * When present this is used instead of interpreting the script.
+         */
+        const CobNativeScript* const nativeScript;
+
         std::vector<int> _statics;
 
         std::vector<std::unique_ptr<CobThread>> threads;
 
         std::deque<CobThread*> readyQueue;
         std::deque<std::pair<BlockedStatus, CobThread*>> blockedQueue;
-        std::deque<std::pair<CobTime, CobThread*>> sleepingQueue;
+        CobSleepQueue sleepingQueue;
         std::deque<CobThread*> finishedQueue;
 
+        /**
+         * Results of query functions run synchronously by the engine,
+         * keyed by function name.
+         * An entry is only valid for the tick on which it was recorded
+         * and while the statics and threads versions are unchanged.
+         */
+        std::unordered_map<std::string, QueryCacheEntry> queryCache;
+
+    private:
+        /** Incremented whenever a static variable is written. */
+        unsigned int staticsVersion{0};
+
+        /** Incremented whenever a thread is created or killed. */
+        unsigned int threadsVersion{0};
+
     public:
         explicit CobEnvironment(const CobScript* _script);
 
+        CobEnvironment(const CobScript* _script, const CobNativeScript* nativeScript);
+
         CobEnvironment(const CobEnvironment& other) = delete;
         CobEnvironment& operator=(const CobEnvironment& other) = delete;
         CobEnvironment(CobEnvironment&& other) = delete;
@@ -280,6 +324,10 @@ namespace rwe
 
         void setStatic(unsigned int id, int value);
 
+        unsigned int getStaticsVersion() const;
+
+        unsigned int getThreadsVersion() const;
+
         const CobScript* script();
 
         std::optional<CobThread> createNonScheduledThread(const std::string& functionName, const std::vector<int>& params);
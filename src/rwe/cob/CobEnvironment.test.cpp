@@ -0,0 +1,38 @@
+#include <catch2/catch.hpp>
+#include <rwe/cob/CobEnvironment.h>
+#include <rwe/cob/CobOpCode.h>
+
+namespace rwe
+{
+    TEST_CASE("CobEnvironment")
+    {
+        CobScript script;
+        script.staticVariableCount = 1;
+        script.functions.push_back(CobFunctionInfo{"Idle", 0});
+        script.instructions = {static_cast<uint32_t>(OpCode::PUSH_CONSTANT), 0, static_cast<uint32_t>(OpCode::RETURN)};
+
+        CobEnvironment env(&script, nullptr);
+
+        SECTION("counts writes to statics")
+        {
+            auto version = env.getStaticsVersion();
+            env.setStatic(0, 5);
+            REQUIRE(env.getStaticsVersion() != version);
+        }
+
+        SECTION("counts thread changes even when the number of threads is the same")
+        {
+            env.createThread(0, {}, 1);
+            auto version = env.getThreadsVersion();
+
+            env.sendSignal(1);
+            env.createThread(0, {}, 0);
+
+            REQUIRE(env.threads.size() == 1);
+            REQUIRE(env.getThreadsVersion() == version + 2);
+
+            env.deleteThread(env.threads.front().get());
+            REQUIRE(env.getThreadsVersion() == version + 3);
+        }
+    }
+}
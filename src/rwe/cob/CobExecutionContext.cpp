@@ -1,127 +1,58 @@
 #include "CobExecutionContext.h"
-#include <random>
 #include <rwe/cob/CobConstants.h>
+#include <rwe/cob/CobNativeRuntime.h>
+#include <rwe/cob/CobNativeScript.h>
 #include <rwe/cob/CobOpCode.h>
-#include <rwe/cob/CobUnitId.h>
-#include <rwe/cob/cob_util.h>
 #include <stdexcept>
 #include <variant>
 
 namespace rwe
 {
-    std::variant<int, CobEnvironment::QueryStatus::Query> getValueInternal(CobValueId valueId, int arg1, int arg2, int /*arg3*/, int /*arg4*/)
+    CobExecutionContext::CobExecutionContext(CobEnvironment* env, CobThread* thread) : env(env), thread(thread)
     {
-        switch (valueId)
-        {
-            case CobValueId::Activation:
-                return CobEnvironment::QueryStatus::Activation{};
-            case CobValueId::StandingFireOrders:
-                return CobEnvironment::QueryStatus::StandingFireOrders{};
-            case CobValueId::StandingMoveOrders:
-                return CobEnvironment::QueryStatus::StandingMoveOrders{};
-            case CobValueId::Health:
-                return CobEnvironment::QueryStatus::Health{};
-            case CobValueId::InBuildStance:
-                return CobEnvironment::QueryStatus::InBuildStance{};
-            case CobValueId::Busy:
-                return CobEnvironment::QueryStatus::Busy{};
-            case CobValueId::PieceXZ:
-                return CobEnvironment::QueryStatus::PieceXZ{arg1};
-            case CobValueId::PieceY:
-                return CobEnvironment::QueryStatus::PieceY{arg1};
-            case CobValueId::UnitXZ:
-                return CobEnvironment::QueryStatus::UnitXZ{CobUnitId(arg1)};
-            case CobValueId::UnitY:
-                return CobEnvironment::QueryStatus::UnitY{CobUnitId(arg1)};
-            case CobValueId::UnitHeight:
-                return CobEnvironment::QueryStatus::UnitHeight{CobUnitId(arg1)};
-            case CobValueId::XZAtan:
-                return CobEnvironment::QueryStatus::XZAtan{arg1};
-            case CobValueId::XZHypot:
-            {
-                auto coords = arg1;
-                auto pair = cobUnpackCoords(coords);
-                auto result = cobHypot(pair.first, pair.second);
-                return result.value;
-            }
-            case CobValueId::Atan:
-            {
-                return cobAtan(arg1, arg2);
-            }
-            case CobValueId::Hypot:
-            {
-                auto a = CobPosition(arg1);
-                auto b = CobPosition(arg2);
-                auto result = cobHypot(a, b);
-                return result.value;
-            }
-            case CobValueId::GroundHeight:
-                return CobEnvironment::QueryStatus::GroundHeight{arg1};
-            case CobValueId::BuildPercentLeft:
-                return CobEnvironment::QueryStatus::BuildPercentLeft{};
-            case CobValueId::YardOpen:
-                return CobEnvironment::QueryStatus::YardOpen{};
-            case CobValueId::BuggerOff:
-                return CobEnvironment::QueryStatus::BuggerOff{};
-            case CobValueId::Armored:
-                return CobEnvironment::QueryStatus::Armored{};
-            case CobValueId::VeteranLevel:
-                return CobEnvironment::QueryStatus::VeteranLevel{};
-            case CobValueId::UnitIsOnThisComp:
-                // This concept is not supported in RWE.
-                // Simulation state cannot be allowed to diverge
-                // between one computer and another.
-                return true;
-            case CobValueId::MinId:
-                return CobEnvironment::QueryStatus::MinId{};
-            case CobValueId::MaxId:
-                return CobEnvironment::QueryStatus::MaxId{};
-            case CobValueId::MyId:
-                return CobEnvironment::QueryStatus::MyId{};
-            case CobValueId::UnitTeam:
-                return CobEnvironment::QueryStatus::UnitTeam{CobUnitId(arg1)};
-            case CobValueId::UnitBuildPercentLeft:
-                return CobEnvironment::QueryStatus::UnitBuildPercentLeft{CobUnitId(arg1)};
-            case CobValueId::UnitAllied:
-                return CobEnvironment::QueryStatus::UnitAllied{CobUnitId(arg1)};
-            default:
-                throw std::runtime_error("Unknown unit value ID: " + std::to_string(static_cast<unsigned int>(valueId)));
-        }
     }
 
-    CobEnvironment::SetQueryStatus::Query setGetter(CobValueId valueId, int value)
+#ifdef RWE_COB_PROFILING
+    CobExecutionContext::CobExecutionContext(CobEnvironment* env, CobThread* thread, CobProfiler* profiler) : env(env), thread(thread), profiler(profiler)
     {
-        switch (valueId)
-        {
-            case CobValueId::Activation:
-                return CobEnvironment::SetQueryStatus::Activation{value != 0};
-            case CobValueId::StandingMoveOrders:
-                return CobEnvironment::SetQueryStatus::StandingMoveOrders{value};
-            case CobValueId::StandingFireOrders:
-                return CobEnvironment::SetQueryStatus::StandingFireOrders{value};
-            case CobValueId::InBuildStance:
-                return CobEnvironment::SetQueryStatus::InBuildStance{value != 0};
-            case CobValueId::Busy:
-                return CobEnvironment::SetQueryStatus::Busy{value != 0};
-            case CobValueId::YardOpen:
-                return CobEnvironment::SetQueryStatus::YardOpen{value != 0};
-            case CobValueId::BuggerOff:
-                return CobEnvironment::SetQueryStatus::BuggerOff{value != 0};
-            case CobValueId::Armored:
-                return CobEnvironment::SetQueryStatus::Armored{value != 0};
-            default:
-                throw std::runtime_error("Cannot set unit value with ID: " + std::to_string(static_cast<unsigned int>(valueId)));
-        }
     }
+#endif
 
-    CobExecutionContext::CobExecutionContext(CobEnvironment* env, CobThread* thread) : env(env), thread(thread)
+    CobEnvironment::Status CobExecutionContext::execute()
     {
+#ifdef RWE_COB_PROFILING
+        if (profiler != nullptr)
+        {
+            CobFrameTimer timer(profiler, env->script(), thread, env->nativeScript != nullptr);
+            auto status = executeInternal();
+            timer.finish(std::holds_alternative<CobEnvironment::PieceCommandStatus>(status));
+            return status;
+        }
+#endif
+
+        return executeInternal();
     }
 
-    CobEnvironment::Status CobExecutionContext::execute()
+    CobEnvironment::Status CobExecutionContext::executeInternal()
     {
+        if (env->nativeScript != nullptr)
+        {
+            if (auto status = env->nativeScript->execute(*env, *thread))
+            {
+                return *status;
+            }
+
+            // The native code bailed out, the interpreter picks up from where it stopped.
+        }
+
         while (!thread->callStack.empty())
         {
+#ifdef RWE_COB_PROFILING
+            if (thread->frameTimer != nullptr)
+            {
+                thread->frameTimer->countInstruction();
+            }
+#endif
             auto instruction = nextInstruction();
             switch (static_cast<OpCode>(instruction))
             {
@@ -360,12 +291,10 @@ namespace rwe
                 case OpCode::GET_VALUE:
                 {
                     auto valueId = popValueId();
-                    auto value = getValueInternal(valueId, 0, 0, 0, 0);
-                    if (auto v = std::get_if<CobEnvironment::QueryStatus::Query>(&value); v != nullptr)
+                    if (auto status = cobGetValue(*thread, valueId, 0, 0, 0, 0))
                     {
-                        return CobEnvironment::QueryStatus{*v};
+                        return *status;
                     }
-                    push(std::get<int>(value));
                     break;
                 }
                 case OpCode::GET_VALUE_WITH_ARGS:
@@ -375,12 +304,10 @@ namespace rwe
                     auto arg2 = pop();
                     auto arg1 = pop();
                     auto valueId = popValueId();
-                    auto value = getValueInternal(valueId, arg1, arg2, arg3, arg4);
-                    if (auto v = std::get_if<CobEnvironment::QueryStatus::Query>(&value); v != nullptr)
+                    if (auto status = cobGetValue(*thread, valueId, arg1, arg2, arg3, arg4))
                     {
-                        return CobEnvironment::QueryStatus{*v};
+                        return *status;
                     }
-                    push(std::get<int>(value));
                     break;
                 }
                 case OpCode::SET_VALUE:
@@ -571,39 +498,21 @@ namespace rwe
 
     void CobExecutionContext::returnFromScript()
     {
-        thread->returnValue = pop();
-        thread->returnLocals = thread->callStack.top().locals;
-        thread->callStack.pop();
+        cobReturnFromScript(*thread);
     }
 
     void CobExecutionContext::callScript()
     {
         auto functionId = nextInstruction();
         auto paramCount = nextInstruction();
-
-        // collect up the parameters
-        std::vector<int> params(paramCount);
-        for (unsigned int i = 0; i < paramCount; ++i)
-        {
-            params[i] = pop();
-        }
-
-        const auto& functionInfo = env->script()->functions.at(functionId);
-        thread->callStack.emplace(functionInfo.address, params);
+        cobCallScript(*env, *thread, functionId, paramCount);
     }
 
     void CobExecutionContext::startScript()
     {
         auto functionId = nextInstruction();
         auto paramCount = nextInstruction();
-
-        std::vector<int> params(paramCount);
-        for (unsigned int i = 0; i < paramCount; ++i)
-        {
-            params[i] = pop();
-        }
-
-        env->createThread(functionId, params, thread->signalMask);
+        cobStartScript(*env, *thread, functionId, paramCount);
     }
 
     void CobExecutionContext::sendSignal()
@@ -620,11 +529,7 @@ namespace rwe
 
     void CobExecutionContext::createLocalVariable()
     {
-        if (thread->callStack.top().localCount == thread->callStack.top().locals.size())
-        {
-            thread->callStack.top().locals.emplace_back();
-        }
-        thread->callStack.top().localCount += 1;
+        cobCreateLocalVariable(*thread);
     }
 
     void CobExecutionContext::pushConstant()
@@ -673,16 +578,7 @@ namespace rwe
 
     int CobExecutionContext::pop()
     {
-        // Malformed scripts may attempt to pop when the stack is empty.
-        // For example see Github issue #56.
-        if (thread->stack.empty())
-        {
-            return 0;
-        }
-
-        auto v = thread->stack.top();
-        thread->stack.pop();
-        return v;
+        return cobPop(*thread);
     }
 
     CobSleepDuration CobExecutionContext::popSleepDuration()
@@ -732,7 +628,7 @@ namespace rwe
 
     void CobExecutionContext::push(int val)
     {
-        thread->stack.push(val);
+        cobPush(*thread, val);
     }
 
     CobAxis CobExecutionContext::nextInstructionAsAxis()
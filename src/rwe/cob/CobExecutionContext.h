@@ -3,6 +3,7 @@
 #include <rwe/cob/CobAngularSpeed.h>
 #include <rwe/cob/CobEnvironment.h>
 #include <rwe/cob/CobPosition.h>
+#include <rwe/cob/CobProfiler.h>
 #include <rwe/cob/CobSfxType.h>
 #include <rwe/cob/CobSleepDuration.h>
 #include <rwe/cob/CobSpeed.h>
@@ -16,12 +17,23 @@ namespace rwe
         CobEnvironment* const env;
         CobThread* const thread;
 
+#ifdef RWE_COB_PROFILING
+        /** Receives execution statistics. May be null, in which case nothing is recorded. */
+        CobProfiler* const profiler{nullptr};
+#endif
+
     public:
         CobExecutionContext(CobEnvironment* env, CobThread* thread);
 
+#ifdef RWE_COB_PROFILING
+        CobExecutionContext(CobEnvironment* env, CobThread* thread, CobProfiler* profiler);
+#endif
+
         CobEnvironment::Status execute();
 
     private:
+        CobEnvironment::Status executeInternal();
+
         // arithmetic
         void add();
 
@@ -11,6 +11,11 @@ namespace rwe
         std::vector<int> locals;
         unsigned int localCount{0};
 
+#ifdef RWE_COB_PROFILING
+        /** The index in the script's function list of the function this frame is running. */
+        unsigned int functionId{0};
+#endif
+
     public:
         CobFunction(unsigned int instructionIndex, const std::vector<int>& locals);
 
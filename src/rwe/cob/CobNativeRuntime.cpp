@@ -0,0 +1,180 @@
+#include "CobNativeRuntime.h"
+#include <rwe/cob/CobProfiler.h>
+#include <rwe/cob/CobUnitId.h>
+#include <rwe/cob/cob_util.h>
+#include <stdexcept>
+#include <string>
+
+namespace rwe
+{
+    std::variant<int, CobEnvironment::QueryStatus::Query> getValueInternal(CobValueId valueId, int arg1, int arg2, int /*arg3*/, int /*arg4*/)
+    {
+        switch (valueId)
+        {
+            case CobValueId::Activation:
+                return CobEnvironment::QueryStatus::Activation{};
+            case CobValueId::StandingFireOrders:
+                return CobEnvironment::QueryStatus::StandingFireOrders{};
+            case CobValueId::StandingMoveOrders:
+                return CobEnvironment::QueryStatus::StandingMoveOrders{};
+            case CobValueId::Health:
+                return CobEnvironment::QueryStatus::Health{};
+            case CobValueId::InBuildStance:
+                return CobEnvironment::QueryStatus::InBuildStance{};
+            case CobValueId::Busy:
+                return CobEnvironment::QueryStatus::Busy{};
+            case CobValueId::PieceXZ:
+                return CobEnvironment::QueryStatus::PieceXZ{arg1};
+            case CobValueId::PieceY:
+                return CobEnvironment::QueryStatus::PieceY{arg1};
+            case CobValueId::UnitXZ:
+                return CobEnvironment::QueryStatus::UnitXZ{CobUnitId(arg1)};
+            case CobValueId::UnitY:
+                return CobEnvironment::QueryStatus::UnitY{CobUnitId(arg1)};
+            case CobValueId::UnitHeight:
+                return CobEnvironment::QueryStatus::UnitHeight{CobUnitId(arg1)};
+            case CobValueId::XZAtan:
+                return CobEnvironment::QueryStatus::XZAtan{arg1};
+            case CobValueId::XZHypot:
+            {
+                auto coords = arg1;
+                auto pair = cobUnpackCoords(coords);
+                auto result = cobHypot(pair.first, pair.second);
+                return result.value;
+            }
+            case CobValueId::Atan:
+            {
+                return cobAtan(arg1, arg2);
+            }
+            case CobValueId::Hypot:
+            {
+                auto a = CobPosition(arg1);
+                auto b = CobPosition(arg2);
+                auto result = cobHypot(a, b);
+                return result.value;
+            }
+            case CobValueId::GroundHeight:
+                return CobEnvironment::QueryStatus::GroundHeight{arg1};
+            case CobValueId::BuildPercentLeft:
+                return CobEnvironment::QueryStatus::BuildPercentLeft{};
+            case CobValueId::YardOpen:
+                return CobEnvironment::QueryStatus::YardOpen{};
+            case CobValueId::BuggerOff:
+                return CobEnvironment::QueryStatus::BuggerOff{};
+            case CobValueId::Armored:
+                return CobEnvironment::QueryStatus::Armored{};
+            case CobValueId::VeteranLevel:
+                return CobEnvironment::QueryStatus::VeteranLevel{};
+            case CobValueId::UnitIsOnThisComp:
+                // This concept is not supported in RWE.
+                // Simulation state cannot be allowed to diverge
+                // between one computer and another.
+                return true;
+            case CobValueId::MinId:
+                return CobEnvironment::QueryStatus::MinId{};
+            case CobValueId::MaxId:
+                return CobEnvironment::QueryStatus::MaxId{};
+            case CobValueId::MyId:
+                return CobEnvironment::QueryStatus::MyId{};
+            case CobValueId::UnitTeam:
+                return CobEnvironment::QueryStatus::UnitTeam{CobUnitId(arg1)};
+            case CobValueId::UnitBuildPercentLeft:
+                return CobEnvironment::QueryStatus::UnitBuildPercentLeft{CobUnitId(arg1)};
+            case CobValueId::UnitAllied:
+                return CobEnvironment::QueryStatus::UnitAllied{CobUnitId(arg1)};
+            default:
+                throw std::runtime_error("Unknown unit value ID: " + std::to_string(static_cast<unsigned int>(valueId)));
+        }
+    }
+
+    CobEnvironment::SetQueryStatus::Query setGetter(CobValueId valueId, int value)
+    {
+        switch (valueId)
+        {
+            case CobValueId::Activation:
+                return CobEnvironment::SetQueryStatus::Activation{value != 0};
+            case CobValueId::StandingMoveOrders:
+                return CobEnvironment::SetQueryStatus::StandingMoveOrders{value};
+            case CobValueId::StandingFireOrders:
+                return CobEnvironment::SetQueryStatus::StandingFireOrders{value};
+            case CobValueId::InBuildStance:
+                return CobEnvironment::SetQueryStatus::InBuildStance{value != 0};
+            case CobValueId::Busy:
+                return CobEnvironment::SetQueryStatus::Busy{value != 0};
+            case CobValueId::YardOpen:
+                return CobEnvironment::SetQueryStatus::YardOpen{value != 0};
+            case CobValueId::BuggerOff:
+                return CobEnvironment::SetQueryStatus::BuggerOff{value != 0};
+            case CobValueId::Armored:
+                return CobEnvironment::SetQueryStatus::Armored{value != 0};
+            default:
+                throw std::runtime_error("Cannot set unit value with ID: " + std::to_string(static_cast<unsigned int>(valueId)));
+        }
+    }
+
+    std::optional<CobEnvironment::Status> cobGetValue(CobThread& thread, CobValueId valueId, int arg1, int arg2, int arg3, int arg4)
+    {
+        auto value = getValueInternal(valueId, arg1, arg2, arg3, arg4);
+        if (auto v = std::get_if<CobEnvironment::QueryStatus::Query>(&value); v != nullptr)
+        {
+            return CobEnvironment::QueryStatus{*v};
+        }
+        cobPush(thread, std::get<int>(value));
+        return std::nullopt;
+    }
+
+    void cobCallScript(CobEnvironment& env, CobThread& thread, unsigned int functionId, unsigned int paramCount)
+    {
+        // collect up the parameters
+        std::vector<int> params(paramCount);
+        for (unsigned int i = 0; i < paramCount; ++i)
+        {
+            params[i] = cobPop(thread);
+        }
+
+        const auto& functionInfo = env.script()->functions.at(functionId);
+#ifdef RWE_COB_PROFILING
+        if (thread.frameTimer != nullptr)
+        {
+            thread.frameTimer->switchFrame();
+        }
+#endif
+        thread.callStack.emplace(functionInfo.address, params);
+#ifdef RWE_COB_PROFILING
+        thread.callStack.top().functionId = functionId;
+#endif
+    }
+
+    void cobStartScript(CobEnvironment& env, CobThread& thread, unsigned int functionId, unsigned int paramCount)
+    {
+        std::vector<int> params(paramCount);
+        for (unsigned int i = 0; i < paramCount; ++i)
+        {
+            params[i] = cobPop(thread);
+        }
+
+        env.createThread(functionId, params, thread.signalMask);
+    }
+
+    void cobReturnFromScript(CobThread& thread)
+    {
+        thread.returnValue = cobPop(thread);
+        thread.returnLocals = thread.callStack.top().locals;
+#ifdef RWE_COB_PROFILING
+        if (thread.frameTimer != nullptr)
+        {
+            thread.frameTimer->switchFrame();
+        }
+#endif
+        thread.callStack.pop();
+    }
+
+    void cobCreateLocalVariable(CobThread& thread)
+    {
+        if (thread.callStack.top().localCount == thread.callStack.top().locals.size())
+        {
+            thread.callStack.top().locals.emplace_back();
+        }
+        thread.callStack.top().localCount += 1;
+    }
+}
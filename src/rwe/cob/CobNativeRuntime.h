@@ -0,0 +1,55 @@
+#pragma once
+
+#include <optional>
+#include <rwe/cob/CobEnvironment.h>
+#include <rwe/cob/CobThread.h>
+#include <rwe/cob/CobValueId.h>
+#include <variant>
+
+namespace rwe
+{
+    /*
+     * Operations shared by the COB interpreter (CobExecutionContext)
+     * and by scripts transpiled to C++ by cob_transpile.
+     * Keeping a single implementation of each operation
+     * guarantees that both execution paths behave identically.
+     */
+
+    inline int cobPop(CobThread& thread)
+    {
+        // Malformed scripts may attempt to pop when the stack is empty.
+        // For example see Github issue #56.
+        if (thread.stack.empty())
+        {
+            return 0;
+        }
+
+        auto v = thread.stack.top();
+        thread.stack.pop();
+        return v;
+    }
+
+    inline void cobPush(CobThread& thread, int val)
+    {
+        thread.stack.push(val);
+    }
+
+    std::variant<int, CobEnvironment::QueryStatus::Query> getValueInternal(CobValueId valueId, int arg1, int arg2, int arg3, int arg4);
+
+    CobEnvironment::SetQueryStatus::Query setGetter(CobValueId valueId, int value);
+
+    /**
+     * Evaluates a get-value instruction.
+     * If the value can be computed locally it is pushed onto the thread's stack,
+     * otherwise the query that the engine must answer is returned.
+     */
+    std::optional<CobEnvironment::Status> cobGetValue(CobThread& thread, CobValueId valueId, int arg1, int arg2, int arg3, int arg4);
+
+    void cobCallScript(CobEnvironment& env, CobThread& thread, unsigned int functionId, unsigned int paramCount);
+
+    void cobStartScript(CobEnvironment& env, CobThread& thread, unsigned int functionId, unsigned int paramCount);
+
+    void cobReturnFromScript(CobThread& thread);
+
+    void cobCreateLocalVariable(CobThread& thread);
+}
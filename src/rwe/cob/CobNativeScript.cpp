@@ -0,0 +1,38 @@
+#include "CobNativeScript.h"
+#include <unordered_map>
+
+namespace rwe
+{
+    static std::unordered_multimap<std::uint64_t, const CobNativeScript*>& getNativeCobScriptRegistry()
+    {
+        // Function-local so that it is constructed before
+        // any registration runs during static initialization.
+        static std::unordered_multimap<std::uint64_t, const CobNativeScript*> registry;
+        return registry;
+    }
+
+    CobNativeScriptRegistration::CobNativeScriptRegistration(const CobNativeScript* script)
+    {
+        getNativeCobScriptRegistry().emplace(script->contentHash, script);
+    }
+
+    const CobNativeScript* findNativeCobScript(const CobScript& script)
+    {
+        const auto& registry = getNativeCobScriptRegistry();
+        if (registry.empty())
+        {
+            return nullptr;
+        }
+
+        auto range = registry.equal_range(script.contentHash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second->instructionCount == script.instructions.size())
+            {
+                return it->second;
+            }
+        }
+
+        return nullptr;
+    }
+}
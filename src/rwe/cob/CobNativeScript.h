@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <rwe/cob/CobEnvironment.h>
+#include <rwe/cob/CobThread.h>
+#include <rwe/io/cob/Cob.h>
+
+namespace rwe
+{
+    /**
+     * A COB script that has been ahead-of-time translated to C++ by cob_transpile.
+     *
+     * The execute function runs the given thread until it yields,
+     * exactly as CobExecutionContext::execute would.
+     * It returns nothing if it reached code that it cannot run natively,
+     * in which case the thread state has been left at that instruction
+     * for the interpreter to continue from.
+     */
+    struct CobNativeScript
+    {
+        using ExecuteFunction = std::optional<CobEnvironment::Status> (*)(CobEnvironment& env, CobThread& thread);
+
+        /** Hash of the contents of the script this was generated from, see computeCobScriptHash. */
+        std::uint64_t contentHash;
+
+        /**
+         * The number of instructions in the script this was generated from.
+         * Checked as well as the hash, so that a hash collision
+         * does not run the wrong native code.
+         */
+        std::size_t instructionCount;
+
+        const char* name;
+        ExecuteFunction execute;
+    };
+
+    /**
+     * Registers a native script during static initialization.
+     * Each file generated by cob_transpile defines one of these.
+     */
+    class CobNativeScriptRegistration
+    {
+    public:
+        explicit CobNativeScriptRegistration(const CobNativeScript* script);
+    };
+
+    /**
+     * Returns the native implementation of the given script,
+     * if one was compiled in whose content hash and instruction count match the script's.
+     */
+    const CobNativeScript* findNativeCobScript(const CobScript& script);
+}
@@ -0,0 +1,91 @@
+#include "CobProfiler.h"
+#include <algorithm>
+#include <rwe/cob/CobThread.h>
+
+namespace rwe
+{
+    void CobProfiler::record(const CobScript* script, const std::string& functionName, bool native, unsigned int instructions, bool issuedPieceCommand, Clock::duration time)
+    {
+        auto& s = stats[std::make_tuple(script, functionName, native)];
+        s.executions += 1;
+        s.instructions += instructions;
+        if (issuedPieceCommand)
+        {
+            s.pieceCommands += 1;
+        }
+        s.time += time;
+    }
+
+    void CobProfiler::reset()
+    {
+        stats.clear();
+    }
+
+    std::vector<CobProfiler::Entry> CobProfiler::getEntriesByTime() const
+    {
+        std::vector<Entry> entries;
+        entries.reserve(stats.size());
+        for (const auto& [key, value] : stats)
+        {
+            entries.push_back(Entry{std::get<0>(key), &std::get<1>(key), std::get<2>(key), &value});
+        }
+
+        std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.stats->time > b.stats->time;
+        });
+
+        return entries;
+    }
+
+    void CobProfiler::writeCsv(std::ostream& os, const ScriptNameLookup& scriptName) const
+    {
+        os << "script,function,native,executions,instructions,piece_commands,time_us\n";
+        for (const auto& entry : getEntriesByTime())
+        {
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(entry.stats->time).count();
+            os << scriptName(entry.script) << ','
+               << *entry.functionName << ','
+               << (entry.native ? 1 : 0) << ','
+               << entry.stats->executions << ','
+               << entry.stats->instructions << ','
+               << entry.stats->pieceCommands << ','
+               << micros << '\n';
+        }
+    }
+
+#ifdef RWE_COB_PROFILING
+    CobFrameTimer::CobFrameTimer(CobProfiler* profiler, const CobScript* script, CobThread* thread, bool native)
+        : profiler(profiler), script(script), thread(thread), native(native), stretchStart(CobProfiler::Clock::now())
+    {
+        thread->frameTimer = this;
+    }
+
+    CobFrameTimer::~CobFrameTimer()
+    {
+        thread->frameTimer = nullptr;
+    }
+
+    void CobFrameTimer::switchFrame()
+    {
+        recordStretch(false);
+    }
+
+    void CobFrameTimer::finish(bool issuedPieceCommand)
+    {
+        recordStretch(issuedPieceCommand);
+    }
+
+    void CobFrameTimer::recordStretch(bool issuedPieceCommand)
+    {
+        auto now = CobProfiler::Clock::now();
+        if (!thread->callStack.empty())
+        {
+            const auto& functionName = script->functions.at(thread->callStack.top().functionId).name;
+            profiler->record(script, functionName, native, stretchInstructions, issuedPieceCommand, now - stretchStart);
+        }
+
+        stretchStart = now;
+        stretchInstructions = 0;
+    }
+#endif
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <rwe/io/cob/Cob.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Accumulates execution statistics for COB script functions,
+     * aggregated across every unit running the same script.
+     *
+     * Samples are recorded by CobExecutionContext through a CobFrameTimer
+     * when RWE is built with the RWE_COB_PROFILING option.
+     * Without it, the simulation has no profiler.
+     *
+     * Time is charged to the function whose frame was executing,
+     * so a function called with call-script is listed separately from its caller.
+     *
+     * Executions that went through a script's native code
+     * are kept apart from interpreted ones so that the two can be compared.
+     * Native code does not count instructions, so their instruction counts
+     * only cover what the interpreter ran after the native code bailed out.
+     */
+    class CobProfiler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct FunctionStats
+        {
+            /**
+             * Number of uninterrupted runs of this function,
+             * each ending when it calls another function, returns or yields.
+             */
+            std::uint64_t executions{0};
+            std::uint64_t instructions{0};
+            std::uint64_t pieceCommands{0};
+            Clock::duration time{0};
+        };
+
+        struct Entry
+        {
+            const CobScript* script;
+            const std::string* functionName;
+            bool native;
+            const FunctionStats* stats;
+        };
+
+        using ScriptNameLookup = std::function<std::string(const CobScript*)>;
+
+    private:
+        std::map<std::tuple<const CobScript*, std::string, bool>, FunctionStats> stats;
+
+    public:
+        void record(const CobScript* script, const std::string& functionName, bool native, unsigned int instructions, bool issuedPieceCommand, Clock::duration time);
+
+        void reset();
+
+        /**
+         * Returns all recorded entries, sorted by total time spent
+         * with the most expensive function first.
+         */
+        std::vector<Entry> getEntriesByTime() const;
+
+        void writeCsv(std::ostream& os, const ScriptNameLookup& scriptName) const;
+    };
+
+#ifdef RWE_COB_PROFILING
+    class CobThread;
+
+    /**
+     * Times a single execution of a thread for a CobProfiler,
+     * charging each stretch of time and instructions
+     * to the function on top of the thread's call stack while it ran.
+     *
+     * While a timer is attached to a thread,
+     * the thread's call stack must only be pushed or popped
+     * after calling switchFrame, as cobCallScript and cobReturnFromScript do.
+     */
+    class CobFrameTimer
+    {
+    private:
+        CobProfiler* const profiler;
+        const CobScript* const script;
+        CobThread* const thread;
+        const bool native;
+
+        CobProfiler::Clock::time_point stretchStart;
+        unsigned int stretchInstructions{0};
+
+    public:
+        /** Attaches the timer to the thread and starts timing. */
+        CobFrameTimer(CobProfiler* profiler, const CobScript* script, CobThread* thread, bool native);
+
+        /** Detaches the timer from the thread. */
+        ~CobFrameTimer();
+
+        CobFrameTimer(const CobFrameTimer&) = delete;
+        CobFrameTimer& operator=(const CobFrameTimer&) = delete;
+
+        void countInstruction()
+        {
+            ++stretchInstructions;
+        }
+
+        /**
+         * Charges the current stretch to the function on top of the call stack
+         * and starts a new stretch.
+         */
+        void switchFrame();
+
+        /**
+         * Charges the final stretch of the execution, which ended with the given status.
+         * Nothing is charged if the thread has finished,
+         * since its last stretch ended when it returned.
+         */
+        void finish(bool issuedPieceCommand);
+
+    private:
+        void recordStretch(bool issuedPieceCommand);
+    };
+#endif
+}
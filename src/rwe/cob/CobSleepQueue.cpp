@@ -0,0 +1,74 @@
+#include "CobSleepQueue.h"
+#include <algorithm>
+#include <cassert>
+
+namespace rwe
+{
+    bool wakesAfter(const CobSleepQueue::Entry& a, const CobSleepQueue::Entry& b)
+    {
+        if (a.wakeTick != b.wakeTick)
+        {
+            return a.wakeTick > b.wakeTick;
+        }
+
+        return a.sequenceNumber > b.sequenceNumber;
+    }
+
+    void CobSleepQueue::push(unsigned int wakeTick, CobThread* thread)
+    {
+        heap.push_back(Entry{wakeTick, nextSequenceNumber++, thread});
+        std::push_heap(heap.begin(), heap.end(), wakesAfter);
+    }
+
+    const CobSleepQueue::Entry& CobSleepQueue::top() const
+    {
+        assert(!heap.empty());
+        return heap.front();
+    }
+
+    void CobSleepQueue::pop()
+    {
+        assert(!heap.empty());
+        std::pop_heap(heap.begin(), heap.end(), wakesAfter);
+        heap.pop_back();
+    }
+
+    bool CobSleepQueue::empty() const
+    {
+        return heap.empty();
+    }
+
+    std::size_t CobSleepQueue::size() const
+    {
+        return heap.size();
+    }
+
+    bool CobSleepQueue::remove(const CobThread* thread)
+    {
+        auto it = std::find_if(heap.begin(), heap.end(), [thread](const auto& e) { return e.thread == thread; });
+        if (it == heap.end())
+        {
+            return false;
+        }
+
+        *it = heap.back();
+        heap.pop_back();
+        std::make_heap(heap.begin(), heap.end(), wakesAfter);
+        return true;
+    }
+
+    bool CobSleepQueue::contains(const CobThread* thread) const
+    {
+        return std::any_of(heap.begin(), heap.end(), [thread](const auto& e) { return e.thread == thread; });
+    }
+
+    std::vector<CobSleepQueue::Entry>::const_iterator CobSleepQueue::begin() const
+    {
+        return heap.begin();
+    }
+
+    std::vector<CobSleepQueue::Entry>::const_iterator CobSleepQueue::end() const
+    {
+        return heap.end();
+    }
+}
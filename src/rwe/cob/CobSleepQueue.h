@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <rwe/cob/CobThread.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Holds the sleeping threads of a cob environment,
+     * ordered by the simulation tick on which they should wake.
+     *
+     * The wake tick is computed once when the thread goes to sleep.
+     * Threads that wake on the same tick are woken
+     * in the order in which they went to sleep.
+     */
+    class CobSleepQueue
+    {
+    public:
+        struct Entry
+        {
+            unsigned int wakeTick;
+            uint64_t sequenceNumber;
+            CobThread* thread;
+        };
+
+    private:
+        /** Binary min-heap ordered by wake tick, then sequence number. */
+        std::vector<Entry> heap;
+
+        uint64_t nextSequenceNumber{0};
+
+    public:
+        void push(unsigned int wakeTick, CobThread* thread);
+
+        /** Returns the entry that will wake soonest. The queue must not be empty. */
+        const Entry& top() const;
+
+        void pop();
+
+        bool empty() const;
+
+        std::size_t size() const;
+
+        /**
+         * Removes the given thread from the queue, if present.
+         * This is linear in the size of the queue.
+         */
+        bool remove(const CobThread* thread);
+
+        bool contains(const CobThread* thread) const;
+
+        /** Iterates the entries in heap order, which is not wake order. */
+        std::vector<Entry>::const_iterator begin() const;
+
+        std::vector<Entry>::const_iterator end() const;
+    };
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+#include <rwe/cob/CobSleepQueue.h>
+
+namespace rwe
+{
+    TEST_CASE("CobSleepQueue")
+    {
+        CobSleepQueue queue;
+        CobThread a("a");
+        CobThread b("b");
+        CobThread c("c");
+        CobThread d("d");
+
+        SECTION("wakes threads in tick order")
+        {
+            queue.push(30, &a);
+            queue.push(10, &b);
+            queue.push(20, &c);
+
+            REQUIRE(queue.size() == 3);
+            REQUIRE(queue.top().thread == &b);
+            queue.pop();
+            REQUIRE(queue.top().thread == &c);
+            queue.pop();
+            REQUIRE(queue.top().thread == &a);
+            REQUIRE(queue.top().wakeTick == 30);
+            queue.pop();
+            REQUIRE(queue.empty());
+        }
+
+        SECTION("threads that wake on the same tick wake in the order they slept")
+        {
+            queue.push(5, &a);
+            queue.push(3, &b);
+            queue.push(5, &c);
+            queue.push(5, &d);
+
+            REQUIRE(queue.top().thread == &b);
+            queue.pop();
+            REQUIRE(queue.top().thread == &a);
+            queue.pop();
+            REQUIRE(queue.top().thread == &c);
+            queue.pop();
+            REQUIRE(queue.top().thread == &d);
+        }
+
+        SECTION("removes threads")
+        {
+            queue.push(1, &a);
+            queue.push(2, &b);
+            queue.push(3, &c);
+
+            REQUIRE(queue.remove(&a));
+            REQUIRE(!queue.remove(&d));
+            REQUIRE(!queue.contains(&a));
+            REQUIRE(queue.contains(&b));
+            REQUIRE(queue.size() == 2);
+
+            REQUIRE(queue.top().thread == &b);
+            queue.pop();
+            REQUIRE(queue.top().thread == &c);
+        }
+    }
+}
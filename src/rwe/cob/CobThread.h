@@ -7,6 +7,10 @@
 
 namespace rwe
 {
+#ifdef RWE_COB_PROFILING
+    class CobFrameTimer;
+#endif
+
     class CobThread
     {
     public:
@@ -26,6 +30,11 @@ namespace rwe
          */
         std::vector<int> returnLocals;
 
+#ifdef RWE_COB_PROFILING
+        /** Times the thread while it is being executed, otherwise null. */
+        CobFrameTimer* frameTimer{nullptr};
+#endif
+
     public:
         CobThread(const std::string& name, unsigned int signalMask);
 
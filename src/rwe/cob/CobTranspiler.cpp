@@ -0,0 +1,675 @@
+#include "CobTranspiler.h"
+#include <cctype>
+#include <climits>
+#include <iomanip>
+#include <map>
+#include <optional>
+#include <rwe/cob/CobNativeScript.h>
+#include <rwe/cob/CobOpCode.h>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace rwe
+{
+    struct DecodedCobInstruction
+    {
+        unsigned int index;
+        OpCode opCode;
+        std::vector<uint32_t> operands;
+        unsigned int next;
+    };
+
+    std::optional<unsigned int> getCobOperandCount(uint32_t instruction)
+    {
+        switch (static_cast<OpCode>(instruction))
+        {
+            case OpCode::MOVE:
+            case OpCode::TURN:
+            case OpCode::SPIN:
+            case OpCode::STOP_SPIN:
+            case OpCode::MOVE_NOW:
+            case OpCode::TURN_NOW:
+            case OpCode::WAIT_FOR_TURN:
+            case OpCode::WAIT_FOR_MOVE:
+            case OpCode::START_SCRIPT:
+            case OpCode::CALL_SCRIPT:
+                return 2;
+
+            case OpCode::SHOW:
+            case OpCode::HIDE:
+            case OpCode::CACHE:
+            case OpCode::DONT_CACHE:
+            case OpCode::SHADE:
+            case OpCode::DONT_SHADE:
+            case OpCode::EMIT_SFX:
+            case OpCode::EXPLODE:
+            case OpCode::PUSH_CONSTANT:
+            case OpCode::PUSH_LOCAL_VAR:
+            case OpCode::PUSH_STATIC:
+            case OpCode::POP_LOCAL_VAR:
+            case OpCode::POP_STATIC:
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_ZERO:
+                return 1;
+
+            case OpCode::SLEEP:
+            case OpCode::CREATE_LOCAL_VAR:
+            case OpCode::POP_STACK:
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::BITWISE_AND:
+            case OpCode::BITWISE_OR:
+            case OpCode::BITWISE_XOR:
+            case OpCode::BITWISE_NOT:
+            case OpCode::RAND:
+            case OpCode::GET_VALUE:
+            case OpCode::GET_VALUE_WITH_ARGS:
+            case OpCode::SET_VALUE:
+            case OpCode::SET_LESS:
+            case OpCode::SET_LESS_OR_EQUAL:
+            case OpCode::SET_GREATER:
+            case OpCode::SET_GREATER_OR_EQUAL:
+            case OpCode::SET_EQUAL:
+            case OpCode::SET_NOT_EQUAL:
+            case OpCode::LOGICAL_AND:
+            case OpCode::LOGICAL_OR:
+            case OpCode::LOGICAL_XOR:
+            case OpCode::LOGICAL_NOT:
+            case OpCode::RETURN:
+            case OpCode::SIGNAL:
+            case OpCode::SET_SIGNAL_MASK:
+            case OpCode::ATTACH_UNIT:
+            case OpCode::DROP_UNIT:
+                return 0;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    bool isAxisOperand(OpCode opCode)
+    {
+        switch (opCode)
+        {
+            case OpCode::MOVE:
+            case OpCode::TURN:
+            case OpCode::SPIN:
+            case OpCode::STOP_SPIN:
+            case OpCode::MOVE_NOW:
+            case OpCode::TURN_NOW:
+            case OpCode::WAIT_FOR_TURN:
+            case OpCode::WAIT_FOR_MOVE:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** True if executing the instruction may hand control back to the engine. */
+    bool mayYield(OpCode opCode)
+    {
+        switch (opCode)
+        {
+            case OpCode::MOVE:
+            case OpCode::TURN:
+            case OpCode::SPIN:
+            case OpCode::STOP_SPIN:
+            case OpCode::MOVE_NOW:
+            case OpCode::TURN_NOW:
+            case OpCode::SHOW:
+            case OpCode::HIDE:
+            case OpCode::SHADE:
+            case OpCode::DONT_SHADE:
+            case OpCode::EMIT_SFX:
+            case OpCode::WAIT_FOR_TURN:
+            case OpCode::WAIT_FOR_MOVE:
+            case OpCode::SLEEP:
+            case OpCode::RAND:
+            case OpCode::GET_VALUE:
+            case OpCode::GET_VALUE_WITH_ARGS:
+            case OpCode::SET_VALUE:
+            case OpCode::CALL_SCRIPT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Decodes the instruction stream with a linear sweep.
+     * When an instruction cannot be decoded the sweep skips ahead
+     * to the next function entry point.
+     * Code that is never decoded is left to the interpreter.
+     */
+    std::map<unsigned int, DecodedCobInstruction> decodeCobInstructions(const CobScript& script)
+    {
+        std::set<unsigned int> functionAddresses;
+        for (const auto& f : script.functions)
+        {
+            functionAddresses.insert(f.address);
+        }
+
+        std::map<unsigned int, DecodedCobInstruction> decoded;
+        unsigned int size = script.instructions.size();
+        unsigned int i = 0;
+        while (i < size)
+        {
+            auto instruction = script.instructions[i];
+            auto operandCount = getCobOperandCount(instruction);
+            auto opCode = static_cast<OpCode>(instruction);
+            bool valid = operandCount && i + *operandCount < size;
+            if (valid && isAxisOperand(opCode) && script.instructions[i + 2] > 2)
+            {
+                valid = false;
+            }
+
+            if (!valid)
+            {
+                auto nextFunction = functionAddresses.upper_bound(i);
+                if (nextFunction == functionAddresses.end())
+                {
+                    break;
+                }
+                i = *nextFunction;
+                continue;
+            }
+
+            DecodedCobInstruction d{i, opCode, {}, i + 1 + *operandCount};
+            for (unsigned int j = 0; j < *operandCount; ++j)
+            {
+                d.operands.push_back(script.instructions[i + 1 + j]);
+            }
+            decoded.emplace(i, std::move(d));
+            i += 1 + *operandCount;
+        }
+
+        return decoded;
+    }
+
+    std::string toIdentifier(const std::string& name)
+    {
+        std::string result;
+        for (auto c : name)
+        {
+            result += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        }
+        return result;
+    }
+
+    std::string escapeStringLiteral(const std::string& str)
+    {
+        std::string result;
+        for (auto c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    std::string intLiteral(uint32_t value)
+    {
+        auto signedValue = static_cast<int>(value);
+        if (signedValue == INT_MIN)
+        {
+            return "static_cast<int>(" + std::to_string(value) + "u)";
+        }
+        return std::to_string(signedValue);
+    }
+
+    std::string axisLiteral(uint32_t axis)
+    {
+        switch (axis)
+        {
+            case 0:
+                return "CobAxis::X";
+            case 1:
+                return "CobAxis::Y";
+            default:
+                return "CobAxis::Z";
+        }
+    }
+
+    class CobTranspiler
+    {
+    private:
+        const CobScript* script;
+        std::map<unsigned int, DecodedCobInstruction> decoded;
+
+        /** Positions a thread can resume execution from. */
+        std::set<unsigned int> resumePoints;
+
+        /** Positions jumped to directly from within native code. */
+        std::set<unsigned int> gotoTargets;
+
+        std::ostringstream out;
+
+    public:
+        explicit CobTranspiler(const CobScript* script) : script(script), decoded(decodeCobInstructions(*script))
+        {
+            for (const auto& f : script->functions)
+            {
+                if (isDecoded(f.address))
+                {
+                    resumePoints.insert(f.address);
+                }
+            }
+
+            for (const auto& [index, d] : decoded)
+            {
+                if (mayYield(d.opCode) && isDecoded(d.next))
+                {
+                    resumePoints.insert(d.next);
+                }
+
+                if ((d.opCode == OpCode::JUMP || d.opCode == OpCode::JUMP_IF_ZERO) && isDecoded(d.operands[0]))
+                {
+                    gotoTargets.insert(d.operands[0]);
+                }
+
+                if (d.opCode == OpCode::CALL_SCRIPT)
+                {
+                    if (auto address = getFunctionAddress(d.operands[0]); address && isDecoded(*address))
+                    {
+                        gotoTargets.insert(*address);
+                    }
+                }
+            }
+        }
+
+        std::string transpile(const std::string& name)
+        {
+            auto identifier = toIdentifier(name);
+
+            out << "// Generated by cob_transpile from " << name << ". Do not edit.\n";
+            out << "#include <rwe/cob/CobConstants.h>\n";
+            out << "#include <rwe/cob/CobNativeRuntime.h>\n";
+            out << "#include <rwe/cob/CobNativeScript.h>\n";
+            out << "\n";
+            out << "namespace rwe\n";
+            out << "{\n";
+            out << "    namespace\n";
+            out << "    {\n";
+            out << "        std::optional<CobEnvironment::Status> cobNative_" << identifier << "(CobEnvironment& env, CobThread& thread)\n";
+            out << "        {\n";
+            out << "            for (;;)\n";
+            out << "            {\n";
+            out << "                if (thread.callStack.empty())\n";
+            out << "                {\n";
+            out << "                    return CobEnvironment::Status(CobEnvironment::FinishedStatus());\n";
+            out << "                }\n";
+            out << "\n";
+            out << "                switch (thread.callStack.top().instructionIndex)\n";
+            out << "                {\n";
+            for (auto p : resumePoints)
+            {
+                out << "                    case " << p << ":\n";
+                out << "                        goto L" << p << ";\n";
+            }
+            out << "                    default:\n";
+            out << "                        return std::nullopt;\n";
+            out << "                }\n";
+
+            for (const auto& [index, d] : decoded)
+            {
+                if (resumePoints.count(index) != 0 || gotoTargets.count(index) != 0)
+                {
+                    out << "\n";
+                    out << "            L" << index << ":\n";
+                }
+
+                emitInstruction(d);
+
+                if (!isDecoded(d.next) && d.opCode != OpCode::JUMP && d.opCode != OpCode::RETURN)
+                {
+                    // execution runs past the end of the translated code,
+                    // hand over to the interpreter
+                    emitLine(sync(d.next));
+                    emitLine("return std::nullopt;");
+                }
+            }
+
+            out << "            }\n";
+            out << "        }\n";
+            out << "\n";
+            out << "        const CobNativeScript nativeScript{0x" << std::hex << std::setw(16) << std::setfill('0') << computeCobScriptHash(*script) << std::dec << "ull, " << script->instructions.size() << ", \"" << escapeStringLiteral(name) << "\", &cobNative_" << identifier << "};\n";
+            out << "        const CobNativeScriptRegistration registration(&nativeScript);\n";
+            out << "    }\n";
+            out << "}\n";
+
+            return out.str();
+        }
+
+    private:
+        bool isDecoded(unsigned int index) const
+        {
+            return decoded.find(index) != decoded.end();
+        }
+
+        std::optional<unsigned int> getFunctionAddress(unsigned int functionId) const
+        {
+            if (functionId >= script->functions.size())
+            {
+                return std::nullopt;
+            }
+            return script->functions[functionId].address;
+        }
+
+        static std::string sync(unsigned int next)
+        {
+            return "thread.callStack.top().instructionIndex = " + std::to_string(next) + ";";
+        }
+
+        void emitLine(const std::string& line)
+        {
+            out << "                " << line << "\n";
+        }
+
+        void emitBlock(const std::vector<std::string>& lines)
+        {
+            emitLine("{");
+            for (const auto& line : lines)
+            {
+                emitLine("    " + line);
+            }
+            emitLine("}");
+        }
+
+        void emitBinary(const std::string& expression)
+        {
+            emitBlock({
+                "auto b = cobPop(thread);",
+                "auto a = cobPop(thread);",
+                "cobPush(thread, " + expression + ");",
+            });
+        }
+
+        void emitPieceCommand(const DecodedCobInstruction& d, const std::vector<std::string>& pops, const std::string& command)
+        {
+            std::vector<std::string> lines(pops);
+            lines.push_back(sync(d.next));
+            lines.push_back("return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{" + std::to_string(d.operands[0]) + ", " + command + "});");
+            emitBlock(lines);
+        }
+
+        std::vector<std::string> jumpTo(unsigned int target) const
+        {
+            if (isDecoded(target))
+            {
+                return {"goto L" + std::to_string(target) + ";"};
+            }
+
+            return {sync(target), "continue;"};
+        }
+
+        void emitInstruction(const DecodedCobInstruction& d)
+        {
+            switch (d.opCode)
+            {
+                case OpCode::RAND:
+                    emitBlock({
+                        "auto high = cobPop(thread);",
+                        "auto low = cobPop(thread);",
+                        sync(d.next),
+                        "return CobEnvironment::Status(CobEnvironment::QueryStatus{CobEnvironment::QueryStatus::Random{low, high}});",
+                    });
+                    break;
+                case OpCode::ADD:
+                    emitBinary("a + b");
+                    break;
+                case OpCode::SUB:
+                    emitBinary("a - b");
+                    break;
+                case OpCode::MUL:
+                    emitBinary("a * b");
+                    break;
+                case OpCode::DIV:
+                    emitBinary("a / b");
+                    break;
+
+                case OpCode::SET_LESS:
+                    emitBinary("a < b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::SET_LESS_OR_EQUAL:
+                    emitBinary("a <= b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::SET_EQUAL:
+                    emitBinary("a == b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::SET_NOT_EQUAL:
+                    emitBinary("a != b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::SET_GREATER:
+                    emitBinary("a > b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::SET_GREATER_OR_EQUAL:
+                    emitBinary("a >= b ? CobTrue : CobFalse");
+                    break;
+
+                case OpCode::JUMP:
+                    for (const auto& line : jumpTo(d.operands[0]))
+                    {
+                        emitLine(line);
+                    }
+                    break;
+                case OpCode::JUMP_IF_ZERO:
+                    emitLine("if (cobPop(thread) == 0)");
+                    emitBlock(jumpTo(d.operands[0]));
+                    break;
+
+                case OpCode::LOGICAL_AND:
+                    emitBinary("a && b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::LOGICAL_OR:
+                    emitBinary("a || b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::LOGICAL_XOR:
+                    emitBinary("!a != !b ? CobTrue : CobFalse");
+                    break;
+                case OpCode::LOGICAL_NOT:
+                    emitLine("cobPush(thread, !cobPop(thread) ? CobTrue : CobFalse);");
+                    break;
+
+                case OpCode::BITWISE_AND:
+                    emitBinary("a & b");
+                    break;
+                case OpCode::BITWISE_OR:
+                    emitBinary("a | b");
+                    break;
+                case OpCode::BITWISE_XOR:
+                    emitBinary("a ^ b");
+                    break;
+                case OpCode::BITWISE_NOT:
+                    emitLine("cobPush(thread, ~cobPop(thread));");
+                    break;
+
+                case OpCode::MOVE:
+                    emitPieceCommand(
+                        d,
+                        {"auto position = CobPosition(cobPop(thread));", "auto speed = CobSpeed(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::Move{" + axisLiteral(d.operands[1]) + ", position, speed}");
+                    break;
+                case OpCode::MOVE_NOW:
+                    emitPieceCommand(
+                        d,
+                        {"auto position = CobPosition(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::Move{" + axisLiteral(d.operands[1]) + ", position, std::nullopt}");
+                    break;
+                case OpCode::TURN:
+                    emitPieceCommand(
+                        d,
+                        {"auto angle = CobAngle(cobPop(thread));", "auto speed = CobAngularSpeed(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::Turn{" + axisLiteral(d.operands[1]) + ", angle, speed}");
+                    break;
+                case OpCode::TURN_NOW:
+                    emitPieceCommand(
+                        d,
+                        {"auto angle = CobAngle(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::Turn{" + axisLiteral(d.operands[1]) + ", angle, std::nullopt}");
+                    break;
+                case OpCode::SPIN:
+                    emitPieceCommand(
+                        d,
+                        {"auto targetSpeed = CobAngularSpeed(cobPop(thread));", "auto acceleration = CobAngularSpeed(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::Spin{" + axisLiteral(d.operands[1]) + ", targetSpeed, acceleration}");
+                    break;
+                case OpCode::STOP_SPIN:
+                    emitPieceCommand(
+                        d,
+                        {"auto deceleration = CobAngularSpeed(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::StopSpin{" + axisLiteral(d.operands[1]) + ", deceleration}");
+                    break;
+                case OpCode::EXPLODE:
+                    emitLine("cobPop(thread);");
+                    break;
+                case OpCode::EMIT_SFX:
+                    emitPieceCommand(
+                        d,
+                        {"auto sfxType = static_cast<CobSfxType>(cobPop(thread));"},
+                        "CobEnvironment::PieceCommandStatus::EmitSfx{sfxType}");
+                    break;
+                case OpCode::SHOW:
+                    emitPieceCommand(d, {}, "CobEnvironment::PieceCommandStatus::Show()");
+                    break;
+                case OpCode::HIDE:
+                    emitPieceCommand(d, {}, "CobEnvironment::PieceCommandStatus::Hide()");
+                    break;
+                case OpCode::SHADE:
+                    emitPieceCommand(d, {}, "CobEnvironment::PieceCommandStatus::EnableShading()");
+                    break;
+                case OpCode::DONT_SHADE:
+                    emitPieceCommand(d, {}, "CobEnvironment::PieceCommandStatus::DisableShading()");
+                    break;
+                case OpCode::CACHE:
+                case OpCode::DONT_CACHE:
+                    // RWE does not have the concept of caching
+                    break;
+                case OpCode::ATTACH_UNIT:
+                    emitLine("cobPop(thread);");
+                    emitLine("cobPop(thread);");
+                    break;
+                case OpCode::DROP_UNIT:
+                    emitLine("cobPop(thread);");
+                    break;
+
+                case OpCode::WAIT_FOR_MOVE:
+                    emitLine(sync(d.next));
+                    emitLine("return CobEnvironment::Status(CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Move(" + std::to_string(d.operands[0]) + ", " + axisLiteral(d.operands[1]) + ")));");
+                    break;
+                case OpCode::WAIT_FOR_TURN:
+                    emitLine(sync(d.next));
+                    emitLine("return CobEnvironment::Status(CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Turn(" + std::to_string(d.operands[0]) + ", " + axisLiteral(d.operands[1]) + ")));");
+                    break;
+                case OpCode::SLEEP:
+                    emitBlock({
+                        "auto duration = CobSleepDuration(cobPop(thread));",
+                        sync(d.next),
+                        "return CobEnvironment::Status(CobEnvironment::SleepStatus{duration});",
+                    });
+                    break;
+
+                case OpCode::CALL_SCRIPT:
+                {
+                    emitLine(sync(d.next));
+                    emitLine("cobCallScript(env, thread, " + std::to_string(d.operands[0]) + ", " + std::to_string(d.operands[1]) + ");");
+                    auto address = getFunctionAddress(d.operands[0]);
+                    if (address && isDecoded(*address))
+                    {
+                        emitLine("goto L" + std::to_string(*address) + ";");
+                    }
+                    else
+                    {
+                        emitLine("continue;");
+                    }
+                    break;
+                }
+                case OpCode::RETURN:
+                    emitLine("cobReturnFromScript(thread);");
+                    emitLine("continue;");
+                    break;
+                case OpCode::START_SCRIPT:
+                    emitLine("cobStartScript(env, thread, " + std::to_string(d.operands[0]) + ", " + std::to_string(d.operands[1]) + ");");
+                    break;
+
+                case OpCode::SIGNAL:
+                    emitLine("env.sendSignal(static_cast<unsigned int>(cobPop(thread)));");
+                    break;
+                case OpCode::SET_SIGNAL_MASK:
+                    emitLine("thread.signalMask = static_cast<unsigned int>(cobPop(thread));");
+                    break;
+
+                case OpCode::CREATE_LOCAL_VAR:
+                    emitLine("cobCreateLocalVariable(thread);");
+                    break;
+                case OpCode::PUSH_CONSTANT:
+                    emitLine("cobPush(thread, " + intLiteral(d.operands[0]) + ");");
+                    break;
+                case OpCode::PUSH_LOCAL_VAR:
+                    emitLine("cobPush(thread, thread.callStack.top().locals.at(" + std::to_string(d.operands[0]) + "));");
+                    break;
+                case OpCode::POP_LOCAL_VAR:
+                    emitBlock({
+                        "auto value = cobPop(thread);",
+                        "thread.callStack.top().locals.at(" + std::to_string(d.operands[0]) + ") = value;",
+                    });
+                    break;
+                case OpCode::PUSH_STATIC:
+                    emitLine("cobPush(thread, env.getStatic(" + std::to_string(d.operands[0]) + "));");
+                    break;
+                case OpCode::POP_STATIC:
+                    emitBlock({
+                        "auto value = cobPop(thread);",
+                        "env.setStatic(" + std::to_string(d.operands[0]) + ", value);",
+                    });
+                    break;
+                case OpCode::POP_STACK:
+                    emitLine("cobPop(thread);");
+                    break;
+
+                case OpCode::GET_VALUE:
+                    emitBlock({
+                        "auto valueId = static_cast<CobValueId>(cobPop(thread));",
+                        "if (auto status = cobGetValue(thread, valueId, 0, 0, 0, 0))",
+                        "{",
+                        "    " + sync(d.next),
+                        "    return status;",
+                        "}",
+                    });
+                    break;
+                case OpCode::GET_VALUE_WITH_ARGS:
+                    emitBlock({
+                        "auto arg4 = cobPop(thread);",
+                        "auto arg3 = cobPop(thread);",
+                        "auto arg2 = cobPop(thread);",
+                        "auto arg1 = cobPop(thread);",
+                        "auto valueId = static_cast<CobValueId>(cobPop(thread));",
+                        "if (auto status = cobGetValue(thread, valueId, arg1, arg2, arg3, arg4))",
+                        "{",
+                        "    " + sync(d.next),
+                        "    return status;",
+                        "}",
+                    });
+                    break;
+                case OpCode::SET_VALUE:
+                    emitBlock({
+                        "auto newValue = cobPop(thread);",
+                        "auto valueId = static_cast<CobValueId>(cobPop(thread));",
+                        sync(d.next),
+                        "return CobEnvironment::Status(CobEnvironment::SetQueryStatus{setGetter(valueId, newValue)});",
+                    });
+                    break;
+            }
+        }
+    };
+
+    std::string transpileCobScript(const CobScript& script, const std::string& name)
+    {
+        return CobTranspiler(&script).transpile(name);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <rwe/io/cob/Cob.h>
+#include <string>
+
+namespace rwe
+{
+    /**
+     * Translates a COB script into C++ source code
+     * defining and registering a CobNativeScript.
+     *
+     * The generated code keeps all thread state (stack, call stack, locals)
+     * in the same CobThread structures the interpreter uses
+     * and yields at exactly the same instructions,
+     * so a thread can move freely between native code and the interpreter.
+     * Instructions that cannot be translated are left to the interpreter.
+     *
+     * The name is used for the generated symbols and for diagnostics.
+     */
+    std::string transpileCobScript(const CobScript& script, const std::string& name);
+}
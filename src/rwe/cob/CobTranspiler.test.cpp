@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <deque>
+#include <fstream>
+#include <rwe/cob/CobEnvironment.h>
+#include <rwe/cob/CobExecutionContext.h>
+#include <rwe/cob/CobNativeScript.h>
+#include <rwe/cob/CobOpCode.h>
+#include <rwe/cob/CobTranspiler.h>
+#include <rwe/cob/CobValueId.h>
+#include <rwe/util/match.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rwe
+{
+    static uint32_t fixtureOp(OpCode opCode)
+    {
+        return static_cast<uint32_t>(opCode);
+    }
+
+    static uint32_t fixtureValue(CobValueId valueId)
+    {
+        return static_cast<uint32_t>(valueId);
+    }
+
+    /**
+     * A small script exercising control flow, calls, statics, locals,
+     * piece commands, queries and sleeping.
+     *
+     * CobTranspiler_fixture_native.test.cpp was generated from this script
+     * by transpileCobScript, and a test checks that it still matches.
+     * If you change the script or the transpiler, regenerate that file.
+     */
+    static CobScript makeTranspilerFixtureScript()
+    {
+        CobScript script;
+        script.pieces = {"base", "turret", "barrel"};
+        script.staticVariableCount = 3;
+
+        auto& code = script.instructions;
+
+        // Create()
+        script.functions.push_back(CobFunctionInfo{"Create", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::POP_STATIC), 0});
+        code.insert(code.end(), {fixtureOp(OpCode::START_SCRIPT), 2, 0});
+        auto loopStart = static_cast<uint32_t>(code.size());
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_STATIC), 0, fixtureOp(OpCode::PUSH_CONSTANT), 3, fixtureOp(OpCode::SET_LESS), fixtureOp(OpCode::JUMP_IF_ZERO)});
+        auto loopExitOperand = code.size();
+        code.push_back(0);
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_STATIC), 0, fixtureOp(OpCode::CALL_SCRIPT), 1, 1, fixtureOp(OpCode::POP_STACK)});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_STATIC), 0, fixtureOp(OpCode::PUSH_CONSTANT), 1, fixtureOp(OpCode::ADD), fixtureOp(OpCode::POP_STATIC), 0});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 100, fixtureOp(OpCode::SLEEP)});
+        code.insert(code.end(), {fixtureOp(OpCode::JUMP), loopStart});
+        code[loopExitOperand] = static_cast<uint32_t>(code.size());
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), fixtureValue(CobValueId::Hypot), fixtureOp(OpCode::PUSH_CONSTANT), 0x00030000, fixtureOp(OpCode::PUSH_CONSTANT), 0x00040000, fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::GET_VALUE_WITH_ARGS), fixtureOp(OpCode::POP_STATIC), 2});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::RETURN)});
+
+        // Step(n)
+        script.functions.push_back(CobFunctionInfo{"Step", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {fixtureOp(OpCode::CREATE_LOCAL_VAR), fixtureOp(OpCode::CREATE_LOCAL_VAR), fixtureOp(OpCode::PUSH_LOCAL_VAR), 0, fixtureOp(OpCode::PUSH_CONSTANT), 2, fixtureOp(OpCode::MUL), fixtureOp(OpCode::POP_LOCAL_VAR), 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 0x00050000, fixtureOp(OpCode::PUSH_LOCAL_VAR), 1, fixtureOp(OpCode::MOVE), 0, 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 0x2000, fixtureOp(OpCode::PUSH_CONSTANT), 0xffffc000, fixtureOp(OpCode::TURN), 1, 2});
+        code.insert(code.end(), {fixtureOp(OpCode::SHOW), 2, fixtureOp(OpCode::CACHE), 2});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_LOCAL_VAR), 1, fixtureOp(OpCode::RETURN)});
+
+        // Spinner()
+        script.functions.push_back(CobFunctionInfo{"Spinner", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 10, fixtureOp(OpCode::PUSH_CONSTANT), 200, fixtureOp(OpCode::SPIN), 1, 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 1, fixtureOp(OpCode::PUSH_CONSTANT), 10, fixtureOp(OpCode::RAND), fixtureOp(OpCode::POP_STATIC), 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), fixtureValue(CobValueId::Activation), fixtureOp(OpCode::GET_VALUE), fixtureOp(OpCode::LOGICAL_NOT), fixtureOp(OpCode::PUSH_STATIC), 1, fixtureOp(OpCode::BITWISE_OR), fixtureOp(OpCode::POP_STATIC), 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), fixtureValue(CobValueId::Activation), fixtureOp(OpCode::PUSH_CONSTANT), 1, fixtureOp(OpCode::SET_VALUE)});
+        code.insert(code.end(), {fixtureOp(OpCode::WAIT_FOR_TURN), 1, 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 50, fixtureOp(OpCode::SLEEP), fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::STOP_SPIN), 1, 1});
+        code.insert(code.end(), {fixtureOp(OpCode::PUSH_CONSTANT), 0, fixtureOp(OpCode::RETURN)});
+
+        script.contentHash = computeCobScriptHash(script);
+        return script;
+    }
+
+    static std::string describeStatus(const CobEnvironment::Status& status)
+    {
+        std::ostringstream os;
+        match(
+            status,
+            [&](const CobEnvironment::SignalStatus& s) { os << "signal " << s.signal; },
+            [&](const CobEnvironment::PieceCommandStatus& s) {
+                os << "piece " << s.piece << " ";
+                match(
+                    s.command,
+                    [&](const CobEnvironment::PieceCommandStatus::Move& c) { os << "move " << static_cast<int>(c.axis) << " " << c.position.value << " " << (c.speed ? c.speed->value : -1); },
+                    [&](const CobEnvironment::PieceCommandStatus::Turn& c) { os << "turn " << static_cast<int>(c.axis) << " " << c.angle.value << " " << (c.speed ? c.speed->value : -1); },
+                    [&](const CobEnvironment::PieceCommandStatus::Spin& c) { os << "spin " << static_cast<int>(c.axis) << " " << c.targetSpeed.value << " " << c.acceleration.value; },
+                    [&](const CobEnvironment::PieceCommandStatus::StopSpin& c) { os << "stop-spin " << static_cast<int>(c.axis) << " " << c.deceleration.value; },
+                    [&](const CobEnvironment::PieceCommandStatus::Show&) { os << "show"; },
+                    [&](const CobEnvironment::PieceCommandStatus::Hide&) { os << "hide"; },
+                    [&](const CobEnvironment::PieceCommandStatus::EnableShading&) { os << "shade"; },
+                    [&](const CobEnvironment::PieceCommandStatus::DisableShading&) { os << "dont-shade"; },
+                    [&](const CobEnvironment::PieceCommandStatus::EmitSfx& c) { os << "emit-sfx " << static_cast<int>(c.sfxType); });
+            },
+            [&](const CobEnvironment::BlockedStatus&) { os << "blocked"; },
+            [&](const CobEnvironment::SleepStatus& s) { os << "sleep " << s.duration.value; },
+            [&](const CobEnvironment::QueryStatus& s) { os << "query " << s.query.index(); },
+            [&](const CobEnvironment::SetQueryStatus& s) { os << "set-query " << s.query.index(); },
+            [&](const CobEnvironment::FinishedStatus&) { os << "finished"; });
+        return os.str();
+    }
+
+    /**
+     * Runs the script's Create function using a minimal scheduler
+     * and returns every status reported by the threads, in order.
+     */
+    static std::vector<std::string> runFixtureScript(CobEnvironment& env, int ticks)
+    {
+        std::vector<std::string> trace;
+        env.createThread("Create");
+
+        for (int tick = 0; tick < ticks; ++tick)
+        {
+            while (!env.sleepingQueue.empty() && env.sleepingQueue.top().wakeTick <= static_cast<unsigned int>(tick))
+            {
+                env.readyQueue.push_back(env.sleepingQueue.top().thread);
+                env.sleepingQueue.pop();
+            }
+
+            // treat every blocking condition as immediately satisfied
+            for (const auto& pair : env.blockedQueue)
+            {
+                env.readyQueue.push_back(pair.second);
+            }
+            env.blockedQueue.clear();
+
+            while (!env.readyQueue.empty())
+            {
+                auto thread = env.readyQueue.front();
+                env.readyQueue.pop_front();
+
+                for (auto running = true; running;)
+                {
+                    CobExecutionContext context(&env, thread);
+                    auto status = context.execute();
+                    trace.push_back(thread->name + ": " + describeStatus(status));
+                    match(
+                        status,
+                        [&](const CobEnvironment::SignalStatus&) {},
+                        [&](const CobEnvironment::PieceCommandStatus&) {},
+                        [&](const CobEnvironment::BlockedStatus& s) {
+                            env.blockedQueue.emplace_back(s, thread);
+                            running = false;
+                        },
+                        [&](const CobEnvironment::SleepStatus& s) {
+                            // each tick is 33ms, and a thread always sleeps until at least the next tick
+                            auto sleepTicks = std::max<unsigned int>(1, (s.duration.value + 32) / 33);
+                            env.sleepingQueue.push(tick + sleepTicks, thread);
+                            running = false;
+                        },
+                        [&](const CobEnvironment::QueryStatus& s) {
+                            auto result = match(
+                                s.query,
+                                [](const CobEnvironment::QueryStatus::Random& q) { return q.low; },
+                                [](const auto&) { return 1; });
+                            thread->stack.push(result);
+                        },
+                        [&](const CobEnvironment::SetQueryStatus&) {},
+                        [&](const CobEnvironment::FinishedStatus&) {
+                            thread->returnValue = thread->stack.empty() ? 0 : thread->stack.top();
+                            env.finishedQueue.push_back(thread);
+                            running = false;
+                        });
+                }
+            }
+        }
+
+        return trace;
+    }
+
+    TEST_CASE("transpileCobScript")
+    {
+        auto script = makeTranspilerFixtureScript();
+
+        SECTION("the fixture's native implementation is registered")
+        {
+            auto native = findNativeCobScript(script);
+            REQUIRE(native != nullptr);
+            REQUIRE(native->contentHash == script.contentHash);
+
+            CobEnvironment env(&script, native);
+            auto thread = env.createNonScheduledThread("Create", {});
+            REQUIRE(thread);
+            REQUIRE(native->execute(env, *thread).has_value());
+        }
+
+        SECTION("native code issues the same commands as the interpreter")
+        {
+            auto native = findNativeCobScript(script);
+            REQUIRE(native != nullptr);
+
+            CobEnvironment interpretedEnv(&script, nullptr);
+            auto interpretedTrace = runFixtureScript(interpretedEnv, 30);
+
+            CobEnvironment nativeEnv(&script, native);
+            auto nativeTrace = runFixtureScript(nativeEnv, 30);
+
+            REQUIRE(interpretedTrace.size() > 20);
+            REQUIRE(nativeTrace == interpretedTrace);
+            for (unsigned int i = 0; i < script.staticVariableCount; ++i)
+            {
+                REQUIRE(nativeEnv.getStatic(i) == interpretedEnv.getStatic(i));
+            }
+            REQUIRE(interpretedEnv.getStatic(0) == 3);
+        }
+
+        SECTION("the checked-in native code is what the transpiler generates")
+        {
+            std::ifstream file(RWE_TEST_SOURCE_DIR "/src/rwe/cob/CobTranspiler_fixture_native.test.cpp", std::ios::binary);
+            REQUIRE(file.is_open());
+            std::ostringstream checkedIn;
+            checkedIn << file.rdbuf();
+
+            REQUIRE(transpileCobScript(script, "fixture") == checkedIn.str());
+        }
+
+        SECTION("the hash depends on the script contents")
+        {
+            auto modified = script;
+            modified.instructions[1] = 1;
+            modified.contentHash = computeCobScriptHash(modified);
+            REQUIRE(modified.contentHash != script.contentHash);
+            REQUIRE(findNativeCobScript(modified) == nullptr);
+        }
+
+        SECTION("a script with the same hash but a different length is not matched")
+        {
+            auto longer = script;
+            longer.instructions.push_back(0);
+            REQUIRE(longer.contentHash == script.contentHash);
+            REQUIRE(findNativeCobScript(longer) == nullptr);
+        }
+    }
+}
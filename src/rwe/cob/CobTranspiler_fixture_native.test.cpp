@@ -0,0 +1,263 @@
+// Generated by cob_transpile from fixture. Do not edit.
+#include <rwe/cob/CobConstants.h>
+#include <rwe/cob/CobNativeRuntime.h>
+#include <rwe/cob/CobNativeScript.h>
+
+namespace rwe
+{
+    namespace
+    {
+        std::optional<CobEnvironment::Status> cobNative_fixture(CobEnvironment& env, CobThread& thread)
+        {
+            for (;;)
+            {
+                if (thread.callStack.empty())
+                {
+                    return CobEnvironment::Status(CobEnvironment::FinishedStatus());
+                }
+
+                switch (thread.callStack.top().instructionIndex)
+                {
+                    case 0:
+                        goto L0;
+                    case 19:
+                        goto L19;
+                    case 30:
+                        goto L30;
+                    case 43:
+                        goto L43;
+                    case 48:
+                        goto L48;
+                    case 64:
+                        goto L64;
+                    case 71:
+                        goto L71;
+                    case 73:
+                        goto L73;
+                    case 78:
+                        goto L78;
+                    case 85:
+                        goto L85;
+                    case 90:
+                        goto L90;
+                    case 95:
+                        goto L95;
+                    case 106:
+                        goto L106;
+                    case 109:
+                        goto L109;
+                    case 112:
+                        goto L112;
+                    case 117:
+                        goto L117;
+                    default:
+                        return std::nullopt;
+                }
+
+            L0:
+                cobPush(thread, 0);
+                {
+                    auto value = cobPop(thread);
+                    env.setStatic(0, value);
+                }
+                cobStartScript(env, thread, 2, 0);
+
+            L7:
+                cobPush(thread, env.getStatic(0));
+                cobPush(thread, 3);
+                {
+                    auto b = cobPop(thread);
+                    auto a = cobPop(thread);
+                    cobPush(thread, a < b ? CobTrue : CobFalse);
+                }
+                if (cobPop(thread) == 0)
+                {
+                    goto L32;
+                }
+                cobPush(thread, env.getStatic(0));
+                thread.callStack.top().instructionIndex = 19;
+                cobCallScript(env, thread, 1, 1);
+                goto L48;
+
+            L19:
+                cobPop(thread);
+                cobPush(thread, env.getStatic(0));
+                cobPush(thread, 1);
+                {
+                    auto b = cobPop(thread);
+                    auto a = cobPop(thread);
+                    cobPush(thread, a + b);
+                }
+                {
+                    auto value = cobPop(thread);
+                    env.setStatic(0, value);
+                }
+                cobPush(thread, 100);
+                {
+                    auto duration = CobSleepDuration(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 30;
+                    return CobEnvironment::Status(CobEnvironment::SleepStatus{duration});
+                }
+
+            L30:
+                goto L7;
+
+            L32:
+                cobPush(thread, 15);
+                cobPush(thread, 196608);
+                cobPush(thread, 262144);
+                cobPush(thread, 0);
+                cobPush(thread, 0);
+                {
+                    auto arg4 = cobPop(thread);
+                    auto arg3 = cobPop(thread);
+                    auto arg2 = cobPop(thread);
+                    auto arg1 = cobPop(thread);
+                    auto valueId = static_cast<CobValueId>(cobPop(thread));
+                    if (auto status = cobGetValue(thread, valueId, arg1, arg2, arg3, arg4))
+                    {
+                        thread.callStack.top().instructionIndex = 43;
+                        return status;
+                    }
+                }
+
+            L43:
+                {
+                    auto value = cobPop(thread);
+                    env.setStatic(2, value);
+                }
+                cobPush(thread, 0);
+                cobReturnFromScript(thread);
+                continue;
+
+            L48:
+                cobCreateLocalVariable(thread);
+                cobCreateLocalVariable(thread);
+                cobPush(thread, thread.callStack.top().locals.at(0));
+                cobPush(thread, 2);
+                {
+                    auto b = cobPop(thread);
+                    auto a = cobPop(thread);
+                    cobPush(thread, a * b);
+                }
+                {
+                    auto value = cobPop(thread);
+                    thread.callStack.top().locals.at(1) = value;
+                }
+                cobPush(thread, 327680);
+                cobPush(thread, thread.callStack.top().locals.at(1));
+                {
+                    auto position = CobPosition(cobPop(thread));
+                    auto speed = CobSpeed(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 64;
+                    return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{0, CobEnvironment::PieceCommandStatus::Move{CobAxis::Y, position, speed}});
+                }
+
+            L64:
+                cobPush(thread, 8192);
+                cobPush(thread, -16384);
+                {
+                    auto angle = CobAngle(cobPop(thread));
+                    auto speed = CobAngularSpeed(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 71;
+                    return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{1, CobEnvironment::PieceCommandStatus::Turn{CobAxis::Z, angle, speed}});
+                }
+
+            L71:
+                {
+                    thread.callStack.top().instructionIndex = 73;
+                    return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{2, CobEnvironment::PieceCommandStatus::Show()});
+                }
+
+            L73:
+                cobPush(thread, thread.callStack.top().locals.at(1));
+                cobReturnFromScript(thread);
+                continue;
+
+            L78:
+                cobPush(thread, 10);
+                cobPush(thread, 200);
+                {
+                    auto targetSpeed = CobAngularSpeed(cobPop(thread));
+                    auto acceleration = CobAngularSpeed(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 85;
+                    return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{1, CobEnvironment::PieceCommandStatus::Spin{CobAxis::Y, targetSpeed, acceleration}});
+                }
+
+            L85:
+                cobPush(thread, 1);
+                cobPush(thread, 10);
+                {
+                    auto high = cobPop(thread);
+                    auto low = cobPop(thread);
+                    thread.callStack.top().instructionIndex = 90;
+                    return CobEnvironment::Status(CobEnvironment::QueryStatus{CobEnvironment::QueryStatus::Random{low, high}});
+                }
+
+            L90:
+                {
+                    auto value = cobPop(thread);
+                    env.setStatic(1, value);
+                }
+                cobPush(thread, 1);
+                {
+                    auto valueId = static_cast<CobValueId>(cobPop(thread));
+                    if (auto status = cobGetValue(thread, valueId, 0, 0, 0, 0))
+                    {
+                        thread.callStack.top().instructionIndex = 95;
+                        return status;
+                    }
+                }
+
+            L95:
+                cobPush(thread, !cobPop(thread) ? CobTrue : CobFalse);
+                cobPush(thread, env.getStatic(1));
+                {
+                    auto b = cobPop(thread);
+                    auto a = cobPop(thread);
+                    cobPush(thread, a | b);
+                }
+                {
+                    auto value = cobPop(thread);
+                    env.setStatic(1, value);
+                }
+                cobPush(thread, 1);
+                cobPush(thread, 1);
+                {
+                    auto newValue = cobPop(thread);
+                    auto valueId = static_cast<CobValueId>(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 106;
+                    return CobEnvironment::Status(CobEnvironment::SetQueryStatus{setGetter(valueId, newValue)});
+                }
+
+            L106:
+                thread.callStack.top().instructionIndex = 109;
+                return CobEnvironment::Status(CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Turn(1, CobAxis::Y)));
+
+            L109:
+                cobPush(thread, 50);
+                {
+                    auto duration = CobSleepDuration(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 112;
+                    return CobEnvironment::Status(CobEnvironment::SleepStatus{duration});
+                }
+
+            L112:
+                cobPush(thread, 0);
+                {
+                    auto deceleration = CobAngularSpeed(cobPop(thread));
+                    thread.callStack.top().instructionIndex = 117;
+                    return CobEnvironment::Status(CobEnvironment::PieceCommandStatus{1, CobEnvironment::PieceCommandStatus::StopSpin{CobAxis::Y, deceleration}});
+                }
+
+            L117:
+                cobPush(thread, 0);
+                cobReturnFromScript(thread);
+                continue;
+            }
+        }
+
+        const CobNativeScript nativeScript{0xfeb9bd8031848fefull, 120, "fixture", &cobNative_fixture};
+        const CobNativeScriptRegistration registration(&nativeScript);
+    }
+}
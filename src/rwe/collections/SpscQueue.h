@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * A bounded lock-free queue for passing values from one producer thread
+     * to one consumer thread.
+     *
+     * Slots are reused, so pushing by copy into a slot that previously held
+     * a vector reuses its storage and does not allocate once the queue has warmed up.
+     * Elements must be default constructible and assignable.
+     */
+    template <typename T>
+    class SpscQueue
+    {
+    private:
+        std::vector<T> slots;
+        std::size_t mask;
+
+        /** The index of the next element to pop. Written only by the consumer. */
+        alignas(64) std::atomic<std::size_t> head{0};
+
+        /** The index of the next element to push. Written only by the producer. */
+        alignas(64) std::atomic<std::size_t> tail{0};
+
+    public:
+        /** The capacity is rounded up to a power of two. */
+        explicit SpscQueue(std::size_t minCapacity) : slots(roundUpToPowerOfTwo(minCapacity)), mask(slots.size() - 1)
+        {
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        std::size_t capacity() const
+        {
+            return slots.size();
+        }
+
+        /**
+         * The number of elements in the queue.
+         * Exact when called from the producer or consumer thread
+         * while the other is not running, otherwise an estimate.
+         */
+        std::size_t size() const
+        {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /** Called by the producer. Returns false if the queue is full. */
+        bool tryPush(const T& value)
+        {
+            auto slot = tryBeginPush();
+            if (slot == nullptr)
+            {
+                return false;
+            }
+
+            *slot = value;
+            commitPush();
+            return true;
+        }
+
+        /** Called by the producer. Returns false if the queue is full, leaving the value untouched. */
+        bool tryPush(T&& value)
+        {
+            auto slot = tryBeginPush();
+            if (slot == nullptr)
+            {
+                return false;
+            }
+
+            *slot = std::move(value);
+            commitPush();
+            return true;
+        }
+
+        /**
+         * Called by the producer.
+         * Returns the slot that the next element goes in, or null if the queue is full,
+         * so that the element can be built in place.
+         * The slot still holds whatever was left in it when it was last popped.
+         * Nothing is pushed until commitPush is called.
+         */
+        T* tryBeginPush()
+        {
+            auto t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == slots.size())
+            {
+                return nullptr;
+            }
+
+            return &slots[t & mask];
+        }
+
+        /** Called by the producer to push the slot returned by tryBeginPush. */
+        void commitPush()
+        {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * Called by the consumer.
+         * Returns the element at the front of the queue, or null if the queue is empty.
+         * The element may be modified or moved from before it is popped.
+         */
+        T* front()
+        {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+
+            return &slots[h & mask];
+        }
+
+        /** Called by the consumer. The queue must not be empty. */
+        void pop()
+        {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /** Called by the consumer. */
+        std::optional<T> tryPop()
+        {
+            auto value = front();
+            if (value == nullptr)
+            {
+                return std::nullopt;
+            }
+
+            std::optional<T> out(std::move(*value));
+            pop();
+            return out;
+        }
+
+    private:
+        static std::size_t roundUpToPowerOfTwo(std::size_t n)
+        {
+            std::size_t p = 1;
+            while (p < n)
+            {
+                p <<= 1;
+            }
+            return p;
+        }
+    };
+}
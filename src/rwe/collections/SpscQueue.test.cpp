@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+#include <rwe/collections/SpscQueue.h>
+#include <thread>
+
+namespace rwe
+{
+    TEST_CASE("SpscQueue")
+    {
+        SECTION("rounds capacity up to a power of two")
+        {
+            SpscQueue<int> q(5);
+            REQUIRE(q.capacity() == 8);
+        }
+
+        SECTION("pops values in the order they were pushed")
+        {
+            SpscQueue<int> q(4);
+            REQUIRE(q.empty());
+            REQUIRE(q.tryPush(1));
+            REQUIRE(q.tryPush(2));
+            REQUIRE(q.tryPush(3));
+            REQUIRE(q.size() == 3);
+
+            REQUIRE(q.tryPop() == std::optional<int>(1));
+            REQUIRE(q.tryPop() == std::optional<int>(2));
+            REQUIRE(*q.front() == 3);
+            q.pop();
+            REQUIRE(q.front() == nullptr);
+            REQUIRE(q.tryPop() == std::nullopt);
+        }
+
+        SECTION("refuses to push when full")
+        {
+            SpscQueue<int> q(2);
+            REQUIRE(q.tryPush(1));
+            REQUIRE(q.tryPush(2));
+            REQUIRE(!q.tryPush(3));
+
+            REQUIRE(q.tryPop() == std::optional<int>(1));
+            REQUIRE(q.tryPush(3));
+            REQUIRE(q.tryPop() == std::optional<int>(2));
+            REQUIRE(q.tryPop() == std::optional<int>(3));
+        }
+
+        SECTION("builds elements in place in reused slots")
+        {
+            SpscQueue<std::vector<int>> q(2);
+            q.tryBeginPush()->assign({1, 2, 3});
+            REQUIRE(q.empty());
+            q.commitPush();
+            REQUIRE(q.size() == 1);
+
+            auto storage = q.front()->data();
+            q.pop();
+            q.tryPush(std::vector<int>{4});
+            q.pop();
+
+            // back round to the first slot, which still has its storage
+            auto slot = q.tryBeginPush();
+            REQUIRE(slot->data() == storage);
+            slot->clear();
+            slot->push_back(5);
+            q.commitPush();
+            REQUIRE(q.tryPop() == std::optional<std::vector<int>>(std::vector<int>{5}));
+        }
+
+        SECTION("passes every value between threads in order")
+        {
+            SpscQueue<int> q(16);
+            const int count = 100000;
+
+            std::thread producer([&]() {
+                for (int i = 0; i < count; ++i)
+                {
+                    while (!q.tryPush(i))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+
+            int expected = 0;
+            bool inOrder = true;
+            while (expected < count)
+            {
+                if (auto v = q.tryPop(); v)
+                {
+                    inOrder = inOrder && *v == expected;
+                    ++expected;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            producer.join();
+            REQUIRE(inOrder);
+            REQUIRE(q.empty());
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace rwe
+{
+    /**
+     * Lets one thread publish snapshots of a value
+     * for another thread to read without either thread ever waiting.
+     *
+     * The writer fills one buffer and publishes it by atomically swapping it
+     * with a spare buffer. The reader swaps the spare for its own buffer
+     * when something new has been published, so it always sees
+     * a complete snapshot, the latest one at the time of reading.
+     */
+    template <typename T>
+    class TripleBuffer
+    {
+    private:
+        static constexpr unsigned int IndexMask = 3u;
+
+        /** Set on the spare index when it holds a snapshot the reader has not seen. */
+        static constexpr unsigned int NewDataBit = 4u;
+
+        std::array<T, 3> buffers;
+
+        /** The buffer being written. Used only by the writer. */
+        unsigned int writeIndex{0};
+
+        /** The buffer most recently published and not yet taken by the reader. */
+        std::atomic<unsigned int> spareIndex{1};
+
+        /** The buffer being read. Used only by the reader. */
+        unsigned int readIndex{2};
+
+    public:
+        TripleBuffer() = default;
+
+        explicit TripleBuffer(const T& initialValue) : buffers{initialValue, initialValue, initialValue}
+        {
+        }
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        /** Called by the writer. */
+        void publish(const T& value)
+        {
+            buffers[writeIndex] = value;
+            writeIndex = spareIndex.exchange(writeIndex | NewDataBit, std::memory_order_acq_rel) & IndexMask;
+        }
+
+        /**
+         * Called by the reader.
+         * The returned reference stays valid until the next call.
+         */
+        const T& read()
+        {
+            if (spareIndex.load(std::memory_order_relaxed) & NewDataBit)
+            {
+                readIndex = spareIndex.exchange(readIndex, std::memory_order_acq_rel) & IndexMask;
+            }
+
+            return buffers[readIndex];
+        }
+    };
+}
@@ -0,0 +1,57 @@
+#include <catch2/catch.hpp>
+#include <rwe/collections/TripleBuffer.h>
+#include <thread>
+
+namespace rwe
+{
+    TEST_CASE("TripleBuffer")
+    {
+        SECTION("reads the initial value before anything is published")
+        {
+            TripleBuffer<int> b(7);
+            REQUIRE(b.read() == 7);
+        }
+
+        SECTION("reads the latest published value")
+        {
+            TripleBuffer<int> b(0);
+            b.publish(1);
+            b.publish(2);
+            REQUIRE(b.read() == 2);
+            REQUIRE(b.read() == 2);
+            b.publish(3);
+            REQUIRE(b.read() == 3);
+        }
+
+        SECTION("never reads a torn or stale snapshot across threads")
+        {
+            struct Pair
+            {
+                int a;
+                int b;
+            };
+
+            TripleBuffer<Pair> buffer(Pair{0, 0});
+            const int count = 100000;
+
+            std::thread writer([&]() {
+                for (int i = 1; i <= count; ++i)
+                {
+                    buffer.publish(Pair{i, -i});
+                }
+            });
+
+            int last = 0;
+            bool consistent = true;
+            while (last < count)
+            {
+                auto p = buffer.read();
+                consistent = consistent && p.a == -p.b && p.a >= last;
+                last = p.a;
+            }
+
+            writer.join();
+            REQUIRE(consistent);
+        }
+    }
+}
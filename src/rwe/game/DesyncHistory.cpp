@@ -0,0 +1,181 @@
+#include "DesyncHistory.h"
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <network.pb.h>
+#include <rwe/proto/serialization.h>
+#include <stdexcept>
+
+namespace rwe
+{
+    DesyncHistory::DesyncHistory(std::size_t capacity) : records(capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::logic_error("Desync history capacity must be positive");
+        }
+    }
+
+    GameHash DesyncHistory::recordTick(SceneTime sceneTime, const GameSimulation& simulation, const std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>& commands)
+    {
+        auto& record = records[recordCount % records.size()];
+        record.sceneTime = sceneTime;
+        computeHashBreakdown(simulation, record.hashes);
+
+        record.commandSetHashes.clear();
+        for (const auto& [playerId, playerCommands] : commands)
+        {
+            GameHash hash(0);
+            if (!playerCommands.empty())
+            {
+                auto encodedCommands = serializeCommandSet(playerCommands, unitTypes);
+                boost::crc_32_type crc;
+                crc.process_bytes(encodedCommands.data(), encodedCommands.size());
+                hash = GameHash(crc.checksum());
+            }
+            record.commandSetHashes.emplace_back(playerId, hash);
+        }
+
+        ++recordCount;
+        return record.hashes.total();
+    }
+
+    const DesyncTickRecord* DesyncHistory::findTick(SceneTime sceneTime) const
+    {
+        if (recordCount == 0)
+        {
+            return nullptr;
+        }
+
+        const auto& latest = records[(recordCount - 1) % records.size()];
+        if (sceneTime > latest.sceneTime)
+        {
+            return nullptr;
+        }
+
+        std::size_t age = latest.sceneTime.value - sceneTime.value;
+        if (age >= std::min(recordCount, records.size()))
+        {
+            return nullptr;
+        }
+
+        const auto& record = records[(recordCount - 1 - age) % records.size()];
+        return record.sceneTime == sceneTime ? &record : nullptr;
+    }
+
+    DesyncSnapshot DesyncHistory::createSnapshot(PlayerId localPlayerId, SceneTime mismatchTime) const
+    {
+        DesyncSnapshot snapshot{localPlayerId, mismatchTime, {}};
+
+        auto count = std::min(recordCount, records.size());
+        for (auto i = recordCount - count; i < recordCount; ++i)
+        {
+            const auto& record = records[i % records.size()];
+            if (record.sceneTime > mismatchTime)
+            {
+                break;
+            }
+
+            // Entity hashes are only worth sending for the tick we know is wrong.
+            auto& tick = snapshot.ticks.emplace_back(record);
+            if (tick.sceneTime != mismatchTime)
+            {
+                tick.hashes.playerHashes.clear();
+                tick.hashes.unitHashes.clear();
+                tick.hashes.projectileHashes.clear();
+            }
+        }
+
+        return snapshot;
+    }
+
+    std::string serializeDesyncSnapshot(const DesyncSnapshot& snapshot)
+    {
+        proto::DesyncSnapshotMessage message;
+        message.set_player_id(snapshot.playerId.value);
+        message.set_mismatch_time(snapshot.mismatchTime.value);
+
+        for (const auto& record : snapshot.ticks)
+        {
+            auto& tick = *message.add_ticks();
+            tick.set_scene_time(record.sceneTime.value);
+            tick.set_game_time_hash(record.hashes.gameTime.value);
+            tick.set_players_hash(record.hashes.players.value);
+            tick.set_units_hash(record.hashes.units.value);
+            tick.set_projectiles_hash(record.hashes.projectiles.value);
+
+            for (const auto& [playerId, hash] : record.commandSetHashes)
+            {
+                tick.add_command_set_player_id(playerId.value);
+                tick.add_command_set_hash(hash.value);
+            }
+
+            for (const auto& hash : record.hashes.playerHashes)
+            {
+                tick.add_player_hash(hash.value);
+            }
+
+            for (const auto& [unitId, hash] : record.hashes.unitHashes)
+            {
+                tick.add_unit_id(unitId.value);
+                tick.add_unit_hash(hash.value);
+            }
+
+            for (const auto& [projectileId, hash] : record.hashes.projectileHashes)
+            {
+                tick.add_projectile_id(projectileId.value);
+                tick.add_projectile_hash(hash.value);
+            }
+        }
+
+        return message.SerializeAsString();
+    }
+
+    DesyncSnapshot deserializeDesyncSnapshot(const std::string& data)
+    {
+        proto::DesyncSnapshotMessage message;
+        if (!message.ParseFromString(data))
+        {
+            throw std::runtime_error("Desync snapshot is malformed");
+        }
+
+        DesyncSnapshot snapshot{PlayerId(message.player_id()), SceneTime(message.mismatch_time()), {}};
+        for (const auto& tick : message.ticks())
+        {
+            if (tick.command_set_player_id_size() != tick.command_set_hash_size()
+                || tick.unit_id_size() != tick.unit_hash_size()
+                || tick.projectile_id_size() != tick.projectile_hash_size())
+            {
+                throw std::runtime_error("Desync snapshot has mismatched lists");
+            }
+
+            auto& record = snapshot.ticks.emplace_back();
+            record.sceneTime = SceneTime(tick.scene_time());
+            record.hashes.gameTime = GameHash(tick.game_time_hash());
+            record.hashes.players = GameHash(tick.players_hash());
+            record.hashes.units = GameHash(tick.units_hash());
+            record.hashes.projectiles = GameHash(tick.projectiles_hash());
+
+            for (int i = 0; i < tick.command_set_player_id_size(); ++i)
+            {
+                record.commandSetHashes.emplace_back(PlayerId(tick.command_set_player_id(i)), GameHash(tick.command_set_hash(i)));
+            }
+
+            for (auto hash : tick.player_hash())
+            {
+                record.hashes.playerHashes.emplace_back(hash);
+            }
+
+            for (int i = 0; i < tick.unit_id_size(); ++i)
+            {
+                record.hashes.unitHashes.emplace_back(UnitId(tick.unit_id(i)), GameHash(tick.unit_hash(i)));
+            }
+
+            for (int i = 0; i < tick.projectile_id_size(); ++i)
+            {
+                record.hashes.projectileHashes.emplace_back(ProjectileId(tick.projectile_id(i)), GameHash(tick.projectile_hash(i)));
+            }
+        }
+
+        return snapshot;
+    }
+}
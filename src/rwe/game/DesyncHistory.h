@@ -0,0 +1,95 @@
+#pragma once
+
+#include <rwe/game/PlayerCommand.h>
+#include <rwe/game/SceneTime.h>
+#include <rwe/proto/UnitTypeTable.h>
+#include <rwe/sim/GameHash.h>
+#include <rwe/sim/GameHash_util.h>
+#include <rwe/sim/GameSimulation.h>
+#include <rwe/sim/PlayerId.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rwe
+{
+    /** What we remember of one tick for tracking down a desync. */
+    struct DesyncTickRecord
+    {
+        SceneTime sceneTime{0};
+
+        /** The hashes of the simulation after the tick. */
+        GameHashBreakdown hashes;
+
+        /**
+         * A checksum of each player's command set executed on the tick, in player ID order.
+         * The checksum of an empty set is zero.
+         */
+        std::vector<std::pair<PlayerId, GameHash>> commandSetHashes;
+    };
+
+    /** What a peer sends of its history once the peers' game hashes differ. */
+    struct DesyncSnapshot
+    {
+        PlayerId playerId;
+
+        /** The first scene time on which the game hashes differed. */
+        SceneTime mismatchTime{0};
+
+        /**
+         * The recorded ticks up to and including the mismatch time, oldest first.
+         * Only the record for the mismatch time has entity hashes.
+         */
+        std::vector<DesyncTickRecord> ticks;
+    };
+
+    /**
+     * Remembers the hashes and commands of the last few ticks,
+     * so that when peers find that their game hashes differ
+     * they can compare what they remember
+     * and work out when and where the game diverged.
+     *
+     * Records are kept in a ring whose slots are reused,
+     * so recording a tick does not allocate once the ring is warmed up.
+     */
+    class DesyncHistory
+    {
+    public:
+        /**
+         * Enough ticks to still hold the mismatched one
+         * when we find out about it, allowing for command delay,
+         * and some before it to look for earlier divergence in.
+         */
+        static constexpr std::size_t DefaultCapacity = 128;
+
+    private:
+        std::vector<DesyncTickRecord> records;
+
+        std::size_t recordCount{0};
+
+        /** Commands are recorded with unit types as names so that records stand alone. */
+        UnitTypeTable unitTypes;
+
+    public:
+        explicit DesyncHistory(std::size_t capacity = DefaultCapacity);
+
+        /**
+         * Records the commands executed on a tick and the hashes of the simulation after it,
+         * replacing the oldest record if the history is full.
+         * Ticks must be recorded in order, one scene time apart.
+         * Returns the simulation's hash.
+         */
+        GameHash recordTick(SceneTime sceneTime, const GameSimulation& simulation, const std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>& commands);
+
+        /** Returns null if the tick is not in the history. */
+        const DesyncTickRecord* findTick(SceneTime sceneTime) const;
+
+        /** Creates the snapshot we send to peers when our hashes differ from theirs at the given scene time. */
+        DesyncSnapshot createSnapshot(PlayerId localPlayerId, SceneTime mismatchTime) const;
+    };
+
+    std::string serializeDesyncSnapshot(const DesyncSnapshot& snapshot);
+
+    /** Throws std::runtime_error if the data is not a valid snapshot. */
+    DesyncSnapshot deserializeDesyncSnapshot(const std::string& data);
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+#include <rwe/game/DesyncHistory.h>
+
+namespace rwe
+{
+    TEST_CASE("DesyncHistory")
+    {
+        GameSimulation simulation(MapTerrain(Grid<unsigned char>(65, 65, 0), 0_ss), 0, 0, 20);
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            GamePlayerInfo info{"Player " + std::to_string(i), GamePlayerType::Human, PlayerColorIndex(i), GamePlayerStatus::Alive, "ARM", Metal(1000), Energy(1000), Metal(1000), Energy(1000), Metal(1000), Energy(1000)};
+            simulation.addPlayer(info);
+        }
+
+        std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> noCommands{{PlayerId(0), {}}, {PlayerId(1), {}}};
+        std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> someCommands{
+            {PlayerId(0), {}},
+            {PlayerId(1), {PlayerUnitCommand(UnitId(3), PlayerUnitCommand::Stop())}}};
+
+        DesyncHistory history(4);
+
+        SECTION("returns the simulation's hash")
+        {
+            REQUIRE(history.recordTick(SceneTime(1), simulation, noCommands) == computeHashOf(simulation));
+        }
+
+        SECTION("remembers only the latest ticks")
+        {
+            for (unsigned int t = 1; t <= 6; ++t)
+            {
+                history.recordTick(SceneTime(t), simulation, t == 5 ? someCommands : noCommands);
+            }
+
+            REQUIRE(history.findTick(SceneTime(2)) == nullptr);
+            REQUIRE(history.findTick(SceneTime(7)) == nullptr);
+            REQUIRE(history.findTick(SceneTime(3)) != nullptr);
+            REQUIRE(history.findTick(SceneTime(3))->sceneTime == SceneTime(3));
+
+            const auto* tick = history.findTick(SceneTime(5));
+            REQUIRE(tick != nullptr);
+            REQUIRE(tick->commandSetHashes.size() == 2);
+            REQUIRE(tick->commandSetHashes[0] == std::pair(PlayerId(0), GameHash(0)));
+            REQUIRE(tick->commandSetHashes[1].first == PlayerId(1));
+            REQUIRE(tick->commandSetHashes[1].second != GameHash(0));
+        }
+
+        SECTION("creates snapshots with entity hashes for the mismatch time only")
+        {
+            for (unsigned int t = 1; t <= 6; ++t)
+            {
+                history.recordTick(SceneTime(t), simulation, noCommands);
+            }
+
+            auto snapshot = history.createSnapshot(PlayerId(1), SceneTime(5));
+            REQUIRE(snapshot.playerId == PlayerId(1));
+            REQUIRE(snapshot.mismatchTime == SceneTime(5));
+            REQUIRE(snapshot.ticks.size() == 3);
+            REQUIRE(snapshot.ticks.front().sceneTime == SceneTime(3));
+            REQUIRE(snapshot.ticks.front().hashes.playerHashes.empty());
+            REQUIRE(snapshot.ticks.front().hashes.players != GameHash(0));
+            REQUIRE(snapshot.ticks.back().sceneTime == SceneTime(5));
+            REQUIRE(snapshot.ticks.back().hashes.playerHashes.size() == 2);
+        }
+
+        SECTION("serializes snapshots")
+        {
+            history.recordTick(SceneTime(1), simulation, noCommands);
+            simulation.players[1].metal += Metal(1);
+            history.recordTick(SceneTime(2), simulation, someCommands);
+
+            auto snapshot = history.createSnapshot(PlayerId(1), SceneTime(2));
+            auto result = deserializeDesyncSnapshot(serializeDesyncSnapshot(snapshot));
+
+            REQUIRE(result.playerId == snapshot.playerId);
+            REQUIRE(result.mismatchTime == snapshot.mismatchTime);
+            REQUIRE(result.ticks.size() == 2);
+            for (std::size_t i = 0; i < result.ticks.size(); ++i)
+            {
+                const auto& a = result.ticks[i];
+                const auto& b = snapshot.ticks[i];
+                REQUIRE(a.sceneTime == b.sceneTime);
+                REQUIRE(a.hashes.total() == b.hashes.total());
+                REQUIRE(a.hashes.players == b.hashes.players);
+                REQUIRE(a.hashes.playerHashes == b.hashes.playerHashes);
+                REQUIRE(a.hashes.unitHashes == b.hashes.unitHashes);
+                REQUIRE(a.commandSetHashes == b.commandSetHashes);
+            }
+        }
+
+        SECTION("rejects malformed snapshots")
+        {
+            REQUIRE_THROWS_AS(deserializeDesyncSnapshot("\xff\xff\xff"), std::runtime_error);
+        }
+    }
+}
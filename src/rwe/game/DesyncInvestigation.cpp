@@ -0,0 +1,269 @@
+#include "DesyncInvestigation.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace rwe
+{
+    const char* getDesyncSubsystemName(DesyncSubsystem subsystem)
+    {
+        switch (subsystem)
+        {
+            case DesyncSubsystem::Commands:
+                return "commands";
+            case DesyncSubsystem::GameTime:
+                return "game time";
+            case DesyncSubsystem::Players:
+                return "players";
+            case DesyncSubsystem::Units:
+                return "units";
+            case DesyncSubsystem::Projectiles:
+                return "projectiles";
+            default:
+                throw std::logic_error("Unhandled desync subsystem");
+        }
+    }
+
+    /** Returns the IDs whose hashes differ between two lists ordered by ID, or that are in only one. */
+    template <typename Id>
+    static std::vector<Id> findDifferingIds(const std::vector<std::pair<Id, GameHash>>& a, const std::vector<std::pair<Id, GameHash>>& b)
+    {
+        std::vector<Id> ids;
+        auto itA = a.begin();
+        auto itB = b.begin();
+        while (itA != a.end() || itB != b.end())
+        {
+            if (itB == b.end() || (itA != a.end() && itA->first < itB->first))
+            {
+                ids.push_back((itA++)->first);
+            }
+            else if (itA == a.end() || itB->first < itA->first)
+            {
+                ids.push_back((itB++)->first);
+            }
+            else
+            {
+                if (itA->second != itB->second)
+                {
+                    ids.push_back(itA->first);
+                }
+                ++itA;
+                ++itB;
+            }
+        }
+
+        return ids;
+    }
+
+    std::optional<DesyncDivergence> findDivergence(const DesyncSnapshot& a, const DesyncSnapshot& b)
+    {
+        auto itA = a.ticks.begin();
+        auto itB = b.ticks.begin();
+        while (itA != a.ticks.end() && itB != b.ticks.end())
+        {
+            if (itA->sceneTime < itB->sceneTime)
+            {
+                ++itA;
+                continue;
+            }
+            if (itB->sceneTime < itA->sceneTime)
+            {
+                ++itB;
+                continue;
+            }
+
+            DesyncDivergence divergence{itA->sceneTime, {}, findDifferingIds(itA->commandSetHashes, itB->commandSetHashes)};
+            if (!divergence.commandPlayers.empty())
+            {
+                divergence.subsystems.push_back(DesyncSubsystem::Commands);
+            }
+            if (itA->hashes.gameTime != itB->hashes.gameTime)
+            {
+                divergence.subsystems.push_back(DesyncSubsystem::GameTime);
+            }
+            if (itA->hashes.players != itB->hashes.players)
+            {
+                divergence.subsystems.push_back(DesyncSubsystem::Players);
+            }
+            if (itA->hashes.units != itB->hashes.units)
+            {
+                divergence.subsystems.push_back(DesyncSubsystem::Units);
+            }
+            if (itA->hashes.projectiles != itB->hashes.projectiles)
+            {
+                divergence.subsystems.push_back(DesyncSubsystem::Projectiles);
+            }
+
+            if (!divergence.subsystems.empty())
+            {
+                return divergence;
+            }
+
+            ++itA;
+            ++itB;
+        }
+
+        return std::nullopt;
+    }
+
+    DesyncEntityDifferences findEntityDifferences(const GameHashBreakdown& a, const GameHashBreakdown& b)
+    {
+        DesyncEntityDifferences differences;
+
+        auto playerCount = std::max(a.playerHashes.size(), b.playerHashes.size());
+        for (std::size_t i = 0; i < playerCount; ++i)
+        {
+            if (i >= a.playerHashes.size() || i >= b.playerHashes.size() || a.playerHashes[i] != b.playerHashes[i])
+            {
+                differences.players.emplace_back(i);
+            }
+        }
+
+        differences.units = findDifferingIds(a.unitHashes, b.unitHashes);
+        differences.projectiles = findDifferingIds(a.projectileHashes, b.projectileHashes);
+        return differences;
+    }
+
+    DesyncInvestigation::DesyncInvestigation(DesyncSnapshot&& localSnapshot, const std::vector<PlayerId>& remotePlayers, Timestamp startTime)
+        : localSnapshot(std::move(localSnapshot)), remotePlayers(remotePlayers), remoteSnapshots(remotePlayers.size()), startTime(startTime)
+    {
+        if (remotePlayers.empty())
+        {
+            completeTime = startTime;
+        }
+    }
+
+    const DesyncSnapshot& DesyncInvestigation::getLocalSnapshot() const
+    {
+        return localSnapshot;
+    }
+
+    bool DesyncInvestigation::addRemoteSnapshot(DesyncSnapshot&& snapshot, Timestamp now)
+    {
+        auto it = std::find(remotePlayers.begin(), remotePlayers.end(), snapshot.playerId);
+        if (it == remotePlayers.end())
+        {
+            return false;
+        }
+
+        remoteSnapshots[it - remotePlayers.begin()] = std::move(snapshot);
+
+        if (!completeTime && std::all_of(remoteSnapshots.begin(), remoteSnapshots.end(), [](const auto& s) { return s.has_value(); }))
+        {
+            completeTime = now;
+        }
+
+        return true;
+    }
+
+    bool DesyncInvestigation::isFinished(Timestamp now) const
+    {
+        return now - startTime >= Timeout || (completeTime && now - *completeTime >= Linger);
+    }
+
+    template <typename Id>
+    static void writeIds(std::ostream& out, const char* kind, const std::vector<Id>& ids)
+    {
+        if (ids.empty())
+        {
+            return;
+        }
+
+        out << "; " << kind << " ";
+        auto count = std::min(ids.size(), DesyncInvestigation::MaxReportedEntities);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out << (i == 0 ? "" : ", ") << ids[i].value;
+        }
+        if (ids.size() > count)
+        {
+            out << " and " << (ids.size() - count) << " more";
+        }
+    }
+
+    /** Returns the record of the tick that has entity hashes, or null if the snapshot lacks it. */
+    static const DesyncTickRecord* findMismatchTick(const DesyncSnapshot& snapshot)
+    {
+        if (snapshot.ticks.empty() || snapshot.ticks.back().sceneTime != snapshot.mismatchTime)
+        {
+            return nullptr;
+        }
+
+        return &snapshot.ticks.back();
+    }
+
+    std::string DesyncInvestigation::createReport() const
+    {
+        std::ostringstream out;
+        out << "Desync at scene time " << localSnapshot.mismatchTime.value
+            << ", reported by player " << localSnapshot.playerId.value << "." << std::endl;
+
+        if (localSnapshot.ticks.empty())
+        {
+            out << "We have no history to compare." << std::endl;
+        }
+        else
+        {
+            out << "We have history from scene time " << localSnapshot.ticks.front().sceneTime.value
+                << " to " << localSnapshot.ticks.back().sceneTime.value << "." << std::endl;
+        }
+
+        for (std::size_t i = 0; i < remotePlayers.size(); ++i)
+        {
+            out << "Player " << remotePlayers[i].value << ": ";
+
+            const auto& remote = remoteSnapshots[i];
+            if (!remote)
+            {
+                out << "sent no snapshot." << std::endl;
+                continue;
+            }
+
+            auto divergence = findDivergence(localSnapshot, *remote);
+            if (!divergence)
+            {
+                out << "agrees with us on every scene time we both have";
+            }
+            else
+            {
+                out << "first differs at scene time " << divergence->sceneTime.value << ", in ";
+                for (std::size_t j = 0; j < divergence->subsystems.size(); ++j)
+                {
+                    out << (j == 0 ? "" : ", ") << getDesyncSubsystemName(divergence->subsystems[j]);
+                    if (divergence->subsystems[j] == DesyncSubsystem::Commands)
+                    {
+                        out << " of player";
+                        for (const auto& p : divergence->commandPlayers)
+                        {
+                            out << " " << p.value;
+                        }
+                    }
+                }
+            }
+
+            if (remote->mismatchTime != localSnapshot.mismatchTime)
+            {
+                out << " (found the desync at scene time " << remote->mismatchTime.value << ")";
+            }
+            out << "." << std::endl;
+
+            const auto* localTick = findMismatchTick(localSnapshot);
+            const auto* remoteTick = findMismatchTick(*remote);
+            if (divergence && localTick != nullptr && remoteTick != nullptr && localTick->sceneTime == remoteTick->sceneTime)
+            {
+                auto differences = findEntityDifferences(localTick->hashes, remoteTick->hashes);
+                out << "  Entities that differ at scene time " << localTick->sceneTime.value;
+                if (differences.players.empty() && differences.units.empty() && differences.projectiles.empty())
+                {
+                    out << ": none";
+                }
+                writeIds(out, "players", differences.players);
+                writeIds(out, "units", differences.units);
+                writeIds(out, "projectiles", differences.projectiles);
+                out << std::endl;
+            }
+        }
+
+        return out.str();
+    }
+}
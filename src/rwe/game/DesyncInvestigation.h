@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <rwe/game/DesyncHistory.h>
+#include <rwe/game/SceneTime.h>
+#include <rwe/rwe_time.h>
+#include <rwe/sim/GameHash_util.h>
+#include <rwe/sim/PlayerId.h>
+#include <rwe/sim/ProjectileId.h>
+#include <rwe/sim/UnitId.h>
+#include <string>
+#include <vector>
+
+namespace rwe
+{
+    /** The parts of a tick's record that are compared, in the order they are reported. */
+    enum class DesyncSubsystem
+    {
+        Commands,
+        GameTime,
+        Players,
+        Units,
+        Projectiles
+    };
+
+    const char* getDesyncSubsystemName(DesyncSubsystem subsystem);
+
+    /** Where two peers' snapshots first differ. */
+    struct DesyncDivergence
+    {
+        /** The first scene time, of those both peers recorded, on which anything differed. */
+        SceneTime sceneTime;
+
+        /** What differed on that tick. */
+        std::vector<DesyncSubsystem> subsystems;
+
+        /** The players whose command sets differed on that tick. */
+        std::vector<PlayerId> commandPlayers;
+    };
+
+    /** Entities whose hashes differ between two peers, or that only one peer has, in ID order. */
+    struct DesyncEntityDifferences
+    {
+        std::vector<PlayerId> players;
+        std::vector<UnitId> units;
+        std::vector<ProjectileId> projectiles;
+    };
+
+    /** Returns nothing if the snapshots agree on every tick they both recorded. */
+    std::optional<DesyncDivergence> findDivergence(const DesyncSnapshot& a, const DesyncSnapshot& b);
+
+    DesyncEntityDifferences findEntityDifferences(const GameHashBreakdown& a, const GameHashBreakdown& b);
+
+    /**
+     * Collects the snapshots of every peer once a desync is detected
+     * and compares them with ours to report when and where the game diverged.
+     *
+     * Peers send their snapshots at their own pace,
+     * so we wait a while for them to arrive,
+     * and keep going a little longer once we have them all
+     * so that peers still waiting for ours can get it.
+     */
+    class DesyncInvestigation
+    {
+    public:
+        /** How long we wait for snapshots before reporting on those we have. */
+        static constexpr std::chrono::milliseconds Timeout{10000};
+
+        /** How long we keep going once we have every snapshot. */
+        static constexpr std::chrono::milliseconds Linger{2000};
+
+        /** The most entities of each kind listed in a report. */
+        static constexpr std::size_t MaxReportedEntities = 10;
+
+    private:
+        DesyncSnapshot localSnapshot;
+
+        std::vector<PlayerId> remotePlayers;
+
+        /** Parallel to remotePlayers. */
+        std::vector<std::optional<DesyncSnapshot>> remoteSnapshots;
+
+        Timestamp startTime;
+
+        std::optional<Timestamp> completeTime;
+
+    public:
+        DesyncInvestigation(DesyncSnapshot&& localSnapshot, const std::vector<PlayerId>& remotePlayers, Timestamp startTime);
+
+        const DesyncSnapshot& getLocalSnapshot() const;
+
+        /**
+         * Takes a peer's snapshot.
+         * Returns false if it is not from a peer we are waiting on.
+         */
+        bool addRemoteSnapshot(DesyncSnapshot&& snapshot, Timestamp now);
+
+        /** True once we have waited long enough to write the report. */
+        bool isFinished(Timestamp now) const;
+
+        /** A compact, human-readable report comparing our snapshot with each peer's. */
+        std::string createReport() const;
+    };
+}
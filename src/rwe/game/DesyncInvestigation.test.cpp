@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+#include <rwe/game/DesyncInvestigation.h>
+
+namespace rwe
+{
+    static DesyncTickRecord makeTickRecord(unsigned int sceneTime, unsigned int playersHash, unsigned int player1Commands)
+    {
+        DesyncTickRecord record;
+        record.sceneTime = SceneTime(sceneTime);
+        record.hashes.gameTime = GameHash(sceneTime);
+        record.hashes.players = GameHash(playersHash);
+        record.commandSetHashes = {{PlayerId(0), GameHash(0)}, {PlayerId(1), GameHash(player1Commands)}};
+        return record;
+    }
+
+    TEST_CASE("findDivergence")
+    {
+        DesyncSnapshot a{PlayerId(0), SceneTime(4), {makeTickRecord(2, 10, 0), makeTickRecord(3, 10, 0), makeTickRecord(4, 10, 0)}};
+
+        SECTION("finds nothing when the snapshots agree")
+        {
+            DesyncSnapshot b{PlayerId(1), SceneTime(4), {makeTickRecord(1, 10, 0), makeTickRecord(2, 10, 0), makeTickRecord(3, 10, 0)}};
+            REQUIRE(!findDivergence(a, b));
+        }
+
+        SECTION("finds the first tick that differs among those both have")
+        {
+            DesyncSnapshot b{PlayerId(1), SceneTime(4), {makeTickRecord(1, 99, 0), makeTickRecord(2, 10, 0), makeTickRecord(3, 11, 7), makeTickRecord(4, 12, 0)}};
+            auto divergence = findDivergence(a, b);
+            REQUIRE(divergence);
+            REQUIRE(divergence->sceneTime == SceneTime(3));
+            REQUIRE(divergence->subsystems == std::vector<DesyncSubsystem>{DesyncSubsystem::Commands, DesyncSubsystem::Players});
+            REQUIRE(divergence->commandPlayers == std::vector<PlayerId>{PlayerId(1)});
+        }
+    }
+
+    TEST_CASE("findEntityDifferences")
+    {
+        GameHashBreakdown a;
+        a.playerHashes = {GameHash(1), GameHash(2)};
+        a.unitHashes = {{UnitId(1), GameHash(1)}, {UnitId(2), GameHash(2)}, {UnitId(4), GameHash(4)}};
+
+        GameHashBreakdown b;
+        b.playerHashes = {GameHash(1), GameHash(3)};
+        b.unitHashes = {{UnitId(1), GameHash(1)}, {UnitId(2), GameHash(5)}, {UnitId(3), GameHash(3)}};
+
+        auto differences = findEntityDifferences(a, b);
+        REQUIRE(differences.players == std::vector<PlayerId>{PlayerId(1)});
+        REQUIRE(differences.units == std::vector<UnitId>{UnitId(2), UnitId(3), UnitId(4)});
+        REQUIRE(differences.projectiles.empty());
+    }
+
+    TEST_CASE("DesyncInvestigation")
+    {
+        auto now = Timestamp();
+
+        auto localTick = makeTickRecord(4, 10, 0);
+        localTick.hashes.playerHashes = {GameHash(4), GameHash(6)};
+        DesyncSnapshot local{PlayerId(0), SceneTime(4), {makeTickRecord(3, 10, 0), localTick}};
+
+        auto remoteTick = makeTickRecord(4, 11, 0);
+        remoteTick.hashes.playerHashes = {GameHash(5), GameHash(6)};
+        DesyncSnapshot remote{PlayerId(2), SceneTime(4), {makeTickRecord(3, 10, 0), remoteTick}};
+
+        DesyncInvestigation investigation(std::move(local), {PlayerId(1), PlayerId(2)}, now);
+
+        SECTION("lingers once it has every snapshot")
+        {
+            REQUIRE(!investigation.isFinished(now));
+            REQUIRE(!investigation.addRemoteSnapshot(DesyncSnapshot{PlayerId(3), SceneTime(4), {}}, now));
+            REQUIRE(investigation.addRemoteSnapshot(std::move(remote), now));
+            REQUIRE(investigation.addRemoteSnapshot(DesyncSnapshot{PlayerId(1), SceneTime(4), {}}, now + std::chrono::milliseconds(100)));
+            REQUIRE(!investigation.isFinished(now + std::chrono::milliseconds(100)));
+            REQUIRE(investigation.isFinished(now + std::chrono::milliseconds(100) + DesyncInvestigation::Linger));
+        }
+
+        SECTION("gives up waiting on snapshots")
+        {
+            investigation.addRemoteSnapshot(std::move(remote), now);
+            REQUIRE(!investigation.isFinished(now + DesyncInvestigation::Timeout - std::chrono::milliseconds(1)));
+            REQUIRE(investigation.isFinished(now + DesyncInvestigation::Timeout));
+        }
+
+        SECTION("reports where each peer diverged")
+        {
+            investigation.addRemoteSnapshot(std::move(remote), now);
+            auto report = investigation.createReport();
+            REQUIRE(report.find("Desync at scene time 4, reported by player 0.") != std::string::npos);
+            REQUIRE(report.find("Player 1: sent no snapshot.") != std::string::npos);
+            REQUIRE(report.find("Player 2: first differs at scene time 4, in players.") != std::string::npos);
+            REQUIRE(report.find("Entities that differ at scene time 4; players 0") != std::string::npos);
+        }
+    }
+}
@@ -1,12 +1,13 @@
 #include "GameNetworkService.h"
+#include <algorithm>
 #include <boost/range/adaptors.hpp>
+#include <cmath>
+#include <google/protobuf/io/coded_stream.h>
 #include <rwe/network_util.h>
 #include <rwe/proto/serialization.h>
 #include <rwe/sim/GameHash.h>
 #include <rwe/sim/SimTicksPerSecond.h>
-#include <rwe/util/Index.h>
 #include <rwe/util/OpaqueId_io.h>
-#include <rwe/util/range_util.h>
 #include <spdlog/spdlog.h>
 #include <thread>
 
@@ -16,15 +17,23 @@ namespace rwe
         PlayerId localPlayerId,
         int port,
         const std::vector<GameNetworkService::EndpointInfo>& endpoints,
+        const std::optional<boost::asio::ip::udp::endpoint>& relayEndpoint,
+        const UnitTypeTable& unitTypes,
         PlayerCommandService* playerCommandService)
         : localPlayerId(localPlayerId),
           port(port),
           resolver(ioContext),
           socket(ioContext),
           sendTimer(ioContext),
+          flushTimer(ioContext),
           endpoints(endpoints),
-          playerCommandService(playerCommandService)
+          playerCommandService(playerCommandService),
+          unitTypes(unitTypes)
     {
+        if (relayEndpoint)
+        {
+            relay.emplace(localPlayerId, *relayEndpoint);
+        }
     }
 
     GameNetworkService::~GameNetworkService()
@@ -43,56 +52,139 @@ namespace rwe
 
     void GameNetworkService::submitCommands(SceneTime currentSceneTime, const GameNetworkService::CommandSet& commands)
     {
-        ioContext.post([this, currentSceneTime, commands]() {
-            this->currentSceneTime = currentSceneTime;
-            for (auto& e : endpoints)
-            {
-                e.sendBuffer.push_back(commands);
-            }
-        });
+        // Fill the slot in place so that its command vector's storage is reused.
+        auto slot = commandSubmissions.tryBeginPush();
+        if (slot == nullptr)
+        {
+            throw std::runtime_error("Command submission queue is full, the network thread has stopped");
+        }
+
+        slot->sceneTime = currentSceneTime;
+        slot->commands.assign(commands.begin(), commands.end());
+        commandSubmissions.commitPush();
+
+        notifySubmission();
     }
 
     void GameNetworkService::submitGameHash(GameHash hash)
     {
-        ioContext.post([this, hash]() {
-            for (auto& e : endpoints)
+        if (!hashSubmissions.tryPush(hash))
+        {
+            throw std::runtime_error("Game hash submission queue is full, the network thread has stopped");
+        }
+
+        notifySubmission();
+    }
+
+    void GameNetworkService::submitDesyncSnapshot(const std::string& snapshot)
+    {
+        ioContext.post([this, snapshot]() {
+            desyncSnapshotFragments.clear();
+            for (std::size_t i = 0; i < snapshot.size(); i += DesyncSnapshotFragmentSize)
             {
-                e.hashSendBuffer.push_back(hash);
+                desyncSnapshotFragments.push_back(snapshot.substr(i, DesyncSnapshotFragmentSize));
             }
+
+            spdlog::get("rwe")->info("Sending desync snapshot of {} bytes in {} fragments", snapshot.size(), desyncSnapshotFragments.size());
+            sendToAll();
         });
     }
 
+    std::optional<std::string> GameNetworkService::tryTakeDesyncSnapshot()
+    {
+        return receivedDesyncSnapshots.tryPop();
+    }
+
+    std::vector<PlayerId> GameNetworkService::getRemotePlayerIds() const
+    {
+        // Endpoints' player IDs never change, so it is safe to read them from the game thread.
+        std::vector<PlayerId> playerIds;
+        for (const auto& e : endpoints)
+        {
+            playerIds.push_back(e.playerId);
+        }
+        return playerIds;
+    }
+
     SceneTime GameNetworkService::estimateAvergeSceneTime(SceneTime localSceneTime)
     {
-        std::promise<unsigned int> result;
-        ioContext.post([this, localSceneTime, &result]() {
-            auto time = getTimestamp();
-            auto otherTimes = choose(endpoints, [](const auto& e) { return e.lastKnownSceneTime; });
+        const auto& currentStats = stats.read();
+        return SceneTime(estimateAverageSceneTimeStatic(localSceneTime, currentStats.peerSceneTimes, getTimestamp()));
+    }
 
-            auto finalValue = estimateAverageSceneTimeStatic(localSceneTime, otherTimes, time);
-            result.set_value(finalValue);
-        });
+    const std::vector<PeerLatency>& GameNetworkService::getPeerLatencies()
+    {
+        return stats.read().peerLatencies;
+    }
+
+    template <typename F>
+    void GameNetworkService::forEachUpstream(F&& f)
+    {
+        if (relay)
+        {
+            f(*relay);
+            return;
+        }
+
+        for (auto& e : endpoints)
+        {
+            f(e);
+        }
+    }
+
+    void GameNetworkService::notifySubmission()
+    {
+        // Only one wakeup needs to be waiting at a time,
+        // since it takes everything that is in the queues when it runs.
+        if (!takeSubmissionsPending.exchange(true, std::memory_order_acq_rel))
+        {
+            ioContext.post([this]() { takeSubmissions(); });
+        }
+    }
+
+    void GameNetworkService::takeSubmissions()
+    {
+        // Clear the flag before looking at the queues
+        // so that anything submitted after we look triggers another wakeup.
+        takeSubmissionsPending.exchange(false, std::memory_order_acq_rel);
 
-        return SceneTime(result.get_future().get());
+        auto newCommands = false;
+        while (auto submission = commandSubmissions.front())
+        {
+            currentSceneTime = submission->sceneTime;
+            auto encodedCommands = serializeCommandSet(submission->commands, unitTypes);
+            commandSubmissions.pop();
+
+            forEachUpstream([&](auto& e) { e.sendBuffer.push_back(encodedCommands); });
+            newCommands = true;
+        }
+
+        while (auto hash = hashSubmissions.front())
+        {
+            forEachUpstream([&](auto& e) { e.hashSendBuffer.push_back(*hash); });
+            hashSubmissions.pop();
+        }
+
+        if (newCommands)
+        {
+            scheduleFlush();
+        }
     }
 
-    float GameNetworkService::getMaxAverageRttMillis()
+    void GameNetworkService::publishStats()
     {
-        std::promise<float> result;
-        ioContext.post([this, &result]() {
-            auto maxRtt = 0.0f;
-            for (const auto& e : endpoints)
+        nextStats.peerLatencies.clear();
+        nextStats.peerSceneTimes.clear();
+        for (const auto& e : endpoints)
+        {
+            nextStats.peerLatencies.push_back(PeerLatency{e.averageRoundTripTime, e.roundTripTimeDeviation});
+            if (e.lastKnownSceneTime)
             {
-                if (e.averageRoundTripTime > maxRtt)
-                {
-                    maxRtt = e.averageRoundTripTime;
-                }
+                nextStats.peerSceneTimes.push_back(*e.lastKnownSceneTime);
             }
+        }
 
-            result.set_value(maxRtt);
-        });
-
-        return result.get_future().get();
+        stats.publish(nextStats);
     }
 
     void GameNetworkService::run()
@@ -105,7 +197,7 @@ namespace rwe
 
             listenForNextMessage();
 
-            sendLoop();
+            scheduleNextSend();
 
             ioContext.run();
         }
@@ -134,9 +226,7 @@ namespace rwe
         SequenceNumber nextCommandToReceive,
         GameTime nextHashToSend,
         GameTime nextHashToReceive,
-        std::chrono::milliseconds ackDelay,
-        const std::deque<GameNetworkService::CommandSet>& sendBuffer,
-        const std::deque<GameHash>& gameHashBuffer)
+        std::chrono::milliseconds ackDelay)
     {
         proto::NetworkMessage outerMessage;
         auto& m = *outerMessage.mutable_game_update();
@@ -149,52 +239,112 @@ namespace rwe
         m.set_next_game_hash_to_receive(nextHashToReceive.value);
         m.set_ack_delay(ackDelay.count());
 
-        for (const auto& set : sendBuffer)
+        return outerMessage;
+    }
+
+    void GameNetworkService::scheduleFlush()
+    {
+        if (flushScheduled)
         {
-            auto& setMessage = *m.add_command_set();
+            return;
+        }
 
-            for (const auto& cmd : set)
+        flushScheduled = true;
+        flushTimer.expires_from_now(CommandCoalesceWindow);
+        flushTimer.async_wait([this](const boost::system::error_code& error) {
+            flushScheduled = false;
+            if (error)
             {
-                auto& cmdMessage = *setMessage.add_command();
-                serializePlayerCommand(cmd, cmdMessage);
+                spdlog::get("rwe")->error("Boost error while waiting on timer: {}", error.message());
+                return;
             }
-        }
 
-        for (const auto& hash : gameHashBuffer)
-        {
-            m.add_game_hashes(hash.value);
-        }
-
-        return outerMessage;
+            sendToAll();
+            scheduleNextSend();
+        });
     }
 
-    void GameNetworkService::sendLoop()
+    void GameNetworkService::scheduleNextSend()
     {
-        sendToAll();
-        sendTimer.expires_from_now(std::chrono::milliseconds(100));
+        auto now = getTimestamp();
+        auto nextSendTime = now + KeepAliveInterval;
+        forEachUpstream([&](const auto& e) { nextSendTime = std::min(nextSendTime, getNextSendTime(e, now)); });
+
+        // Setting the expiry cancels any wait already in progress.
+        sendTimer.expires_at(nextSendTime);
         sendTimer.async_wait([this](const boost::system::error_code& error) {
+            if (error == boost::asio::error::operation_aborted)
+            {
+                // rescheduled, a newer wait is in progress
+                return;
+            }
+
             if (error)
             {
                 spdlog::get("rwe")->error("Boost error while waiting on timer: {}", error.message());
                 return;
             }
 
-            sendLoop();
+            sendDue();
+        });
+    }
+
+    void GameNetworkService::sendDue()
+    {
+        auto now = getTimestamp();
+        forEachUpstream([&](auto& e) {
+            if (getNextSendTime(e, now) <= now)
+            {
+                send(e);
+            }
         });
+
+        scheduleNextSend();
+    }
+
+    Timestamp GameNetworkService::getNextSendTime(const EndpointInfo& endpoint, Timestamp now) const
+    {
+        if (!endpoint.lastSendTime)
+        {
+            return now;
+        }
+
+        auto hasUnackedData = !endpoint.sendBuffer.empty() || !endpoint.hashSendBuffer.empty();
+        auto interval = hasUnackedData
+            ? computeRetransmitInterval(endpoint.averageRoundTripTime, endpoint.roundTripTimeDeviation, MinRetransmitInterval, KeepAliveInterval)
+            : KeepAliveInterval;
+        return *endpoint.lastSendTime + interval;
     }
 
     void GameNetworkService::sendToAll()
     {
-        for (auto& e : endpoints)
+        forEachUpstream([&](auto& e) { send(e); });
+    }
+
+    template <typename Message>
+    std::size_t GameNetworkService::addCommandSets(Message& message, const EndpointInfo& endpoint, std::size_t firstSetIndex, std::size_t messageSize)
+    {
+        auto setIndex = firstSetIndex;
+        while (setIndex < endpoint.sendBuffer.size())
         {
-            send(e);
+            const auto& set = endpoint.sendBuffer[setIndex];
+            auto fieldSize = 1 + getVarintSize(set.size()) + set.size();
+            if (messageSize + fieldSize > MaxMessageSize)
+            {
+                break;
+            }
+
+            message.add_command_set(set);
+            messageSize += fieldSize;
+            ++setIndex;
         }
+
+        return setIndex - firstSetIndex;
     }
 
-    void GameNetworkService::send(GameNetworkService::EndpointInfo& endpoint)
+    void GameNetworkService::send(EndpointInfo& endpoint)
     {
-        auto packetId = uniform_dist(gen);
-        spdlog::get("rwe")->debug("Sending packet ID {} to endpoint: {}:{}", packetId, endpoint.endpoint.address().to_string(), endpoint.endpoint.port());
+        spdlog::get("rwe")->debug("Sending to endpoint: {}:{}", endpoint.endpoint.address().to_string(), endpoint.endpoint.port());
         std::chrono::milliseconds delay(0);
         auto sendTime = getTimestamp();
         if (endpoint.lastReceiveTime)
@@ -202,11 +352,202 @@ namespace rwe
             delay = std::chrono::duration_cast<std::chrono::milliseconds>(sendTime - *endpoint.lastReceiveTime);
         }
 
-        auto message = createProtoMessage(packetId, localPlayerId, currentSceneTime, endpoint.nextCommandToSend, endpoint.nextCommandToReceive, endpoint.nextHashToSend, endpoint.nextHashToReceive, delay, endpoint.sendBuffer, endpoint.hashSendBuffer);
-        auto messageSize = message.ByteSize();
-        if (messageSize > getSize(sendBuffer) - 4)
+        auto setsSent = relay ? sendToRelay(endpoint, delay) : sendToPeer(endpoint, delay);
+        sendDesyncSnapshotFragments(endpoint);
+
+        endpoint.lastSendTime = sendTime;
+
+        auto nextSequenceNumber = SequenceNumber(endpoint.nextCommandToSend.value + setsSent);
+        if (endpoint.sendTimes.empty() || endpoint.sendTimes.back().first < nextSequenceNumber)
+        {
+            endpoint.sendTimes.emplace_back(nextSequenceNumber, sendTime);
+        }
+    }
+
+    std::size_t GameNetworkService::sendToPeer(EndpointInfo& endpoint, std::chrono::milliseconds delay)
+    {
+        // Each packet carries as many consecutive command sets as fit,
+        // continuing from where the previous packet left off.
+        std::size_t setsSent = 0;
+        for (unsigned int packetIndex = 0; packetIndex < MaxCommandPacketsPerSend; ++packetIndex)
+        {
+            auto message = createProtoMessage(
+                uniform_dist(gen),
+                localPlayerId,
+                currentSceneTime,
+                SequenceNumber(endpoint.nextCommandToSend.value + setsSent),
+                endpoint.nextCommandToReceive,
+                endpoint.nextHashToSend,
+                endpoint.nextHashToReceive,
+                delay);
+            auto& m = *message.mutable_game_update();
+
+            if (packetIndex == 0)
+            {
+                auto hashCount = std::min(endpoint.hashSendBuffer.size(), MaxGameHashesPerPacket);
+                for (std::size_t i = 0; i < hashCount; ++i)
+                {
+                    m.add_game_hashes(endpoint.hashSendBuffer[i].value);
+                }
+            }
+
+            // allow a couple of bytes for the length prefix of the game update growing
+            auto messageSize = message.ByteSizeLong() + 2;
+            setsSent += addCommandSets(m, endpoint, setsSent, messageSize);
+
+            if (m.command_set_size() == 0 && setsSent < endpoint.sendBuffer.size())
+            {
+                // The next set does not fit in a packet by itself.
+                // Any hashes still need to go, so send this packet anyway
+                // and follow it up with the set in pieces.
+                sendMessage(message, endpoint);
+                sendCommandSetFragments(endpoint, setsSent, delay);
+                ++setsSent;
+                break;
+            }
+
+            sendMessage(message, endpoint);
+
+            if (setsSent == endpoint.sendBuffer.size())
+            {
+                break;
+            }
+        }
+
+        return setsSent;
+    }
+
+    std::size_t GameNetworkService::sendToRelay(EndpointInfo& relayEndpoint, std::chrono::milliseconds delay)
+    {
+        // As sendToPeer, but our stream is one part of a message that also acks everyone else's.
+        std::size_t setsSent = 0;
+        for (unsigned int packetIndex = 0; packetIndex < MaxCommandPacketsPerSend; ++packetIndex)
+        {
+            auto message = createRelayMessage(SequenceNumber(relayEndpoint.nextCommandToSend.value + setsSent), delay);
+            auto& stream = *message.mutable_relay_update()->mutable_streams(0);
+
+            if (packetIndex == 0)
+            {
+                auto hashCount = std::min(relayEndpoint.hashSendBuffer.size(), MaxGameHashesPerPacket);
+                for (std::size_t i = 0; i < hashCount; ++i)
+                {
+                    stream.add_game_hashes(relayEndpoint.hashSendBuffer[i].value);
+                }
+            }
+
+            // allow a few bytes for the length prefixes of the stream and the relay update growing
+            auto messageSize = message.ByteSizeLong() + 4;
+            setsSent += addCommandSets(stream, relayEndpoint, setsSent, messageSize);
+
+            if (stream.command_set_size() == 0 && setsSent < relayEndpoint.sendBuffer.size())
+            {
+                sendMessage(message, relayEndpoint);
+                sendCommandSetFragments(relayEndpoint, setsSent, delay);
+                ++setsSent;
+                break;
+            }
+
+            sendMessage(message, relayEndpoint);
+
+            if (setsSent == relayEndpoint.sendBuffer.size())
+            {
+                break;
+            }
+        }
+
+        return setsSent;
+    }
+
+    void GameNetworkService::sendCommandSetFragments(const EndpointInfo& endpoint, std::size_t setIndex, std::chrono::milliseconds ackDelay)
+    {
+        const auto& set = endpoint.sendBuffer[setIndex];
+        auto fragmentCount = (set.size() + CommandSetFragmentSize - 1) / CommandSetFragmentSize;
+        spdlog::get("rwe")->debug("Sending command set of {} bytes in {} fragments", set.size(), fragmentCount);
+
+        auto addFragment = [&](auto& m, std::size_t i) {
+            m.add_command_set(set.substr(i * CommandSetFragmentSize, CommandSetFragmentSize));
+            m.set_command_set_fragment_index(static_cast<int>(i));
+            m.set_command_set_fragment_count(static_cast<int>(fragmentCount));
+        };
+
+        for (std::size_t i = 0; i < fragmentCount; ++i)
+        {
+            auto sequenceNumber = SequenceNumber(endpoint.nextCommandToSend.value + setIndex);
+            if (relay)
+            {
+                auto message = createRelayMessage(sequenceNumber, ackDelay);
+                addFragment(*message.mutable_relay_update()->mutable_streams(0), i);
+                sendMessage(message, endpoint);
+            }
+            else
+            {
+                auto message = createProtoMessage(
+                    uniform_dist(gen),
+                    localPlayerId,
+                    currentSceneTime,
+                    sequenceNumber,
+                    endpoint.nextCommandToReceive,
+                    endpoint.nextHashToSend,
+                    endpoint.nextHashToReceive,
+                    ackDelay);
+                addFragment(*message.mutable_game_update(), i);
+                sendMessage(message, endpoint);
+            }
+        }
+    }
+
+    void GameNetworkService::sendDesyncSnapshotFragments(EndpointInfo& endpoint)
+    {
+        // We don't know which pieces the peer has,
+        // so we go round them all in turn for as long as we are running.
+        auto count = std::min<std::size_t>(MaxDesyncSnapshotFragmentsPerSend, desyncSnapshotFragments.size());
+        for (std::size_t i = 0; i < count; ++i)
         {
-            throw std::runtime_error("Message to be sent was bigger than buffer size");
+            auto index = endpoint.nextDesyncSnapshotFragment;
+
+            proto::NetworkMessage message;
+            auto& fragment = *message.mutable_desync_snapshot_fragment();
+            fragment.set_player_id(localPlayerId.value);
+            fragment.set_fragment_index(static_cast<int>(index));
+            fragment.set_fragment_count(static_cast<int>(desyncSnapshotFragments.size()));
+            fragment.set_data(desyncSnapshotFragments[index]);
+            sendMessage(message, endpoint);
+
+            endpoint.nextDesyncSnapshotFragment = (index + 1) % desyncSnapshotFragments.size();
+        }
+    }
+
+    proto::NetworkMessage GameNetworkService::createRelayMessage(SequenceNumber nextCommandToSend, std::chrono::milliseconds ackDelay)
+    {
+        proto::NetworkMessage outerMessage;
+        auto& m = *outerMessage.mutable_relay_update();
+        m.set_player_id(localPlayerId.value);
+        m.set_packet_id(uniform_dist(gen));
+        m.set_ack_delay(ackDelay.count());
+
+        auto& stream = *m.add_streams();
+        stream.set_player_id(localPlayerId.value);
+        stream.set_current_scene_time(currentSceneTime.value);
+        stream.set_next_command_set_to_send(nextCommandToSend.value);
+        stream.set_next_game_hash_to_send(relay->nextHashToSend.value);
+
+        for (const auto& e : endpoints)
+        {
+            auto& ack = *m.add_acks();
+            ack.set_player_id(e.playerId.value);
+            ack.set_next_command_set_to_receive(e.nextCommandToReceive.value);
+            ack.set_next_game_hash_to_receive(e.nextHashToReceive.value);
+        }
+
+        return outerMessage;
+    }
+
+    void GameNetworkService::sendMessage(const proto::NetworkMessage& message, const EndpointInfo& endpoint)
+    {
+        auto messageSize = message.ByteSizeLong();
+        if (messageSize + 4 > sendBuffer.size())
+        {
+            throw std::logic_error("Message to be sent was bigger than buffer size");
         }
         if (!message.SerializeToArray(sendBuffer.data(), sendBuffer.size()))
         {
@@ -217,12 +558,34 @@ namespace rwe
         writeInt(&sendBuffer[messageSize], computeCrc(sendBuffer.data(), messageSize));
 
         socket.send_to(boost::asio::buffer(sendBuffer.data(), messageSize + 4), endpoint.endpoint);
+    }
 
-        auto nextSequenceNumber = SequenceNumber(endpoint.nextCommandToSend.value + (endpoint.sendBuffer.size()));
-        if (endpoint.sendTimes.empty() || endpoint.sendTimes.back().first < nextSequenceNumber)
+    /**
+     * Finds the update in a serialized NetworkMessage without parsing the NetworkMessage,
+     * which would allocate a new update each time,
+     * so that the update can be parsed into a message we reuse.
+     * Returns the field number of the update and where its bytes are,
+     * or nothing if the data is not a single length-delimited field.
+     */
+    static std::optional<std::tuple<int, const char*, std::size_t>> findUpdate(const char* data, std::size_t size)
+    {
+        google::protobuf::io::CodedInputStream input(reinterpret_cast<const std::uint8_t*>(data), static_cast<int>(size));
+        auto tag = input.ReadTag();
+
+        // wire type 2 is length-delimited
+        std::uint32_t length;
+        if ((tag & 7u) != 2u || !input.ReadVarint32(&length))
         {
-            endpoint.sendTimes.emplace_back(nextSequenceNumber, sendTime);
+            return std::nullopt;
+        }
+
+        auto offset = static_cast<std::size_t>(input.CurrentPosition());
+        if (offset + length != size)
+        {
+            return std::nullopt;
         }
+
+        return std::make_tuple(static_cast<int>(tag >> 3u), data + offset, static_cast<std::size_t>(length));
     }
 
     void GameNetworkService::receive(const boost::system::error_code& error, std::size_t receivedBytes)
@@ -234,7 +597,12 @@ namespace rwe
         }
 
         auto receiveTime = getTimestamp();
-        spdlog::get("rwe")->debug("Received {} bytes from endpoint: {}:{}", receivedBytes, currentRemoteEndpoint.address().to_string(), currentRemoteEndpoint.port());
+
+        // Formatting the address allocates, so only do it if it will be logged.
+        if (spdlog::get("rwe")->should_log(spdlog::level::debug))
+        {
+            spdlog::get("rwe")->debug("Received {} bytes from endpoint: {}:{}", receivedBytes, currentRemoteEndpoint.address().to_string(), currentRemoteEndpoint.port());
+        }
 
         if (receivedBytes == receiveBuffer.size())
         {
@@ -248,7 +616,8 @@ namespace rwe
         }
 
         auto endpointIt = std::find_if(endpoints.begin(), endpoints.end(), [this](const auto& e) { return currentRemoteEndpoint == e.endpoint; });
-        if (endpointIt == endpoints.end())
+        auto isKnownEndpoint = relay ? currentRemoteEndpoint == relay->endpoint : endpointIt != endpoints.end();
+        if (!isKnownEndpoint)
         {
             // message was from some unknown address, ignore it
             spdlog::get("rwe")->debug("Unknown address, ignoring");
@@ -263,19 +632,65 @@ namespace rwe
             return;
         }
 
-        proto::NetworkMessage outerMessage;
-        outerMessage.ParseFromArray(receiveBuffer.data(), receivedBytes - 4);
-        if (!outerMessage.has_game_update())
+        auto update = findUpdate(receiveBuffer.data(), receivedBytes - 4);
+        if (!update)
         {
-            // message wasn't a game update, ignore it
-            spdlog::get("rwe")->debug("Not game update, ignoring");
+            spdlog::get("rwe")->error("Received malformed message, ignoring");
             return;
         }
 
-        EndpointInfo& endpoint = *endpointIt;
+        const auto& [fieldNumber, updateData, updateSize] = *update;
+        if (relay && fieldNumber == proto::NetworkMessage::kRelayUpdateFieldNumber)
+        {
+            if (!receivedRelayUpdate.ParseFromArray(updateData, updateSize))
+            {
+                spdlog::get("rwe")->error("Received malformed relay update, ignoring");
+                return;
+            }
+
+            receiveRelayUpdate(receivedRelayUpdate, receiveTime);
+        }
+        else if (!relay && fieldNumber == proto::NetworkMessage::kGameUpdateFieldNumber)
+        {
+            if (!receivedGameUpdate.ParseFromArray(updateData, updateSize))
+            {
+                spdlog::get("rwe")->error("Received malformed game update, ignoring");
+                return;
+            }
+
+            receiveGameUpdate(*endpointIt, receivedGameUpdate, receiveTime);
+        }
+        else if (fieldNumber == proto::NetworkMessage::kDesyncSnapshotFragmentFieldNumber)
+        {
+            // These only come once the game has desynced, so allocating here is fine.
+            proto::DesyncSnapshotFragment fragment;
+            if (!fragment.ParseFromArray(updateData, updateSize))
+            {
+                spdlog::get("rwe")->error("Received malformed desync snapshot fragment, ignoring");
+                return;
+            }
+
+            // Through a relay the fragment could be from any player, otherwise it must be from the sender.
+            auto senderIt = relay
+                ? std::find_if(endpoints.begin(), endpoints.end(), [&](const auto& e) { return e.playerId.value == fragment.player_id(); })
+                : endpointIt;
+            if (senderIt == endpoints.end() || senderIt->playerId.value != fragment.player_id())
+            {
+                spdlog::get("rwe")->error("Received desync snapshot fragment for unexpected player {}, ignoring", fragment.player_id());
+                return;
+            }
 
-        const auto& message = outerMessage.game_update();
+            receiveDesyncSnapshotFragment(*senderIt, fragment);
+        }
+        else
+        {
+            // message wasn't an update we expect, ignore it
+            spdlog::get("rwe")->debug("Not game update, ignoring");
+        }
+    }
 
+    void GameNetworkService::receiveGameUpdate(EndpointInfo& endpoint, const proto::GameUpdateMessage& message, Timestamp receiveTime)
+    {
         spdlog::get("rwe")->debug("Packet received with ID {}", message.packet_id());
         if (message.player_id() != endpoint.playerId.value)
         {
@@ -283,18 +698,79 @@ namespace rwe
             return;
         }
 
-        spdlog::get("rwe")->debug("Received ack to {0} and {1} commands starting at {2}", message.next_command_set_to_receive(), message.command_set_size(), message.next_command_set_to_send());
+        receiveAcks(
+            endpoint,
+            SequenceNumber(message.next_command_set_to_receive()),
+            GameTime(message.next_game_hash_to_receive()),
+            std::chrono::milliseconds(message.ack_delay()),
+            receiveTime);
+
+        receiveStream(endpoint, message, receiveTime);
+
+        publishStats();
+    }
+
+    void GameNetworkService::receiveRelayUpdate(const proto::RelayUpdateMessage& message, Timestamp receiveTime)
+    {
+        spdlog::get("rwe")->debug("Relay packet received with ID {}", message.packet_id());
+        if (message.player_id() != localPlayerId.value)
+        {
+            spdlog::get("rwe")->error("Relay sent an update for the wrong player ID: {}", message.player_id());
+            return;
+        }
+
+        for (const auto& ack : message.acks())
+        {
+            if (ack.player_id() == localPlayerId.value)
+            {
+                receiveAcks(
+                    *relay,
+                    SequenceNumber(ack.next_command_set_to_receive()),
+                    GameTime(ack.next_game_hash_to_receive()),
+                    std::chrono::milliseconds(message.ack_delay()),
+                    receiveTime);
+            }
+        }
+
+        for (const auto& stream : message.streams())
+        {
+            auto endpointIt = std::find_if(endpoints.begin(), endpoints.end(), [&](const auto& e) { return e.playerId.value == stream.player_id(); });
+            if (endpointIt == endpoints.end())
+            {
+                spdlog::get("rwe")->error("Relay sent stream for unknown player ID: {}", stream.player_id());
+                continue;
+            }
+
+            // Everything to and from this player goes through the relay,
+            // so the round trip is ours to the relay plus theirs.
+            endpointIt->averageRoundTripTime = relay->averageRoundTripTime + stream.round_trip_time();
+            endpointIt->roundTripTimeDeviation = relay->roundTripTimeDeviation + stream.round_trip_time_deviation();
+
+            receiveStream(*endpointIt, stream, receiveTime);
+
+            // The relay's ack delay is measured from the last time it sent us anything new.
+            if (endpointIt->lastReceiveTime == receiveTime)
+            {
+                relay->lastReceiveTime = receiveTime;
+            }
+        }
+
+        publishStats();
+    }
 
-        SequenceNumber newNextCommandToSend(message.next_command_set_to_receive());
-        if (newNextCommandToSend.value > endpoint.nextCommandToSend.value + endpoint.sendBuffer.size())
+    void GameNetworkService::receiveAcks(EndpointInfo& endpoint, SequenceNumber nextCommandToReceive, GameTime nextHashToReceive, std::chrono::milliseconds ackDelay, Timestamp receiveTime)
+    {
+        spdlog::get("rwe")->debug("Received ack to {0}", nextCommandToReceive.value);
+
+        if (nextCommandToReceive.value > endpoint.nextCommandToSend.value + endpoint.sendBuffer.size())
         {
             spdlog::get("rwe")->error(
                 "Remote acked up to {0}, but we are at {1} and command buffer contains {2} elements",
-                newNextCommandToSend.value,
+                nextCommandToReceive.value,
                 endpoint.nextCommandToSend.value,
                 endpoint.sendBuffer.size());
         }
-        while (newNextCommandToSend > endpoint.nextCommandToSend && !endpoint.sendBuffer.empty())
+        while (nextCommandToReceive > endpoint.nextCommandToSend && !endpoint.sendBuffer.empty())
         {
             endpoint.sendBuffer.pop_front();
             endpoint.nextCommandToSend = SequenceNumber(endpoint.nextCommandToSend.value + 1);
@@ -308,13 +784,34 @@ namespace rwe
         if (!endpoint.sendTimes.empty() && endpoint.nextCommandToSend == endpoint.sendTimes.front().first)
         {
             auto roundTripTime = receiveTime - endpoint.sendTimes.front().second;
-            auto ackDelay = std::chrono::milliseconds(message.ack_delay());
             roundTripTime = roundTripTime > ackDelay ? roundTripTime - ackDelay : std::chrono::milliseconds(0);
             auto rttMillis = std::chrono::duration_cast<std::chrono::milliseconds>(roundTripTime).count();
+            auto deviation = std::abs(static_cast<float>(rttMillis) - endpoint.averageRoundTripTime);
+            endpoint.roundTripTimeDeviation = ema(deviation, endpoint.roundTripTimeDeviation, 0.25f);
             endpoint.averageRoundTripTime = ema(rttMillis, endpoint.averageRoundTripTime, 0.1f);
             spdlog::get("rwe")->debug("Average RTT: {0}ms", endpoint.averageRoundTripTime);
         }
 
+        if (nextHashToReceive > endpoint.nextHashToSend + GameTime(endpoint.hashSendBuffer.size()))
+        {
+            spdlog::get("rwe")->error(
+                "Remote acked up to {0}, but we are at {1} and hash buffer contains {2} elements",
+                nextHashToReceive.value,
+                endpoint.nextHashToSend.value,
+                endpoint.hashSendBuffer.size());
+        }
+        while (nextHashToReceive > endpoint.nextHashToSend && !endpoint.hashSendBuffer.empty())
+        {
+            endpoint.hashSendBuffer.pop_front();
+            endpoint.nextHashToSend += GameTime(1);
+        }
+    }
+
+    template <typename Message>
+    void GameNetworkService::receiveStream(EndpointInfo& endpoint, const Message& message, Timestamp receiveTime)
+    {
+        spdlog::get("rwe")->debug("Received {0} commands starting at {1}", message.command_set_size(), message.next_command_set_to_send());
+
         auto extraFrames = static_cast<unsigned int>((endpoint.averageRoundTripTime / 2.0f) * SimTicksPerSecond / 1000.0f);
         endpoint.lastKnownSceneTime = std::make_pair(SceneTime(message.current_scene_time() + extraFrames), receiveTime);
         spdlog::get("rwe")->debug("Estimated peer scene time: {0}", endpoint.lastKnownSceneTime->first.value);
@@ -322,40 +819,53 @@ namespace rwe
         SequenceNumber firstCommandNumber(message.next_command_set_to_send());
         if (firstCommandNumber > endpoint.nextCommandToReceive)
         {
-            // message starts with commands too far in the future, ignore it.
-            // FIXME: this should probably be an error as it shouldn't ever happen
-            spdlog::get("rwe")->error("First command number in message was too high! Expecting no more than {0}, received {1}", endpoint.nextCommandToReceive.value, firstCommandNumber.value);
-            return;
+            // An earlier packet from the same send was lost or reordered.
+            // These commands will be sent again once we have acked the ones before them.
+            spdlog::get("rwe")->debug("First command number in message was too high, expecting no more than {0}, received {1}", endpoint.nextCommandToReceive.value, firstCommandNumber.value);
         }
-
-        auto firstRelevantCommandIndex = (endpoint.nextCommandToReceive - firstCommandNumber).value;
-
-        // if the packet is relevant (contains new information), process it
-        if (firstRelevantCommandIndex < static_cast<unsigned int>(message.command_set_size()))
+        else if (message.has_command_set_fragment_count())
         {
-            endpoint.lastReceiveTime = receiveTime;
-
-            for (int i = firstRelevantCommandIndex; i < message.command_set_size(); ++i)
+            if (firstCommandNumber == endpoint.nextCommandToReceive)
             {
-                auto commandSet = deserializeCommandSet(message.command_set(i));
-                playerCommandService->pushCommands(endpoint.playerId, commandSet);
-                endpoint.nextCommandToReceive = SequenceNumber(endpoint.nextCommandToReceive.value + 1);
+                receiveCommandSetFragment(endpoint, message, receiveTime);
             }
         }
-
-        GameTime newNextHashToSend(message.next_game_hash_to_receive());
-        if (newNextHashToSend > endpoint.nextHashToSend + GameTime(endpoint.hashSendBuffer.size()))
-        {
-            spdlog::get("rwe")->error(
-                "Remote acked up to {0}, but we are at {1} and hash buffer contains {2} elements",
-                newNextHashToSend.value,
-                endpoint.nextHashToSend.value,
-                endpoint.hashSendBuffer.size());
-        }
-        while (newNextHashToSend > endpoint.nextHashToSend && !endpoint.hashSendBuffer.empty())
+        else
         {
-            endpoint.hashSendBuffer.pop_front();
-            endpoint.nextHashToSend += GameTime(1);
+            auto firstRelevantCommandIndex = (endpoint.nextCommandToReceive - firstCommandNumber).value;
+
+            // if the packet is relevant (contains new information), process it
+            if (firstRelevantCommandIndex < static_cast<unsigned int>(message.command_set_size()))
+            {
+                endpoint.lastReceiveTime = receiveTime;
+
+                for (int i = firstRelevantCommandIndex; i < message.command_set_size(); ++i)
+                {
+                    const auto& set = message.command_set(i);
+                    bool pushed;
+                    try
+                    {
+                        pushed = playerCommandService->tryEmplaceCommands(endpoint.playerId, [&](auto& commands) {
+                            deserializeCommandSet(set.data(), set.size(), unitTypes, commands);
+                        });
+                    }
+                    catch (const std::runtime_error& e)
+                    {
+                        // Nothing is pushed for the bad set, and it and the sets after it stay unacked.
+                        spdlog::get("rwe")->error("Received malformed command set from player {0}, ignoring: {1}", endpoint.playerId.value, e.what());
+                        return;
+                    }
+                    if (!pushed)
+                    {
+                        // The game is not keeping up. Leave the rest unacked
+                        // so that the peer sends them again later.
+                        spdlog::get("rwe")->warn("Command buffer for player {0} is full", endpoint.playerId.value);
+                        break;
+                    }
+                    endpoint.nextCommandToReceive = SequenceNumber(endpoint.nextCommandToReceive.value + 1);
+                }
+                endpoint.commandSetFragmentsReceived.clear();
+            }
         }
 
         GameTime firstGameHashTime(message.next_game_hash_to_send());
@@ -370,8 +880,126 @@ namespace rwe
         auto firstRelevantGameHashIndex = (endpoint.nextHashToReceive - firstGameHashTime).value;
         for (int i = firstRelevantGameHashIndex; i < message.game_hashes_size(); ++i)
         {
-            playerCommandService->pushHash(endpoint.playerId, GameHash(message.game_hashes(i)));
+            if (!playerCommandService->tryPushHash(endpoint.playerId, GameHash(message.game_hashes(i))))
+            {
+                spdlog::get("rwe")->warn("Hash buffer for player {0} is full", endpoint.playerId.value);
+                break;
+            }
             endpoint.nextHashToReceive += GameTime(1);
         }
     }
+
+    template <typename Message>
+    void GameNetworkService::receiveCommandSetFragment(EndpointInfo& endpoint, const Message& message, Timestamp receiveTime)
+    {
+        auto fragmentCount = message.command_set_fragment_count();
+        auto fragmentIndex = message.command_set_fragment_index();
+        auto isLastFragment = fragmentIndex == fragmentCount - 1;
+
+        // Every fragment but the last is full size, which puts each at a known place in the set.
+        if (fragmentCount <= 0
+            || fragmentCount > MaxCommandSetFragmentCount
+            || fragmentIndex < 0
+            || fragmentIndex >= fragmentCount
+            || message.command_set_size() != 1
+            || message.command_set(0).size() > CommandSetFragmentSize
+            || (!isLastFragment && message.command_set(0).size() != CommandSetFragmentSize))
+        {
+            spdlog::get("rwe")->error("Received malformed command set fragment {0} of {1}", fragmentIndex, fragmentCount);
+            return;
+        }
+
+        auto& data = endpoint.commandSetFragmentData;
+        auto& received = endpoint.commandSetFragmentsReceived;
+        if (received.size() != static_cast<std::size_t>(fragmentCount))
+        {
+            received.assign(fragmentCount, false);
+            data.clear();
+        }
+
+        if (!received[fragmentIndex])
+        {
+            endpoint.lastReceiveTime = receiveTime;
+
+            const auto& fragment = message.command_set(0);
+            auto offset = fragmentIndex * CommandSetFragmentSize;
+            data.resize(std::max(data.size(), offset + fragment.size()));
+            std::copy(fragment.begin(), fragment.end(), data.begin() + offset);
+            received[fragmentIndex] = true;
+        }
+
+        if (!std::all_of(received.begin(), received.end(), [](bool r) { return r; }))
+        {
+            return;
+        }
+
+        bool pushed;
+        try
+        {
+            pushed = playerCommandService->tryEmplaceCommands(endpoint.playerId, [&](auto& commands) {
+                deserializeCommandSet(data.data(), data.size(), unitTypes, commands);
+            });
+        }
+        catch (const std::runtime_error& e)
+        {
+            // Throw away the fragments so that the set is reassembled from scratch when the peer resends.
+            spdlog::get("rwe")->error("Received malformed command set from player {0}, ignoring: {1}", endpoint.playerId.value, e.what());
+            received.clear();
+            return;
+        }
+        if (!pushed)
+        {
+            // keep the fragments and try again when the peer resends
+            spdlog::get("rwe")->warn("Command buffer for player {0} is full", endpoint.playerId.value);
+            return;
+        }
+
+        received.clear();
+        endpoint.nextCommandToReceive = SequenceNumber(endpoint.nextCommandToReceive.value + 1);
+    }
+
+    void GameNetworkService::receiveDesyncSnapshotFragment(EndpointInfo& endpoint, const proto::DesyncSnapshotFragment& message)
+    {
+        if (endpoint.desyncSnapshotReceived)
+        {
+            return;
+        }
+
+        auto fragmentCount = message.fragment_count();
+        auto fragmentIndex = message.fragment_index();
+        if (fragmentCount <= 0 || fragmentCount > MaxDesyncSnapshotFragmentCount || fragmentIndex < 0 || fragmentIndex >= fragmentCount)
+        {
+            spdlog::get("rwe")->error("Received malformed desync snapshot fragment {0} of {1}", fragmentIndex, fragmentCount);
+            return;
+        }
+
+        auto& fragments = endpoint.desyncSnapshotFragments;
+        if (fragments.size() != static_cast<std::size_t>(fragmentCount))
+        {
+            fragments.clear();
+            fragments.resize(fragmentCount);
+        }
+
+        fragments[fragmentIndex] = message.data();
+        if (!std::all_of(fragments.begin(), fragments.end(), [](const auto& f) { return f.has_value(); }))
+        {
+            return;
+        }
+
+        std::string snapshot;
+        for (const auto& f : fragments)
+        {
+            snapshot += *f;
+        }
+
+        if (!receivedDesyncSnapshots.tryPush(std::move(snapshot)))
+        {
+            spdlog::get("rwe")->error("Desync snapshot queue is full, dropping snapshot from player {}", endpoint.playerId.value);
+            return;
+        }
+
+        spdlog::get("rwe")->info("Received desync snapshot from player {}", endpoint.playerId.value);
+        endpoint.desyncSnapshotReceived = true;
+        fragments.clear();
+    }
 }
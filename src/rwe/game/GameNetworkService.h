@@ -1,29 +1,118 @@
 #pragma once
 
+#include <atomic>
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp> // not in asio.hpp in old boost versions
 #include <chrono>
 #include <deque>
-#include <future>
 #include <network.pb.h>
+#include <optional>
 #include <random>
+#include <rwe/collections/SpscQueue.h>
+#include <rwe/collections/TripleBuffer.h>
+#include <rwe/game/PeerLatency.h>
 #include <rwe/game/PlayerCommand.h>
 #include <rwe/game/PlayerCommandService.h>
+#include <rwe/proto/UnitTypeTable.h>
 #include <rwe/rwe_time.h>
 #include <rwe/sim/GameHash.h>
 #include <rwe/sim/GameTime.h>
 #include <rwe/sim/PlayerId.h>
 #include <rwe/util/OpaqueId.h>
 #include <rwe/util/OpaqueUnit.h>
+#include <string>
 
 namespace rwe
 {
     struct SequenceNumberTag;
     using SequenceNumber = OpaqueUnit<unsigned int, SequenceNumberTag>;
 
+    /**
+     * Exchanges player commands and game hashes with remote peers.
+     *
+     * Sending is driven by events rather than a fixed timer.
+     * Submitting new commands sends to every peer straight away,
+     * after a short window in which further submissions are coalesced into the same packet.
+     * Peers with unacked data are sent to again after a retransmit interval
+     * derived from the measured round trip time,
+     * and idle peers are sent to at a slower keep-alive interval
+     * so that acks and scene times keep flowing.
+     *
+     * The game thread never waits on the network thread.
+     * Commands and hashes are handed over through lock-free queues,
+     * and round trip times and peer scene times are published
+     * by the network thread as a snapshot the game thread reads.
+     *
+     * Receiving does not allocate once warmed up.
+     * Updates are parsed into messages that are reused from packet to packet,
+     * and commands are decoded from them straight into the command buffers' slots,
+     * reusing the storage of sets the game has already popped.
+     * Unit types are sent as IDs from a table that every peer builds from its unit definitions.
+     *
+     * In relay mode we send only to a relay server (see RelayServer),
+     * which forwards our commands and hashes to every other peer
+     * and sends us theirs merged into one message.
+     * Each remote player still has an endpoint for tracking their stream,
+     * but its round trip time is ours to the relay plus theirs.
+     *
+     * Once the game hashes differ, the game submits a desync snapshot (see DesyncHistory),
+     * which we send to every peer a few pieces at a time, over and over,
+     * until the game is done with us. Snapshots from peers are handed to the game as they complete.
+     */
     class GameNetworkService
     {
     public:
+        /** Commands submitted within this long of each other are sent in the same packet. */
+        static constexpr std::chrono::milliseconds CommandCoalesceWindow{2};
+
+        static constexpr std::chrono::milliseconds MinRetransmitInterval{15};
+
+        /**
+         * The longest we go without sending to a peer,
+         * whether or not we have anything new to tell it.
+         */
+        static constexpr std::chrono::milliseconds KeepAliveInterval{100};
+
+        /**
+         * The largest message we put in one packet.
+         * Kept well below the typical internet MTU so that packets are not fragmented.
+         */
+        static constexpr std::size_t MaxMessageSize = 1200;
+
+        /**
+         * The most packets of command sets we send to a peer at once.
+         * Unacked sets beyond these wait until the earlier ones are acked,
+         * so a large backlog is not resent in full every time we send.
+         */
+        static constexpr unsigned int MaxCommandPacketsPerSend = 4;
+
+        /** The most game hashes we send to a peer at once. */
+        static constexpr std::size_t MaxGameHashesPerPacket = 64;
+
+        /** The size of each piece of a command set that is too big for one packet. */
+        static constexpr std::size_t CommandSetFragmentSize = 1024;
+
+        /**
+         * The most pieces we accept a command set in, which bounds the memory a peer can make us use.
+         * This is far more than any player can issue in one tick.
+         */
+        static constexpr int MaxCommandSetFragmentCount = 1024;
+
+        /**
+         * How many submissions of each kind can wait for the network thread.
+         * This is many seconds' worth, so filling it means the network thread has stopped.
+         */
+        static constexpr std::size_t SubmissionQueueCapacity = 4096;
+
+        /** The size of each piece of a desync snapshot, which is too big for one packet. */
+        static constexpr std::size_t DesyncSnapshotFragmentSize = 1024;
+
+        /** The most pieces of our desync snapshot we send to a peer at once. */
+        static constexpr unsigned int MaxDesyncSnapshotFragmentsPerSend = 4;
+
+        /** The most pieces we accept a peer's desync snapshot in, which bounds the memory it can make us use. */
+        static constexpr int MaxDesyncSnapshotFragmentCount = 1024;
+
         using CommandSet = std::vector<PlayerCommand>;
         struct EndpointInfo
         {
@@ -50,10 +139,27 @@ namespace rwe
              */
             std::optional<std::pair<SceneTime, Timestamp>> lastKnownSceneTime;
 
-            std::deque<CommandSet> sendBuffer;
+            /** Unacked command sets, encoded by serializeCommandSet. */
+            std::deque<std::string> sendBuffer;
+
+            /**
+             * When the command set at nextCommandToReceive was too big to be sent in one packet,
+             * the fragments of it received so far, each at its place in the set,
+             * and which fragments those are. Reused from one set to the next.
+             */
+            std::string commandSetFragmentData;
+            std::vector<bool> commandSetFragmentsReceived;
 
             std::deque<GameHash> hashSendBuffer;
 
+            /** The next piece of our desync snapshot to send to this endpoint. */
+            std::size_t nextDesyncSnapshotFragment{0};
+
+            /** The pieces received so far of this player's desync snapshot. */
+            std::vector<std::optional<std::string>> desyncSnapshotFragments;
+
+            bool desyncSnapshotReceived{false};
+
             /**
              * Records the time at which we first sent a packet
              * finishing at the given sequence number.
@@ -67,6 +173,15 @@ namespace rwe
              */
             float averageRoundTripTime{0};
 
+            /**
+             * Exponential moving average of the difference
+             * between each round trip time measurement and the average.
+             */
+            float roundTripTimeDeviation{0};
+
+            /** The time at which we last sent a packet to the remote peer. */
+            std::optional<Timestamp> lastSendTime;
+
             EndpointInfo(const PlayerId& playerId, const boost::asio::ip::udp::endpoint& endpoint)
                 : playerId(playerId), endpoint(endpoint)
             {
@@ -74,6 +189,19 @@ namespace rwe
         };
 
     private:
+        struct CommandSubmission
+        {
+            SceneTime sceneTime;
+            CommandSet commands;
+        };
+
+        /** Network state that the game thread needs, published by the network thread. */
+        struct NetworkStats
+        {
+            std::vector<PeerLatency> peerLatencies;
+            std::vector<std::pair<SceneTime, Timestamp>> peerSceneTimes;
+        };
+
         std::random_device rd;
         std::default_random_engine gen{rd()};
         std::uniform_int_distribution<int> uniform_dist{};
@@ -86,19 +214,58 @@ namespace rwe
         boost::asio::ip::udp::resolver resolver;
         boost::asio::ip::udp::socket socket;
         boost::asio::steady_timer sendTimer;
+        boost::asio::steady_timer flushTimer;
+        bool flushScheduled{false};
 
         std::vector<EndpointInfo> endpoints;
 
+        /** In relay mode, the relay server, which is the only endpoint we send to. */
+        std::optional<EndpointInfo> relay;
+
         std::array<char, 1500> sendBuffer;
         std::array<char, 1500> receiveBuffer;
         boost::asio::ip::udp::endpoint currentRemoteEndpoint;
 
         PlayerCommandService* const playerCommandService;
 
+        UnitTypeTable unitTypes;
+
         SceneTime currentSceneTime{0};
 
+        SpscQueue<CommandSubmission> commandSubmissions{SubmissionQueueCapacity};
+        SpscQueue<GameHash> hashSubmissions{SubmissionQueueCapacity};
+
+        /** True while a call to takeSubmissions is waiting to run on the network thread. */
+        std::atomic<bool> takeSubmissionsPending{false};
+
+        TripleBuffer<NetworkStats> stats;
+
+        /** Reused for every packet received, so that protobuf keeps the storage of their fields. */
+        proto::GameUpdateMessage receivedGameUpdate;
+        proto::RelayUpdateMessage receivedRelayUpdate;
+
+        /** Reused for every snapshot published. */
+        NetworkStats nextStats;
+
+        /** Our desync snapshot, in pieces, once the game has submitted it. */
+        std::vector<std::string> desyncSnapshotFragments;
+
+        /** Complete desync snapshots from peers. There is at most one per peer. */
+        SpscQueue<std::string> receivedDesyncSnapshots{16};
+
     public:
-        GameNetworkService(PlayerId localPlayerId, int port, const std::vector<EndpointInfo>& endpoints, PlayerCommandService* playerCommandService);
+        /**
+         * @param relayEndpoint If given, we run in relay mode and send only to this address.
+         *                      The addresses of the other endpoints are then not used.
+         * @param unitTypes The table that commands are encoded with, which must be the same on every peer.
+         */
+        GameNetworkService(
+            PlayerId localPlayerId,
+            int port,
+            const std::vector<EndpointInfo>& endpoints,
+            const std::optional<boost::asio::ip::udp::endpoint>& relayEndpoint,
+            const UnitTypeTable& unitTypes,
+            PlayerCommandService* playerCommandService);
 
         virtual ~GameNetworkService();
 
@@ -117,21 +284,100 @@ namespace rwe
 
         void submitGameHash(GameHash hash);
 
+        /** Starts sending a serialized DesyncSnapshot to every peer. */
+        void submitDesyncSnapshot(const std::string& snapshot);
+
+        /** Returns the next serialized DesyncSnapshot received from a peer, if any. */
+        std::optional<std::string> tryTakeDesyncSnapshot();
+
+        /** The IDs of the players we exchange commands with. */
+        std::vector<PlayerId> getRemotePlayerIds() const;
+
         SceneTime estimateAvergeSceneTime(SceneTime localSceneTime);
 
-        float getMaxAverageRttMillis();
+        /** The returned reference is valid until the next call to this or estimateAvergeSceneTime. */
+        const std::vector<PeerLatency>& getPeerLatencies();
 
     private:
         void run();
 
         void listenForNextMessage();
 
-        void sendLoop();
+        /** Called by the game thread after submitting to make sure the network thread takes the submissions. */
+        void notifySubmission();
+
+        void takeSubmissions();
+
+        void publishStats();
+
+        /**
+         * Calls f with each endpoint we send our commands and hashes to.
+         * This is every peer, or just the relay in relay mode.
+         */
+        template <typename F>
+        void forEachUpstream(F&& f);
+
+        /** Sends to every upstream after the coalesce window, unless already scheduled. */
+        void scheduleFlush();
+
+        /** Sets the send timer to wake when the next upstream is due to be sent to. */
+        void scheduleNextSend();
+
+        /** Sends to every upstream that is due to be sent to. */
+        void sendDue();
+
+        Timestamp getNextSendTime(const EndpointInfo& endpoint, Timestamp now) const;
 
         void sendToAll();
 
         void send(EndpointInfo& endpoint);
 
+        /** Sends our unacked commands and hashes to a peer. Returns the number of command sets sent. */
+        std::size_t sendToPeer(EndpointInfo& endpoint, std::chrono::milliseconds ackDelay);
+
+        /** As sendToPeer, but to the relay, with our acks of every other player's stream. */
+        std::size_t sendToRelay(EndpointInfo& relayEndpoint, std::chrono::milliseconds ackDelay);
+
+        /**
+         * Adds as many command sets from the send buffer to the message as fit,
+         * starting at the given index. Returns the number added.
+         */
+        template <typename Message>
+        std::size_t addCommandSets(Message& message, const EndpointInfo& endpoint, std::size_t firstSetIndex, std::size_t messageSize);
+
+        /** Sends the command set at the given index of the send buffer in several packets. */
+        void sendCommandSetFragments(const EndpointInfo& endpoint, std::size_t setIndex, std::chrono::milliseconds ackDelay);
+
+        /**
+         * Creates a message to the relay holding our stream, without any commands or hashes yet,
+         * and our acks of every other player's stream.
+         */
+        proto::NetworkMessage createRelayMessage(SequenceNumber nextCommandToSend, std::chrono::milliseconds ackDelay);
+
+        void sendMessage(const proto::NetworkMessage& message, const EndpointInfo& endpoint);
+
         void receive(const boost::system::error_code& error, std::size_t receivedBytes);
+
+        void receiveGameUpdate(EndpointInfo& endpoint, const proto::GameUpdateMessage& message, Timestamp receiveTime);
+
+        void receiveRelayUpdate(const proto::RelayUpdateMessage& message, Timestamp receiveTime);
+
+        /** Processes the remote end's acks of our commands and hashes and measures round trip time from them. */
+        void receiveAcks(EndpointInfo& endpoint, SequenceNumber nextCommandToReceive, GameTime nextHashToReceive, std::chrono::milliseconds ackDelay, Timestamp receiveTime);
+
+        /**
+         * Takes the remote player's scene time, commands and hashes from a message carrying their stream.
+         * This is either a GameUpdateMessage or a PlayerStreamMessage, which share field names.
+         */
+        template <typename Message>
+        void receiveStream(EndpointInfo& endpoint, const Message& message, Timestamp receiveTime);
+
+        template <typename Message>
+        void receiveCommandSetFragment(EndpointInfo& endpoint, const Message& message, Timestamp receiveTime);
+
+        /** Sends the next few pieces of our desync snapshot, if we have one. */
+        void sendDesyncSnapshotFragments(EndpointInfo& endpoint);
+
+        void receiveDesyncSnapshotFragment(EndpointInfo& endpoint, const proto::DesyncSnapshotFragment& message);
     };
 }
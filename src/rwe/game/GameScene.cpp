@@ -7,6 +7,7 @@
 #include <rwe/Mesh.h>
 #include <rwe/camera_util.h>
 #include <rwe/game/GameScene_util.h>
+#include <rwe/game/PlayerCommand_util.h>
 #include <rwe/game/dump_util.h>
 #include <rwe/game/matrix_util.h>
 #include <rwe/resource_io.h>
@@ -215,7 +216,9 @@ namespace rwe
         const std::shared_ptr<SpriteSeries>& guiFont,
         PlayerId localPlayerId,
         TdfBlock* audioLookup,
-        std::optional<std::ofstream>&& stateLogStream)
+        std::optional<std::ofstream>&& stateLogStream,
+        std::optional<ReplayWriter>&& replayWriter,
+        bool dumpStateOnDesync)
         : sceneContext(sceneContext),
           worldViewport(CroppedViewport(this->sceneContext.viewport, GuiSizeLeft, GuiSizeTop, GuiSizeRight, GuiSizeBottom)),
           playerCommandService(std::move(playerCommandService)),
@@ -237,7 +240,9 @@ namespace rwe
           guiFont(guiFont),
           localPlayerId(localPlayerId),
           uiFactory(sceneContext.textureService, sceneContext.audioService, audioLookup, sceneContext.vfs, sceneContext.pathMapping, sceneContext.viewport->width(), sceneContext.viewport->height()),
-          stateLogStream(std::move(stateLogStream))
+          stateLogStream(std::move(stateLogStream)),
+          replayWriter(std::move(replayWriter)),
+          dumpStateOnDesync(dumpStateOnDesync)
     {
     }
 
@@ -1102,10 +1107,9 @@ namespace rwe
                 ImGui::SetNextItemOpen(true, ImGuiCond_Once);
                 if (ImGui::TreeNode("Sleeping"))
                 {
-                    for (Index i = 0; i < getSize(unit.cobEnvironment->sleepingQueue); ++i)
+                    for (const auto& entry : unit.cobEnvironment->sleepingQueue)
                     {
-                        const auto& pair = unit.cobEnvironment->sleepingQueue[i];
-                        ImGui::Text("%s, wake time: %d", pair.second->name.c_str(), pair.first.value);
+                        ImGui::Text("%s, wake tick: %u", entry.thread->name.c_str(), entry.wakeTick);
                     }
                     ImGui::TreePop();
                 }
@@ -1125,6 +1129,56 @@ namespace rwe
         }
     }
 
+#ifdef RWE_COB_PROFILING
+    std::string getCobScriptName(const GameSimulation& simulation, const CobScript* script)
+    {
+        for (const auto& [name, s] : simulation.unitScriptDefinitions)
+        {
+            if (&s == script)
+            {
+                return name;
+            }
+        }
+
+        return "<unknown>";
+    }
+
+    void renderCobProfilerSection(GameSimulation& simulation)
+    {
+        if (ImGui::Button("Reset"))
+        {
+            simulation.cobProfiler.reset();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Dump CSV"))
+        {
+            std::ofstream dumpFile;
+            dumpFile.open("rwe-cob-profile-" + std::to_string(simulation.gameTime.value) + ".csv");
+            simulation.cobProfiler.writeCsv(dumpFile, [&](const CobScript* script) { return getCobScriptName(simulation, script); });
+            dumpFile.close();
+        }
+
+        // Only the most expensive functions are shown,
+        // the CSV dump contains everything.
+        const Index maxRows = 30;
+        auto entries = simulation.cobProfiler.getEntriesByTime();
+        for (Index i = 0; i < std::min(getSize(entries), maxRows); ++i)
+        {
+            const auto& entry = entries[i];
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(entry.stats->time).count();
+            ImGui::Text(
+                "%s:%s%s, %lld us, %llu execs, %llu instrs, %llu piece cmds",
+                getCobScriptName(simulation, entry.script).c_str(),
+                entry.functionName->c_str(),
+                entry.native ? " (native)" : "",
+                static_cast<long long>(micros),
+                static_cast<unsigned long long>(entry.stats->executions),
+                static_cast<unsigned long long>(entry.stats->instructions),
+                static_cast<unsigned long long>(entry.stats->pieceCommands));
+        }
+    }
+#endif
+
     void GameScene::renderDebugWindow()
     {
         if (!showDebugWindow)
@@ -1171,6 +1225,22 @@ namespace rwe
             ImGui::LabelText("Unit sounds", "%lld", getSize(playingUnitChannels));
             ImGui::LabelText("Sound volume", "%d", computeSoundVolume(getSize(playingUnitChannels)));
         }
+        ImGui::LabelText("COB threads woken", "%u", simulation.cobThreadsWokenThisTick);
+        {
+            const auto& pathCacheStats = simulation.pathFindingService.getPathCacheStats();
+            auto pathCacheLookups = pathCacheStats.hits + pathCacheStats.misses;
+            auto pathCacheHitRate = pathCacheLookups == 0 ? 0.0f : (100.0f * static_cast<float>(pathCacheStats.hits)) / static_cast<float>(pathCacheLookups);
+            ImGui::LabelText("Path cache hits", "%u / %u (%.1f%%)", pathCacheStats.hits, pathCacheLookups, pathCacheHitRate);
+            ImGui::LabelText("Path cache stale", "%u", pathCacheStats.staleHits);
+        }
+        {
+            const auto& lockstepMetrics = lockstepGovernor.getMetrics();
+            ImGui::LabelText("Command delay", "%u ticks", lockstepMetrics.commandDelayTicks);
+            ImGui::LabelText("Tick interval", "%d ms", lockstepMetrics.tickIntervalMillis);
+            ImGui::LabelText("Stalls", "%u (%lld ms total)", lockstepMetrics.stallCount, static_cast<long long>(lockstepMetrics.totalStallDuration.count()));
+            ImGui::LabelText("Longest stall", "%lld ms", static_cast<long long>(lockstepMetrics.longestStallDuration.count()));
+            ImGui::LabelText("Last stall", "%lld ms", static_cast<long long>(lockstepMetrics.lastStallDuration.count()));
+        }
 
         if (ImGui::CollapsingHeader("Selected Unit"))
         {
@@ -1187,6 +1257,15 @@ namespace rwe
             ImGui::Unindent();
         }
 
+#ifdef RWE_COB_PROFILING
+        if (ImGui::CollapsingHeader("COB Profiler"))
+        {
+            ImGui::Indent();
+            renderCobProfilerSection(simulation);
+            ImGui::Unindent();
+        }
+#endif
+
         auto mouseTerrainCoordinate = getMouseTerrainCoordinate();
 
         if (mouseTerrainCoordinate)
@@ -1976,10 +2055,8 @@ namespace rwe
                 });
         }
 
-        auto maxRtt = std::clamp(gameNetworkService->getMaxAverageRttMillis(), 16.0f, 2000.0f);
-        auto highCommandLatencyMillis = maxRtt + (maxRtt / 4.0f) + 200.0f;
-        auto commandLatencyFrames = static_cast<unsigned int>(highCommandLatencyMillis / 16.0f) + 1;
-        auto targetCommandBufferSize = commandLatencyFrames;
+        lockstepGovernor.updateCommandDelay(gameNetworkService->getPeerLatencies());
+        auto targetCommandBufferSize = lockstepGovernor.getCommandDelayTicks();
 
         auto bufferedCommandCount = playerCommandService->bufferedCommandCount(localPlayerId);
 
@@ -2029,24 +2106,22 @@ namespace rwe
 
         auto averageSceneTime = gameNetworkService->estimateAvergeSceneTime(sceneTime);
 
-        // allow skipping sim frames every so often to get back down to average.
-        // We tolerate X frames of drift in either direction to cope with noisiness in the estimation.
-        const SceneTime frameTolerance(3);
-        const SceneTime frameCheckInterval(5);
-        auto highSceneTime = averageSceneTime + frameTolerance;
-        auto lowSceneTime = averageSceneTime <= frameTolerance ? SceneTime{0} : averageSceneTime - frameTolerance;
-        for (; millisecondsBuffer >= SimMillisecondsPerTick; millisecondsBuffer -= SimMillisecondsPerTick)
+        // Run slightly slower or faster to converge on the average of all peers.
+        auto tickInterval = lockstepGovernor.updateTickInterval(sceneTime, averageSceneTime);
+        while (millisecondsBuffer >= tickInterval)
         {
-            if (sceneTime % frameCheckInterval != SceneTime(0) || sceneTime <= highSceneTime)
+            if (!tryTickGame())
             {
-                tryTickGame();
+                lockstepGovernor.onStall(getTimestamp());
 
-                // simulate an extra frame to catch up every so often
-                if (sceneTime % frameCheckInterval == SceneTime(0) && sceneTime < lowSceneTime)
-                {
-                    tryTickGame();
-                }
+                // Don't bank the time spent waiting,
+                // or we would rush through ticks once the commands arrive.
+                millisecondsBuffer = tickInterval;
+                break;
             }
+
+            lockstepGovernor.onTick(getTimestamp());
+            millisecondsBuffer -= tickInterval;
         }
 
         renderDebugWindow();
@@ -2321,22 +2396,25 @@ namespace rwe
         return inverseView * worldInverseProjection * minimapProjection;
     }
 
-    void GameScene::tryTickGame()
+    bool GameScene::tryTickGame()
     {
-        if (!playerCommandService->checkHashes())
+        if (desyncInvestigation)
         {
-            std::ofstream dumpFile;
-            dumpFile.open("rwe-dump-" + std::to_string(std::rand()) + ".json");
-            dumpFile << dumpJson(simulation);
-            dumpFile.close();
-            throw std::runtime_error("Desync detected");
+            continueDesyncInvestigation();
+            return false;
+        }
+
+        if (auto mismatchTime = playerCommandService->findHashMismatch(); mismatchTime)
+        {
+            startDesyncInvestigation(*mismatchTime);
+            return false;
         }
 
         auto playerCommands = playerCommandService->tryPopCommands();
         if (!playerCommands)
         {
-            spdlog::get("rwe")->error("Blocked waiting for player commands");
-            return;
+            spdlog::get("rwe")->debug("Blocked waiting for player commands");
+            return false;
         }
 
         sceneTime += SceneTime(1);
@@ -2347,10 +2425,15 @@ namespace rwe
 
         simulation.tick();
 
-        auto gameHash = simulation.computeHash();
+        auto gameHash = desyncHistory.recordTick(sceneTime, simulation, *playerCommands);
         playerCommandService->pushHash(localPlayerId, gameHash);
         gameNetworkService->submitGameHash(gameHash);
 
+        if (replayWriter)
+        {
+            replayWriter->recordTick(sceneTime, *playerCommands, gameHash);
+        }
+
         if (stateLogStream)
         {
             *stateLogStream << dumpJson(simulation) << std::endl;
@@ -2376,6 +2459,56 @@ namespace rwe
             [&](const WinStatusUndecided&) {
                 // do nothing, game still in progress
             });
+
+        return true;
+    }
+
+    void GameScene::startDesyncInvestigation(SceneTime mismatchTime)
+    {
+        spdlog::get("rwe")->error("Desync detected at scene time {}, comparing history with peers", mismatchTime.value);
+
+        if (dumpStateOnDesync)
+        {
+            std::ofstream dumpFile;
+            dumpFile.open("rwe-dump-" + std::to_string(std::rand()) + ".json");
+            dumpFile << dumpJson(simulation);
+            dumpFile.close();
+        }
+
+        auto snapshot = desyncHistory.createSnapshot(localPlayerId, mismatchTime);
+        gameNetworkService->submitDesyncSnapshot(serializeDesyncSnapshot(snapshot));
+        desyncInvestigation.emplace(std::move(snapshot), gameNetworkService->getRemotePlayerIds(), getTimestamp());
+    }
+
+    void GameScene::continueDesyncInvestigation()
+    {
+        auto now = getTimestamp();
+
+        while (auto data = gameNetworkService->tryTakeDesyncSnapshot())
+        {
+            try
+            {
+                desyncInvestigation->addRemoteSnapshot(deserializeDesyncSnapshot(*data), now);
+            }
+            catch (const std::runtime_error& e)
+            {
+                spdlog::get("rwe")->error("Failed to read desync snapshot: {}", e.what());
+            }
+        }
+
+        if (!desyncInvestigation->isFinished(now))
+        {
+            return;
+        }
+
+        auto report = desyncInvestigation->createReport();
+        auto reportPath = "rwe-desync-" + std::to_string(std::rand()) + ".txt";
+        std::ofstream reportFile(reportPath);
+        reportFile << report;
+        reportFile.close();
+        spdlog::get("rwe")->error("Desync report written to {}:\n{}", reportPath, report);
+
+        throw std::runtime_error("Desync detected");
     }
 
     std::optional<UnitId> GameScene::getUnitUnderCursor() const
@@ -2602,48 +2735,6 @@ namespace rwe
         refreshBuildGuiTotal(unitId, unitType);
     }
 
-    void GameScene::issueUnitOrder(UnitId unitId, const UnitOrder& order)
-    {
-        auto unit = tryGetUnit(unitId);
-        if (unit)
-        {
-            unit->get().clearOrders();
-            unit->get().addOrder(order);
-        }
-    }
-
-    void GameScene::enqueueUnitOrder(UnitId unitId, const UnitOrder& order)
-    {
-        auto unit = tryGetUnit(unitId);
-        if (unit)
-        {
-            unit->get().addOrder(order);
-        }
-    }
-
-    void GameScene::stopUnit(UnitId unitId)
-    {
-        auto unit = tryGetUnit(unitId);
-        if (unit)
-        {
-            unit->get().clearOrders();
-        }
-    }
-
-    void GameScene::setFireOrders(UnitId unitId, UnitFireOrders orders)
-    {
-        auto unit = tryGetUnit(unitId);
-        if (unit)
-        {
-            unit->get().fireOrders = orders;
-
-            if (auto selectedUnit = getSingleSelectedUnit(); selectedUnit && *selectedUnit == unitId)
-            {
-                fireOrders.next(orders);
-            }
-        }
-    }
-
     void GameScene::startTrack()
     {
         // sort selection by unit id so repeated 'T' keydown cycles through all units in a group consistently
@@ -3016,18 +3107,6 @@ namespace rwe
         spawnWake(spawnPosition2, velocity, duration);
     }
 
-    void GameScene::modifyBuildQueue(UnitId unitId, const std::string& unitType, int count)
-    {
-        auto unit = tryGetUnit(unitId);
-        if (unit)
-        {
-            unit->get().modifyBuildQueue(unitType, count);
-
-            updateUnconfirmedBuildQueueDelta(unitId, unitType, -count);
-            refreshBuildGuiTotal(unitId, unitType);
-        }
-    }
-
     struct CorpseSpawnInfo
     {
         std::string featureName;
@@ -3586,53 +3665,33 @@ namespace rwe
 
     void GameScene::processPlayerCommand(const PlayerCommand& playerCommand)
     {
-        match(
-            playerCommand,
-            [&](const PlayerUnitCommand& c) {
-                processUnitCommand(c);
-            },
-            [](const PlayerPauseGameCommand&) {
-                // TODO
-            },
-            [](const PlayerUnpauseGameCommand&) {
-                // TODO
-            });
+        applyPlayerCommand(simulation, playerCommand);
+
+        if (auto unitCommand = std::get_if<PlayerUnitCommand>(&playerCommand); unitCommand != nullptr)
+        {
+            updateGuiForUnitCommand(*unitCommand);
+        }
     }
 
-    void GameScene::processUnitCommand(const PlayerUnitCommand& unitCommand)
+    void GameScene::updateGuiForUnitCommand(const PlayerUnitCommand& unitCommand)
     {
-        match(
-            unitCommand.command,
-            [&](const PlayerUnitCommand::IssueOrder& c) {
-                switch (c.issueKind)
-                {
-                    case PlayerUnitCommand::IssueOrder::IssueKind::Immediate:
-                        issueUnitOrder(unitCommand.unit, c.order);
-                        break;
-                    case PlayerUnitCommand::IssueOrder::IssueKind::Queued:
-                        enqueueUnitOrder(unitCommand.unit, c.order);
-                        break;
-                }
-            },
-            [&](const PlayerUnitCommand::ModifyBuildQueue& c) {
-                modifyBuildQueue(unitCommand.unit, c.unitType, c.count);
-            },
-            [&](const PlayerUnitCommand::Stop&) {
-                stopUnit(unitCommand.unit);
-            },
-            [&](const PlayerUnitCommand::SetFireOrders& c) {
-                setFireOrders(unitCommand.unit, c.orders);
-            },
-            [&](const PlayerUnitCommand::SetOnOff& c) {
-                if (c.on)
-                {
-                    simulation.activateUnit(unitCommand.unit);
-                }
-                else
-                {
-                    simulation.deactivateUnit(unitCommand.unit);
-                }
-            });
+        if (!simulation.unitExists(unitCommand.unit))
+        {
+            return;
+        }
+
+        if (auto c = std::get_if<PlayerUnitCommand::ModifyBuildQueue>(&unitCommand.command); c != nullptr)
+        {
+            updateUnconfirmedBuildQueueDelta(unitCommand.unit, c->unitType, -c->count);
+            refreshBuildGuiTotal(unitCommand.unit, c->unitType);
+        }
+        else if (auto c = std::get_if<PlayerUnitCommand::SetFireOrders>(&unitCommand.command); c != nullptr)
+        {
+            if (auto selectedUnit = getSingleSelectedUnit(); selectedUnit && *selectedUnit == unitCommand.unit)
+            {
+                fireOrders.next(c->orders);
+            }
+        }
     }
 
     bool GameScene::leftClickMode() const
@@ -16,13 +16,17 @@
 #include <rwe/UiRenderService.h>
 #include <rwe/Viewport.h>
 #include <rwe/game/BuilderGuisDatabase.h>
+#include <rwe/game/DesyncHistory.h>
+#include <rwe/game/DesyncInvestigation.h>
 #include <rwe/game/GameCameraState.h>
 #include <rwe/game/GameMediaDatabase.h>
 #include <rwe/game/GameNetworkService.h>
 #include <rwe/game/InGameSoundsInfo.h>
+#include <rwe/game/LockstepGovernor.h>
 #include <rwe/game/Particle.h>
 #include <rwe/game/PlayerCommand.h>
 #include <rwe/game/PlayerCommandService.h>
+#include <rwe/game/Replay.h>
 #include <rwe/game/SceneTime.h>
 #include <rwe/game/UnitSoundType.h>
 #include <rwe/game/WeaponMediaInfo.h>
@@ -284,6 +288,16 @@ namespace rwe
 
         std::optional<std::ofstream> stateLogStream;
 
+        std::optional<ReplayWriter> replayWriter;
+
+        DesyncHistory desyncHistory;
+
+        /** Present once a desync has been detected, while we gather peers' snapshots. */
+        std::optional<DesyncInvestigation> desyncInvestigation;
+
+        /** Whether to also dump the full simulation state as JSON when a desync is detected. */
+        bool dumpStateOnDesync;
+
         bool showDebugWindow{false};
         char unitSpawnText[20]{""};
         int unitSpawnPlayer{0};
@@ -295,6 +309,8 @@ namespace rwe
 
         int millisecondsBuffer{0};
 
+        LockstepGovernor lockstepGovernor;
+
         std::vector<FlashEffect> flashes;
         bool guiVisible{true};
 
@@ -328,7 +344,9 @@ namespace rwe
             const std::shared_ptr<SpriteSeries>& guiFont,
             PlayerId localPlayerId,
             TdfBlock* audioLookup,
-            std::optional<std::ofstream>&& stateLogStream);
+            std::optional<std::ofstream>&& stateLogStream,
+            std::optional<ReplayWriter>&& replayWriter,
+            bool dumpStateOnDesync);
 
         void init() override;
 
@@ -385,15 +403,19 @@ namespace rwe
 
         void emitWake1FromPiece(UnitId unitId, const std::string& pieceName);
 
-        void modifyBuildQueue(UnitId unitId, const std::string& unitType, int count);
-
         void onChannelFinished(int channel);
 
         static Matrix4f worldToMinimapMatrix(const MapTerrain& terrain, const Rectangle2f& minimapRect);
 
         static Matrix4f minimapToWorldMatrix(const MapTerrain& terrain, const Rectangle2f& minimapRect);
 
-        void tryTickGame();
+        /** Returns false if the tick could not be simulated because commands were missing. */
+        bool tryTickGame();
+
+        void startDesyncInvestigation(SceneTime mismatchTime);
+
+        /** Throws once the investigation is finished and its report written. */
+        void continueDesyncInvestigation();
 
         std::optional<UnitId> getUnitUnderCursor() const;
         std::optional<FeatureId> getFeatureUnderCursor() const;
@@ -431,14 +453,6 @@ namespace rwe
 
         void localPlayerModifyBuildQueue(UnitId unitId, const std::string& unitType, int count);
 
-        void issueUnitOrder(UnitId unitId, const UnitOrder& order);
-
-        void enqueueUnitOrder(UnitId unitId, const UnitOrder& order);
-
-        void stopUnit(UnitId unitId);
-
-        void setFireOrders(UnitId unitId, UnitFireOrders orders);
-
         void startTrack();
 
         void startTrackInternal(const std::vector<UnitId>& unitIds);
@@ -477,7 +491,8 @@ namespace rwe
 
         void processPlayerCommand(const PlayerCommand& playerCommand);
 
-        void processUnitCommand(const PlayerUnitCommand& unitCommand);
+        /** Updates the interface to reflect a unit command that has just been applied. */
+        void updateGuiForUnitCommand(const PlayerUnitCommand& unitCommand);
 
         template <typename T>
         void delay(SceneTime interval, T&& f)
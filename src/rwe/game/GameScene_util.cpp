@@ -56,18 +56,11 @@ namespace rwe
     }
 
     void
-    drawPathfindingVisualisation(const MapTerrain& terrain, const AStarPathInfo<Point, PathCost>& pathInfo, ColoredMeshBatch& batch)
+    drawPathfindingVisualisation(const MapTerrain& terrain, const PathFindingDebugInfo& pathInfo, ColoredMeshBatch& batch)
     {
-        for (const auto& item : pathInfo.closedVertices)
+        for (const auto& edge : pathInfo.expandedEdges)
         {
-            if (!item.second.predecessor)
-            {
-                continue;
-            }
-
-            auto start = (*item.second.predecessor)->vertex;
-            auto end = item.second.vertex;
-            drawTerrainArrow(terrain, start, end, Color(255, 0, 0), batch);
+            drawTerrainArrow(terrain, edge.first, edge.second, Color(255, 0, 0), batch);
         }
 
         if (pathInfo.path.size() > 1)
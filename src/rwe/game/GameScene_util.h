@@ -6,8 +6,7 @@
 #include <rwe/game/Particle.h>
 #include <rwe/game/PlayerColorIndex.h>
 #include <rwe/math/Matrix4x.h>
-#include <rwe/pathfinding/AStarPathFinder.h>
-#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathFindingService.h>
 #include <rwe/sim/GameSimulation.h>
 #include <rwe/sim/MapTerrain.h>
 #include <rwe/sim/OccupiedGrid.h>
@@ -24,7 +23,7 @@
 namespace rwe
 {
     void
-    drawPathfindingVisualisation(const MapTerrain& terrain, const AStarPathInfo<Point, PathCost>& pathInfo, ColoredMeshBatch& batch);
+    drawPathfindingVisualisation(const MapTerrain& terrain, const PathFindingDebugInfo& pathInfo, ColoredMeshBatch& batch);
 
     void
     drawTerrainArrow(const MapTerrain& terrain, const Point& start, const Point& end, const Color& color, ColoredMeshBatch& batch);
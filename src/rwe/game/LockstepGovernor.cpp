@@ -0,0 +1,106 @@
+#include "LockstepGovernor.h"
+#include <algorithm>
+#include <cmath>
+#include <rwe/sim/SimTicksPerSecond.h>
+
+namespace rwe
+{
+    LockstepGovernor::LockstepGovernor()
+    {
+        metrics.commandDelayTicks = MinCommandDelayTicks;
+        metrics.tickIntervalMillis = SimMillisecondsPerTick;
+    }
+
+    unsigned int LockstepGovernor::computeRequiredCommandDelay(const std::vector<PeerLatency>& peers)
+    {
+        auto latencyMillis = 0.0f;
+        for (const auto& p : peers)
+        {
+            auto oneWayMillis = (p.averageRoundTripTime / 2.0f) + (JitterDeviations * p.roundTripTimeDeviation);
+            latencyMillis = std::max(latencyMillis, oneWayMillis);
+        }
+
+        auto ticks = static_cast<unsigned int>(std::ceil((latencyMillis + CommandDelayMarginMillis) / static_cast<float>(SimMillisecondsPerTick)));
+        return std::clamp(ticks, MinCommandDelayTicks, MaxCommandDelayTicks);
+    }
+
+    void LockstepGovernor::updateCommandDelay(const std::vector<PeerLatency>& peers)
+    {
+        auto required = computeRequiredCommandDelay(peers);
+        if (required > metrics.commandDelayTicks)
+        {
+            raiseCommandDelay(required - metrics.commandDelayTicks);
+            return;
+        }
+
+        if (required < metrics.commandDelayTicks && ticksSinceDelayRose >= CommandDelayDecreaseIntervalTicks)
+        {
+            metrics.commandDelayTicks -= 1;
+            ticksSinceDelayRose = 0;
+        }
+    }
+
+    int LockstepGovernor::updateTickInterval(SceneTime localSceneTime, SceneTime averageSceneTime)
+    {
+        auto drift = static_cast<int>(localSceneTime.value) - static_cast<int>(averageSceneTime.value);
+        auto tolerance = static_cast<int>(SceneTimeTolerance);
+
+        auto adjustment = 0;
+        if (drift > tolerance)
+        {
+            // ahead of the others, slow down
+            adjustment = std::min(drift - tolerance, MaxTickAdjustmentMillis);
+        }
+        else if (drift < -tolerance)
+        {
+            // behind the others, speed up
+            adjustment = std::max(drift + tolerance, -MaxTickAdjustmentMillis);
+        }
+
+        metrics.tickIntervalMillis = SimMillisecondsPerTick + adjustment;
+        return metrics.tickIntervalMillis;
+    }
+
+    void LockstepGovernor::onTick(Timestamp now)
+    {
+        ++ticksSinceDelayRose;
+
+        if (stallStartTime)
+        {
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - *stallStartTime);
+            stallStartTime = std::nullopt;
+            metrics.lastStallDuration = duration;
+            metrics.totalStallDuration += duration;
+            metrics.longestStallDuration = std::max(metrics.longestStallDuration, duration);
+
+            // Commands arrived later than the delay allowed for,
+            // so allow a little more from now on.
+            raiseCommandDelay(1);
+        }
+    }
+
+    void LockstepGovernor::onStall(Timestamp now)
+    {
+        if (!stallStartTime)
+        {
+            stallStartTime = now;
+            ++metrics.stallCount;
+        }
+    }
+
+    unsigned int LockstepGovernor::getCommandDelayTicks() const
+    {
+        return metrics.commandDelayTicks;
+    }
+
+    const LockstepMetrics& LockstepGovernor::getMetrics() const
+    {
+        return metrics;
+    }
+
+    void LockstepGovernor::raiseCommandDelay(unsigned int ticks)
+    {
+        metrics.commandDelayTicks = std::min(metrics.commandDelayTicks + ticks, MaxCommandDelayTicks);
+        ticksSinceDelayRose = 0;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <rwe/game/PeerLatency.h>
+#include <rwe/game/SceneTime.h>
+#include <rwe/rwe_time.h>
+#include <vector>
+
+namespace rwe
+{
+    struct LockstepMetrics
+    {
+        unsigned int commandDelayTicks{0};
+        int tickIntervalMillis{0};
+
+        /** The number of times the simulation has had to wait for a peer's commands. */
+        unsigned int stallCount{0};
+        std::chrono::milliseconds totalStallDuration{0};
+        std::chrono::milliseconds longestStallDuration{0};
+        std::chrono::milliseconds lastStallDuration{0};
+    };
+
+    /**
+     * Decides how far ahead local commands are scheduled
+     * and how fast the local simulation runs, to keep lockstep play smooth.
+     *
+     * The command delay is the number of ticks between a command being issued
+     * and being executed. It is chosen to cover the one way latency to the slowest peer,
+     * with an allowance for jitter, so that commands usually arrive before they are needed.
+     * It rises straight away when latency rises or the simulation stalls,
+     * but falls only one tick at a time and only after a quiet period,
+     * so that it does not swing back and forth.
+     *
+     * The simulation runs slightly slower when it is ahead of the peer average
+     * and slightly faster when it is behind, rather than skipping or doubling ticks.
+     */
+    class LockstepGovernor
+    {
+    public:
+        static constexpr unsigned int MinCommandDelayTicks = 2;
+        static constexpr unsigned int MaxCommandDelayTicks = 60;
+
+        /** The number of deviations of round trip time to allow for jitter. */
+        static constexpr float JitterDeviations = 4.0f;
+
+        /** Extra latency to allow for, covering send coalescing and frame timing. */
+        static constexpr float CommandDelayMarginMillis = 40.0f;
+
+        /** How long the delay must go without needing to rise before it may fall by one tick. */
+        static constexpr unsigned int CommandDelayDecreaseIntervalTicks = 150;
+
+        /** The number of ticks the local simulation may drift from the average before being corrected. */
+        static constexpr unsigned int SceneTimeTolerance = 1;
+
+        /** The most a tick is lengthened or shortened by to correct drift. */
+        static constexpr int MaxTickAdjustmentMillis = 3;
+
+    private:
+        LockstepMetrics metrics;
+
+        unsigned int ticksSinceDelayRose{0};
+
+        std::optional<Timestamp> stallStartTime;
+
+    public:
+        LockstepGovernor();
+
+        /** The command delay needed to cover the given peers' latencies, ignoring history. */
+        static unsigned int computeRequiredCommandDelay(const std::vector<PeerLatency>& peers);
+
+        /** Updates the command delay from the latest latency measurements. */
+        void updateCommandDelay(const std::vector<PeerLatency>& peers);
+
+        /**
+         * Returns how many milliseconds the next tick should take
+         * for the local simulation to converge on the average scene time of all peers.
+         */
+        int updateTickInterval(SceneTime localSceneTime, SceneTime averageSceneTime);
+
+        /** Called when a tick is simulated. */
+        void onTick(Timestamp now);
+
+        /** Called when a tick could not be simulated because commands were missing. */
+        void onStall(Timestamp now);
+
+        unsigned int getCommandDelayTicks() const;
+
+        const LockstepMetrics& getMetrics() const;
+
+    private:
+        void raiseCommandDelay(unsigned int ticks);
+    };
+}
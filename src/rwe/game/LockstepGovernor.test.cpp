@@ -0,0 +1,72 @@
+#include <catch2/catch.hpp>
+#include <rwe/game/LockstepGovernor.h>
+#include <rwe/sim/SimTicksPerSecond.h>
+
+namespace rwe
+{
+    TEST_CASE("LockstepGovernor")
+    {
+        LockstepGovernor governor;
+        auto now = Timestamp();
+
+        SECTION("covers the one way latency of the slowest peer")
+        {
+            REQUIRE(LockstepGovernor::computeRequiredCommandDelay({}) == LockstepGovernor::MinCommandDelayTicks);
+
+            // 75ms one way + 40ms jitter + 40ms margin
+            std::vector<PeerLatency> peers{{20.0f, 1.0f}, {150.0f, 10.0f}};
+            auto delay = LockstepGovernor::computeRequiredCommandDelay(peers);
+            REQUIRE(delay == 5);
+            REQUIRE(delay * SimMillisecondsPerTick >= 155);
+
+            std::vector<PeerLatency> slowPeers{{5000.0f, 100.0f}};
+            REQUIRE(LockstepGovernor::computeRequiredCommandDelay(slowPeers) == LockstepGovernor::MaxCommandDelayTicks);
+        }
+
+        SECTION("raises the delay at once but lowers it slowly")
+        {
+            governor.updateCommandDelay({{150.0f, 10.0f}});
+            REQUIRE(governor.getCommandDelayTicks() == 5);
+
+            governor.updateCommandDelay({{20.0f, 1.0f}});
+            REQUIRE(governor.getCommandDelayTicks() == 5);
+
+            for (unsigned int i = 0; i < LockstepGovernor::CommandDelayDecreaseIntervalTicks; ++i)
+            {
+                governor.onTick(now);
+            }
+            governor.updateCommandDelay({{20.0f, 1.0f}});
+            REQUIRE(governor.getCommandDelayTicks() == 4);
+            governor.updateCommandDelay({{20.0f, 1.0f}});
+            REQUIRE(governor.getCommandDelayTicks() == 4);
+        }
+
+        SECTION("records stalls and raises the delay after one")
+        {
+            governor.onStall(now);
+            governor.onStall(now + std::chrono::milliseconds(16));
+            governor.onTick(now + std::chrono::milliseconds(50));
+
+            const auto& metrics = governor.getMetrics();
+            REQUIRE(metrics.stallCount == 1);
+            REQUIRE(metrics.lastStallDuration == std::chrono::milliseconds(50));
+            REQUIRE(metrics.totalStallDuration == std::chrono::milliseconds(50));
+            REQUIRE(governor.getCommandDelayTicks() == LockstepGovernor::MinCommandDelayTicks + 1);
+
+            governor.onStall(now + std::chrono::milliseconds(100));
+            governor.onTick(now + std::chrono::milliseconds(120));
+            REQUIRE(metrics.stallCount == 2);
+            REQUIRE(metrics.totalStallDuration == std::chrono::milliseconds(70));
+            REQUIRE(metrics.longestStallDuration == std::chrono::milliseconds(50));
+        }
+
+        SECTION("slows down when ahead and speeds up when behind")
+        {
+            REQUIRE(governor.updateTickInterval(SceneTime(100), SceneTime(101)) == SimMillisecondsPerTick);
+            REQUIRE(governor.updateTickInterval(SceneTime(103), SceneTime(100)) == SimMillisecondsPerTick + 2);
+            REQUIRE(governor.updateTickInterval(SceneTime(150), SceneTime(100)) == SimMillisecondsPerTick + LockstepGovernor::MaxTickAdjustmentMillis);
+            REQUIRE(governor.updateTickInterval(SceneTime(97), SceneTime(100)) == SimMillisecondsPerTick - 2);
+            REQUIRE(governor.updateTickInterval(SceneTime(0), SceneTime(100)) == SimMillisecondsPerTick - LockstepGovernor::MaxTickAdjustmentMillis);
+        }
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace rwe
+{
+    /** Round trip time measurements for one remote peer, in milliseconds. */
+    struct PeerLatency
+    {
+        float averageRoundTripTime{0};
+        float roundTripTimeDeviation{0};
+    };
+}
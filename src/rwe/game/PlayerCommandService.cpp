@@ -1,73 +1,98 @@
 #include "PlayerCommandService.h"
+#include <algorithm>
+#include <stdexcept>
 
 namespace rwe
 {
-    std::optional<std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>> PlayerCommandService::tryPopCommands()
+    const std::vector<std::pair<PlayerId, PlayerCommandService::CommandSet>>* PlayerCommandService::tryPopCommands()
     {
-        std::scoped_lock<std::mutex> lock(mutex);
-
-        for (const auto& p : commandBuffers)
+        for (const auto& p : players)
         {
-            if (p.second.empty())
+            if (p->commands.front() == nullptr)
             {
-                return std::nullopt;
+                return nullptr;
             }
         }
 
-        std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> out;
-        for (auto& p : commandBuffers)
+        for (std::size_t i = 0; i < players.size(); ++i)
         {
-            out.emplace_back(p.first, p.second.front());
-            p.second.pop_front();
+            // Swap rather than move so that the ring slot takes over
+            // the storage of the previous set and can reuse it.
+            auto& commands = *players[i]->commands.front();
+            poppedCommands[i].second.clear();
+            std::swap(poppedCommands[i].second, commands);
+            players[i]->commands.pop();
         }
 
-        return out;
+        return &poppedCommands;
+    }
+
+    void PlayerCommandService::pushCommands(PlayerId player, const CommandSet& commands)
+    {
+        if (!getPlayer(player).commands.tryPush(commands))
+        {
+            throw std::runtime_error("Player command buffer is full");
+        }
     }
 
-    void PlayerCommandService::pushCommands(PlayerId player, const std::vector<PlayerCommand>& commands)
+    void PlayerCommandService::pushCommands(PlayerId player, CommandSet&& commands)
     {
-        std::scoped_lock<std::mutex> lock(mutex);
-        commandBuffers.at(player).push_back(commands);
+        if (!tryPushCommands(player, std::move(commands)))
+        {
+            throw std::runtime_error("Player command buffer is full");
+        }
+    }
+
+    bool PlayerCommandService::tryPushCommands(PlayerId player, CommandSet&& commands)
+    {
+        return getPlayer(player).commands.tryPush(std::move(commands));
     }
 
     void PlayerCommandService::pushHash(PlayerId player, const GameHash& gameHash)
     {
-        std::scoped_lock<std::mutex> lock(mutex);
-        gameTimeBuffers.at(player).push_back(gameHash);
+        if (!tryPushHash(player, gameHash))
+        {
+            throw std::runtime_error("Player hash buffer is full");
+        }
     }
 
-    void PlayerCommandService::registerPlayer(PlayerId playerId)
+    bool PlayerCommandService::tryPushHash(PlayerId player, const GameHash& gameHash)
     {
-        std::scoped_lock<std::mutex> lock(mutex);
+        return getPlayer(player).hashes.tryPush(gameHash);
+    }
 
-        auto result = commandBuffers.emplace(playerId, std::deque<std::vector<PlayerCommand>>());
-        if (!result.second)
+    void PlayerCommandService::registerPlayer(PlayerId playerId)
+    {
+        auto it = std::lower_bound(players.begin(), players.end(), playerId, [](const auto& p, const auto& id) { return p->playerId < id; });
+        if (it != players.end() && (*it)->playerId == playerId)
         {
             throw std::logic_error("Player already registered");
         }
 
-        gameTimeBuffers.emplace(playerId, std::deque<GameHash>());
+        players.insert(it, std::make_unique<PlayerBuffers>(playerId));
+
+        poppedCommands.clear();
+        for (const auto& p : players)
+        {
+            poppedCommands.emplace_back(p->playerId, CommandSet());
+        }
     }
 
     unsigned int PlayerCommandService::bufferedCommandCount(PlayerId player) const
     {
-        std::scoped_lock<std::mutex> lock(mutex);
-
-        return commandBuffers.at(player).size();
+        return getPlayer(player).commands.size();
     }
 
-    bool PlayerCommandService::checkHashes()
+    std::optional<SceneTime> PlayerCommandService::findHashMismatch()
     {
-        std::scoped_lock<std::mutex> lock(mutex);
-
-        while (!std::any_of(gameTimeBuffers.begin(), gameTimeBuffers.end(), [](const auto& p) { return p.second.empty(); }))
+        while (!std::any_of(players.begin(), players.end(), [](const auto& p) { return p->hashes.front() == nullptr; }))
         {
             std::optional<GameHash> baseHash;
             bool matching = true;
-            for (auto& p : gameTimeBuffers)
+            for (auto& p : players)
             {
-                auto hash = p.second.front();
-                p.second.pop_front();
+                auto hash = *p->hashes.front();
+                p->hashes.pop();
 
                 if (!baseHash)
                 {
@@ -78,12 +103,36 @@ namespace rwe
                 matching = matching && (*baseHash == hash);
             }
 
+            auto hashTime = nextHashTime;
+            nextHashTime += SceneTime(1);
+
             if (!matching)
             {
-                return false;
+                return hashTime;
             }
         }
 
-        return true;
+        return std::nullopt;
+    }
+
+    bool PlayerCommandService::checkHashes()
+    {
+        return !findHashMismatch();
+    }
+
+    PlayerCommandService::PlayerBuffers& PlayerCommandService::getPlayer(PlayerId playerId)
+    {
+        return const_cast<PlayerBuffers&>(static_cast<const PlayerCommandService*>(this)->getPlayer(playerId));
+    }
+
+    const PlayerCommandService::PlayerBuffers& PlayerCommandService::getPlayer(PlayerId playerId) const
+    {
+        auto it = std::lower_bound(players.begin(), players.end(), playerId, [](const auto& p, const auto& id) { return p->playerId < id; });
+        if (it == players.end() || (*it)->playerId != playerId)
+        {
+            throw std::out_of_range("Player not registered");
+        }
+
+        return **it;
     }
 }
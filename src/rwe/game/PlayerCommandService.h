@@ -1,35 +1,130 @@
 #pragma once
 
-#include <deque>
-#include <mutex>
+#include <memory>
+#include <optional>
+#include <rwe/collections/SpscQueue.h>
 #include <rwe/game/PlayerCommand.h>
 #include <rwe/game/SceneTime.h>
 #include <rwe/sim/GameHash.h>
 #include <rwe/sim/GameTime.h>
 #include <rwe/sim/PlayerId.h>
-#include <unordered_map>
 #include <vector>
 
 namespace rwe
 {
+    /**
+     * Buffers each player's command sets and game hashes
+     * until the simulation is ready for them.
+     *
+     * Each player's buffers are lock-free rings with a single producer,
+     * the network thread for remote players and the game thread otherwise,
+     * and the game thread as the consumer.
+     * Players are kept ordered by ID, so popped commands
+     * are always in the same order on every peer.
+     *
+     * All players must be registered before any commands or hashes are pushed.
+     */
     class PlayerCommandService
     {
+    public:
+        using CommandSet = std::vector<PlayerCommand>;
+
+        /**
+         * The number of command sets or hashes that can be buffered for each player.
+         * This is many seconds' worth, well beyond any command delay in use.
+         */
+        static constexpr std::size_t BufferCapacity = 1024;
+
     private:
-        mutable std::mutex mutex;
-        std::unordered_map<PlayerId, std::deque<std::vector<PlayerCommand>>> commandBuffers;
-        std::unordered_map<PlayerId, std::deque<GameHash>> gameTimeBuffers;
+        struct PlayerBuffers
+        {
+            PlayerId playerId;
+            SpscQueue<CommandSet> commands{BufferCapacity};
+            SpscQueue<GameHash> hashes{BufferCapacity};
+
+            explicit PlayerBuffers(PlayerId playerId) : playerId(playerId) {}
+        };
+
+        /** Ordered by player ID. */
+        std::vector<std::unique_ptr<PlayerBuffers>> players;
+
+        /** Holds the most recently popped commands. Reused to avoid allocating. */
+        std::vector<std::pair<PlayerId, CommandSet>> poppedCommands;
+
+        /** The scene time of the next hashes to be compared. */
+        SceneTime nextHashTime{1};
 
     public:
-        std::optional<std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>> tryPopCommands();
+        /**
+         * Pops one command set for every player, in player ID order,
+         * or returns null if any player has none buffered.
+         * The returned commands remain valid until the next call.
+         */
+        const std::vector<std::pair<PlayerId, CommandSet>>* tryPopCommands();
+
+        /** Throws if the player's buffer is full. */
+        void pushCommands(PlayerId player, const CommandSet& commands);
 
-        void pushCommands(PlayerId player, const std::vector<PlayerCommand>& commands);
+        /** Throws if the player's buffer is full. */
+        void pushCommands(PlayerId player, CommandSet&& commands);
 
+        /**
+         * Returns false if the player's buffer is full,
+         * in which case the commands are not pushed
+         * and should be tried again later.
+         */
+        bool tryPushCommands(PlayerId player, CommandSet&& commands);
+
+        /**
+         * Pushes a command set built in place by fill,
+         * which is called with the buffer slot to build it in.
+         * The slot holds the storage of a set popped earlier, which fill may reuse,
+         * so pushing this way need not allocate.
+         * Returns false without calling fill if the player's buffer is full.
+         * If fill throws, nothing is pushed.
+         */
+        template <typename F>
+        bool tryEmplaceCommands(PlayerId player, F&& fill)
+        {
+            auto& commands = getPlayer(player).commands;
+            auto slot = commands.tryBeginPush();
+            if (slot == nullptr)
+            {
+                return false;
+            }
+
+            fill(*slot);
+            commands.commitPush();
+            return true;
+        }
+
+        /** Throws if the player's buffer is full. */
         void pushHash(PlayerId player, const GameHash& gameHash);
 
+        /**
+         * Returns false if the player's buffer is full,
+         * in which case the hash is not pushed
+         * and should be tried again later.
+         */
+        bool tryPushHash(PlayerId player, const GameHash& gameHash);
+
         unsigned int bufferedCommandCount(PlayerId player) const;
 
         void registerPlayer(PlayerId playerId);
 
+        /**
+         * Compares the hashes every player has pushed for the same scene time,
+         * popping them as it goes, and returns the first scene time on which they differ.
+         * Each player's first hash is taken to be for scene time 1, the first tick.
+         */
+        std::optional<SceneTime> findHashMismatch();
+
+        /** As findHashMismatch, but returns only whether the hashes matched. */
         bool checkHashes();
+
+    private:
+        PlayerBuffers& getPlayer(PlayerId playerId);
+
+        const PlayerBuffers& getPlayer(PlayerId playerId) const;
     };
 }
@@ -0,0 +1,141 @@
+#include <catch2/catch.hpp>
+#include <rwe/game/PlayerCommandService.h>
+#include <rwe/proto/serialization.h>
+
+namespace rwe
+{
+    TEST_CASE("PlayerCommandService")
+    {
+        PlayerCommandService service;
+        service.registerPlayer(PlayerId(2));
+        service.registerPlayer(PlayerId(0));
+        service.registerPlayer(PlayerId(1));
+
+        SECTION("pops only when every player has commands")
+        {
+            service.pushCommands(PlayerId(0), PlayerCommandService::CommandSet());
+            service.pushCommands(PlayerId(2), PlayerCommandService::CommandSet());
+            REQUIRE(service.tryPopCommands() == nullptr);
+            REQUIRE(service.bufferedCommandCount(PlayerId(0)) == 1);
+
+            service.pushCommands(PlayerId(1), PlayerCommandService::CommandSet());
+            REQUIRE(service.tryPopCommands() != nullptr);
+            REQUIRE(service.bufferedCommandCount(PlayerId(0)) == 0);
+        }
+
+        SECTION("pops commands in player ID order")
+        {
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                PlayerCommandService::CommandSet commands;
+                for (unsigned int j = 0; j <= i; ++j)
+                {
+                    commands.emplace_back(PlayerUnitCommand(UnitId(j), PlayerUnitCommand::Stop()));
+                }
+                service.pushCommands(PlayerId(2 - i), std::move(commands));
+            }
+
+            auto popped = service.tryPopCommands();
+            REQUIRE(popped != nullptr);
+            REQUIRE(popped->size() == 3);
+            REQUIRE((*popped)[0].first == PlayerId(0));
+            REQUIRE((*popped)[0].second.size() == 3);
+            REQUIRE((*popped)[1].first == PlayerId(1));
+            REQUIRE((*popped)[1].second.size() == 2);
+            REQUIRE((*popped)[2].first == PlayerId(2));
+            REQUIRE((*popped)[2].second.size() == 1);
+        }
+
+        SECTION("refuses commands when a buffer is full")
+        {
+            for (std::size_t i = 0; i < PlayerCommandService::BufferCapacity; ++i)
+            {
+                REQUIRE(service.tryPushCommands(PlayerId(1), PlayerCommandService::CommandSet()));
+            }
+
+            REQUIRE(!service.tryPushCommands(PlayerId(1), PlayerCommandService::CommandSet()));
+            REQUIRE_THROWS(service.pushCommands(PlayerId(1), PlayerCommandService::CommandSet()));
+        }
+
+        SECTION("builds commands in place")
+        {
+            REQUIRE(service.tryEmplaceCommands(PlayerId(1), [](auto& commands) {
+                commands.clear();
+                commands.emplace_back(PlayerPauseGameCommand());
+            }));
+            REQUIRE(service.bufferedCommandCount(PlayerId(1)) == 1);
+
+            REQUIRE_THROWS(service.tryEmplaceCommands(PlayerId(1), [](auto&) { throw std::runtime_error("malformed"); }));
+            REQUIRE(service.bufferedCommandCount(PlayerId(1)) == 1);
+
+            service.pushCommands(PlayerId(0), PlayerCommandService::CommandSet());
+            service.pushCommands(PlayerId(2), PlayerCommandService::CommandSet());
+            auto popped = service.tryPopCommands();
+            REQUIRE(popped != nullptr);
+            REQUIRE((*popped)[1].second.size() == 1);
+        }
+
+        SECTION("survives decoding a malformed command set in place")
+        {
+            UnitTypeTable unitTypes;
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(1), PlayerUnitCommand::Stop()),
+                PlayerUnitCommand(UnitId(2), PlayerUnitCommand::SetOnOff{true}),
+                PlayerUnitCommand(UnitId(3), PlayerUnitCommand::ModifyBuildQueue{1, "ARMPW"}),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+
+            // the first two commands decode before the truncation is found
+            auto truncated = encoded.substr(0, encoded.size() - 1);
+            REQUIRE_THROWS_AS(
+                service.tryEmplaceCommands(PlayerId(1), [&](auto& out) {
+                    deserializeCommandSet(truncated.data(), truncated.size(), unitTypes, out);
+                }),
+                std::runtime_error);
+            REQUIRE(service.bufferedCommandCount(PlayerId(1)) == 0);
+
+            REQUIRE(service.tryEmplaceCommands(PlayerId(1), [&](auto& out) {
+                deserializeCommandSet(encoded.data(), encoded.size(), unitTypes, out);
+            }));
+
+            service.pushCommands(PlayerId(0), PlayerCommandService::CommandSet());
+            service.pushCommands(PlayerId(2), PlayerCommandService::CommandSet());
+            auto popped = service.tryPopCommands();
+            REQUIRE(popped != nullptr);
+            REQUIRE(serializeCommandSet((*popped)[1].second, unitTypes) == encoded);
+        }
+
+        SECTION("rejects unknown and duplicate players")
+        {
+            REQUIRE_THROWS(service.pushCommands(PlayerId(3), PlayerCommandService::CommandSet()));
+            REQUIRE_THROWS(service.registerPlayer(PlayerId(1)));
+        }
+
+        SECTION("checks hashes once every player has sent one")
+        {
+            service.pushHash(PlayerId(0), GameHash(5));
+            service.pushHash(PlayerId(1), GameHash(5));
+            REQUIRE(service.checkHashes());
+
+            service.pushHash(PlayerId(2), GameHash(5));
+            REQUIRE(service.checkHashes());
+
+            service.pushHash(PlayerId(0), GameHash(6));
+            service.pushHash(PlayerId(1), GameHash(6));
+            service.pushHash(PlayerId(2), GameHash(7));
+            REQUIRE(!service.checkHashes());
+        }
+
+        SECTION("finds the scene time on which hashes differ")
+        {
+            for (unsigned int t = 1; t <= 3; ++t)
+            {
+                service.pushHash(PlayerId(0), GameHash(t));
+                service.pushHash(PlayerId(1), GameHash(t));
+                service.pushHash(PlayerId(2), GameHash(t == 3 ? 99 : t));
+            }
+
+            REQUIRE(service.findHashMismatch() == SceneTime(3));
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "PlayerCommand_util.h"
+#include <rwe/util/match.h>
+
+namespace rwe
+{
+    static void applyUnitCommand(GameSimulation& simulation, const PlayerUnitCommand& unitCommand)
+    {
+        auto unit = simulation.tryGetUnitState(unitCommand.unit);
+        if (!unit)
+        {
+            return;
+        }
+
+        match(
+            unitCommand.command,
+            [&](const PlayerUnitCommand::IssueOrder& c) {
+                switch (c.issueKind)
+                {
+                    case PlayerUnitCommand::IssueOrder::IssueKind::Immediate:
+                        unit->get().clearOrders();
+                        unit->get().addOrder(c.order);
+                        break;
+                    case PlayerUnitCommand::IssueOrder::IssueKind::Queued:
+                        unit->get().addOrder(c.order);
+                        break;
+                }
+            },
+            [&](const PlayerUnitCommand::ModifyBuildQueue& c) {
+                unit->get().modifyBuildQueue(c.unitType, c.count);
+            },
+            [&](const PlayerUnitCommand::Stop&) {
+                unit->get().clearOrders();
+            },
+            [&](const PlayerUnitCommand::SetFireOrders& c) {
+                unit->get().fireOrders = c.orders;
+            },
+            [&](const PlayerUnitCommand::SetOnOff& c) {
+                if (c.on)
+                {
+                    simulation.activateUnit(unitCommand.unit);
+                }
+                else
+                {
+                    simulation.deactivateUnit(unitCommand.unit);
+                }
+            });
+    }
+
+    void applyPlayerCommand(GameSimulation& simulation, const PlayerCommand& command)
+    {
+        match(
+            command,
+            [&](const PlayerUnitCommand& c) {
+                applyUnitCommand(simulation, c);
+            },
+            [](const PlayerPauseGameCommand&) {
+                // TODO
+            },
+            [](const PlayerUnpauseGameCommand&) {
+                // TODO
+            });
+    }
+}
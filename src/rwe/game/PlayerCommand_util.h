@@ -0,0 +1,15 @@
+#pragma once
+
+#include <rwe/game/PlayerCommand.h>
+#include <rwe/sim/GameSimulation.h>
+
+namespace rwe
+{
+    /**
+     * Applies a player's command to the simulation.
+     * This is everything a command does that affects the game state,
+     * so it is shared by the game scene and headless replay playback.
+     * Commands for units that no longer exist are ignored.
+     */
+    void applyPlayerCommand(GameSimulation& simulation, const PlayerCommand& command);
+}
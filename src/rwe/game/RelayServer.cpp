@@ -0,0 +1,689 @@
+#include "RelayServer.h"
+#include <algorithm>
+#include <cmath>
+#include <rwe/network_util.h>
+#include <spdlog/spdlog.h>
+
+namespace rwe
+{
+    SequenceNumber RelayServer::PlayerStream::getNextCommandSet() const
+    {
+        return SequenceNumber(firstCommandSet.value + commandSets.size());
+    }
+
+    GameTime RelayServer::PlayerStream::getNextHash() const
+    {
+        return firstHash + GameTime(hashes.size());
+    }
+
+    RelayServer::Peer::Peer(PlayerId playerId, unsigned int playerCount)
+        : playerId(playerId),
+          nextCommandToSend(playerCount, SequenceNumber(0)),
+          nextHashToSend(playerCount, GameTime(0)),
+          nextCommandToForward(playerCount, SequenceNumber(0))
+    {
+    }
+
+    unsigned int RelayServer::Peer::getTotalCommandsAcked() const
+    {
+        unsigned int total = 0;
+        for (const auto& n : nextCommandToSend)
+        {
+            total += n.value;
+        }
+        return total;
+    }
+
+    RelayServer::RelayServer(int port, unsigned int playerCount)
+        : port(port),
+          socket(ioContext),
+          sendTimer(ioContext),
+          flushTimer(ioContext)
+    {
+        for (unsigned int i = 0; i < playerCount; ++i)
+        {
+            peers.emplace_back(PlayerId(i), playerCount);
+        }
+    }
+
+    void RelayServer::run()
+    {
+        auto endpoint = boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v6(), port);
+        socket.open(endpoint.protocol());
+        socket.bind(endpoint);
+
+        listenForNextMessage();
+
+        scheduleNextSend();
+
+        ioContext.run();
+    }
+
+    void RelayServer::stop()
+    {
+        ioContext.stop();
+    }
+
+    void RelayServer::listenForNextMessage()
+    {
+        socket.async_receive_from(
+            boost::asio::buffer(receiveBuffer.data(), receiveBuffer.size()),
+            currentRemoteEndpoint,
+            [this](const auto& error, const auto& bytesTransferred) {
+                receive(error, bytesTransferred);
+                listenForNextMessage();
+            });
+    }
+
+    void RelayServer::scheduleFlush()
+    {
+        if (flushScheduled)
+        {
+            return;
+        }
+
+        flushScheduled = true;
+        flushTimer.expires_from_now(GameNetworkService::CommandCoalesceWindow);
+        flushTimer.async_wait([this](const boost::system::error_code& error) {
+            flushScheduled = false;
+            if (error)
+            {
+                spdlog::get("rwe")->error("Boost error while waiting on timer: {}", error.message());
+                return;
+            }
+
+            sendToAll();
+            scheduleNextSend();
+        });
+    }
+
+    void RelayServer::scheduleNextSend()
+    {
+        auto now = getTimestamp();
+        auto nextSendTime = now + GameNetworkService::KeepAliveInterval;
+        for (const auto& p : peers)
+        {
+            nextSendTime = std::min(nextSendTime, getNextSendTime(p, now));
+        }
+
+        // Setting the expiry cancels any wait already in progress.
+        sendTimer.expires_at(nextSendTime);
+        sendTimer.async_wait([this](const boost::system::error_code& error) {
+            if (error == boost::asio::error::operation_aborted)
+            {
+                // rescheduled, a newer wait is in progress
+                return;
+            }
+
+            if (error)
+            {
+                spdlog::get("rwe")->error("Boost error while waiting on timer: {}", error.message());
+                return;
+            }
+
+            sendDue();
+        });
+    }
+
+    void RelayServer::sendDue()
+    {
+        auto now = getTimestamp();
+        for (auto& p : peers)
+        {
+            if (p.endpoint && getNextSendTime(p, now) <= now)
+            {
+                send(p, false);
+            }
+        }
+
+        scheduleNextSend();
+    }
+
+    Timestamp RelayServer::getNextSendTime(const Peer& peer, Timestamp now) const
+    {
+        if (!peer.endpoint)
+        {
+            // We can't send to a peer until we have heard from it.
+            return now + GameNetworkService::KeepAliveInterval;
+        }
+
+        if (!peer.lastSendTime)
+        {
+            return now;
+        }
+
+        auto interval = hasUnackedData(peer)
+            ? computeRetransmitInterval(peer.averageRoundTripTime, peer.roundTripTimeDeviation, GameNetworkService::MinRetransmitInterval, GameNetworkService::KeepAliveInterval)
+            : GameNetworkService::KeepAliveInterval;
+        return *peer.lastSendTime + interval;
+    }
+
+    bool RelayServer::hasUnackedData(const Peer& peer) const
+    {
+        for (const auto& source : peers)
+        {
+            if (source.playerId == peer.playerId)
+            {
+                continue;
+            }
+
+            auto i = source.playerId.value;
+            if (peer.nextCommandToSend[i] < source.stream.getNextCommandSet() || peer.nextHashToSend[i] < source.stream.getNextHash())
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void RelayServer::sendToAll()
+    {
+        for (auto& p : peers)
+        {
+            if (p.endpoint)
+            {
+                send(p, true);
+            }
+        }
+    }
+
+    void RelayServer::send(Peer& peer, bool newOnly)
+    {
+        std::chrono::milliseconds delay(0);
+        auto sendTime = getTimestamp();
+        if (peer.lastReceiveTime)
+        {
+            delay = std::chrono::duration_cast<std::chrono::milliseconds>(sendTime - *peer.lastReceiveTime);
+        }
+
+        auto otherPlayerCount = peers.size() - 1;
+
+        auto isIncluded = [&](const Peer& source) {
+            if (source.playerId == peer.playerId || !source.endpoint)
+            {
+                return false;
+            }
+
+            return !newOnly || peer.nextCommandToForward[source.playerId.value] < source.stream.getNextCommandSet();
+        };
+
+        // For each player, how many of their command sets we have sent in this send,
+        // and whether we have stopped because the next one is being sent in fragments.
+        std::vector<std::size_t> setsSent(peers.size(), 0);
+        std::vector<bool> fragmented(peers.size(), false);
+
+        for (unsigned int packetIndex = 0; packetIndex < GameNetworkService::MaxCommandPacketsPerSend; ++packetIndex)
+        {
+            auto message = createMessage(peer, delay);
+            auto& m = *message.mutable_relay_update();
+
+            // Indexed by player ID, the stream in this packet, if it has been added.
+            std::vector<proto::PlayerStreamMessage*> streams(peers.size(), nullptr);
+
+            if (packetIndex == 0)
+            {
+                // Every other player's stream goes in the first packet, even if there is nothing new in it,
+                // so that the peer keeps hearing their scene time and round trip time.
+                auto hashesPerStream = std::max<std::size_t>(1, GameNetworkService::MaxGameHashesPerPacket / std::max<std::size_t>(1, otherPlayerCount));
+                for (const auto& source : peers)
+                {
+                    if (!isIncluded(source))
+                    {
+                        continue;
+                    }
+
+                    auto i = source.playerId.value;
+                    auto& stream = addStream(m, source, peer.nextCommandToSend[i], peer.nextHashToSend[i]);
+                    streams[i] = &stream;
+
+                    auto firstHashIndex = (peer.nextHashToSend[i] - source.stream.firstHash).value;
+                    auto hashCount = std::min(source.stream.hashes.size() - firstHashIndex, hashesPerStream);
+                    for (std::size_t j = 0; j < hashCount; ++j)
+                    {
+                        stream.add_game_hashes(source.stream.hashes[firstHashIndex + j].value);
+                    }
+                }
+            }
+
+            // Take command sets from each player in turn, so that no one player's backlog
+            // keeps everyone else's commands out of the packet.
+            std::vector<std::size_t> newlyFragmented;
+            auto full = false;
+            auto added = true;
+            while (!full && added)
+            {
+                added = false;
+                for (const auto& source : peers)
+                {
+                    auto i = source.playerId.value;
+                    if (!isIncluded(source) || fragmented[i])
+                    {
+                        continue;
+                    }
+
+                    auto setIndex = (peer.nextCommandToSend[i] - source.stream.firstCommandSet).value + setsSent[i];
+                    if (setIndex >= source.stream.commandSets.size())
+                    {
+                        continue;
+                    }
+
+                    const auto& set = source.stream.commandSets[setIndex];
+                    if (set.size() > GameNetworkService::CommandSetFragmentSize)
+                    {
+                        fragmented[i] = true;
+                        newlyFragmented.push_back(i);
+                        continue;
+                    }
+
+                    auto newStream = streams[i] == nullptr;
+                    if (newStream)
+                    {
+                        streams[i] = &addStream(m, source, SequenceNumber(peer.nextCommandToSend[i].value + setsSent[i]), peer.nextHashToSend[i]);
+                    }
+                    streams[i]->add_command_set(set);
+
+                    if (message.ByteSizeLong() + 4 > GameNetworkService::MaxMessageSize)
+                    {
+                        if (newStream)
+                        {
+                            m.mutable_streams()->RemoveLast();
+                            streams[i] = nullptr;
+                        }
+                        else
+                        {
+                            streams[i]->mutable_command_set()->RemoveLast();
+                        }
+                        full = true;
+                        break;
+                    }
+
+                    ++setsSent[i];
+                    added = true;
+                }
+            }
+
+            if (m.streams_size() > 0 || peer.ackPending)
+            {
+                sendMessage(message, peer);
+                peer.ackPending = false;
+            }
+
+            for (auto i : newlyFragmented)
+            {
+                auto setIndex = (peer.nextCommandToSend[i] - peers[i].stream.firstCommandSet).value + setsSent[i];
+                sendCommandSetFragments(peer, peers[i], setIndex, delay);
+                ++setsSent[i];
+            }
+
+            if (!full)
+            {
+                // everything left is waiting to be acked or is being sent in fragments
+                break;
+            }
+        }
+
+        if (!newOnly)
+        {
+            peer.lastSendTime = sendTime;
+        }
+
+        auto nextTotal = peer.getTotalCommandsAcked();
+        for (std::size_t i = 0; i < peers.size(); ++i)
+        {
+            nextTotal += setsSent[i];
+            auto sentUpTo = SequenceNumber(peer.nextCommandToSend[i].value + setsSent[i]);
+            peer.nextCommandToForward[i] = std::max(peer.nextCommandToForward[i], sentUpTo);
+        }
+        if (peer.sendTimes.empty() || peer.sendTimes.back().first < nextTotal)
+        {
+            peer.sendTimes.emplace_back(nextTotal, sendTime);
+        }
+    }
+
+    void RelayServer::sendCommandSetFragments(const Peer& peer, const Peer& source, std::size_t setIndex, std::chrono::milliseconds ackDelay)
+    {
+        const auto& set = source.stream.commandSets[setIndex];
+        auto fragmentCount = (set.size() + GameNetworkService::CommandSetFragmentSize - 1) / GameNetworkService::CommandSetFragmentSize;
+        spdlog::get("rwe")->debug("Sending command set of {} bytes from player {} to player {} in {} fragments", set.size(), source.playerId.value, peer.playerId.value, fragmentCount);
+
+        auto sequenceNumber = SequenceNumber(source.stream.firstCommandSet.value + setIndex);
+        for (std::size_t i = 0; i < fragmentCount; ++i)
+        {
+            auto message = createMessage(peer, ackDelay);
+            auto& stream = addStream(*message.mutable_relay_update(), source, sequenceNumber, peer.nextHashToSend[source.playerId.value]);
+            stream.add_command_set(set.substr(i * GameNetworkService::CommandSetFragmentSize, GameNetworkService::CommandSetFragmentSize));
+            stream.set_command_set_fragment_index(static_cast<int>(i));
+            stream.set_command_set_fragment_count(static_cast<int>(fragmentCount));
+            sendMessage(message, peer);
+        }
+    }
+
+    proto::NetworkMessage RelayServer::createMessage(const Peer& peer, std::chrono::milliseconds ackDelay)
+    {
+        proto::NetworkMessage outerMessage;
+        auto& m = *outerMessage.mutable_relay_update();
+        m.set_player_id(peer.playerId.value);
+        m.set_packet_id(uniform_dist(gen));
+        m.set_ack_delay(ackDelay.count());
+
+        auto& ack = *m.add_acks();
+        ack.set_player_id(peer.playerId.value);
+        ack.set_next_command_set_to_receive(peer.stream.getNextCommandSet().value);
+        ack.set_next_game_hash_to_receive(peer.stream.getNextHash().value);
+
+        return outerMessage;
+    }
+
+    proto::PlayerStreamMessage& RelayServer::addStream(proto::RelayUpdateMessage& message, const Peer& source, SequenceNumber nextCommandToSend, GameTime nextHashToSend)
+    {
+        auto& stream = *message.add_streams();
+        stream.set_player_id(source.playerId.value);
+        stream.set_current_scene_time(source.stream.currentSceneTime.value);
+        stream.set_next_command_set_to_send(nextCommandToSend.value);
+        stream.set_next_game_hash_to_send(nextHashToSend.value);
+        stream.set_round_trip_time(source.averageRoundTripTime);
+        stream.set_round_trip_time_deviation(source.roundTripTimeDeviation);
+        return stream;
+    }
+
+    void RelayServer::sendMessage(const proto::NetworkMessage& message, const Peer& peer)
+    {
+        auto messageSize = message.ByteSizeLong();
+        if (messageSize + 4 > sendBuffer.size())
+        {
+            throw std::logic_error("Message to be sent was bigger than buffer size");
+        }
+        if (!message.SerializeToArray(sendBuffer.data(), sendBuffer.size()))
+        {
+            throw std::runtime_error("Failed to serialize message to buffer");
+        }
+
+        writeInt(&sendBuffer[messageSize], computeCrc(sendBuffer.data(), messageSize));
+
+        // One unreachable peer must not bring down the relay for everyone else.
+        boost::system::error_code error;
+        socket.send_to(boost::asio::buffer(sendBuffer.data(), messageSize + 4), *peer.endpoint, 0, error);
+        if (error)
+        {
+            spdlog::get("rwe")->warn("Failed to send to player {}: {}", peer.playerId.value, error.message());
+        }
+    }
+
+    void RelayServer::receive(const boost::system::error_code& error, std::size_t receivedBytes)
+    {
+        if (error)
+        {
+            spdlog::get("rwe")->error("Boost error on receive: {}", error.message());
+            return;
+        }
+
+        auto receiveTime = getTimestamp();
+
+        if (receivedBytes < 4)
+        {
+            spdlog::get("rwe")->error("Received message is too short, ignoring");
+            return;
+        }
+
+        auto receivedCrc = readInt(&receiveBuffer[receivedBytes - 4]);
+        auto computedCrc = computeCrc(receiveBuffer.data(), receivedBytes - 4);
+        if (receivedCrc != computedCrc)
+        {
+            spdlog::get("rwe")->error("Message CRC incorrect, ignoring");
+            return;
+        }
+
+        proto::NetworkMessage outerMessage;
+        if (!outerMessage.ParseFromArray(receiveBuffer.data(), receivedBytes - 4))
+        {
+            spdlog::get("rwe")->error("Received malformed message, ignoring");
+            return;
+        }
+
+        if (outerMessage.has_desync_snapshot_fragment())
+        {
+            forwardDesyncSnapshotFragment(outerMessage.desync_snapshot_fragment(), receivedBytes);
+            return;
+        }
+
+        if (!outerMessage.has_relay_update())
+        {
+            spdlog::get("rwe")->debug("Not relay update, ignoring");
+            return;
+        }
+
+        const auto& message = outerMessage.relay_update();
+        if (message.player_id() >= peers.size())
+        {
+            spdlog::get("rwe")->error("Received update from unknown player ID {}, ignoring", message.player_id());
+            return;
+        }
+
+        auto& peer = peers[message.player_id()];
+        if (peer.endpoint != currentRemoteEndpoint)
+        {
+            spdlog::get("rwe")->info("Player {} is at {}:{}", peer.playerId.value, currentRemoteEndpoint.address().to_string(), currentRemoteEndpoint.port());
+            peer.endpoint = currentRemoteEndpoint;
+        }
+
+        receiveAcks(peer, message, receiveTime);
+
+        auto newCommands = false;
+        for (const auto& stream : message.streams())
+        {
+            if (stream.player_id() != peer.playerId.value)
+            {
+                spdlog::get("rwe")->error("Player {} sent stream for player {}, ignoring", peer.playerId.value, stream.player_id());
+                continue;
+            }
+
+            newCommands = receiveStream(peer, stream) || newCommands;
+        }
+
+        if (newCommands)
+        {
+            // Pass the commands on to everyone straight away,
+            // which also acks them to the sender.
+            peer.lastReceiveTime = receiveTime;
+            peer.ackPending = true;
+            scheduleFlush();
+        }
+
+        trimStreams();
+    }
+
+    void RelayServer::forwardDesyncSnapshotFragment(const proto::DesyncSnapshotFragment& fragment, std::size_t receivedBytes)
+    {
+        if (fragment.player_id() >= peers.size() || peers[fragment.player_id()].endpoint != currentRemoteEndpoint)
+        {
+            spdlog::get("rwe")->error("Received desync snapshot fragment for player {} from the wrong address, ignoring", fragment.player_id());
+            return;
+        }
+
+        for (const auto& peer : peers)
+        {
+            if (peer.playerId.value == fragment.player_id() || !peer.endpoint)
+            {
+                continue;
+            }
+
+            boost::system::error_code error;
+            socket.send_to(boost::asio::buffer(receiveBuffer.data(), receivedBytes), *peer.endpoint, 0, error);
+            if (error)
+            {
+                spdlog::get("rwe")->warn("Failed to send to player {}: {}", peer.playerId.value, error.message());
+            }
+        }
+    }
+
+    void RelayServer::receiveAcks(Peer& peer, const proto::RelayUpdateMessage& message, Timestamp receiveTime)
+    {
+        for (const auto& ack : message.acks())
+        {
+            auto i = ack.player_id();
+            if (i >= peers.size() || i == peer.playerId.value)
+            {
+                continue;
+            }
+
+            const auto& source = peers[i].stream;
+
+            SequenceNumber nextCommand(ack.next_command_set_to_receive());
+            if (source.getNextCommandSet() < nextCommand)
+            {
+                spdlog::get("rwe")->error("Player {} acked commands of player {} up to {}, but we only have up to {}", peer.playerId.value, i, nextCommand.value, source.getNextCommandSet().value);
+                nextCommand = source.getNextCommandSet();
+            }
+            peer.nextCommandToSend[i] = std::max(peer.nextCommandToSend[i], nextCommand);
+
+            GameTime nextHash(ack.next_game_hash_to_receive());
+            if (source.getNextHash() < nextHash)
+            {
+                spdlog::get("rwe")->error("Player {} acked hashes of player {} up to {}, but we only have up to {}", peer.playerId.value, i, nextHash.value, source.getNextHash().value);
+                nextHash = source.getNextHash();
+            }
+            peer.nextHashToSend[i] = std::max(peer.nextHashToSend[i], nextHash);
+        }
+
+        auto totalAcked = peer.getTotalCommandsAcked();
+        while (!peer.sendTimes.empty() && totalAcked > peer.sendTimes.front().first)
+        {
+            // skip older send time measurements
+            peer.sendTimes.pop_front();
+        }
+        if (!peer.sendTimes.empty() && totalAcked == peer.sendTimes.front().first)
+        {
+            auto roundTripTime = receiveTime - peer.sendTimes.front().second;
+            auto ackDelay = std::chrono::milliseconds(message.ack_delay());
+            roundTripTime = roundTripTime > ackDelay ? roundTripTime - ackDelay : std::chrono::milliseconds(0);
+            auto rttMillis = std::chrono::duration_cast<std::chrono::milliseconds>(roundTripTime).count();
+            auto deviation = std::abs(static_cast<float>(rttMillis) - peer.averageRoundTripTime);
+            peer.roundTripTimeDeviation = ema(deviation, peer.roundTripTimeDeviation, 0.25f);
+            peer.averageRoundTripTime = ema(rttMillis, peer.averageRoundTripTime, 0.1f);
+            peer.sendTimes.pop_front();
+        }
+    }
+
+    bool RelayServer::receiveStream(Peer& peer, const proto::PlayerStreamMessage& message)
+    {
+        auto& stream = peer.stream;
+        stream.currentSceneTime = SceneTime(message.current_scene_time());
+
+        auto newCommands = false;
+        SequenceNumber firstCommandNumber(message.next_command_set_to_send());
+        if (stream.getNextCommandSet() < firstCommandNumber)
+        {
+            // An earlier packet was lost or reordered, the peer will send these again.
+            spdlog::get("rwe")->debug("First command number from player {} was too high, expecting no more than {}, received {}", peer.playerId.value, stream.getNextCommandSet().value, firstCommandNumber.value);
+        }
+        else if (message.has_command_set_fragment_count())
+        {
+            if (firstCommandNumber == stream.getNextCommandSet())
+            {
+                newCommands = receiveCommandSetFragment(peer, message);
+            }
+        }
+        else
+        {
+            auto firstRelevantCommandIndex = (stream.getNextCommandSet() - firstCommandNumber).value;
+            for (int i = firstRelevantCommandIndex; i < message.command_set_size(); ++i)
+            {
+                stream.commandSets.push_back(message.command_set(i));
+                newCommands = true;
+            }
+
+            if (newCommands)
+            {
+                stream.commandSetFragments.clear();
+            }
+        }
+
+        GameTime firstGameHashTime(message.next_game_hash_to_send());
+        if (stream.getNextHash() < firstGameHashTime)
+        {
+            spdlog::get("rwe")->error("First game hash time from player {} was too high! Expecting no more than {}, received {}", peer.playerId.value, stream.getNextHash().value, firstGameHashTime.value);
+            return newCommands;
+        }
+
+        auto firstRelevantGameHashIndex = (stream.getNextHash() - firstGameHashTime).value;
+        for (int i = firstRelevantGameHashIndex; i < message.game_hashes_size(); ++i)
+        {
+            stream.hashes.emplace_back(message.game_hashes(i));
+        }
+
+        return newCommands;
+    }
+
+    bool RelayServer::receiveCommandSetFragment(Peer& peer, const proto::PlayerStreamMessage& message)
+    {
+        auto fragmentCount = message.command_set_fragment_count();
+        auto fragmentIndex = message.command_set_fragment_index();
+        if (fragmentCount <= 0
+            || fragmentCount > GameNetworkService::MaxCommandSetFragmentCount
+            || fragmentIndex < 0
+            || fragmentIndex >= fragmentCount
+            || message.command_set_size() != 1
+            || message.command_set(0).size() > GameNetworkService::CommandSetFragmentSize)
+        {
+            spdlog::get("rwe")->error("Received malformed command set fragment {0} of {1}", fragmentIndex, fragmentCount);
+            return false;
+        }
+
+        auto& fragments = peer.stream.commandSetFragments;
+        if (fragments.size() != static_cast<std::size_t>(fragmentCount))
+        {
+            fragments.clear();
+            fragments.resize(fragmentCount);
+        }
+
+        if (!fragments[fragmentIndex])
+        {
+            fragments[fragmentIndex] = message.command_set(0);
+        }
+
+        if (!std::all_of(fragments.begin(), fragments.end(), [](const auto& f) { return f.has_value(); }))
+        {
+            return false;
+        }
+
+        std::string set;
+        for (const auto& f : fragments)
+        {
+            set += *f;
+        }
+
+        peer.stream.commandSets.push_back(std::move(set));
+        fragments.clear();
+        return true;
+    }
+
+    void RelayServer::trimStreams()
+    {
+        for (auto& source : peers)
+        {
+            auto nextCommand = source.stream.getNextCommandSet();
+            auto nextHash = source.stream.getNextHash();
+            for (const auto& p : peers)
+            {
+                if (p.playerId != source.playerId)
+                {
+                    nextCommand = std::min(nextCommand, p.nextCommandToSend[source.playerId.value]);
+                    nextHash = std::min(nextHash, p.nextHashToSend[source.playerId.value]);
+                }
+            }
+
+            while (source.stream.firstCommandSet < nextCommand)
+            {
+                source.stream.commandSets.pop_front();
+                source.stream.firstCommandSet = SequenceNumber(source.stream.firstCommandSet.value + 1);
+            }
+
+            while (source.stream.firstHash < nextHash)
+            {
+                source.stream.hashes.pop_front();
+                source.stream.firstHash += GameTime(1);
+            }
+        }
+    }
+}
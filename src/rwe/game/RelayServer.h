@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp> // not in asio.hpp in old boost versions
+#include <chrono>
+#include <deque>
+#include <network.pb.h>
+#include <optional>
+#include <random>
+#include <rwe/game/GameNetworkService.h>
+#include <rwe/game/SceneTime.h>
+#include <rwe/rwe_time.h>
+#include <rwe/sim/GameHash.h>
+#include <rwe/sim/GameTime.h>
+#include <rwe/sim/PlayerId.h>
+#include <string>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Relays command sets and game hashes between the peers of a lockstep game,
+     * so that each peer sends to and receives from only the relay
+     * rather than every other peer.
+     *
+     * Each peer sends the relay its own stream, which the relay acks
+     * and keeps until every other peer has acked it in turn.
+     * The relay sends each peer the streams of all the other players
+     * merged into one message, so a peer's upstream bandwidth
+     * does not grow with the number of players
+     * and one slow link only holds up the peer on the end of it.
+     *
+     * Players are numbered from zero, as they are in the game.
+     * The relay learns a peer's address from the messages it sends,
+     * so peers must speak first.
+     *
+     * Pieces of desync snapshots are passed on to every other peer as they are.
+     */
+    class RelayServer
+    {
+    private:
+        /** What we have of a player's stream that some other peer has not yet acked. */
+        struct PlayerStream
+        {
+            SequenceNumber firstCommandSet{0};
+
+            /** Command sets, encoded by serializeCommandSet. */
+            std::deque<std::string> commandSets;
+
+            /** Fragments received so far of the next command set, when it was too big for one packet. */
+            std::vector<std::optional<std::string>> commandSetFragments;
+
+            GameTime firstHash{0};
+            std::deque<GameHash> hashes;
+
+            SceneTime currentSceneTime{0};
+
+            SequenceNumber getNextCommandSet() const;
+
+            GameTime getNextHash() const;
+        };
+
+        struct Peer
+        {
+            PlayerId playerId;
+            std::optional<boost::asio::ip::udp::endpoint> endpoint;
+
+            PlayerStream stream;
+
+            /** For each player, the next command set of theirs that this peer needs. */
+            std::vector<SequenceNumber> nextCommandToSend;
+
+            /** For each player, the next game hash of theirs that this peer needs. */
+            std::vector<GameTime> nextHashToSend;
+
+            /** For each player, the command set of theirs after the last one we have sent this peer. */
+            std::vector<SequenceNumber> nextCommandToForward;
+
+            /** The time we last received new commands from this peer. */
+            std::optional<Timestamp> lastReceiveTime;
+
+            /** Whether we have received new commands from this peer and not yet sent it an ack. */
+            bool ackPending{false};
+
+            /**
+             * Records the time at which we first sent a packet
+             * that would bring the total of this peer's command set acks to the given value.
+             * This is used for measuring RTT when we receive acks.
+             */
+            std::deque<std::pair<unsigned int, Timestamp>> sendTimes;
+
+            float averageRoundTripTime{0};
+            float roundTripTimeDeviation{0};
+
+            /** The time we last sent this peer everything it has not acked. */
+            std::optional<Timestamp> lastSendTime;
+
+            Peer(PlayerId playerId, unsigned int playerCount);
+
+            /** The total of this peer's acks of every other player's command sets. */
+            unsigned int getTotalCommandsAcked() const;
+        };
+
+        std::random_device rd;
+        std::default_random_engine gen{rd()};
+        std::uniform_int_distribution<int> uniform_dist{};
+
+        int port;
+
+        boost::asio::io_service ioContext;
+        boost::asio::ip::udp::socket socket;
+        boost::asio::steady_timer sendTimer;
+        boost::asio::steady_timer flushTimer;
+        bool flushScheduled{false};
+
+        /** Indexed by player ID. */
+        std::vector<Peer> peers;
+
+        std::array<char, 1500> sendBuffer;
+        std::array<char, 1500> receiveBuffer;
+        boost::asio::ip::udp::endpoint currentRemoteEndpoint;
+
+    public:
+        RelayServer(int port, unsigned int playerCount);
+
+        /** Relays messages until stop is called. */
+        void run();
+
+        /** Makes run return. May be called from any thread. */
+        void stop();
+
+    private:
+        void listenForNextMessage();
+
+        void scheduleFlush();
+
+        void scheduleNextSend();
+
+        void sendDue();
+
+        Timestamp getNextSendTime(const Peer& peer, Timestamp now) const;
+
+        bool hasUnackedData(const Peer& peer) const;
+
+        /** Forwards new command sets to every peer. */
+        void sendToAll();
+
+        /**
+         * Sends the peer everything of the other players' streams that it has not acked.
+         * If newOnly is set, only the streams holding command sets the peer has never been sent are included.
+         * The rest are left to the retransmit timer, so that each new command set
+         * does not resend every other player's unacked sets along with it.
+         */
+        void send(Peer& peer, bool newOnly);
+
+        /** Sends the given command set of the source player in several packets. */
+        void sendCommandSetFragments(const Peer& peer, const Peer& source, std::size_t setIndex, std::chrono::milliseconds ackDelay);
+
+        /** Creates a message to the peer holding our ack of its stream. */
+        proto::NetworkMessage createMessage(const Peer& peer, std::chrono::milliseconds ackDelay);
+
+        /** Adds the source player's stream to the message without any commands or hashes yet. */
+        proto::PlayerStreamMessage& addStream(proto::RelayUpdateMessage& message, const Peer& source, SequenceNumber nextCommandToSend, GameTime nextHashToSend);
+
+        void sendMessage(const proto::NetworkMessage& message, const Peer& peer);
+
+        void receive(const boost::system::error_code& error, std::size_t receivedBytes);
+
+        void receiveAcks(Peer& peer, const proto::RelayUpdateMessage& message, Timestamp receiveTime);
+
+        /** Returns true if the stream held new command sets. */
+        bool receiveStream(Peer& peer, const proto::PlayerStreamMessage& message);
+
+        bool receiveCommandSetFragment(Peer& peer, const proto::PlayerStreamMessage& message);
+
+        /** Passes the received packet, which holds the fragment, on to every other peer. */
+        void forwardDesyncSnapshotFragment(const proto::DesyncSnapshotFragment& fragment, std::size_t receivedBytes);
+
+        /** Drops the parts of each player's stream that every other peer has acked. */
+        void trimStreams();
+    };
+}
@@ -0,0 +1,223 @@
+#include "Replay.h"
+#include <algorithm>
+#include <google/protobuf/message_lite.h>
+#include <replay.pb.h>
+#include <rwe/proto/serialization.h>
+#include <stdexcept>
+
+namespace rwe
+{
+    static const char ReplayMagic[4] = {'R', 'W', 'E', 'R'};
+
+    static const std::size_t MaxRecordSize = 64 * 1024 * 1024;
+
+    /** Writes the message preceded by its length as a varint. */
+    static void writeRecord(std::ostream& stream, const google::protobuf::MessageLite& message)
+    {
+        auto bytes = message.SerializeAsString();
+
+        auto size = bytes.size();
+        while (size >= 0x80u)
+        {
+            stream.put(static_cast<char>((size & 0x7fu) | 0x80u));
+            size >>= 7u;
+        }
+        stream.put(static_cast<char>(size));
+
+        stream.write(bytes.data(), bytes.size());
+        if (!stream)
+        {
+            throw std::runtime_error("Failed to write replay");
+        }
+    }
+
+    /** Reads a message written by writeRecord. Returns false if the stream is at its end. */
+    static bool readRecord(std::istream& stream, google::protobuf::MessageLite& message)
+    {
+        std::size_t size = 0;
+        for (unsigned int shift = 0;; shift += 7)
+        {
+            auto c = stream.get();
+            if (c == std::char_traits<char>::eof())
+            {
+                if (shift == 0)
+                {
+                    return false;
+                }
+
+                throw std::runtime_error("Replay is truncated");
+            }
+
+            if (shift > 28)
+            {
+                throw std::runtime_error("Replay record size is malformed");
+            }
+
+            size |= static_cast<std::size_t>(c & 0x7f) << shift;
+            if ((c & 0x80) == 0)
+            {
+                break;
+            }
+        }
+
+        if (size > MaxRecordSize)
+        {
+            throw std::runtime_error("Replay record is too large");
+        }
+
+        std::string bytes(size, '\0');
+        stream.read(bytes.data(), size);
+        if (static_cast<std::size_t>(stream.gcount()) != size)
+        {
+            throw std::runtime_error("Replay is truncated");
+        }
+
+        if (!message.ParseFromString(bytes))
+        {
+            throw std::runtime_error("Replay record is malformed");
+        }
+
+        return true;
+    }
+
+    ReplayWriter::ReplayWriter(std::unique_ptr<std::ostream>&& stream, const ReplayHeader& header)
+        : stream(std::move(stream)), unitTypes(header.unitTypes)
+    {
+        proto::ReplayHeader message;
+        message.set_version(CurrentVersion);
+        message.set_map_name(header.mapName);
+        message.set_schema_index(header.schemaIndex);
+        for (const auto& p : header.players)
+        {
+            auto& player = *message.add_players();
+            player.set_slot(p.slot);
+            if (p.name)
+            {
+                player.set_name(*p.name);
+            }
+            player.set_computer(p.computer);
+            player.set_side(p.side);
+            player.set_color(p.color.value);
+            player.set_metal(p.metal.value);
+            player.set_energy(p.energy.value);
+        }
+        message.set_rng_state(header.rngState);
+        for (const auto& name : unitTypes.getNames())
+        {
+            message.add_unit_types(name);
+        }
+
+        this->stream->write(ReplayMagic, sizeof(ReplayMagic));
+        writeRecord(*this->stream, message);
+        this->stream->flush();
+    }
+
+    void ReplayWriter::recordTick(SceneTime sceneTime, const std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>& commands, GameHash gameHash)
+    {
+        auto hashDue = sceneTime.value % HashInterval == 0;
+        auto hasCommands = std::any_of(commands.begin(), commands.end(), [](const auto& p) { return !p.second.empty(); });
+        if (!hashDue && !hasCommands)
+        {
+            return;
+        }
+
+        proto::ReplayTick message;
+        message.set_tick_delta(sceneTime.value - lastRecordedTime.value);
+        for (const auto& [playerId, playerCommands] : commands)
+        {
+            if (playerCommands.empty())
+            {
+                continue;
+            }
+
+            message.add_command_set_player_id(playerId.value);
+            message.add_command_set(serializeCommandSet(playerCommands, unitTypes));
+        }
+
+        if (hashDue)
+        {
+            message.set_game_hash(gameHash.value);
+        }
+
+        writeRecord(*stream, message);
+        lastRecordedTime = sceneTime;
+
+        if (hashDue)
+        {
+            stream->flush();
+        }
+    }
+
+    ReplayReader::ReplayReader(std::unique_ptr<std::istream>&& stream)
+        : stream(std::move(stream))
+    {
+        char magic[sizeof(ReplayMagic)];
+        this->stream->read(magic, sizeof(magic));
+        if (this->stream->gcount() != sizeof(magic) || !std::equal(std::begin(magic), std::end(magic), std::begin(ReplayMagic)))
+        {
+            throw std::runtime_error("Not a replay file");
+        }
+
+        proto::ReplayHeader message;
+        if (!readRecord(*this->stream, message))
+        {
+            throw std::runtime_error("Replay is truncated");
+        }
+
+        if (message.version() != static_cast<int>(ReplayWriter::CurrentVersion))
+        {
+            throw std::runtime_error("Unsupported replay version " + std::to_string(message.version()));
+        }
+
+        header.mapName = message.map_name();
+        header.schemaIndex = message.schema_index();
+        for (const auto& p : message.players())
+        {
+            header.players.push_back(ReplayPlayer{
+                static_cast<unsigned int>(p.slot()),
+                p.has_name() ? std::make_optional(p.name()) : std::nullopt,
+                p.computer(),
+                p.side(),
+                PlayerColorIndex(p.color()),
+                Metal(p.metal()),
+                Energy(p.energy())});
+        }
+        header.rngState = message.rng_state();
+        header.unitTypes.assign(message.unit_types().begin(), message.unit_types().end());
+        unitTypes = UnitTypeTable(header.unitTypes);
+    }
+
+    const ReplayHeader& ReplayReader::getHeader() const
+    {
+        return header;
+    }
+
+    std::optional<ReplayTick> ReplayReader::readTick()
+    {
+        proto::ReplayTick message;
+        if (!readRecord(*stream, message))
+        {
+            return std::nullopt;
+        }
+
+        if (message.command_set_player_id_size() != message.command_set_size())
+        {
+            throw std::runtime_error("Replay tick has mismatched command sets");
+        }
+
+        ReplayTick tick;
+        tick.sceneTime = lastReadTime + SceneTime(message.tick_delta());
+        for (int i = 0; i < message.command_set_size(); ++i)
+        {
+            tick.commands.emplace_back(PlayerId(message.command_set_player_id(i)), deserializeCommandSet(message.command_set(i), unitTypes));
+        }
+
+        if (message.has_game_hash())
+        {
+            tick.gameHash = GameHash(message.game_hash());
+        }
+
+        lastReadTime = tick.sceneTime;
+        return tick;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <rwe/game/PlayerColorIndex.h>
+#include <rwe/game/PlayerCommand.h>
+#include <rwe/game/SceneTime.h>
+#include <rwe/proto/UnitTypeTable.h>
+#include <rwe/sim/Energy.h>
+#include <rwe/sim/GameHash.h>
+#include <rwe/sim/Metal.h>
+#include <rwe/sim/PlayerId.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rwe
+{
+    struct ReplayPlayer
+    {
+        /** The player's slot in the game parameters, which decides their start position. */
+        unsigned int slot;
+        std::optional<std::string> name;
+        bool computer;
+        std::string side;
+        PlayerColorIndex color;
+        Metal metal;
+        Energy energy;
+    };
+
+    /** Everything needed to set up the simulation as it was at the start of the game. */
+    struct ReplayHeader
+    {
+        std::string mapName;
+        unsigned int schemaIndex;
+
+        /** In the order they were added to the simulation. */
+        std::vector<ReplayPlayer> players;
+
+        /** The state of the simulation's random number generator once seeded, as written by operator<<. */
+        std::string rngState;
+
+        /** The names of the game's unit types, as in its UnitTypeTable. */
+        std::vector<std::string> unitTypes;
+    };
+
+    struct ReplayTick
+    {
+        SceneTime sceneTime;
+
+        /** The non-empty command sets executed on this tick, in player ID order. */
+        std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> commands;
+
+        std::optional<GameHash> gameHash;
+    };
+
+    /**
+     * Writes a replay of a game as it is played.
+     *
+     * A replay is a header followed by a record for every tick on which commands were executed.
+     * Every HashInterval ticks a record is written regardless, holding the game hash,
+     * so that playback can check it is reproducing the game faithfully.
+     * Records are flushed when a hash is written,
+     * so a game that ends abruptly still leaves a usable replay.
+     */
+    class ReplayWriter
+    {
+    public:
+        static constexpr unsigned int CurrentVersion = 2;
+
+        static constexpr unsigned int HashInterval = 30;
+
+    private:
+        std::unique_ptr<std::ostream> stream;
+
+        UnitTypeTable unitTypes;
+
+        SceneTime lastRecordedTime{0};
+
+    public:
+        ReplayWriter(std::unique_ptr<std::ostream>&& stream, const ReplayHeader& header);
+
+        /** Records the commands executed on a tick and the game hash after it. */
+        void recordTick(SceneTime sceneTime, const std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>>& commands, GameHash gameHash);
+    };
+
+    /**
+     * Reads a replay written by ReplayWriter.
+     * Throws std::runtime_error if the replay is malformed
+     * or was written by an incompatible version.
+     */
+    class ReplayReader
+    {
+    private:
+        std::unique_ptr<std::istream> stream;
+
+        ReplayHeader header;
+
+        UnitTypeTable unitTypes;
+
+        SceneTime lastReadTime{0};
+
+    public:
+        explicit ReplayReader(std::unique_ptr<std::istream>&& stream);
+
+        const ReplayHeader& getHeader() const;
+
+        /**
+         * Reads the next recorded tick, or returns nothing at the end of the replay.
+         * Ticks between recorded ticks had no commands.
+         */
+        std::optional<ReplayTick> readTick();
+    };
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+#include <rwe/game/Replay.h>
+#include <sstream>
+
+namespace rwe
+{
+    TEST_CASE("Replay")
+    {
+        ReplayHeader header{
+            "Coast To Coast",
+            2,
+            {
+                ReplayPlayer{0, std::string("Alice"), false, "ARM", PlayerColorIndex(3), Metal(1000), Energy(1500)},
+                ReplayPlayer{4, std::nullopt, true, "CORE", PlayerColorIndex(1), Metal(500), Energy(500)},
+            },
+            "48271",
+            {"ARMCOM", "CORAK"}};
+
+        auto stream = std::make_unique<std::stringstream>();
+        auto& written = *stream;
+        ReplayWriter writer(std::move(stream), header);
+
+        auto readBack = [&]() {
+            return ReplayReader(std::make_unique<std::stringstream>(written.str()));
+        };
+
+        SECTION("reads back the header")
+        {
+            auto reader = readBack();
+            const auto& h = reader.getHeader();
+            REQUIRE(h.mapName == "Coast To Coast");
+            REQUIRE(h.schemaIndex == 2);
+            REQUIRE(h.players.size() == 2);
+            REQUIRE(h.players[0].slot == 0);
+            REQUIRE(h.players[0].name == std::optional<std::string>("Alice"));
+            REQUIRE(!h.players[0].computer);
+            REQUIRE(h.players[0].side == "ARM");
+            REQUIRE(h.players[0].color == PlayerColorIndex(3));
+            REQUIRE(h.players[0].energy == Energy(1500));
+            REQUIRE(h.players[1].slot == 4);
+            REQUIRE(!h.players[1].name);
+            REQUIRE(h.players[1].computer);
+            REQUIRE(h.rngState == "48271");
+            REQUIRE(h.unitTypes == std::vector<std::string>{"ARMCOM", "CORAK"});
+
+            REQUIRE(!reader.readTick());
+        }
+
+        SECTION("records only ticks with commands or a hash")
+        {
+            std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> noCommands{{PlayerId(0), {}}, {PlayerId(1), {}}};
+            std::vector<std::pair<PlayerId, std::vector<PlayerCommand>>> someCommands{
+                {PlayerId(0), {}},
+                {PlayerId(1), {PlayerUnitCommand(UnitId(7), PlayerUnitCommand::Stop()), PlayerUnitCommand(UnitId(8), PlayerUnitCommand::Stop())}}};
+
+            for (unsigned int t = 1; t <= ReplayWriter::HashInterval + 5; ++t)
+            {
+                writer.recordTick(SceneTime(t), t == 4 || t == ReplayWriter::HashInterval ? someCommands : noCommands, GameHash(t * 3));
+            }
+
+            auto reader = readBack();
+
+            auto first = reader.readTick();
+            REQUIRE(first);
+            REQUIRE(first->sceneTime == SceneTime(4));
+            REQUIRE(!first->gameHash);
+            REQUIRE(first->commands.size() == 1);
+            REQUIRE(first->commands[0].first == PlayerId(1));
+            REQUIRE(first->commands[0].second.size() == 2);
+
+            auto second = reader.readTick();
+            REQUIRE(second);
+            REQUIRE(second->sceneTime == SceneTime(ReplayWriter::HashInterval));
+            REQUIRE(second->gameHash == GameHash(ReplayWriter::HashInterval * 3));
+            REQUIRE(second->commands.size() == 1);
+
+            REQUIRE(!reader.readTick());
+        }
+
+        SECTION("reads back unit types in commands")
+        {
+            writer.recordTick(SceneTime(1), {{PlayerId(0), {PlayerUnitCommand(UnitId(7), PlayerUnitCommand::ModifyBuildQueue{1, "CORAK"})}}}, GameHash(1));
+
+            auto reader = readBack();
+            auto tick = reader.readTick();
+            REQUIRE(tick);
+            const auto& command = std::get<PlayerUnitCommand>(tick->commands.at(0).second.at(0));
+            REQUIRE(std::get<PlayerUnitCommand::ModifyBuildQueue>(command.command).unitType == "CORAK");
+        }
+
+        SECTION("rejects files that are not replays")
+        {
+            REQUIRE_THROWS(ReplayReader(std::make_unique<std::stringstream>("not a replay")));
+        }
+
+        SECTION("rejects truncated replays")
+        {
+            writer.recordTick(SceneTime(ReplayWriter::HashInterval), {{PlayerId(0), {PlayerPauseGameCommand()}}}, GameHash(1));
+            auto data = written.str();
+            data.pop_back();
+
+            ReplayReader reader(std::make_unique<std::stringstream>(data));
+            REQUIRE_THROWS(reader.readTick());
+        }
+    }
+}
@@ -3,6 +3,69 @@
 
 namespace rwe
 {
+    class Fnv1aHasher
+    {
+    private:
+        std::uint64_t hash{14695981039346656037ull};
+
+    public:
+        void addByte(std::uint8_t b)
+        {
+            hash ^= b;
+            hash *= 1099511628211ull;
+        }
+
+        void add(std::uint32_t v)
+        {
+            addByte(static_cast<std::uint8_t>(v));
+            addByte(static_cast<std::uint8_t>(v >> 8));
+            addByte(static_cast<std::uint8_t>(v >> 16));
+            addByte(static_cast<std::uint8_t>(v >> 24));
+        }
+
+        void add(const std::string& s)
+        {
+            add(static_cast<std::uint32_t>(s.size()));
+            for (auto c : s)
+            {
+                addByte(static_cast<std::uint8_t>(c));
+            }
+        }
+
+        std::uint64_t get() const
+        {
+            return hash;
+        }
+    };
+
+    std::uint64_t computeCobScriptHash(const CobScript& script)
+    {
+        Fnv1aHasher hasher;
+
+        hasher.add(static_cast<std::uint32_t>(script.instructions.size()));
+        for (auto instruction : script.instructions)
+        {
+            hasher.add(instruction);
+        }
+
+        hasher.add(static_cast<std::uint32_t>(script.pieces.size()));
+        for (const auto& piece : script.pieces)
+        {
+            hasher.add(piece);
+        }
+
+        hasher.add(static_cast<std::uint32_t>(script.functions.size()));
+        for (const auto& function : script.functions)
+        {
+            hasher.add(function.name);
+            hasher.add(function.address);
+        }
+
+        hasher.add(script.staticVariableCount);
+
+        return hasher.get();
+    }
+
     CobScript parseCob(std::istream& stream)
     {
         auto header = readRaw<CobHeader>(stream);
@@ -50,6 +113,8 @@ namespace rwe
             stream.seekg(loc);
         }
 
+        script.contentHash = computeCobScriptHash(script);
+
         return script;
     }
 }
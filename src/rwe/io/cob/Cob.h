@@ -35,7 +35,16 @@ namespace rwe
         std::vector<std::string> pieces;
         std::vector<CobFunctionInfo> functions;
         unsigned int staticVariableCount;
+
+        /**
+         * The result of computeCobScriptHash for this script,
+         * computed once when the script is loaded.
+         */
+        std::uint64_t contentHash{0};
     };
 
+    /** Hashes the script's code, pieces, functions and static variable count. */
+    std::uint64_t computeCobScriptHash(const CobScript& script);
+
     CobScript parseCob(std::istream& stream);
 }
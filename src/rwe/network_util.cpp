@@ -1,4 +1,5 @@
 #include "network_util.h"
+#include <algorithm>
 #include <boost/crc.hpp>
 
 namespace rwe
@@ -7,6 +8,21 @@ namespace rwe
     {
         return (alpha * val) + ((1.0f - alpha) * average);
     }
+
+    std::chrono::milliseconds computeRetransmitInterval(
+        float averageRoundTripTime,
+        float roundTripTimeDeviation,
+        std::chrono::milliseconds minInterval,
+        std::chrono::milliseconds maxInterval)
+    {
+        if (averageRoundTripTime <= 0.0f)
+        {
+            return maxInterval;
+        }
+
+        auto interval = std::chrono::milliseconds(static_cast<long long>(averageRoundTripTime + (4.0f * roundTripTimeDeviation)));
+        return std::clamp(interval, minInterval, maxInterval);
+    }
     void writeInt(char* sendBuffer, unsigned int crcResult)
     {
         sendBuffer[0] = crcResult & 0xffu;
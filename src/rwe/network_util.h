@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <rwe/game/SceneTime.h>
 #include <rwe/rwe_time.h>
 
@@ -7,6 +8,19 @@ namespace rwe
 {
     float ema(float val, float average, float alpha);
 
+    /**
+     * Computes how long to wait for an ack before sending unacked data again,
+     * from the smoothed round trip time and its mean deviation, in milliseconds,
+     * in the same way as TCP's retransmission timeout.
+     * The result is clamped to the given bounds.
+     * With no measurement yet, the maximum is used.
+     */
+    std::chrono::milliseconds computeRetransmitInterval(
+        float averageRoundTripTime,
+        float roundTripTimeDeviation,
+        std::chrono::milliseconds minInterval,
+        std::chrono::milliseconds maxInterval);
+
     template <typename Range>
     unsigned int estimateAverageSceneTimeStatic(SceneTime localSceneTime, Range sceneTimes, Timestamp time)
     {
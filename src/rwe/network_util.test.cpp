@@ -14,6 +14,28 @@ namespace rwe
         }
     }
 
+    TEST_CASE("computeRetransmitInterval")
+    {
+        std::chrono::milliseconds minInterval(15);
+        std::chrono::milliseconds maxInterval(100);
+
+        SECTION("uses the maximum before RTT has been measured")
+        {
+            REQUIRE(computeRetransmitInterval(0.0f, 0.0f, minInterval, maxInterval) == maxInterval);
+        }
+
+        SECTION("allows four deviations on top of the average")
+        {
+            REQUIRE(computeRetransmitInterval(20.0f, 5.0f, minInterval, maxInterval) == std::chrono::milliseconds(40));
+        }
+
+        SECTION("clamps to the bounds")
+        {
+            REQUIRE(computeRetransmitInterval(1.0f, 0.5f, minInterval, maxInterval) == minInterval);
+            REQUIRE(computeRetransmitInterval(300.0f, 20.0f, minInterval, maxInterval) == maxInterval);
+        }
+    }
+
     TEST_CASE("readInt")
     {
         rc::prop("readInt inverts writeInt", [](unsigned int i) {
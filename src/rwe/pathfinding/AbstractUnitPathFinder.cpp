@@ -3,13 +3,15 @@
 namespace rwe
 {
     AbstractUnitPathFinder::AbstractUnitPathFinder(
-        const GameSimulation* simulation,
+        Workspace* workspace,
+        const PathFindingSnapshot* snapshot,
         const MovementClassCollisionService* collisionService,
         UnitId self,
         std::optional<MovementClassId> movementClass,
         unsigned int footprintX,
         unsigned int footprintZ)
-        : simulation(simulation),
+        : GridAStarPathFinder(workspace, snapshot->getWidth(), snapshot->getHeight()),
+          snapshot(snapshot),
           collisionService(collisionService),
           self(self),
           movementClass(movementClass),
@@ -18,22 +20,24 @@ namespace rwe
     {
     }
 
-    std::vector<AbstractUnitPathFinder::VertexInfo>
-    AbstractUnitPathFinder::getSuccessors(const VertexInfo& info)
+    void AbstractUnitPathFinder::getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors)
     {
         std::optional<Direction> prevDirection;
-        if (info.predecessor)
+        if (predecessor)
         {
-            prevDirection = pointToDirection(info.vertex - (*info.predecessor)->vertex);
+            prevDirection = pointToDirection(vertex - *predecessor);
         }
 
-        auto neighbours = getNeighbours(info.vertex);
-
-        std::vector<VertexInfo> vs;
-        for (const auto& neighbour : neighbours)
+        for (auto direction : Directions)
         {
-            auto direction = pointToDirection(neighbour - info.vertex);
-            auto distance = octileDistance(info.vertex, neighbour);
+            auto neighbour = step(vertex, direction);
+
+            if (!isWalkable(neighbour))
+            {
+                continue;
+            }
+
+            auto distance = octileDistance(vertex, neighbour);
             assert(distance.diagonal == 0 || distance.straight == 0);
             if (isRoughTerrain(neighbour))
             {
@@ -42,16 +46,14 @@ namespace rwe
             }
             unsigned int turns = prevDirection ? directionDistance(*prevDirection, direction) : 0;
             PathCost cost(distance, turns);
-            vs.push_back(VertexInfo{info.costToReach + cost, neighbour, &info});
+            successors.push(neighbour, costToReach + cost);
         }
-
-        return vs;
     }
 
     bool AbstractUnitPathFinder::isWalkable(const Point& p) const
     {
         DiscreteRect rect(p.x, p.y, footprintX, footprintZ);
-        return (movementClass ? collisionService->isWalkable(*movementClass, p) : true) && !simulation->isCollisionAt(rect, self);
+        return (movementClass ? collisionService->isWalkable(*movementClass, p) : true) && !snapshot->isCollisionAt(rect, self);
     }
 
     bool AbstractUnitPathFinder::isWalkable(int x, int y) const
@@ -62,7 +64,7 @@ namespace rwe
     bool AbstractUnitPathFinder::isRoughTerrain(const Point& p) const
     {
         DiscreteRect rect(p.x, p.y, footprintX, footprintZ);
-        return simulation->isAdjacentToObstacle(rect);
+        return snapshot->isAdjacentToObstacle(rect);
     }
 
     Point AbstractUnitPathFinder::step(const Point& p, Direction d) const
@@ -70,24 +72,4 @@ namespace rwe
         auto directionVector = directionToPoint(d);
         return p + directionVector;
     }
-
-    std::vector<Point> AbstractUnitPathFinder::getNeighbours(const Point& p)
-    {
-        std::vector<Point> neighbours;
-        neighbours.reserve(Directions.size());
-
-        for (auto d : Directions)
-        {
-            auto newPosition = step(p, d);
-
-            if (!isWalkable(newPosition))
-            {
-                continue;
-            }
-
-            neighbours.push_back(newPosition);
-        }
-
-        return neighbours;
-    }
 }
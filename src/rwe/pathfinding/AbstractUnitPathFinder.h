@@ -2,10 +2,10 @@
 
 #include <rwe/grid/DiscreteRect.h>
 #include <rwe/grid/EightWayDirection.h>
-#include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
 #include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
 #include <rwe/pathfinding/pathfinding_utils.h>
-#include <rwe/sim/GameSimulation.h>
 #include <rwe/sim/MovementClassCollisionService.h>
 #include <rwe/sim/UnitId.h>
 
@@ -14,10 +14,10 @@ namespace rwe
     /**
      * Standard unit pathfinder.
      */
-    class AbstractUnitPathFinder : public AStarPathFinder<Point, PathCost>
+    class AbstractUnitPathFinder : public GridAStarPathFinder<PathCost>
     {
     private:
-        const GameSimulation* const simulation;
+        const PathFindingSnapshot* const snapshot;
         const MovementClassCollisionService* const collisionService;
         const UnitId self;
         const std::optional<MovementClassId> movementClass;
@@ -26,7 +26,8 @@ namespace rwe
 
     public:
         AbstractUnitPathFinder(
-            const GameSimulation* simulation,
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
             const MovementClassCollisionService* collisionService,
             UnitId self,
             std::optional<MovementClassId> movementClass,
@@ -34,17 +35,15 @@ namespace rwe
             unsigned int footprintZ);
 
     protected:
-        std::vector<VertexInfo> getSuccessors(const VertexInfo& vertex) override;
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override;
 
-    private:
         bool isWalkable(const Point& p) const;
 
-        bool isWalkable(int x, int y) const;
-
         bool isRoughTerrain(const Point& p) const;
 
-        Point step(const Point& p, Direction d) const;
+    private:
+        bool isWalkable(int x, int y) const;
 
-        std::vector<Point> getNeighbours(const Point& p);
+        Point step(const Point& p, Direction d) const;
     };
 }
@@ -0,0 +1,147 @@
+#include "ConnectedComponents.h"
+#include <algorithm>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+#include <utility>
+#include <vector>
+
+namespace rwe
+{
+    ConnectedComponents::ConnectedComponents(int width, int height, const WalkableFunction& isWalkable)
+        : labels(Grid<unsigned int>::from(width, height, [&](const GridCoordinates& c) {
+              return isWalkable(Point(c.x, c.y)) ? Unlabelled : NoComponent;
+          }))
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if (labels.get(x, y) == Unlabelled)
+                {
+                    floodFill(Point(x, y), 0);
+                }
+            }
+        }
+    }
+
+    void ConnectedComponents::relabelRegion(const DiscreteRect& rect, const WalkableFunction& isWalkable)
+    {
+        auto region = labels.clipRegion(rect);
+        for (auto y = region.y; y < region.y + region.height; ++y)
+        {
+            for (auto x = region.x; x < region.x + region.width; ++x)
+            {
+                labels.set(x, y, isWalkable(Point(x, y)) ? Unlabelled : NoComponent);
+            }
+        }
+
+        // Any component that was split or joined by the change
+        // has a cell in the rect or just outside it,
+        // so filling from those cells relabels every affected component in full.
+        auto minLabelToKeep = nextLabel;
+        auto margin = labels.clipRegion(DiscreteRect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2));
+        for (auto y = margin.y; y < margin.y + margin.height; ++y)
+        {
+            for (auto x = margin.x; x < margin.x + margin.width; ++x)
+            {
+                auto label = labels.get(x, y);
+                if (label != NoComponent && (label == Unlabelled || label < minLabelToKeep))
+                {
+                    floodFill(Point(x, y), minLabelToKeep);
+                }
+            }
+        }
+    }
+
+    unsigned int ConnectedComponents::getLabel(const Point& p) const
+    {
+        return labels.tryGetValue(p).value_or(NoComponent);
+    }
+
+    bool ConnectedComponents::isSameComponent(const Point& a, const Point& b) const
+    {
+        auto label = getLabel(a);
+        return label != NoComponent && label == getLabel(b);
+    }
+
+    std::optional<Point> ConnectedComponents::findNearestInComponent(const Point& target, unsigned int label) const
+    {
+        if (label == NoComponent)
+        {
+            return std::nullopt;
+        }
+
+        if (getLabel(target) == label)
+        {
+            return target;
+        }
+
+        // Every cell in the ring at a given radius is at least that far away,
+        // but a diagonal cell in one ring can be further away than a straight cell in the next,
+        // so keep looking outwards until no further ring can hold a closer cell.
+        std::optional<Point> best;
+        float bestDistance = 0.0f;
+        auto maxRadius = std::max(labels.getWidth(), labels.getHeight());
+        for (int radius = 1; radius <= maxRadius; ++radius)
+        {
+            if (best && static_cast<float>(radius) > bestDistance)
+            {
+                break;
+            }
+
+            for (auto y = target.y - radius; y <= target.y + radius; ++y)
+            {
+                auto onEdgeRow = y == target.y - radius || y == target.y + radius;
+                auto step = onEdgeRow ? 1 : 2 * radius;
+                for (auto x = target.x - radius; x <= target.x + radius; x += step)
+                {
+                    Point p(x, y);
+                    if (getLabel(p) != label)
+                    {
+                        continue;
+                    }
+
+                    auto distance = octileDistance(target, p).asFloat();
+                    if (!best || distance < bestDistance || (distance == bestDistance && std::make_pair(p.y, p.x) < std::make_pair(best->y, best->x)))
+                    {
+                        best = p;
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+
+        return best;
+    }
+
+    void ConnectedComponents::floodFill(const Point& start, unsigned int minLabelToKeep)
+    {
+        auto label = nextLabel++;
+        labels.set(start.x, start.y, label);
+
+        std::vector<Point> open{start};
+        while (!open.empty())
+        {
+            auto p = open.back();
+            open.pop_back();
+
+            for (auto d : Directions)
+            {
+                auto n = p + directionToPoint(d);
+                auto neighbourLabel = labels.tryGetValue(n);
+                if (!neighbourLabel || *neighbourLabel == NoComponent)
+                {
+                    continue;
+                }
+
+                if (*neighbourLabel != Unlabelled && *neighbourLabel >= minLabelToKeep)
+                {
+                    continue;
+                }
+
+                labels.set(n.x, n.y, label);
+                open.push_back(n);
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <rwe/grid/DiscreteRect.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/grid/Point.h>
+
+namespace rwe
+{
+    /**
+     * Labels each walkable cell of a grid with the connected component it belongs to,
+     * so that whether one cell can be reached from another
+     * can be answered without searching.
+     *
+     * Cells are connected to all eight of their neighbours,
+     * as in AbstractUnitPathFinder.
+     */
+    class ConnectedComponents
+    {
+    public:
+        using WalkableFunction = std::function<bool(const Point&)>;
+
+        /** The label of cells that are not walkable. */
+        static constexpr unsigned int NoComponent = 0;
+
+    private:
+        /** Marks walkable cells not yet given a label during relabelling. */
+        static constexpr unsigned int Unlabelled = ~0u;
+
+        Grid<unsigned int> labels;
+        unsigned int nextLabel{1};
+
+    public:
+        ConnectedComponents(int width, int height, const WalkableFunction& isWalkable);
+
+        /**
+         * Updates the labels after the walkability of cells within the given rect has changed.
+         * Only the components touching the rect are relabelled,
+         * but each of those is refilled in full,
+         * so the cost grows with the size of those components rather than of the rect.
+         */
+        void relabelRegion(const DiscreteRect& rect, const WalkableFunction& isWalkable);
+
+        /** Returns NoComponent for cells that are not walkable or are outside the grid. */
+        unsigned int getLabel(const Point& p) const;
+
+        bool isSameComponent(const Point& a, const Point& b) const;
+
+        /**
+         * Returns the cell in the given component closest to target,
+         * or nullopt if the component is empty.
+         * Of cells equally close, the first in row order is chosen.
+         */
+        std::optional<Point> findNearestInComponent(const Point& target, unsigned int label) const;
+
+    private:
+        /**
+         * Gives a new label to every unlabelled cell connected to start,
+         * and to every cell connected to those with a label lower than minLabelToKeep.
+         */
+        void floodFill(const Point& start, unsigned int minLabelToKeep);
+    };
+}
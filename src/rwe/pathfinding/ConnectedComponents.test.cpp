@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/ConnectedComponents.h>
+
+namespace rwe
+{
+    TEST_CASE("ConnectedComponents")
+    {
+        Grid<char> grid(20, 10, 1);
+        auto isWalkable = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) != 0; };
+
+        auto buildWall = [&](int x) {
+            for (int y = 0; y < 10; ++y)
+            {
+                grid.set(x, y, 0);
+            }
+        };
+
+        SECTION("labels separated areas differently")
+        {
+            buildWall(10);
+            ConnectedComponents components(20, 10, isWalkable);
+
+            REQUIRE(components.isSameComponent(Point(0, 0), Point(9, 9)));
+            REQUIRE(components.isSameComponent(Point(11, 0), Point(19, 9)));
+            REQUIRE(!components.isSameComponent(Point(0, 0), Point(19, 9)));
+            REQUIRE(components.getLabel(Point(10, 5)) == ConnectedComponents::NoComponent);
+            REQUIRE(components.getLabel(Point(-1, 5)) == ConnectedComponents::NoComponent);
+        }
+
+        SECTION("connects cells diagonally")
+        {
+            grid = Grid<char>(20, 10, 0);
+            grid.set(2, 2, 1);
+            grid.set(3, 3, 1);
+            ConnectedComponents components(20, 10, isWalkable);
+
+            REQUIRE(components.isSameComponent(Point(2, 2), Point(3, 3)));
+        }
+
+        SECTION("splits a component when a wall is added")
+        {
+            ConnectedComponents components(20, 10, isWalkable);
+            REQUIRE(components.isSameComponent(Point(0, 0), Point(19, 9)));
+
+            buildWall(10);
+            components.relabelRegion(DiscreteRect(10, 0, 1, 10), isWalkable);
+
+            REQUIRE(components.isSameComponent(Point(0, 0), Point(9, 9)));
+            REQUIRE(components.isSameComponent(Point(11, 0), Point(19, 9)));
+            REQUIRE(!components.isSameComponent(Point(0, 0), Point(19, 9)));
+        }
+
+        SECTION("joins components when a gap is opened")
+        {
+            buildWall(10);
+            ConnectedComponents components(20, 10, isWalkable);
+
+            grid.set(10, 3, 1);
+            components.relabelRegion(DiscreteRect(10, 3, 1, 1), isWalkable);
+
+            REQUIRE(components.isSameComponent(Point(0, 0), Point(19, 9)));
+            REQUIRE(components.isSameComponent(Point(10, 3), Point(19, 9)));
+        }
+
+        SECTION("finds the nearest cell in a component")
+        {
+            buildWall(10);
+            buildWall(11);
+            ConnectedComponents components(20, 10, isWalkable);
+
+            auto label = components.getLabel(Point(0, 0));
+            REQUIRE(components.findNearestInComponent(Point(15, 4), label) == Point(9, 4));
+            REQUIRE(components.findNearestInComponent(Point(3, 3), label) == Point(3, 3));
+            REQUIRE(!components.findNearestInComponent(Point(3, 3), ConnectedComponents::NoComponent));
+        }
+
+        SECTION("prefers a straight cell further out to a diagonal cell further away")
+        {
+            grid = Grid<char>(20, 10, 0);
+            grid.set(9, 5, 1);
+            grid.set(9, 6, 1);
+            grid.set(9, 7, 1);
+            grid.set(8, 8, 1);
+            ConnectedComponents components(20, 10, isWalkable);
+
+            auto label = components.getLabel(Point(9, 5));
+            REQUIRE(components.findNearestInComponent(Point(5, 5), label) == Point(9, 5));
+        }
+    }
+}
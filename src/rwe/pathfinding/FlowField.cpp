@@ -0,0 +1,221 @@
+#include "FlowField.h"
+#include <algorithm>
+#include <queue>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+
+namespace rwe
+{
+    FlowField::FlowField(int width, int height, const Point& goal)
+        : goal(goal), cells(width, height)
+    {
+    }
+
+    FlowField FlowField::compute(
+        int width,
+        int height,
+        const Point& goal,
+        const std::vector<Point>& targets,
+        const CellFunction& isWalkable,
+        const CellFunction& isRoughTerrain)
+    {
+        FlowField field(width, height, goal);
+
+        auto goalCell = field.cells.tryGet(goal);
+        if (!goalCell || !isWalkable(goal))
+        {
+            return field;
+        }
+
+        auto toIndex = [&](const Point& p) { return static_cast<unsigned int>((p.y * width) + p.x); };
+        auto fromIndex = [&](unsigned int i) { return Point(static_cast<int>(i) % width, static_cast<int>(i) / width); };
+
+        std::vector<Point> remainingTargets(targets);
+        auto sortByIndex = [&](const Point& a, const Point& b) { return toIndex(a) < toIndex(b); };
+        std::sort(remainingTargets.begin(), remainingTargets.end(), sortByIndex);
+        remainingTargets.erase(std::unique(remainingTargets.begin(), remainingTargets.end()), remainingTargets.end());
+
+        // Cells are settled in order of cost, with ties broken by index,
+        // so that the field does not depend on how the queue is implemented.
+        using QueueEntry = std::pair<OctileDistance, unsigned int>;
+        auto compareEntries = [](const QueueEntry& a, const QueueEntry& b) {
+            if (b.first < a.first)
+            {
+                return true;
+            }
+            if (a.first < b.first)
+            {
+                return false;
+            }
+            return a.second > b.second;
+        };
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, decltype(compareEntries)> open(compareEntries);
+
+        std::vector<bool> settled(width * height, false);
+
+        auto& goalState = field.cells.get(goal.x, goal.y);
+        goalState.cost = OctileDistance();
+        goalState.rough = isRoughTerrain(goal);
+        open.emplace(OctileDistance(), toIndex(goal));
+
+        while (!open.empty() && !remainingTargets.empty())
+        {
+            auto [cost, index] = open.top();
+            open.pop();
+            if (settled[index])
+            {
+                continue;
+            }
+            settled[index] = true;
+            field.reachedCellCount += 1;
+
+            auto p = fromIndex(index);
+            if (!field.reachedBounds)
+            {
+                field.reachedBounds = DiscreteRect(p.x, p.y, 1, 1);
+            }
+            else
+            {
+                auto& bounds = *field.reachedBounds;
+                auto right = std::max(bounds.x + bounds.width, p.x + 1);
+                auto bottom = std::max(bounds.y + bounds.height, p.y + 1);
+                bounds.x = std::min(bounds.x, p.x);
+                bounds.y = std::min(bounds.y, p.y);
+                bounds.width = right - bounds.x;
+                bounds.height = bottom - bounds.y;
+            }
+            auto targetIt = std::lower_bound(remainingTargets.begin(), remainingTargets.end(), p, sortByIndex);
+            if (targetIt != remainingTargets.end() && *targetIt == p)
+            {
+                remainingTargets.erase(targetIt);
+            }
+
+            const auto& state = field.cells.get(p.x, p.y);
+            for (auto d : Directions)
+            {
+                auto n = p + directionToPoint(d);
+                auto neighbour = field.cells.tryGet(n);
+                if (!neighbour || settled[toIndex(n)])
+                {
+                    continue;
+                }
+
+                if (!neighbour->get().cost && !isWalkable(n))
+                {
+                    continue;
+                }
+
+                // A unit at n steps onto p, so p's terrain determines the cost.
+                auto distance = octileDistance(n, p);
+                if (state.rough)
+                {
+                    // double the cost on rough terrain
+                    distance = distance + distance;
+                }
+                auto newCost = cost + distance;
+
+                auto& neighbourState = field.cells.get(n.x, n.y);
+                if (!neighbourState.cost)
+                {
+                    neighbourState.rough = isRoughTerrain(n);
+                }
+                else if (!(newCost < *neighbourState.cost))
+                {
+                    continue;
+                }
+
+                neighbourState.cost = newCost;
+                open.emplace(newCost, toIndex(n));
+            }
+        }
+
+        // Cells left in the open list have a cost, but it may not be final.
+        while (!open.empty())
+        {
+            auto index = open.top().second;
+            open.pop();
+            if (!settled[index])
+            {
+                auto p = fromIndex(index);
+                field.cells.get(p.x, p.y).cost = std::nullopt;
+            }
+        }
+
+        return field;
+    }
+
+    const Point& FlowField::getGoal() const
+    {
+        return goal;
+    }
+
+    bool FlowField::isReached(const Point& p) const
+    {
+        auto cell = cells.tryGet(p);
+        return cell && cell->get().cost.has_value();
+    }
+
+    unsigned int FlowField::getReachedCellCount() const
+    {
+        return reachedCellCount;
+    }
+
+    const std::optional<DiscreteRect>& FlowField::getReachedBounds() const
+    {
+        return reachedBounds;
+    }
+
+    std::optional<std::vector<Point>> FlowField::findPath(const Point& start) const
+    {
+        if (!isReached(start))
+        {
+            return std::nullopt;
+        }
+
+        std::vector<Point> path{start};
+
+        // Every step is strictly downhill, so the path can be no longer than the grid has cells.
+        auto maxLength = static_cast<std::size_t>(cells.getWidth()) * static_cast<std::size_t>(cells.getHeight());
+
+        while (path.back() != goal)
+        {
+            if (path.size() > maxLength)
+            {
+                return std::nullopt;
+            }
+
+            const auto& current = path.back();
+            std::optional<Point> best;
+            OctileDistance bestCost;
+            for (auto d : Directions)
+            {
+                auto n = current + directionToPoint(d);
+                if (!isReached(n))
+                {
+                    continue;
+                }
+
+                auto cost = *cells.get(n.x, n.y).cost + stepCost(current, n);
+                if (!best || cost < bestCost)
+                {
+                    best = n;
+                    bestCost = cost;
+                }
+            }
+
+            path.push_back(*best);
+        }
+
+        return path;
+    }
+
+    OctileDistance FlowField::stepCost(const Point& from, const Point& to) const
+    {
+        auto distance = octileDistance(from, to);
+        if (cells.get(to.x, to.y).rough)
+        {
+            distance = distance + distance;
+        }
+        return distance;
+    }
+}
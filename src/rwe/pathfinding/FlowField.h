@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <rwe/grid/DiscreteRect.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/OctileDistance.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * The cost of travelling to a single goal cell from the cells around it,
+     * computed by a Dijkstra search outward from the goal.
+     *
+     * Costs are octile distance, doubled when stepping onto rough terrain,
+     * as in AbstractUnitPathFinder, though turns are not counted.
+     * Once computed, the shortest path to the goal from any reached cell
+     * can be read off by repeatedly stepping to the cheapest neighbour,
+     * so a single field serves every unit heading to the same place.
+     */
+    class FlowField
+    {
+    public:
+        using CellFunction = std::function<bool(const Point&)>;
+
+    private:
+        struct Cell
+        {
+            std::optional<OctileDistance> cost;
+            bool rough{false};
+        };
+
+        Point goal;
+        Grid<Cell> cells;
+        unsigned int reachedCellCount{0};
+        std::optional<DiscreteRect> reachedBounds;
+
+    public:
+        /**
+         * Expands outward from the goal until every one of the targets has been reached
+         * or no more cells can be reached.
+         * If the goal is not walkable, no cells are reached.
+         */
+        static FlowField compute(
+            int width,
+            int height,
+            const Point& goal,
+            const std::vector<Point>& targets,
+            const CellFunction& isWalkable,
+            const CellFunction& isRoughTerrain);
+
+        const Point& getGoal() const;
+
+        bool isReached(const Point& p) const;
+
+        unsigned int getReachedCellCount() const;
+
+        /** The smallest rect containing every reached cell, or nullopt if no cells were reached. */
+        const std::optional<DiscreteRect>& getReachedBounds() const;
+
+        /**
+         * Returns the cells of the shortest path from start to the goal, inclusive.
+         * Returns nullopt if start was not reached.
+         */
+        std::optional<std::vector<Point>> findPath(const Point& start) const;
+
+    private:
+        FlowField(int width, int height, const Point& goal);
+
+        /** The cost of stepping from one cell to an adjacent, reached cell. */
+        OctileDistance stepCost(const Point& from, const Point& to) const;
+    };
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+#include <random>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/FlowField.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder_test_util.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+
+namespace rwe
+{
+    TEST_CASE("FlowField")
+    {
+        GridAStarWorkspace<PathCost> workspace;
+
+        SECTION("finds shortest paths to the goal from every target")
+        {
+            std::mt19937 rng(1234);
+            std::uniform_int_distribution<int> coordDist(0, 39);
+            std::discrete_distribution<int> cellDist({20, 70, 10});
+
+            for (int i = 0; i < 50; ++i)
+            {
+                auto grid = Grid<char>::from(40, 40, [&](const GridCoordinates&) { return static_cast<char>(cellDist(rng)); });
+                auto isWalkable = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) != 0; };
+                auto isRoughTerrain = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) == 2; };
+
+                auto goalX = coordDist(rng);
+                auto goalY = coordDist(rng);
+                Point goal(goalX, goalY);
+                grid.set(goal.x, goal.y, 1);
+
+                std::vector<Point> starts;
+                for (int j = 0; j < 5; ++j)
+                {
+                    auto startX = coordDist(rng);
+                    auto startY = coordDist(rng);
+                    starts.emplace_back(startX, startY);
+                    grid.set(startX, startY, 1);
+                }
+
+                auto field = FlowField::compute(40, 40, goal, starts, isWalkable, isRoughTerrain);
+
+                for (const auto& start : starts)
+                {
+                    TestGridPathFinder finder(&workspace, &grid, goal);
+                    auto aStarResult = finder.findPath(start);
+
+                    auto path = field.findPath(start);
+                    if (aStarResult.type != AStarPathType::Complete)
+                    {
+                        REQUIRE(!path);
+                        continue;
+                    }
+
+                    REQUIRE(path);
+                    REQUIRE(path->front() == start);
+                    REQUIRE(path->back() == goal);
+                    REQUIRE(isValidTestGridPath(grid, *path));
+                    REQUIRE(testGridPathCost(grid, *path).distance == testGridPathCost(grid, aStarResult.path).distance);
+                }
+            }
+        }
+
+        SECTION("stops expanding once every target is reached")
+        {
+            Grid<char> grid(64, 64, 1);
+            auto isWalkable = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) != 0; };
+            auto isRoughTerrain = [&](const Point&) { return false; };
+
+            auto field = FlowField::compute(64, 64, Point(10, 10), {Point(12, 10), Point(10, 13)}, isWalkable, isRoughTerrain);
+
+            REQUIRE(field.isReached(Point(12, 10)));
+            REQUIRE(field.isReached(Point(10, 13)));
+            REQUIRE(!field.isReached(Point(60, 60)));
+            REQUIRE(!field.findPath(Point(60, 60)));
+            REQUIRE(field.getReachedCellCount() < 100);
+
+            const auto& bounds = field.getReachedBounds();
+            REQUIRE(bounds);
+            REQUIRE(bounds->contains(Point(10, 10)));
+            REQUIRE(bounds->contains(Point(12, 10)));
+            REQUIRE(bounds->contains(Point(10, 13)));
+            REQUIRE(!bounds->contains(Point(60, 60)));
+        }
+
+        SECTION("reaches nothing when the goal is blocked")
+        {
+            Grid<char> grid(16, 16, 1);
+            grid.set(5, 5, 0);
+            auto isWalkable = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) != 0; };
+            auto isRoughTerrain = [&](const Point&) { return false; };
+
+            auto field = FlowField::compute(16, 16, Point(5, 5), {Point(1, 1)}, isWalkable, isRoughTerrain);
+
+            REQUIRE(field.getReachedCellCount() == 0);
+            REQUIRE(!field.getReachedBounds());
+            REQUIRE(!field.findPath(Point(1, 1)));
+        }
+    }
+}
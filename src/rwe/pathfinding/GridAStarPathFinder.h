@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <optional>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace rwe
+{
+    template <typename Cost>
+    struct GridAStarSuccessor
+    {
+        Point vertex;
+        Cost costToReach;
+    };
+
+    /**
+     * Holds the successors of a grid cell.
+     * A cell has at most eight neighbours,
+     * so this never needs to allocate.
+     */
+    template <typename Cost>
+    class GridAStarSuccessorBuffer
+    {
+    private:
+        std::array<GridAStarSuccessor<Cost>, 8> items;
+        unsigned int count{0};
+
+    public:
+        void push(const Point& vertex, const Cost& costToReach)
+        {
+            assert(count < items.size());
+            items[count++] = GridAStarSuccessor<Cost>{vertex, costToReach};
+        }
+
+        void clear()
+        {
+            count = 0;
+        }
+
+        unsigned int size() const
+        {
+            return count;
+        }
+
+        const GridAStarSuccessor<Cost>* begin() const
+        {
+            return items.data();
+        }
+
+        const GridAStarSuccessor<Cost>* end() const
+        {
+            return items.data() + count;
+        }
+    };
+
+    template <typename Cost>
+    struct GridAStarPathInfo
+    {
+        AStarPathType type;
+        std::vector<Point> path;
+
+        /** The number of vertices taken from the open list during the search. */
+        unsigned int expandedVertexCount;
+    };
+
+    /**
+     * Search state for GridAStarPathFinder, stored in flat arrays indexed by grid cell.
+     *
+     * The workspace is intended to be reused across searches.
+     * Each cell is stamped with the generation of the search that last touched it,
+     * and cells stamped with an older generation are treated as unvisited,
+     * so starting a new search does not need to clear or allocate anything.
+     */
+    template <typename Cost>
+    class GridAStarWorkspace
+    {
+    public:
+        static constexpr unsigned int NoParent = std::numeric_limits<unsigned int>::max();
+        static constexpr unsigned int Closed = std::numeric_limits<unsigned int>::max();
+
+        struct Node
+        {
+            unsigned int generation{0};
+
+            /** The node's position in the open heap, or Closed. */
+            unsigned int heapPosition{0};
+
+            unsigned int parent{NoParent};
+
+            Cost costToReach{};
+        };
+
+        struct HeapEntry
+        {
+            Cost estimatedTotalCost;
+            unsigned int cell;
+        };
+
+        unsigned int width{0};
+        unsigned int height{0};
+        unsigned int generation{0};
+
+        std::vector<Node> nodes;
+
+        /** Binary min-heap of open cells, ordered by estimated total cost. */
+        std::vector<HeapEntry> heap;
+
+        /** The cells expanded by the current search, in the order they were expanded. */
+        std::vector<unsigned int> closedCells;
+
+    public:
+        /** Prepares the workspace for a new search over a grid of the given size. */
+        void beginSearch(unsigned int newWidth, unsigned int newHeight)
+        {
+            if (newWidth != width || newHeight != height)
+            {
+                width = newWidth;
+                height = newHeight;
+                nodes.assign(width * height, Node());
+                generation = 0;
+            }
+
+            ++generation;
+            if (generation == 0)
+            {
+                // the stamp has wrapped around, so old stamps could be mistaken for current ones
+                for (auto& node : nodes)
+                {
+                    node.generation = 0;
+                }
+                generation = 1;
+            }
+
+            heap.clear();
+            closedCells.clear();
+        }
+
+        bool contains(const Point& p) const
+        {
+            return p.x >= 0 && p.y >= 0 && static_cast<unsigned int>(p.x) < width && static_cast<unsigned int>(p.y) < height;
+        }
+
+        unsigned int toCell(const Point& p) const
+        {
+            return (static_cast<unsigned int>(p.y) * width) + static_cast<unsigned int>(p.x);
+        }
+
+        Point toPoint(unsigned int cell) const
+        {
+            return Point(cell % width, cell / width);
+        }
+
+        bool isClosed(unsigned int cell) const
+        {
+            const auto& node = nodes[cell];
+            return node.generation == generation && node.heapPosition == Closed;
+        }
+
+        /**
+         * Calls f(vertex, predecessor) for every vertex expanded by the most recent search.
+         * The predecessor is nullopt for the start vertex.
+         */
+        template <typename F>
+        void forEachClosedVertex(F f) const
+        {
+            for (auto cell : closedCells)
+            {
+                auto parent = nodes[cell].parent;
+                f(toPoint(cell), parent == NoParent ? std::optional<Point>() : std::optional<Point>(toPoint(parent)));
+            }
+        }
+    };
+
+    /**
+     * A* search over the cells of a grid.
+     *
+     * This behaves identically to AStarPathFinder<Point, Cost>,
+     * but keeps its search state in a GridAStarWorkspace
+     * rather than in hash maps, and successors are written into
+     * a fixed-size buffer rather than returned in a new vector.
+     * Vertices outside the grid are never visited.
+     */
+    template <typename Cost>
+    class GridAStarPathFinder
+    {
+    public:
+        using Workspace = GridAStarWorkspace<Cost>;
+        using Successors = GridAStarSuccessorBuffer<Cost>;
+
+    private:
+        Workspace* const workspace;
+        const unsigned int gridWidth;
+        const unsigned int gridHeight;
+
+    public:
+        GridAStarPathFinder(Workspace* workspace, unsigned int gridWidth, unsigned int gridHeight)
+            : workspace(workspace), gridWidth(gridWidth), gridHeight(gridHeight)
+        {
+        }
+
+        GridAStarPathInfo<Cost> findPath(const Point& start)
+        {
+            auto& ws = *workspace;
+            ws.beginSearch(gridWidth, gridHeight);
+
+            if (!ws.contains(start))
+            {
+                return GridAStarPathInfo<Cost>{AStarPathType::Partial, std::vector<Point>{start}, 0};
+            }
+
+            pushOrDecrease(ws.toCell(start), estimateCostToGoal(start), Cost(), Workspace::NoParent);
+
+            std::optional<std::pair<Cost, unsigned int>> closestCell;
+
+            unsigned int openListPopsPerformed = 0;
+
+            Successors successors;
+
+            while (!ws.heap.empty() && openListPopsPerformed < MaxOpenListQueries)
+            {
+                auto cell = ws.heap.front().cell;
+                pop();
+                auto& node = ws.nodes[cell];
+                node.heapPosition = Workspace::Closed;
+                ws.closedCells.push_back(cell);
+                openListPopsPerformed += 1;
+
+                auto vertex = ws.toPoint(cell);
+                if (isGoal(vertex))
+                {
+                    spdlog::get("rwe")->debug("Found goal after visiting {0} vertices", openListPopsPerformed);
+                    return GridAStarPathInfo<Cost>{AStarPathType::Complete, walkPath(cell), openListPopsPerformed};
+                }
+
+                auto estimatedCostToGoal = estimateCostToGoal(vertex);
+                if (!closestCell || estimatedCostToGoal < closestCell->first)
+                {
+                    closestCell = std::pair<Cost, unsigned int>(estimatedCostToGoal, cell);
+                }
+
+                auto predecessor = node.parent == Workspace::NoParent ? std::optional<Point>() : std::optional<Point>(ws.toPoint(node.parent));
+
+                successors.clear();
+                getSuccessors(vertex, predecessor, node.costToReach, successors);
+
+                for (const auto& s : successors)
+                {
+                    if (!ws.contains(s.vertex))
+                    {
+                        continue;
+                    }
+
+                    auto successorCell = ws.toCell(s.vertex);
+                    if (ws.isClosed(successorCell))
+                    {
+                        continue;
+                    }
+
+                    auto estimatedTotalCost = s.costToReach + estimateCostToGoal(s.vertex);
+                    pushOrDecrease(successorCell, estimatedTotalCost, s.costToReach, cell);
+                }
+            }
+
+            spdlog::get("rwe")->debug("Failed to find goal, visited {0} vertices", openListPopsPerformed);
+            return GridAStarPathInfo<Cost>{AStarPathType::Partial, walkPath(closestCell->second), openListPopsPerformed};
+        }
+
+    protected:
+        virtual bool isGoal(const Point& vertex) = 0;
+
+        virtual Cost estimateCostToGoal(const Point& vertex) = 0;
+
+        /**
+         * Writes the successors of the given vertex into the buffer.
+         * The predecessor is the vertex the given vertex was reached from,
+         * or nullopt if it is the start vertex.
+         */
+        virtual void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const Cost& costToReach, Successors& successors) = 0;
+
+    private:
+        void pushOrDecrease(unsigned int cell, const Cost& estimatedTotalCost, const Cost& costToReach, unsigned int parent)
+        {
+            auto& ws = *workspace;
+            auto& node = ws.nodes[cell];
+
+            if (node.generation != ws.generation)
+            {
+                node.generation = ws.generation;
+                node.parent = parent;
+                node.costToReach = costToReach;
+                ws.heap.resize(ws.heap.size() + 1);
+                siftUp(ws.heap.size() - 1, typename Workspace::HeapEntry{estimatedTotalCost, cell});
+                return;
+            }
+
+            assert(node.heapPosition != Workspace::Closed);
+            if (!(estimatedTotalCost < ws.heap[node.heapPosition].estimatedTotalCost))
+            {
+                return;
+            }
+
+            node.parent = parent;
+            node.costToReach = costToReach;
+            siftUp(node.heapPosition, typename Workspace::HeapEntry{estimatedTotalCost, cell});
+        }
+
+        void pop()
+        {
+            auto& heap = workspace->heap;
+            auto lastElement = heap.back();
+            heap.pop_back();
+
+            if (!heap.empty())
+            {
+                siftDown(0, lastElement);
+            }
+        }
+
+        void siftUp(std::size_t position, const typename Workspace::HeapEntry& element)
+        {
+            auto& heap = workspace->heap;
+            auto& nodes = workspace->nodes;
+            while (position > 0)
+            {
+                auto parentPosition = (position - 1) / 2;
+                const auto& parentElement = heap[parentPosition];
+                if (!(element.estimatedTotalCost < parentElement.estimatedTotalCost))
+                {
+                    break;
+                }
+
+                heap[position] = parentElement;
+                nodes[parentElement.cell].heapPosition = position;
+                position = parentPosition;
+            }
+
+            heap[position] = element;
+            nodes[element.cell].heapPosition = position;
+        }
+
+        void siftDown(std::size_t position, const typename Workspace::HeapEntry& element)
+        {
+            auto& heap = workspace->heap;
+            auto& nodes = workspace->nodes;
+            auto firstLeafPosition = heap.size() / 2;
+            while (position < firstLeafPosition) // while non-leaf
+            {
+                auto smallestChildPosition = (position * 2) + 1;
+                const auto* smallestChild = &heap[smallestChildPosition];
+                auto rightChildPosition = (position * 2) + 2;
+                if (rightChildPosition < heap.size())
+                {
+                    const auto* rightChild = &heap[rightChildPosition];
+                    if (rightChild->estimatedTotalCost < smallestChild->estimatedTotalCost)
+                    {
+                        smallestChildPosition = rightChildPosition;
+                        smallestChild = rightChild;
+                    }
+                }
+
+                if (element.estimatedTotalCost < smallestChild->estimatedTotalCost)
+                {
+                    break;
+                }
+
+                heap[position] = *smallestChild;
+                nodes[smallestChild->cell].heapPosition = position;
+                position = smallestChildPosition;
+            }
+
+            heap[position] = element;
+            nodes[element.cell].heapPosition = position;
+        }
+
+        std::vector<Point> walkPath(unsigned int cell) const
+        {
+            const auto& ws = *workspace;
+            std::vector<Point> items;
+            for (auto c = cell; c != Workspace::NoParent; c = ws.nodes[c].parent)
+            {
+                items.push_back(ws.toPoint(c));
+            }
+
+            std::reverse(items.begin(), items.end());
+            return items;
+        }
+    };
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+#include <random>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder_test_util.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+
+namespace rwe
+{
+    namespace
+    {
+        class TestHashAStarPathFinder : public AStarPathFinder<Point, PathCost>
+        {
+        private:
+            const Grid<char>* grid;
+            Point goal;
+
+        public:
+            TestHashAStarPathFinder(const Grid<char>* grid, const Point& goal) : grid(grid), goal(goal)
+            {
+            }
+
+        protected:
+            bool isGoal(const Point& vertex) override
+            {
+                return vertex == goal;
+            }
+
+            PathCost estimateCostToGoal(const Point& vertex) override
+            {
+                return testGridEstimate(vertex, goal);
+            }
+
+            std::vector<VertexInfo> getSuccessors(const VertexInfo& info) override
+            {
+                std::optional<Point> predecessor;
+                if (info.predecessor)
+                {
+                    predecessor = (*info.predecessor)->vertex;
+                }
+
+                std::vector<VertexInfo> vs;
+                for (auto d : Directions)
+                {
+                    auto neighbour = info.vertex + directionToPoint(d);
+                    if (grid->tryGetValue(neighbour).value_or(0))
+                    {
+                        vs.push_back(VertexInfo{info.costToReach + testGridStepCost(*grid, info.vertex, neighbour, predecessor), neighbour, &info});
+                    }
+                }
+                return vs;
+            }
+        };
+    }
+
+    TEST_CASE("GridAStarPathFinder")
+    {
+        GridAStarWorkspace<PathCost> workspace;
+
+        SECTION("finds a path around a wall")
+        {
+            Grid<char> grid(5, 5, 1);
+            grid.set(2, 0, 0);
+            grid.set(2, 1, 0);
+            grid.set(2, 2, 0);
+            grid.set(2, 3, 0);
+
+            TestGridPathFinder finder(&workspace, &grid, Point(4, 0));
+            auto result = finder.findPath(Point(0, 0));
+            REQUIRE(result.type == AStarPathType::Complete);
+            REQUIRE(result.path.front() == Point(0, 0));
+            REQUIRE(result.path.back() == Point(4, 0));
+            for (const auto& p : result.path)
+            {
+                REQUIRE(grid.get(p.x, p.y) == 1);
+            }
+        }
+
+        SECTION("returns a partial path when the goal is unreachable")
+        {
+            Grid<char> grid(5, 5, 1);
+            for (int y = 0; y < 5; ++y)
+            {
+                grid.set(2, y, 0);
+            }
+
+            TestGridPathFinder finder(&workspace, &grid, Point(4, 2));
+            auto result = finder.findPath(Point(0, 2));
+            REQUIRE(result.type == AStarPathType::Partial);
+            REQUIRE(result.path.back() == Point(1, 2));
+        }
+
+        SECTION("returns the same paths as the hash map based finder")
+        {
+            std::mt19937 rng(1234);
+            std::uniform_int_distribution<int> coordDist(0, 39);
+            std::bernoulli_distribution wallDist(0.25);
+
+            for (int i = 0; i < 50; ++i)
+            {
+                auto grid = Grid<char>::from(40, 40, [&](const GridCoordinates&) { return static_cast<char>(wallDist(rng) ? 0 : 1); });
+                auto startX = coordDist(rng);
+                auto startY = coordDist(rng);
+                auto goalX = coordDist(rng);
+                auto goalY = coordDist(rng);
+                Point start(startX, startY);
+                Point goal(goalX, goalY);
+                grid.set(start.x, start.y, 1);
+                grid.set(goal.x, goal.y, 1);
+
+                // the workspace is reused between searches
+                TestGridPathFinder gridFinder(&workspace, &grid, goal);
+                auto gridResult = gridFinder.findPath(start);
+
+                TestHashAStarPathFinder hashFinder(&grid, goal);
+                auto hashResult = hashFinder.findPath(start);
+
+                REQUIRE(gridResult.type == hashResult.type);
+                REQUIRE(gridResult.path == hashResult.path);
+                REQUIRE(gridResult.expandedVertexCount == hashResult.closedVertices.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <optional>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+#include <vector>
+
+/*
+ * Helpers shared by the path finder tests.
+ *
+ * Test maps are grids of chars in which 0 is blocked, 1 is clear and 2 is rough.
+ * Costs are the same as AbstractUnitPathFinder's:
+ * octile distance, doubled when stepping onto rough terrain,
+ * plus the number of turns.
+ */
+namespace rwe
+{
+    inline PathCost testGridStepCost(const Grid<char>& grid, const Point& from, const Point& to, const std::optional<Point>& predecessor)
+    {
+        auto direction = pointToDirection(to - from);
+        auto distance = octileDistance(from, to);
+        if (grid.get(to.x, to.y) == 2)
+        {
+            distance = distance + distance;
+        }
+        unsigned int turns = predecessor ? directionDistance(pointToDirection(from - *predecessor), direction) : 0;
+        return PathCost(distance, turns);
+    }
+
+    inline PathCost testGridEstimate(const Point& from, const Point& goal)
+    {
+        auto distance = octileDistance(from, goal);
+        unsigned int turns = (distance.straight > 0 && distance.diagonal > 0) ? 1 : 0;
+        return PathCost(distance, turns);
+    }
+
+    inline PathCost testGridPathCost(const Grid<char>& grid, const std::vector<Point>& path)
+    {
+        PathCost cost;
+        for (std::size_t i = 1; i < path.size(); ++i)
+        {
+            auto predecessor = i >= 2 ? std::optional<Point>(path[i - 2]) : std::optional<Point>();
+            cost = cost + testGridStepCost(grid, path[i - 1], path[i], predecessor);
+        }
+        return cost;
+    }
+
+    /** True if every cell of the path is walkable and each step moves to a neighbouring cell. */
+    inline bool isValidTestGridPath(const Grid<char>& grid, const std::vector<Point>& path)
+    {
+        for (std::size_t i = 0; i < path.size(); ++i)
+        {
+            if (grid.tryGetValue(path[i]).value_or(0) == 0)
+            {
+                return false;
+            }
+            if (i > 0 && path[i - 1].maxSingleDimensionDistance(path[i]) != 1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Marks every walkable cell next to a blocked cell as rough, like GameSimulation::isAdjacentToObstacle. */
+    inline void markTestGridRoughTerrain(Grid<char>& grid)
+    {
+        auto copy = grid;
+        for (int y = 0; y < static_cast<int>(grid.getHeight()); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(grid.getWidth()); ++x)
+            {
+                if (copy.get(x, y) == 0)
+                {
+                    continue;
+                }
+
+                for (auto d : Directions)
+                {
+                    if (copy.tryGetValue(Point(x, y) + directionToPoint(d)).value_or(0) == 0)
+                    {
+                        grid.set(x, y, 2);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Finds paths across a test grid by plain A*, like AbstractUnitPathFinder.
+     * Subclasses may replace how successors are generated.
+     */
+    class TestGridPathFinder : public GridAStarPathFinder<PathCost>
+    {
+    protected:
+        const Grid<char>* grid;
+        Point goal;
+
+    public:
+        TestGridPathFinder(Workspace* workspace, const Grid<char>* grid, const Point& goal)
+            : GridAStarPathFinder(workspace, grid->getWidth(), grid->getHeight()), grid(grid), goal(goal)
+        {
+        }
+
+        bool isWalkable(const Point& p) const
+        {
+            return grid->tryGetValue(p).value_or(0) != 0;
+        }
+
+        bool isRoughTerrain(const Point& p) const
+        {
+            return grid->tryGetValue(p).value_or(0) == 2;
+        }
+
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+    protected:
+        PathCost estimateCostToGoal(const Point& vertex) override
+        {
+            return testGridEstimate(vertex, goal);
+        }
+
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override
+        {
+            for (auto d : Directions)
+            {
+                auto neighbour = vertex + directionToPoint(d);
+                if (isWalkable(neighbour))
+                {
+                    successors.push(neighbour, costToReach + testGridStepCost(*grid, vertex, neighbour, predecessor));
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,362 @@
+#include "HierarchicalPathGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+
+namespace rwe
+{
+    class HierarchicalAbstractPathFinder : public AStarPathFinder<Point, float>
+    {
+    private:
+        HierarchicalPathGraph* const graph;
+        const HierarchicalPathGraph::WalkableFunction* const isWalkable;
+        const Point start;
+        const Point goal;
+        const unsigned int goalCluster;
+        const std::vector<HierarchicalPathGraph::Edge> startEdges;
+        const std::unordered_map<Point, float> costsToGoal;
+
+    public:
+        HierarchicalAbstractPathFinder(
+            HierarchicalPathGraph* graph,
+            const HierarchicalPathGraph::WalkableFunction* isWalkable,
+            const Point& start,
+            const Point& goal,
+            std::vector<HierarchicalPathGraph::Edge>&& startEdges,
+            std::unordered_map<Point, float>&& costsToGoal)
+            : graph(graph),
+              isWalkable(isWalkable),
+              start(start),
+              goal(goal),
+              goalCluster(graph->getClusterIndex(goal)),
+              startEdges(std::move(startEdges)),
+              costsToGoal(std::move(costsToGoal))
+        {
+        }
+
+    protected:
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+        float estimateCostToGoal(const Point& vertex) override
+        {
+            return octileDistance(vertex, goal).asFloat();
+        }
+
+        std::vector<VertexInfo> getSuccessors(const VertexInfo& info) override
+        {
+            std::vector<VertexInfo> successors;
+
+            if (info.vertex == start)
+            {
+                for (const auto& e : startEdges)
+                {
+                    successors.push_back(VertexInfo{info.costToReach + e.cost, e.target, &info});
+                }
+            }
+
+            for (const auto& e : graph->getPortalEdges(info.vertex, *isWalkable))
+            {
+                successors.push_back(VertexInfo{info.costToReach + e.cost, e.target, &info});
+            }
+
+            if (graph->getClusterIndex(info.vertex) == goalCluster)
+            {
+                if (auto it = costsToGoal.find(info.vertex); it != costsToGoal.end())
+                {
+                    successors.push_back(VertexInfo{info.costToReach + it->second, goal, &info});
+                }
+            }
+
+            return successors;
+        }
+    };
+
+    HierarchicalPathGraph::HierarchicalPathGraph(int gridWidth, int gridHeight, unsigned int footprintX, unsigned int footprintZ)
+        : gridWidth(gridWidth),
+          gridHeight(gridHeight),
+          footprintX(footprintX),
+          footprintZ(footprintZ),
+          clusterCountX((gridWidth + ClusterSize - 1) / ClusterSize),
+          clusterCountY((gridHeight + ClusterSize - 1) / ClusterSize),
+          clusters(clusterCountX * clusterCountY)
+    {
+    }
+
+    void HierarchicalPathGraph::invalidateRegion(const DiscreteRect& rect)
+    {
+        if (clusters.empty())
+        {
+            return;
+        }
+
+        // positions whose footprint overlaps the rect
+        auto minX = std::clamp(rect.x - static_cast<int>(footprintX) + 1, 0, gridWidth - 1);
+        auto minY = std::clamp(rect.y - static_cast<int>(footprintZ) + 1, 0, gridHeight - 1);
+        auto maxX = std::clamp(rect.x + rect.width - 1, 0, gridWidth - 1);
+        auto maxY = std::clamp(rect.y + rect.height - 1, 0, gridHeight - 1);
+
+        // Neighbouring clusters share border portals with the changed clusters,
+        // so they must be rebuilt too.
+        auto minClusterX = std::max((minX / ClusterSize) - 1, 0);
+        auto minClusterY = std::max((minY / ClusterSize) - 1, 0);
+        auto maxClusterX = std::min((maxX / ClusterSize) + 1, clusterCountX - 1);
+        auto maxClusterY = std::min((maxY / ClusterSize) + 1, clusterCountY - 1);
+
+        for (auto cy = minClusterY; cy <= maxClusterY; ++cy)
+        {
+            for (auto cx = minClusterX; cx <= maxClusterX; ++cx)
+            {
+                clusters[(cy * clusterCountX) + cx].built = false;
+            }
+        }
+    }
+
+    std::optional<std::vector<Point>> HierarchicalPathGraph::findPath(const Point& start, const Point& goal, const WalkableFunction& isWalkable)
+    {
+        if (!isInGrid(start) || !isInGrid(goal))
+        {
+            return std::nullopt;
+        }
+
+        auto startCluster = getClusterIndex(start);
+        auto goalCluster = getClusterIndex(goal);
+        ensureBuilt(startCluster, isWalkable);
+        ensureBuilt(goalCluster, isWalkable);
+
+        auto startTargets = clusters[startCluster].portals;
+        if (startCluster == goalCluster)
+        {
+            startTargets.push_back(goal);
+        }
+        auto startEdges = computeEdgesWithinCluster(start, startTargets, isWalkable);
+
+        std::unordered_map<Point, float> costsToGoal;
+        for (const auto& e : computeEdgesWithinCluster(goal, clusters[goalCluster].portals, isWalkable))
+        {
+            costsToGoal.emplace(e.target, e.cost);
+        }
+
+        HierarchicalAbstractPathFinder finder(this, &isWalkable, start, goal, std::move(startEdges), std::move(costsToGoal));
+        auto result = finder.findPath(start);
+        if (result.type != AStarPathType::Complete)
+        {
+            return std::nullopt;
+        }
+
+        return std::move(result.path);
+    }
+
+    unsigned int HierarchicalPathGraph::getBuiltClusterCount() const
+    {
+        return std::count_if(clusters.begin(), clusters.end(), [](const auto& c) { return c.built; });
+    }
+
+    unsigned int HierarchicalPathGraph::getClusterIndex(const Point& p) const
+    {
+        return ((p.y / ClusterSize) * clusterCountX) + (p.x / ClusterSize);
+    }
+
+    DiscreteRect HierarchicalPathGraph::getClusterRect(unsigned int clusterIndex) const
+    {
+        auto x = static_cast<int>(clusterIndex % clusterCountX) * ClusterSize;
+        auto y = static_cast<int>(clusterIndex / clusterCountX) * ClusterSize;
+        return DiscreteRect(x, y, std::min(ClusterSize, gridWidth - x), std::min(ClusterSize, gridHeight - y));
+    }
+
+    const std::vector<HierarchicalPathGraph::Edge>& HierarchicalPathGraph::getPortalEdges(const Point& portal, const WalkableFunction& isWalkable)
+    {
+        static const std::vector<Edge> noEdges;
+
+        if (!isInGrid(portal))
+        {
+            return noEdges;
+        }
+
+        ensureBuilt(getClusterIndex(portal), isWalkable);
+
+        auto it = portalEdges.find(portal);
+        if (it == portalEdges.end())
+        {
+            return noEdges;
+        }
+
+        return it->second;
+    }
+
+    std::vector<HierarchicalPathGraph::Edge> HierarchicalPathGraph::computeEdgesWithinCluster(const Point& source, const std::vector<Point>& targets, const WalkableFunction& isWalkable) const
+    {
+        static const float DiagonalCost = std::sqrt(2.0f);
+
+        auto rect = getClusterRect(getClusterIndex(source));
+        auto toIndex = [&](const Point& p) { return static_cast<unsigned int>(((p.y - rect.y) * rect.width) + (p.x - rect.x)); };
+
+        std::vector<float> costs(rect.width * rect.height, std::numeric_limits<float>::infinity());
+        using QueueEntry = std::pair<float, unsigned int>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+        costs[toIndex(source)] = 0.0f;
+        open.emplace(0.0f, toIndex(source));
+
+        while (!open.empty())
+        {
+            auto [cost, index] = open.top();
+            open.pop();
+            if (cost > costs[index])
+            {
+                continue;
+            }
+
+            Point p(rect.x + static_cast<int>(index % rect.width), rect.y + static_cast<int>(index / rect.width));
+            for (auto d : Directions)
+            {
+                auto n = p + directionToPoint(d);
+                if (n.x < rect.x || n.y < rect.y || n.x >= rect.x + rect.width || n.y >= rect.y + rect.height)
+                {
+                    continue;
+                }
+
+                if (!isWalkable(n))
+                {
+                    continue;
+                }
+
+                auto newCost = cost + (isDiagonal(d) ? DiagonalCost : 1.0f);
+                auto nIndex = toIndex(n);
+                if (newCost < costs[nIndex])
+                {
+                    costs[nIndex] = newCost;
+                    open.emplace(newCost, nIndex);
+                }
+            }
+        }
+
+        std::vector<Edge> edges;
+        for (const auto& t : targets)
+        {
+            if (t == source)
+            {
+                continue;
+            }
+
+            auto cost = costs[toIndex(t)];
+            if (cost != std::numeric_limits<float>::infinity())
+            {
+                edges.push_back(Edge{t, cost});
+            }
+        }
+
+        return edges;
+    }
+
+    void HierarchicalPathGraph::ensureBuilt(unsigned int clusterIndex, const WalkableFunction& isWalkable)
+    {
+        auto& cluster = clusters[clusterIndex];
+        if (cluster.built)
+        {
+            return;
+        }
+
+        for (const auto& p : cluster.portals)
+        {
+            portalEdges.erase(p);
+        }
+
+        std::vector<std::pair<Point, Point>> crossings;
+        findBorderPortals(clusterIndex, Point(0, -1), isWalkable, crossings);
+        findBorderPortals(clusterIndex, Point(-1, 0), isWalkable, crossings);
+        findBorderPortals(clusterIndex, Point(0, 1), isWalkable, crossings);
+        findBorderPortals(clusterIndex, Point(1, 0), isWalkable, crossings);
+
+        // A corner cell may be a portal on two borders.
+        cluster.portals.clear();
+        for (const auto& crossing : crossings)
+        {
+            if (std::find(cluster.portals.begin(), cluster.portals.end(), crossing.first) == cluster.portals.end())
+            {
+                cluster.portals.push_back(crossing.first);
+            }
+        }
+
+        for (const auto& portal : cluster.portals)
+        {
+            auto edges = computeEdgesWithinCluster(portal, cluster.portals, isWalkable);
+            for (const auto& crossing : crossings)
+            {
+                if (crossing.first == portal)
+                {
+                    edges.push_back(Edge{crossing.second, 1.0f});
+                }
+            }
+            portalEdges.insert_or_assign(portal, std::move(edges));
+        }
+
+        cluster.built = true;
+    }
+
+    void HierarchicalPathGraph::findBorderPortals(unsigned int clusterIndex, const Point& across, const WalkableFunction& isWalkable, std::vector<std::pair<Point, Point>>& out) const
+    {
+        auto rect = getClusterRect(clusterIndex);
+
+        Point first(
+            across.x > 0 ? rect.x + rect.width - 1 : rect.x,
+            across.y > 0 ? rect.y + rect.height - 1 : rect.y);
+        Point along = across.x == 0 ? Point(1, 0) : Point(0, 1);
+        int length = across.x == 0 ? rect.width : rect.height;
+
+        if (!isInGrid(first + across))
+        {
+            // no neighbouring cluster on this side
+            return;
+        }
+
+        auto emitRun = [&](int runStart, int runEnd) {
+            auto runLength = runEnd - runStart;
+            auto emit = [&](int i) {
+                Point p(first.x + (along.x * i), first.y + (along.y * i));
+                out.emplace_back(p, p + across);
+            };
+            if (runLength >= MaxSinglePortalRunLength)
+            {
+                emit(runStart);
+                emit(runEnd - 1);
+            }
+            else
+            {
+                emit(runStart + (runLength / 2));
+            }
+        };
+
+        std::optional<int> runStart;
+        for (int i = 0; i < length; ++i)
+        {
+            Point p(first.x + (along.x * i), first.y + (along.y * i));
+            auto open = isWalkable(p) && isWalkable(p + across);
+            if (open && !runStart)
+            {
+                runStart = i;
+            }
+            else if (!open && runStart)
+            {
+                emitRun(*runStart, i);
+                runStart = std::nullopt;
+            }
+        }
+
+        if (runStart)
+        {
+            emitRun(*runStart, length);
+        }
+    }
+
+    bool HierarchicalPathGraph::isInGrid(const Point& p) const
+    {
+        return p.x >= 0 && p.y >= 0 && p.x < gridWidth && p.y < gridHeight;
+    }
+}
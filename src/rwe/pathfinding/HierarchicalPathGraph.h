@@ -0,0 +1,114 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <rwe/grid/DiscreteRect.h>
+#include <rwe/grid/Point.h>
+#include <unordered_map>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Abstract graph for hierarchical pathfinding (HPA*) over a walkability grid.
+     *
+     * The grid is divided into square clusters.
+     * Wherever two neighbouring clusters share an open border,
+     * a pair of portal cells is placed, one on either side of the border.
+     * Portals within the same cluster are joined by edges
+     * whose cost is the length of the shortest path between them inside that cluster.
+     * Searching this graph gives a coarse route across the map
+     * which can then be refined by short searches between consecutive portals.
+     *
+     * Clusters are built lazily, when a search first reaches them,
+     * and are rebuilt after invalidateRegion marks them dirty.
+     */
+    class HierarchicalPathGraph
+    {
+    public:
+        using WalkableFunction = std::function<bool(const Point&)>;
+
+        static constexpr int ClusterSize = 16;
+
+        /**
+         * An open run along a border at least this long
+         * gets a portal at each end rather than one in the middle.
+         */
+        static constexpr int MaxSinglePortalRunLength = 6;
+
+        struct Edge
+        {
+            Point target;
+            float cost;
+        };
+
+    private:
+        struct Cluster
+        {
+            bool built{false};
+            std::vector<Point> portals;
+        };
+
+        int gridWidth;
+        int gridHeight;
+        unsigned int footprintX;
+        unsigned int footprintZ;
+        int clusterCountX;
+        int clusterCountY;
+
+        std::vector<Cluster> clusters;
+
+        std::unordered_map<Point, std::vector<Edge>> portalEdges;
+
+    public:
+        /**
+         * The grid describes the top-left positions of a footprint of the given size,
+         * as in MovementClassCollisionService.
+         */
+        HierarchicalPathGraph(int gridWidth, int gridHeight, unsigned int footprintX, unsigned int footprintZ);
+
+        /**
+         * Marks dirty every cluster containing a position
+         * whose footprint overlaps the given rectangle of map cells.
+         */
+        void invalidateRegion(const DiscreteRect& rect);
+
+        /**
+         * Searches the abstract graph for a route from start to goal.
+         * Returns the route as a list of cells beginning with start and ending with goal,
+         * with consecutive cells either in the same cluster or adjacent across a border.
+         * Returns nullopt if no route was found.
+         */
+        std::optional<std::vector<Point>> findPath(const Point& start, const Point& goal, const WalkableFunction& isWalkable);
+
+        unsigned int getBuiltClusterCount() const;
+
+        unsigned int getClusterIndex(const Point& p) const;
+
+        DiscreteRect getClusterRect(unsigned int clusterIndex) const;
+
+        /**
+         * Ensures the cluster's portals and edges are up to date
+         * and returns the outgoing edges of the given portal.
+         */
+        const std::vector<Edge>& getPortalEdges(const Point& portal, const WalkableFunction& isWalkable);
+
+        /**
+         * Returns the cost of the shortest path inside the cluster containing source
+         * from source to each of the given targets in the same cluster.
+         * Unreachable targets are omitted.
+         */
+        std::vector<Edge> computeEdgesWithinCluster(const Point& source, const std::vector<Point>& targets, const WalkableFunction& isWalkable) const;
+
+    private:
+        void ensureBuilt(unsigned int clusterIndex, const WalkableFunction& isWalkable);
+
+        /**
+         * Finds the portals on the cluster's side of its border with a neighbouring cluster,
+         * paired with the cell on the other side of the border.
+         */
+        void findBorderPortals(unsigned int clusterIndex, const Point& across, const WalkableFunction& isWalkable, std::vector<std::pair<Point, Point>>& out) const;
+
+        bool isInGrid(const Point& p) const;
+    };
+}
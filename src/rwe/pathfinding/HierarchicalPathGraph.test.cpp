@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/HierarchicalPathGraph.h>
+
+namespace rwe
+{
+    static bool isValidRoute(const HierarchicalPathGraph& graph, const std::vector<Point>& route)
+    {
+        for (std::size_t i = 1; i < route.size(); ++i)
+        {
+            const auto& a = route[i - 1];
+            const auto& b = route[i];
+            if (graph.getClusterIndex(a) != graph.getClusterIndex(b) && a.maxSingleDimensionDistance(b) != 1)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    TEST_CASE("HierarchicalPathGraph")
+    {
+        Grid<char> grid(64, 64, 1);
+        auto isWalkable = [&](const Point& p) { return grid.tryGetValue(p).value_or(0) != 0; };
+        HierarchicalPathGraph graph(64, 64, 1, 1);
+
+        SECTION("finds a route across open ground")
+        {
+            auto route = graph.findPath(Point(1, 1), Point(60, 62), isWalkable);
+            REQUIRE(route);
+            REQUIRE(route->front() == Point(1, 1));
+            REQUIRE(route->back() == Point(60, 62));
+            REQUIRE(isValidRoute(graph, *route));
+        }
+
+        SECTION("routes through a gap in a wall")
+        {
+            for (int y = 0; y < 64; ++y)
+            {
+                if (y != 40)
+                {
+                    grid.set(31, y, 0);
+                }
+            }
+
+            auto route = graph.findPath(Point(5, 5), Point(58, 5), isWalkable);
+            REQUIRE(route);
+            REQUIRE(isValidRoute(graph, *route));
+            auto crossesGap = std::any_of(route->begin(), route->end(), [](const auto& p) { return p.y == 40 && (p.x == 31 || p.x == 32); });
+            REQUIRE(crossesGap);
+        }
+
+        SECTION("returns nullopt when the goal is unreachable")
+        {
+            for (int y = 0; y < 64; ++y)
+            {
+                grid.set(31, y, 0);
+            }
+
+            REQUIRE(!graph.findPath(Point(5, 5), Point(58, 5), isWalkable));
+        }
+
+        SECTION("rebuilds clusters after they are invalidated")
+        {
+            REQUIRE(graph.findPath(Point(5, 5), Point(58, 5), isWalkable));
+            REQUIRE(graph.getBuiltClusterCount() > 0);
+
+            for (int y = 0; y < 64; ++y)
+            {
+                grid.set(31, y, 0);
+            }
+
+            graph.invalidateRegion(DiscreteRect(31, 0, 1, 64));
+            REQUIRE(!graph.findPath(Point(5, 5), Point(58, 5), isWalkable));
+        }
+
+        SECTION("builds only the clusters that the search reaches")
+        {
+            auto route = graph.findPath(Point(1, 1), Point(40, 1), isWalkable);
+            REQUIRE(route);
+            REQUIRE(graph.getBuiltClusterCount() < 16);
+        }
+    }
+}
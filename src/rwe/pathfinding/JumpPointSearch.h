@@ -0,0 +1,201 @@
+#pragma once
+
+#include <optional>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/PathCost.h>
+
+namespace rwe
+{
+    /**
+     * Generates successors for a jump point search (JPS)
+     * using the same costs as AbstractUnitPathFinder:
+     * octile distance, doubled when stepping onto rough terrain,
+     * plus the number of turns.
+     *
+     * Clear cells (walkable and not rough) are crossed by jumping in straight lines
+     * until reaching the goal or a cell with a forced neighbour, as in standard JPS,
+     * treating any cell that is not clear as an obstacle when looking for forced neighbours.
+     * Rough cells are never jumped over. They are stepped onto one at a time
+     * and all of their neighbours are considered, as in plain A*.
+     * The savings are therefore greatest in open areas away from obstacles,
+     * since obstacles are surrounded by rough terrain.
+     *
+     * The paths found have the same distance as those found by A*,
+     * but among paths of equal distance the one chosen may have more turns.
+     * Consecutive vertices of a path lie on a common straight or diagonal line
+     * and can be filled in with fillPathGaps.
+     *
+     * Terrain must provide isWalkable(const Point&), isRoughTerrain(const Point&)
+     * and isGoal(const Point&).
+     */
+    template <typename Terrain>
+    class JumpPointSuccessorGenerator
+    {
+    private:
+        Terrain* const terrain;
+
+        unsigned int scannedCellCount{0};
+
+    public:
+        explicit JumpPointSuccessorGenerator(Terrain* terrain) : terrain(terrain)
+        {
+        }
+
+        /** The number of cells examined while jumping so far. */
+        unsigned int getScannedCellCount() const
+        {
+            return scannedCellCount;
+        }
+
+        template <typename Successors>
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors)
+        {
+            std::optional<Point> arrivalDirection;
+            if (predecessor)
+            {
+                arrivalDirection = normalizeDirection(vertex - *predecessor);
+            }
+
+            for (auto d : Directions)
+            {
+                auto direction = directionToPoint(d);
+                if (arrivalDirection && isClear(vertex) && !isNaturalOrForced(vertex, *arrivalDirection, direction))
+                {
+                    continue;
+                }
+
+                auto target = jump(vertex, direction);
+                if (!target)
+                {
+                    continue;
+                }
+
+                auto steps = static_cast<unsigned int>(vertex.maxSingleDimensionDistance(*target));
+                if (terrain->isRoughTerrain(*target))
+                {
+                    // double the cost of the final step onto rough terrain
+                    steps += 1;
+                }
+                auto distance = isDiagonal(d) ? OctileDistance(0, steps) : OctileDistance(steps, 0);
+                unsigned int turns = arrivalDirection ? directionDistance(pointToDirection(*arrivalDirection), d) : 0;
+                successors.push(*target, costToReach + PathCost(distance, turns));
+            }
+        }
+
+    private:
+        static int sign(int v)
+        {
+            return (v > 0) - (v < 0);
+        }
+
+        static Point normalizeDirection(const Point& p)
+        {
+            return Point(sign(p.x), sign(p.y));
+        }
+
+        bool isClear(const Point& p) const
+        {
+            return terrain->isWalkable(p) && !terrain->isRoughTerrain(p);
+        }
+
+        /**
+         * Returns true if the cell at p + direction must be considered
+         * when p was reached by moving in arrivalDirection.
+         * Assumes p is clear.
+         */
+        bool isNaturalOrForced(const Point& p, const Point& arrivalDirection, const Point& direction) const
+        {
+            const auto& a = arrivalDirection;
+            if (direction == a)
+            {
+                return true;
+            }
+
+            if (a.x != 0 && a.y != 0)
+            {
+                if (direction == Point(a.x, 0) || direction == Point(0, a.y))
+                {
+                    return true;
+                }
+
+                if (direction == Point(-a.x, a.y))
+                {
+                    return !isClear(p + Point(-a.x, 0));
+                }
+
+                if (direction == Point(a.x, -a.y))
+                {
+                    return !isClear(p + Point(0, -a.y));
+                }
+
+                return false;
+            }
+
+            // Straight arrival. The only forced neighbours
+            // are the forward diagonals past a side cell that is not clear.
+            auto side = Point(a.y, a.x);
+            if (direction == a + side)
+            {
+                return !isClear(p + side);
+            }
+
+            if (direction == a - side)
+            {
+                return !isClear(p - side);
+            }
+
+            return false;
+        }
+
+        bool hasForcedNeighbour(const Point& p, const Point& direction) const
+        {
+            if (direction.x != 0 && direction.y != 0)
+            {
+                return (!isClear(p + Point(-direction.x, 0)) && terrain->isWalkable(p + Point(-direction.x, direction.y)))
+                    || (!isClear(p + Point(0, -direction.y)) && terrain->isWalkable(p + Point(direction.x, -direction.y)));
+            }
+
+            auto side = Point(direction.y, direction.x);
+            return (!isClear(p + side) && terrain->isWalkable(p + direction + side))
+                || (!isClear(p - side) && terrain->isWalkable(p + direction - side));
+        }
+
+        /**
+         * Moves from p in the given direction until reaching a jump point.
+         * Returns nullopt if the way is blocked before one is found.
+         */
+        std::optional<Point> jump(const Point& p, const Point& direction)
+        {
+            auto current = p;
+            while (true)
+            {
+                current = current + direction;
+                scannedCellCount += 1;
+
+                if (!terrain->isWalkable(current))
+                {
+                    return std::nullopt;
+                }
+
+                if (terrain->isGoal(current) || terrain->isRoughTerrain(current))
+                {
+                    return current;
+                }
+
+                if (hasForcedNeighbour(current, direction))
+                {
+                    return current;
+                }
+
+                if (direction.x != 0 && direction.y != 0)
+                {
+                    if (jump(current, Point(direction.x, 0)) || jump(current, Point(0, direction.y)))
+                    {
+                        return current;
+                    }
+                }
+            }
+        }
+    };
+}
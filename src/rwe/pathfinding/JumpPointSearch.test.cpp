@@ -0,0 +1,107 @@
+#include <catch2/catch.hpp>
+#include <random>
+#include <rwe/grid/EightWayDirection.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/GridAStarPathFinder_test_util.h>
+#include <rwe/pathfinding/JumpPointSearch.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+
+namespace rwe
+{
+    namespace
+    {
+        class TestJumpPointPathFinder : public TestGridPathFinder
+        {
+        private:
+            JumpPointSuccessorGenerator<TestJumpPointPathFinder> generator;
+
+        public:
+            TestJumpPointPathFinder(Workspace* workspace, const Grid<char>* grid, const Point& goal)
+                : TestGridPathFinder(workspace, grid, goal), generator(this)
+            {
+            }
+
+        protected:
+            void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override
+            {
+                generator.getSuccessors(vertex, predecessor, costToReach, successors);
+            }
+        };
+    }
+
+    TEST_CASE("JumpPointSuccessorGenerator")
+    {
+        GridAStarWorkspace<PathCost> workspace;
+
+        SECTION("finds paths with the same distance as A*")
+        {
+            std::mt19937 rng(4321);
+            std::uniform_int_distribution<int> coordDist(0, 39);
+            std::discrete_distribution<int> cellDist({20, 70, 10});
+
+            for (int i = 0; i < 100; ++i)
+            {
+                auto grid = Grid<char>::from(40, 40, [&](const GridCoordinates&) { return static_cast<char>(cellDist(rng)); });
+                if (i % 2 == 0)
+                {
+                    // the layout found in game, with rough terrain around every obstacle
+                    for (int y = 0; y < 40; ++y)
+                    {
+                        for (int x = 0; x < 40; ++x)
+                        {
+                            grid.set(x, y, grid.get(x, y) == 0 ? 0 : 1);
+                        }
+                    }
+                    markTestGridRoughTerrain(grid);
+                }
+                auto startX = coordDist(rng);
+                auto startY = coordDist(rng);
+                auto goalX = coordDist(rng);
+                auto goalY = coordDist(rng);
+                Point start(startX, startY);
+                Point goal(goalX, goalY);
+                grid.set(start.x, start.y, 1);
+                grid.set(goal.x, goal.y, 1);
+
+                TestGridPathFinder aStarFinder(&workspace, &grid, goal);
+                auto aStarResult = aStarFinder.findPath(start);
+
+                TestJumpPointPathFinder jpsFinder(&workspace, &grid, goal);
+                auto jpsResult = jpsFinder.findPath(start);
+                auto jpsPath = fillPathGaps(jpsResult.path);
+
+                REQUIRE(jpsResult.type == aStarResult.type);
+                REQUIRE(isValidTestGridPath(grid, jpsPath));
+                REQUIRE(jpsPath.front() == start);
+                if (aStarResult.type == AStarPathType::Complete)
+                {
+                    REQUIRE(jpsPath.back() == goal);
+                    REQUIRE(testGridPathCost(grid, jpsPath).distance == testGridPathCost(grid, aStarResult.path).distance);
+                }
+            }
+        }
+
+        SECTION("expands an order of magnitude fewer vertices in open areas")
+        {
+            Grid<char> grid(128, 128, 1);
+            markTestGridRoughTerrain(grid);
+
+            // Every row ends in the rough terrain along the map edge,
+            // so diagonal jumps stop at each step and the saving comes from the straight leg.
+            Point start(2, 60);
+            Point goal(125, 70);
+
+            TestGridPathFinder aStarFinder(&workspace, &grid, goal);
+            auto aStarResult = aStarFinder.findPath(start);
+
+            TestJumpPointPathFinder jpsFinder(&workspace, &grid, goal);
+            auto jpsResult = jpsFinder.findPath(start);
+
+            REQUIRE(aStarResult.type == AStarPathType::Complete);
+            REQUIRE(jpsResult.type == AStarPathType::Complete);
+            REQUIRE(jpsResult.expandedVertexCount * 10 <= aStarResult.expandedVertexCount);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#include "OccupancyVersionGrid.h"
+#include <algorithm>
+
+namespace rwe
+{
+    OccupancyVersionGrid::OccupancyVersionGrid(int gridWidth, int gridHeight)
+        : gridWidth(gridWidth),
+          gridHeight(gridHeight),
+          regionCountX((gridWidth + RegionSize - 1) / RegionSize),
+          regionCountY((gridHeight + RegionSize - 1) / RegionSize),
+          versions(regionCountX * regionCountY, 0)
+    {
+    }
+
+    void OccupancyVersionGrid::invalidateRegion(const DiscreteRect& rect)
+    {
+        std::vector<unsigned int> regions;
+        appendOverlappingRegions(rect, regions);
+        for (auto index : regions)
+        {
+            versions[index] += 1;
+        }
+    }
+
+    unsigned int OccupancyVersionGrid::getVersion(unsigned int regionIndex) const
+    {
+        return versions[regionIndex];
+    }
+
+    void OccupancyVersionGrid::appendOverlappingRegions(const DiscreteRect& rect, std::vector<unsigned int>& out) const
+    {
+        auto left = std::max(rect.x, 0);
+        auto top = std::max(rect.y, 0);
+        auto right = std::min(rect.x + rect.width, gridWidth);
+        auto bottom = std::min(rect.y + rect.height, gridHeight);
+        if (left >= right || top >= bottom)
+        {
+            return;
+        }
+
+        auto minX = left / RegionSize;
+        auto minY = top / RegionSize;
+        auto maxX = (right - 1) / RegionSize;
+        auto maxY = (bottom - 1) / RegionSize;
+
+        for (auto y = minY; y <= maxY; ++y)
+        {
+            for (auto x = minX; x <= maxX; ++x)
+            {
+                out.push_back(static_cast<unsigned int>((y * regionCountX) + x));
+            }
+        }
+    }
+}
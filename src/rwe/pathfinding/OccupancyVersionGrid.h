@@ -0,0 +1,42 @@
+#pragma once
+
+#include <rwe/grid/DiscreteRect.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Version counters for square regions of the occupied grid.
+     * A region's version is incremented whenever occupancy within it changes,
+     * so anything derived from a region can be checked for staleness
+     * by comparing the version it was derived at with the current version.
+     */
+    class OccupancyVersionGrid
+    {
+    public:
+        static constexpr int RegionSize = 16;
+
+    private:
+        int gridWidth{0};
+        int gridHeight{0};
+        int regionCountX{0};
+        int regionCountY{0};
+        std::vector<unsigned int> versions;
+
+    public:
+        OccupancyVersionGrid() = default;
+
+        OccupancyVersionGrid(int gridWidth, int gridHeight);
+
+        /** Increments the version of every region overlapping the given rectangle of cells. */
+        void invalidateRegion(const DiscreteRect& rect);
+
+        unsigned int getVersion(unsigned int regionIndex) const;
+
+        /**
+         * Appends the indices of the regions overlapping the given rectangle of cells.
+         * Parts of the rectangle outside the grid are ignored.
+         */
+        void appendOverlappingRegions(const DiscreteRect& rect, std::vector<unsigned int>& out) const;
+    };
+}
@@ -0,0 +1,108 @@
+#include "PathCache.h"
+#include <algorithm>
+
+namespace rwe
+{
+    bool PathCacheKey::operator==(const PathCacheKey& rhs) const
+    {
+        return movementClassId == rhs.movementClassId
+            && footprintX == rhs.footprintX
+            && footprintZ == rhs.footprintZ
+            && start == rhs.start
+            && goal == rhs.goal;
+    }
+
+    bool PathCacheKey::operator!=(const PathCacheKey& rhs) const
+    {
+        return !(rhs == *this);
+    }
+
+    PathCache::PathCache(std::size_t capacity) : capacity(capacity)
+    {
+    }
+
+    std::optional<std::vector<Point>> PathCache::tryGet(const PathCacheKey& key, const OccupancyVersionGrid& currentVersions)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            stats.misses += 1;
+            return std::nullopt;
+        }
+
+        auto entryIt = it->second;
+        auto upToDate = std::all_of(entryIt->regionVersions.begin(), entryIt->regionVersions.end(), [&](const auto& rv) {
+            return currentVersions.getVersion(rv.first) == rv.second;
+        });
+        if (!upToDate)
+        {
+            stats.misses += 1;
+            stats.staleHits += 1;
+            entries.erase(entryIt);
+            index.erase(it);
+            return std::nullopt;
+        }
+
+        stats.hits += 1;
+        entries.splice(entries.begin(), entries, entryIt);
+        return entryIt->path;
+    }
+
+    void PathCache::insert(const PathCacheKey& key, const std::vector<Point>& path, const OccupancyVersionGrid& searchedVersions)
+    {
+        if (capacity == 0)
+        {
+            return;
+        }
+
+        // The path depends on the cells under the unit's footprint along the way
+        // and on the cells around them, which decide whether terrain is rough.
+        // The rough terrain check reaches down as far as the footprint is wide,
+        // so cover the larger footprint side in both directions.
+        auto footprintSize = std::max(key.footprintX, key.footprintZ);
+        std::vector<unsigned int> regions;
+        for (const auto& p : path)
+        {
+            DiscreteRect rect(p.x - 1, p.y - 1, footprintSize + 2, footprintSize + 2);
+            searchedVersions.appendOverlappingRegions(rect, regions);
+        }
+        std::sort(regions.begin(), regions.end());
+        regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+
+        Entry entry{key, path, {}};
+        for (auto region : regions)
+        {
+            entry.regionVersions.emplace_back(region, searchedVersions.getVersion(region));
+        }
+
+        if (auto it = index.find(key); it != index.end())
+        {
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        else if (entries.size() >= capacity)
+        {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+
+        entries.push_front(std::move(entry));
+        index.emplace(key, entries.begin());
+    }
+
+    void PathCache::clear()
+    {
+        entries.clear();
+        index.clear();
+    }
+
+    std::size_t PathCache::size() const
+    {
+        return entries.size();
+    }
+
+    const PathCacheStats& PathCache::getStats() const
+    {
+        return stats;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <boost/functional/hash.hpp>
+#include <list>
+#include <optional>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/OccupancyVersionGrid.h>
+#include <rwe/sim/MovementClassId.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rwe
+{
+    struct PathCacheKey
+    {
+        std::optional<MovementClassId> movementClassId;
+        int footprintX;
+        int footprintZ;
+        Point start;
+        Point goal;
+
+        bool operator==(const PathCacheKey& rhs) const;
+
+        bool operator!=(const PathCacheKey& rhs) const;
+    };
+}
+
+namespace std
+{
+    template <>
+    struct hash<rwe::PathCacheKey>
+    {
+        std::size_t operator()(const rwe::PathCacheKey& k) const noexcept
+        {
+            std::size_t seed = 0;
+            boost::hash_combine(seed, std::hash<std::optional<rwe::MovementClassId>>()(k.movementClassId));
+            boost::hash_combine(seed, k.footprintX);
+            boost::hash_combine(seed, k.footprintZ);
+            boost::hash_combine(seed, std::hash<rwe::Point>()(k.start));
+            boost::hash_combine(seed, std::hash<rwe::Point>()(k.goal));
+            return seed;
+        }
+    };
+}
+
+namespace rwe
+{
+    struct PathCacheStats
+    {
+        unsigned int hits{0};
+        unsigned int misses{0};
+
+        /** Lookups that found an entry, but one that was out of date. Also counted as misses. */
+        unsigned int staleHits{0};
+    };
+
+    /**
+     * Remembers recently found paths, as the cells they pass through,
+     * so that units asking again for the same path need not search again.
+     *
+     * Each entry records the version of every occupancy region
+     * that its path, or the cells around it, passes through.
+     * An entry is only returned while none of those regions have changed.
+     * When full, the least recently used entry is discarded.
+     */
+    class PathCache
+    {
+    private:
+        struct Entry
+        {
+            PathCacheKey key;
+            std::vector<Point> path;
+            std::vector<std::pair<unsigned int, unsigned int>> regionVersions;
+        };
+
+        std::size_t capacity;
+
+        /** Most recently used first. */
+        std::list<Entry> entries;
+
+        std::unordered_map<PathCacheKey, std::list<Entry>::iterator> index;
+
+        PathCacheStats stats;
+
+    public:
+        explicit PathCache(std::size_t capacity);
+
+        /**
+         * Returns the cached path for the key
+         * if its regions are unchanged in the given versions.
+         * Out of date entries are discarded.
+         */
+        std::optional<std::vector<Point>> tryGet(const PathCacheKey& key, const OccupancyVersionGrid& currentVersions);
+
+        /**
+         * Adds a path to the cache, replacing any existing path for the key.
+         * The versions given should be those at the time the path was searched for.
+         */
+        void insert(const PathCacheKey& key, const std::vector<Point>& path, const OccupancyVersionGrid& searchedVersions);
+
+        void clear();
+
+        std::size_t size() const;
+
+        const PathCacheStats& getStats() const;
+    };
+}
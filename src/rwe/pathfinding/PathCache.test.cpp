@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+#include <rwe/pathfinding/PathCache.h>
+
+namespace rwe
+{
+    TEST_CASE("PathCache")
+    {
+        OccupancyVersionGrid versions(64, 64);
+        PathCache cache(2);
+
+        PathCacheKey key{MovementClassId(1), 2, 2, Point(1, 1), Point(4, 1)};
+        std::vector<Point> path{Point(1, 1), Point(2, 1), Point(3, 1), Point(4, 1)};
+
+        SECTION("returns a cached path while its regions are unchanged")
+        {
+            cache.insert(key, path, versions);
+
+            versions.invalidateRegion(DiscreteRect(40, 40, 2, 2));
+
+            auto result = cache.tryGet(key, versions);
+            REQUIRE(result);
+            REQUIRE(*result == path);
+            REQUIRE(cache.getStats().hits == 1);
+            REQUIRE(cache.getStats().misses == 0);
+        }
+
+        SECTION("discards a path when a region it passes through changes")
+        {
+            cache.insert(key, path, versions);
+
+            versions.invalidateRegion(DiscreteRect(3, 2, 1, 1));
+
+            REQUIRE(!cache.tryGet(key, versions));
+            REQUIRE(cache.size() == 0);
+            REQUIRE(cache.getStats().misses == 1);
+            REQUIRE(cache.getStats().staleHits == 1);
+        }
+
+        SECTION("covers the longer footprint side in both directions")
+        {
+            PathCacheKey deepKey{MovementClassId(1), 1, 3, Point(10, 1), Point(13, 1)};
+            std::vector<Point> deepPath{Point(10, 1), Point(11, 1), Point(12, 1), Point(13, 1)};
+            cache.insert(deepKey, deepPath, versions);
+
+            versions.invalidateRegion(DiscreteRect(16, 0, 1, 1));
+
+            REQUIRE(!cache.tryGet(deepKey, versions));
+        }
+
+        SECTION("discards the least recently used path when full")
+        {
+            PathCacheKey key2{MovementClassId(1), 2, 2, Point(1, 1), Point(5, 1)};
+            PathCacheKey key3{MovementClassId(1), 2, 2, Point(1, 1), Point(6, 1)};
+
+            cache.insert(key, path, versions);
+            cache.insert(key2, path, versions);
+            REQUIRE(cache.tryGet(key, versions));
+            cache.insert(key3, path, versions);
+
+            REQUIRE(cache.size() == 2);
+            REQUIRE(cache.tryGet(key, versions));
+            REQUIRE(!cache.tryGet(key2, versions));
+            REQUIRE(cache.tryGet(key3, versions));
+        }
+
+        SECTION("does not match different footprints or movement classes")
+        {
+            cache.insert(key, path, versions);
+
+            PathCacheKey otherFootprint{MovementClassId(1), 3, 3, Point(1, 1), Point(4, 1)};
+            PathCacheKey otherClass{std::nullopt, 2, 2, Point(1, 1), Point(4, 1)};
+            REQUIRE(!cache.tryGet(otherFootprint, versions));
+            REQUIRE(!cache.tryGet(otherClass, versions));
+        }
+    }
+
+    TEST_CASE("OccupancyVersionGrid")
+    {
+        OccupancyVersionGrid versions(40, 40);
+
+        SECTION("finds the regions overlapping a rect")
+        {
+            std::vector<unsigned int> regions;
+            versions.appendOverlappingRegions(DiscreteRect(14, 14, 4, 4), regions);
+            REQUIRE(regions == std::vector<unsigned int>{0, 1, 3, 4});
+        }
+
+        SECTION("ignores parts of rects outside the grid")
+        {
+            std::vector<unsigned int> regions;
+            versions.appendOverlappingRegions(DiscreteRect(-5, -5, 3, 3), regions);
+            versions.appendOverlappingRegions(DiscreteRect(38, -2, 5, 3), regions);
+            REQUIRE(regions == std::vector<unsigned int>{2});
+        }
+
+        SECTION("increments the versions of overlapping regions")
+        {
+            versions.invalidateRegion(DiscreteRect(20, 0, 1, 1));
+            REQUIRE(versions.getVersion(0) == 0);
+            REQUIRE(versions.getVersion(1) == 1);
+        }
+    }
+}
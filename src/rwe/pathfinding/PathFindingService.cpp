@@ -1,140 +1,515 @@
 #include "PathFindingService.h"
-#include <rwe/pathfinding/UnitPathFinder.h>
-#include <rwe/pathfinding/UnitPerimeterPathFinder.h>
-#include <rwe/pathfinding/pathfinding_utils.h>
-#include <rwe/util/Index.h>
+#include <algorithm>
+#include <rwe/sim/GameSimulation.h>
+#include <rwe/util/match.h>
 
 namespace rwe
 {
-    static const unsigned int MaxTasksPerTick = 10;
+    /**
+     * The maximum number of requests dispatched in a single tick.
+     * Any further requests wait in the queue for a later tick.
+     */
+    static const unsigned int MaxSearchesDispatchedPerTick = 64;
+
+    /**
+     * The minimum number of units in a batch heading to the same cell
+     * for a flow field to be computed for them.
+     */
+    static const std::size_t MinFlowFieldGroupSize = 4;
+
+    static const std::size_t MaxCachedFlowFields = 8;
+
+    static const std::size_t MaxCachedPaths = 512;
+
+    /** Only searches for position destinations are cached. */
+    static std::optional<PathCacheKey> getPathCacheKey(const PathSearchJob& job)
+    {
+        if (!std::holds_alternative<SimVector>(job.destination))
+        {
+            return std::nullopt;
+        }
+
+        return PathCacheKey{job.movementClassId, job.start.width, job.start.height, Point(job.start.x, job.start.y), Point(job.goal.x, job.goal.y)};
+    }
+
+    PathFindingService::PathFindingService() : pathCache(MaxCachedPaths)
+    {
+    }
+
+    void PathFindingService::setWorkerThreadCount(unsigned int threadCount)
+    {
+        if (!dispatchedBatches.empty())
+        {
+            throw std::logic_error("Cannot change worker thread count while searches are in progress");
+        }
+
+        workerPool.reset();
+        if (threadCount > 0)
+        {
+            workerPool = std::make_unique<PathSearchWorkerPool>(threadCount);
+        }
+    }
 
     void PathFindingService::update(GameSimulation& simulation)
     {
-        int remainingBudget = 4000;
+        if (!occupancyVersions)
+        {
+            occupancyVersions.emplace(simulation.occupiedGrid.getWidth(), simulation.occupiedGrid.getHeight());
+        }
+
+        while (!dispatchedBatches.empty() && dispatchedBatches.front().commitTime <= simulation.gameTime)
+        {
+            commitResults(simulation, dispatchedBatches.front());
+            dispatchedBatches.pop_front();
+        }
+
+        dispatchSearches(simulation);
+    }
+
+    void PathFindingService::notifyStaticObstaclesChanged(const DiscreteRect& rect)
+    {
+        pendingInvalidations.push_back(rect);
+
+        pendingComponentInvalidations.push_back(rect);
+
+        staticObstacleVersion += 1;
+        flowFieldCache.clear();
+
+        notifyOccupancyChanged(rect);
+    }
+
+    void PathFindingService::notifyOccupancyChanged(const DiscreteRect& rect)
+    {
+        if (occupancyVersions)
+        {
+            occupancyVersions->invalidateRegion(rect);
+        }
+    }
+
+    const PathCacheStats& PathFindingService::getPathCacheStats() const
+    {
+        return pathCache.getStats();
+    }
+
+    void PathFindingService::commitResults(GameSimulation& simulation, DispatchedBatch& batch)
+    {
+        if (batch.poolBatch)
+        {
+            workerPool->wait(*batch.poolBatch);
+        }
+
+        auto& results = batch.results->paths;
+
+        // Fields computed before static obstacles last changed are out of date.
+        if (batch.staticObstacleVersion == staticObstacleVersion)
+        {
+            for (std::size_t i = 0; i < batch.groups.size(); ++i)
+            {
+                const auto& group = batch.groups[i];
+                if (!group.cachedFlowField)
+                {
+                    const auto& footprint = batch.searches[group.searchIndices.front()].job.start;
+                    cacheFlowField(group.movementClassId, group.goal, batch.results->flowFields[i], footprint, batch.occupancyVersions, simulation.gameTime);
+                }
+            }
+        }
 
-        auto& requests = simulation.pathRequests;
-        while (!requests.empty() && remainingBudget > 0)
+        for (std::size_t i = 0; i < batch.searches.size(); ++i)
         {
-            auto& request = requests.front();
+            const auto& search = batch.searches[i];
+
+            // Repaired paths are only checked around the repair, so are not cached.
+            if (!search.fromPathCache && !search.fromFlowField && !results[i].debugInfo.repaired && results[i].debugInfo.type == AStarPathType::Complete)
+            {
+                if (auto key = getPathCacheKey(search.job))
+                {
+                    pathCache.insert(*key, results[i].debugInfo.path, batch.occupancyVersions);
+                }
+            }
+
+            auto unit = simulation.tryGetUnitState(search.job.unitId);
+            if (!unit)
+            {
+                // Unit that made the request no longer exists.
+                // Possibly the unit died. Just skip it.
+                continue;
+            }
+
+            auto movingState = std::get_if<NavigationStateMoving>(&unit->get().navigationState.state);
+            if (movingState == nullptr || movingState->movementGoal != search.movementGoal)
+            {
+                // The unit has stopped or been given a new goal
+                // since the search was dispatched.
+                continue;
+            }
+
+            movingState->path = PathFollowingInfo(std::move(results[i].path), simulation.gameTime);
+            movingState->pathRequested = false;
+        }
+
+        lastPathDebugInfo = std::move(results.back().debugInfo);
+    }
+
+    void PathFindingService::dispatchSearches(GameSimulation& simulation)
+    {
+        DispatchedBatch batch;
+        batch.commitTime = simulation.gameTime + commitDelay;
+        batch.staticObstacleVersion = staticObstacleVersion;
+        batch.occupancyVersions = *occupancyVersions;
 
+        for (const auto& request : simulation.pathRequests.takeBatch(MaxSearchesDispatchedPerTick))
+        {
             auto unit = simulation.tryGetUnitState(request.unitId);
             if (!unit)
             {
                 // Unit that made the request no longer exists.
                 // Possibly the unit died. Just skip it.
-                requests.pop_front();
                 continue;
             }
 
-            if (auto movingState = std::get_if<NavigationStateMoving>(&unit->get().navigationState.state); movingState != nullptr)
+            const auto& unitState = unit->get();
+            auto movingState = std::get_if<NavigationStateMoving>(&unitState.navigationState.state);
+            if (movingState == nullptr)
+            {
+                continue;
+            }
+
+            const auto& unitDefinition = simulation.unitDefinitions.at(unitState.unitType);
+            auto start = simulation.computeFootprintRegion(unitState.position, unitDefinition.movementCollisionInfo);
+
+            auto goal = match(
+                movingState->pathDestination,
+                [&](const SimVector& destination) {
+                    return simulation.computeFootprintRegion(destination, unitDefinition.movementCollisionInfo);
+                },
+                [&](const DiscreteRect& destination) {
+                    // expand the goal rect to take into account our own collision rect
+                    return destination.expandTopLeft(start.width, start.height);
+                });
+
+            auto movementClassId = match(
+                unitDefinition.movementCollisionInfo, [&](const UnitDefinition::NamedMovementClass& mc) { return std::make_optional(mc.movementClassId); }, [&](const auto&) { return std::optional<MovementClassId>(); });
+
+            PathSearchJob job{request.unitId, movingState->pathDestination, unitState.position, start, goal, movementClassId, request.algorithm};
+            if (request.reason == PathRequestReason::Repair && movingState->path)
+            {
+                const auto& followed = *movingState->path;
+                const auto& cells = followed.path.cells;
+                if (!cells.empty())
+                {
+                    auto waypointIndex = followed.currentWaypoint - followed.path.waypoints.begin();
+                    job.repairCells.assign(cells.begin() + waypointIndex, cells.end());
+                }
+            }
+            batch.searches.push_back(DispatchedSearch{std::move(job), movingState->movementGoal});
+        }
+
+        if (batch.searches.empty())
+        {
+            return;
+        }
+
+        std::shared_ptr<const PathFindingSnapshot> snapshot;
+        auto getSnapshot = [&]() -> const PathFindingSnapshot& {
+            if (!snapshot)
+            {
+                snapshot = std::make_shared<PathFindingSnapshot>(simulation.createPathFindingSnapshot());
+            }
+            return *snapshot;
+        };
+
+        if (!pendingComponentInvalidations.empty() && !connectedComponents.empty())
+        {
+            const auto& currentSnapshot = getSnapshot();
+            for (auto& entry : connectedComponents)
             {
-                auto path = match(
-                    movingState->pathDestination,
-                    [&](const SimVector& pos) {
-                        return findPath(simulation, request.unitId, pos);
-                    },
-                    [&](const DiscreteRect& pos) {
-                        return findPath(simulation, request.unitId, pos);
-                    });
+                auto movementClassId = entry.first;
+                auto& mc = entry.second;
+                auto isWalkable = [&](const Point& p) {
+                    return simulation.movementClassCollisionService.isWalkable(movementClassId, p)
+                        && !currentSnapshot.isStaticCollisionAt(DiscreteRect(p.x, p.y, mc.footprintX, mc.footprintZ));
+                };
+                for (const auto& rect : pendingComponentInvalidations)
+                {
+                    // positions whose footprint overlaps the rect
+                    DiscreteRect positions(rect.x - static_cast<int>(mc.footprintX) + 1, rect.y - static_cast<int>(mc.footprintZ) + 1, rect.width + mc.footprintX - 1, rect.height + mc.footprintZ - 1);
+                    mc.components.relabelRegion(positions, isWalkable);
+                }
+            }
+        }
+        pendingComponentInvalidations.clear();
+
+        for (auto& search : batch.searches)
+        {
+            redirectUnreachableGoal(simulation, getSnapshot, search.job);
+        }
 
-                movingState->path = PathFollowingInfo(std::move(path), simulation.gameTime);
-                movingState->pathRequested = false;
+        batch.results = std::make_shared<BatchResults>();
+        batch.results->paths.resize(batch.searches.size());
+
+        for (std::size_t i = 0; i < batch.searches.size(); ++i)
+        {
+            auto& search = batch.searches[i];
+            auto key = getPathCacheKey(search.job);
+            if (!key)
+            {
+                continue;
+            }
 
-                // HACK: we know that lastPathDebugInfo is set by the call to findPath,
-                // so we'll exploit it here to deduct from out budget.
-                remainingBudget -= getSize(lastPathDebugInfo.closedVertices);
+            auto cells = pathCache.tryGet(*key, *occupancyVersions);
+            if (!cells)
+            {
+                continue;
             }
 
-            requests.pop_front();
+            auto& result = batch.results->paths[i];
+            result.path = PathSearcher::toUnitPath(simulation.terrain, search.job, *cells, std::get<SimVector>(search.job.destination));
+            result.debugInfo.path = std::move(*cells);
+            search.fromPathCache = true;
+        }
+
+        auto ungroupedSearches = groupSearches(batch, simulation.gameTime);
+        batch.results->flowFields.resize(batch.groups.size());
+
+        if (!ungroupedSearches.empty() || !batch.groups.empty())
+        {
+            submitSearches(simulation, batch, ungroupedSearches, std::move(snapshot));
         }
+
+        dispatchedBatches.push_back(std::move(batch));
     }
 
-    UnitPath PathFindingService::findPath(const GameSimulation& simulation, UnitId unitId, const DiscreteRect& destination)
+    void PathFindingService::submitSearches(GameSimulation& simulation, DispatchedBatch& batch, const std::vector<std::size_t>& ungroupedSearches, std::shared_ptr<const PathFindingSnapshot> snapshot)
     {
-        const auto& unit = simulation.getUnitState(unitId);
-        const auto& unitDefinition = simulation.unitDefinitions.at(unit.unitType);
+        if (!snapshot)
+        {
+            snapshot = std::make_shared<PathFindingSnapshot>(simulation.createPathFindingSnapshot());
+        }
+
+        PathSearchContext context{snapshot.get(), &simulation.movementClassCollisionService, &simulation.terrain, hierarchicalGraphs.get()};
 
-        auto start = simulation.computeFootprintRegion(unit.position, unitDefinition.movementCollisionInfo);
-        // expand the goal rect to take into account our own collision rect
-        auto goal = destination.expandTopLeft(start.width, start.height);
+        std::vector<PathSearchWorkerPool::Task> tasks;
+        for (auto i : ungroupedSearches)
+        {
+            tasks.emplace_back([context, snapshot, results = batch.results, job = batch.searches[i].job, i](PathSearcher& searcher) {
+                results->paths[i] = searcher.search(context, job);
+            });
+        }
 
-        auto movementClassId = match(
-            unitDefinition.movementCollisionInfo, [&](const UnitDefinition::NamedMovementClass& mc) { return std::make_optional(mc.movementClassId); }, [&](const auto&) { return std::optional<MovementClassId>(); });
+        for (std::size_t groupIndex = 0; groupIndex < batch.groups.size(); ++groupIndex)
+        {
+            const auto& group = batch.groups[groupIndex];
 
-        UnitPerimeterPathFinder pathFinder(&simulation, &simulation.movementClassCollisionService, unitId, movementClassId, start.width, start.height, goal);
+            std::vector<PathSearchJob> jobs;
+            for (auto i : group.searchIndices)
+            {
+                jobs.push_back(batch.searches[i].job);
+            }
 
-        auto path = pathFinder.findPath(Point(start.x, start.y));
-        lastPathDebugInfo = AStarPathInfo<Point, PathCost>{path.type, path.path, std::move(path.closedVertices)};
+            tasks.emplace_back([context, snapshot, results = batch.results, jobs = std::move(jobs), indices = group.searchIndices, field = group.cachedFlowField, groupIndex](PathSearcher& searcher) {
+                auto groupResult = searcher.searchGroup(context, jobs, field);
+                for (std::size_t j = 0; j < indices.size(); ++j)
+                {
+                    results->paths[indices[j]] = std::move(groupResult.results[j]);
+                }
+                results->flowFields[groupIndex] = std::move(groupResult.flowField);
+            });
+        }
 
-        assert(path.path.size() >= 1);
+        // Applied before the batch's searches start, and after the previous batch's have finished,
+        // so that the graphs always agree with the snapshot being searched.
+        auto prepare = [graphs = hierarchicalGraphs.get(), invalidations = std::move(pendingInvalidations)]() {
+            std::scoped_lock<std::mutex> lock(graphs->mutex);
+            for (auto& entry : graphs->graphs)
+            {
+                for (const auto& rect : invalidations)
+                {
+                    entry.second.invalidateRegion(rect);
+                }
+            }
+        };
+        pendingInvalidations.clear();
 
-        if (path.path.size() == 1)
+        if (!workerPool)
+        {
+            prepare();
+            for (auto& task : tasks)
+            {
+                task(*synchronousSearcher);
+            }
+        }
+        else
         {
-            // The path is trivial, we are already at the goal.
-            return UnitPath{std::vector<SimVector>{unit.position}};
+            batch.poolBatch = workerPool->submit(std::move(prepare), std::move(tasks));
         }
+    }
+
+    std::vector<std::size_t> PathFindingService::groupSearches(DispatchedBatch& batch, GameTime currentTime)
+    {
+        std::vector<std::size_t> ungroupedSearches;
+
+        for (std::size_t i = 0; i < batch.searches.size(); ++i)
+        {
+            if (batch.searches[i].fromPathCache)
+            {
+                continue;
+            }
 
-        auto simplifiedPath = runSimplifyPath(path.path);
+            // Repairing a path is cheaper than reading it from a field.
+            const auto& job = batch.searches[i].job;
+            if (!job.movementClassId || !std::holds_alternative<SimVector>(job.destination) || !job.repairCells.empty())
+            {
+                ungroupedSearches.push_back(i);
+                continue;
+            }
+
+            Point goal(job.goal.x, job.goal.y);
+            auto it = std::find_if(batch.groups.begin(), batch.groups.end(), [&](const auto& g) {
+                return g.movementClassId == *job.movementClassId && g.goal == goal;
+            });
+            if (it == batch.groups.end())
+            {
+                batch.groups.push_back(DispatchedGroup{*job.movementClassId, goal, {}, nullptr});
+                it = batch.groups.end() - 1;
+            }
+            it->searchIndices.push_back(i);
+        }
 
-        std::vector<SimVector> waypoints;
-        for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
+        // Groups too small to be worth a new field are searched individually.
+        std::vector<DispatchedGroup> groups;
+        for (auto& group : batch.groups)
         {
-            waypoints.push_back(getWorldCenter(simulation, DiscreteRect(it->x, it->y, start.width, start.height)));
+            group.cachedFlowField = tryGetCachedFlowField(group.movementClassId, group.goal, currentTime);
+            if (group.cachedFlowField || group.searchIndices.size() >= MinFlowFieldGroupSize)
+            {
+                for (auto i : group.searchIndices)
+                {
+                    batch.searches[i].fromFlowField = true;
+                }
+                groups.push_back(std::move(group));
+            }
+            else
+            {
+                ungroupedSearches.insert(ungroupedSearches.end(), group.searchIndices.begin(), group.searchIndices.end());
+            }
         }
+        batch.groups = std::move(groups);
 
-        return UnitPath{std::move(waypoints)};
+        return ungroupedSearches;
     }
 
-    UnitPath PathFindingService::findPath(const GameSimulation& simulation, UnitId unitId, const SimVector& destination)
+    std::shared_ptr<const FlowField> PathFindingService::tryGetCachedFlowField(MovementClassId movementClassId, const Point& goal, GameTime currentTime)
     {
-        const auto& unit = simulation.getUnitState(unitId);
-        const auto& unitDefinition = simulation.unitDefinitions.at(unit.unitType);
+        auto it = std::find_if(flowFieldCache.begin(), flowFieldCache.end(), [&](const auto& entry) {
+            return entry.movementClassId == movementClassId && entry.goal == goal;
+        });
+        if (it == flowFieldCache.end())
+        {
+            return nullptr;
+        }
 
-        auto start = simulation.computeFootprintRegion(unit.position, unitDefinition.movementCollisionInfo);
-        auto goal = simulation.computeFootprintRegion(destination, unitDefinition.movementCollisionInfo);
+        auto upToDate = std::all_of(it->regionVersions.begin(), it->regionVersions.end(), [&](const auto& rv) {
+            return occupancyVersions->getVersion(rv.first) == rv.second;
+        });
+        if (!upToDate)
+        {
+            flowFieldCache.erase(it);
+            return nullptr;
+        }
 
-        auto movementClassId = match(
-            unitDefinition.movementCollisionInfo, [&](const UnitDefinition::NamedMovementClass& mc) { return std::make_optional(mc.movementClassId); }, [&](const auto&) { return std::optional<MovementClassId>(); });
+        it->lastUsedTime = currentTime;
+        return it->field;
+    }
 
-        UnitPathFinder pathFinder(&simulation, &simulation.movementClassCollisionService, unitId, movementClassId, start.width, start.height, Point(goal.x, goal.y));
+    void PathFindingService::cacheFlowField(MovementClassId movementClassId, const Point& goal, std::shared_ptr<const FlowField> field, const DiscreteRect& footprint, const OccupancyVersionGrid& computedVersions, GameTime currentTime)
+    {
+        // The field depends on the occupancy under the footprint of a unit standing on any reached cell.
+        // The cells around those decide whether terrain is rough
+        // and which cells the field could not reach.
+        // A field that reached nothing depends on the goal.
+        auto bounds = field->getReachedBounds().value_or(DiscreteRect(goal.x, goal.y, 1, 1));
+        auto footprintSize = std::max(footprint.width, footprint.height);
+        DiscreteRect rect(bounds.x - 2, bounds.y - 2, bounds.width + footprintSize + 3, bounds.height + footprintSize + 3);
+        std::vector<unsigned int> regions;
+        computedVersions.appendOverlappingRegions(rect, regions);
+
+        std::vector<std::pair<unsigned int, unsigned int>> regionVersions;
+        for (auto region : regions)
+        {
+            regionVersions.emplace_back(region, computedVersions.getVersion(region));
+        }
 
-        auto path = pathFinder.findPath(Point(start.x, start.y));
-        lastPathDebugInfo = AStarPathInfo<Point, PathCost>{path.type, path.path, std::move(path.closedVertices)};
+        auto it = std::find_if(flowFieldCache.begin(), flowFieldCache.end(), [&](const auto& entry) {
+            return entry.movementClassId == movementClassId && entry.goal == goal;
+        });
+        if (it != flowFieldCache.end())
+        {
+            it->field = std::move(field);
+            it->lastUsedTime = currentTime;
+            it->regionVersions = std::move(regionVersions);
+            return;
+        }
 
-        if (path.type == AStarPathType::Partial)
+        if (flowFieldCache.size() >= MaxCachedFlowFields)
         {
-            path.path.emplace_back(goal.x, goal.y);
+            auto leastRecentlyUsed = std::min_element(flowFieldCache.begin(), flowFieldCache.end(), [](const auto& a, const auto& b) {
+                return a.lastUsedTime < b.lastUsedTime;
+            });
+            flowFieldCache.erase(leastRecentlyUsed);
         }
 
-        assert(path.path.size() >= 1);
+        flowFieldCache.push_back(CachedFlowField{movementClassId, goal, std::move(field), currentTime, std::move(regionVersions)});
+    }
 
-        if (path.path.size() == 1)
+    void PathFindingService::redirectUnreachableGoal(const GameSimulation& simulation, const std::function<const PathFindingSnapshot&()>& getSnapshot, PathSearchJob& job)
+    {
+        if (!job.movementClassId || !std::holds_alternative<SimVector>(job.destination))
         {
-            // The path is trivial, we are already at the goal.
-            return UnitPath{std::vector<SimVector>{destination}};
+            return;
         }
 
-        auto simplifiedPath = runSimplifyPath(path.path);
+        const auto& components = getConnectedComponents(simulation, getSnapshot, *job.movementClassId, job.start).components;
+
+        Point start(job.start.x, job.start.y);
+        Point goal(job.goal.x, job.goal.y);
+
+        auto label = components.getLabel(start);
+        if (label == ConnectedComponents::NoComponent || components.getLabel(goal) == label)
+        {
+            // Either the goal is reachable,
+            // or the unit is somewhere it could not normally stand
+            // and we can't say where it can reach.
+            return;
+        }
 
-        std::vector<SimVector> waypoints;
-        for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
+        auto nearest = components.findNearestInComponent(goal, label);
+        if (!nearest)
         {
-            waypoints.push_back(getWorldCenter(simulation, DiscreteRect(it->x, it->y, start.width, start.height)));
+            return;
         }
-        waypoints.back() = destination;
 
-        return UnitPath{std::move(waypoints)};
+        job.goal = DiscreteRect(nearest->x, nearest->y, job.goal.width, job.goal.height);
+        job.destination = PathSearcher::getWorldCenter(simulation.terrain, job.goal);
     }
 
-    SimVector PathFindingService::getWorldCenter(const GameSimulation& simulation, const DiscreteRect& rect)
+    PathFindingService::MovementClassComponents& PathFindingService::getConnectedComponents(const GameSimulation& simulation, const std::function<const PathFindingSnapshot&()>& getSnapshot, MovementClassId movementClassId, const DiscreteRect& footprint)
     {
-        auto corner = simulation.terrain.heightmapIndexToWorldCorner(rect.x, rect.y);
-
-        auto halfWorldWidth = (SimScalar(rect.width) * MapTerrain::HeightTileWidthInWorldUnits) / 2_ss;
-        auto halfWorldHeight = (SimScalar(rect.height) * MapTerrain::HeightTileHeightInWorldUnits) / 2_ss;
+        auto it = connectedComponents.find(movementClassId);
+        if (it != connectedComponents.end())
+        {
+            return it->second;
+        }
 
-        auto center = corner + SimVector(halfWorldWidth, 0_ss, halfWorldHeight);
-        center.y = simulation.terrain.getHeightAt(center.x, center.z);
-        return center;
+        const auto& snapshot = getSnapshot();
+        auto footprintX = static_cast<unsigned int>(footprint.width);
+        auto footprintZ = static_cast<unsigned int>(footprint.height);
+        auto isWalkable = [&](const Point& p) {
+            return simulation.movementClassCollisionService.isWalkable(movementClassId, p)
+                && !snapshot.isStaticCollisionAt(DiscreteRect(p.x, p.y, footprintX, footprintZ));
+        };
+
+        const auto& walkableGrid = simulation.movementClassCollisionService.getGrid(movementClassId);
+        ConnectedComponents components(walkableGrid.getWidth(), walkableGrid.getHeight(), isWalkable);
+        return connectedComponents.emplace(movementClassId, MovementClassComponents{footprintX, footprintZ, std::move(components)}).first->second;
     }
 }
@@ -1,29 +1,223 @@
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <rwe/grid/DiscreteRect.h>
 #include <rwe/grid/Point.h>
-#include <rwe/pathfinding/AStarPathFinder.h>
-#include <rwe/pathfinding/PathCost.h>
-#include <rwe/pathfinding/UnitPath.h>
-#include <rwe/sim/MovementClassCollisionService.h>
-#include <rwe/sim/SimVector.h>
-#include <rwe/sim/UnitId.h>
+#include <rwe/pathfinding/ConnectedComponents.h>
+#include <rwe/pathfinding/FlowField.h>
+#include <rwe/pathfinding/OccupancyVersionGrid.h>
+#include <rwe/pathfinding/PathCache.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
+#include <rwe/pathfinding/PathSearchWorkerPool.h>
+#include <rwe/pathfinding/PathSearcher.h>
+#include <rwe/sim/GameTime.h>
+#include <rwe/sim/MovementClassId.h>
+#include <rwe/sim/UnitState.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace rwe
 {
     struct GameSimulation;
 
+    /**
+     * Answers the path requests queued in the simulation.
+     *
+     * Requests are searched against a snapshot of the occupied grid
+     * taken on the tick they are dispatched,
+     * and the resulting paths are given to units a fixed number of ticks later,
+     * in the order the requests were made.
+     * Searches may therefore run on worker threads
+     * without the result depending on how long they take,
+     * so every peer in a game sees identical paths.
+     *
+     * When several units of the same movement class head to the same place,
+     * as after a group move order, their paths are read from a single shared flow field.
+     */
     class PathFindingService
     {
     public:
-        AStarPathInfo<Point, PathCost> lastPathDebugInfo;
+        PathFindingDebugInfo lastPathDebugInfo;
 
+    private:
+        struct DispatchedSearch
+        {
+            PathSearchJob job;
+            MovingStateGoal movementGoal;
+
+            /** True if the path was taken from the path cache rather than searched for. */
+            bool fromPathCache{false};
+
+            /** True if the path was read from a flow field. */
+            bool fromFlowField{false};
+        };
+
+        /** Searches for units of the same movement class heading to the same cell. */
+        struct DispatchedGroup
+        {
+            MovementClassId movementClassId;
+            Point goal;
+            std::vector<std::size_t> searchIndices;
+
+            /** The cached field to read paths from, or null if a new one is computed. */
+            std::shared_ptr<const FlowField> cachedFlowField;
+        };
+
+        struct BatchResults
+        {
+            /** One per search. */
+            std::vector<PathSearchResult> paths;
+
+            /** One per group. */
+            std::vector<std::shared_ptr<const FlowField>> flowFields;
+        };
+
+        struct DispatchedBatch
+        {
+            GameTime commitTime;
+            unsigned int staticObstacleVersion;
+
+            /** The occupancy versions at dispatch, which the snapshot reflects. */
+            OccupancyVersionGrid occupancyVersions;
+
+            std::vector<DispatchedSearch> searches;
+            std::vector<DispatchedGroup> groups;
+            std::shared_ptr<BatchResults> results;
+
+            /** The batch in the worker pool, or null if it was searched synchronously. */
+            std::shared_ptr<PathSearchWorkerPool::Batch> poolBatch;
+        };
+
+        struct MovementClassComponents
+        {
+            unsigned int footprintX;
+            unsigned int footprintZ;
+            ConnectedComponents components;
+        };
+
+        struct CachedFlowField
+        {
+            MovementClassId movementClassId;
+            Point goal;
+            std::shared_ptr<const FlowField> field;
+            GameTime lastUsedTime;
+
+            /** The occupancy region versions that the field was computed against. */
+            std::vector<std::pair<unsigned int, unsigned int>> regionVersions;
+        };
+
+        /** The number of ticks between a search being dispatched and its result being committed. */
+        GameTime commitDelay{3};
+
+        std::unique_ptr<HierarchicalPathGraphs> hierarchicalGraphs{std::make_unique<HierarchicalPathGraphs>()};
+
+        /** Static obstacle changes not yet applied to the hierarchical graphs. */
+        std::vector<DiscreteRect> pendingInvalidations;
+
+        std::deque<DispatchedBatch> dispatchedBatches;
+
+        /** Incremented whenever static obstacles change. */
+        unsigned int staticObstacleVersion{0};
+
+        /**
+         * Flow fields from recent group moves,
+         * discarded when static obstacles change
+         * or when occupancy changes in a region the field covers.
+         */
+        std::vector<CachedFlowField> flowFieldCache;
+
+        /**
+         * Connected components of each movement class's walkability,
+         * considering terrain and static obstacles. Created on first use.
+         */
+        std::unordered_map<MovementClassId, MovementClassComponents> connectedComponents;
+
+        /** Static obstacle changes not yet applied to the connected components. */
+        std::vector<DiscreteRect> pendingComponentInvalidations;
+
+        /** Created on the first update, once the size of the map is known. */
+        std::optional<OccupancyVersionGrid> occupancyVersions;
+
+        PathCache pathCache;
+
+        /** Used to run searches when there are no worker threads. */
+        std::unique_ptr<PathSearcher> synchronousSearcher{std::make_unique<PathSearcher>()};
+
+        /** Declared last so that the workers are stopped before anything they use is destroyed. */
+        std::unique_ptr<PathSearchWorkerPool> workerPool;
+
+    public:
+        PathFindingService();
+
+        /**
+         * Sets the number of worker threads used to run searches.
+         * With zero threads, searches run synchronously during update,
+         * though their results are still committed after the usual delay.
+         * Must not be called while searches are in progress.
+         */
+        void setWorkerThreadCount(unsigned int threadCount);
+
+        /**
+         * Commits the results of searches that are due this tick
+         * and dispatches searches for queued path requests.
+         *
+         * Searches in progress refer to the simulation's terrain and collision service,
+         * so the simulation must not be moved while any are in progress.
+         */
         void update(GameSimulation& simulation);
 
+        /**
+         * Must be called whenever buildings or blocking features
+         * are added to or removed from the given rectangle of map cells.
+         */
+        void notifyStaticObstaclesChanged(const DiscreteRect& rect);
+
+        /**
+         * Must be called whenever mobile units enter or leave
+         * the given rectangle of map cells.
+         */
+        void notifyOccupancyChanged(const DiscreteRect& rect);
+
+        const PathCacheStats& getPathCacheStats() const;
+
     private:
-        UnitPath findPath(const GameSimulation& simulation, UnitId unitId, const SimVector& destination);
-        UnitPath findPath(const GameSimulation& simulation, UnitId unitId, const DiscreteRect& destination);
+        void commitResults(GameSimulation& simulation, DispatchedBatch& batch);
+
+        void dispatchSearches(GameSimulation& simulation);
+
+        /**
+         * Starts the searches for a batch that cannot be answered from the caches.
+         * The snapshot is created if not given.
+         */
+        void submitSearches(GameSimulation& simulation, DispatchedBatch& batch, const std::vector<std::size_t>& ungroupedSearches, std::shared_ptr<const PathFindingSnapshot> snapshot);
+
+        /**
+         * If the search's goal cannot be reached from its start,
+         * moves the goal to the nearest cell that can be.
+         * This spares searching the whole of the start's component for a goal it does not contain.
+         */
+        void redirectUnreachableGoal(const GameSimulation& simulation, const std::function<const PathFindingSnapshot&()>& getSnapshot, PathSearchJob& job);
+
+        /** The snapshot is only requested if the components have not yet been created. */
+        MovementClassComponents& getConnectedComponents(const GameSimulation& simulation, const std::function<const PathFindingSnapshot&()>& getSnapshot, MovementClassId movementClassId, const DiscreteRect& footprint);
+
+        /**
+         * Groups searches that can share a flow field.
+         * Searches that are not grouped are returned.
+         */
+        std::vector<std::size_t> groupSearches(DispatchedBatch& batch, GameTime currentTime);
+
+        /** Out of date fields are discarded. */
+        std::shared_ptr<const FlowField> tryGetCachedFlowField(MovementClassId movementClassId, const Point& goal, GameTime currentTime);
 
-        SimVector getWorldCenter(const GameSimulation& simulation, const DiscreteRect& discreteRect);
+        /**
+         * The versions given should be those at the time the field was computed.
+         * The footprint is that of the units the field was computed for.
+         */
+        void cacheFlowField(MovementClassId movementClassId, const Point& goal, std::shared_ptr<const FlowField> field, const DiscreteRect& footprint, const OccupancyVersionGrid& computedVersions, GameTime currentTime);
     };
 }
@@ -0,0 +1,95 @@
+#include "PathFindingSnapshot.h"
+#include <algorithm>
+
+namespace rwe
+{
+    PathFindingSnapshot::PathFindingSnapshot(Grid<Cell>&& cells) : cells(std::move(cells))
+    {
+    }
+
+    int PathFindingSnapshot::getWidth() const
+    {
+        return cells.getWidth();
+    }
+
+    int PathFindingSnapshot::getHeight() const
+    {
+        return cells.getHeight();
+    }
+
+    bool PathFindingSnapshot::isCollisionAt(const DiscreteRect& rect) const
+    {
+        auto region = cells.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        return cells.any(*region, [&](const auto& cell) {
+            return cell.staticCollision || cell.mobileUnitId;
+        });
+    }
+
+    bool PathFindingSnapshot::isCollisionAt(const DiscreteRect& rect, UnitId self) const
+    {
+        auto region = cells.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        return cells.any(*region, [&](const auto& cell) {
+            return cell.staticCollision || (cell.mobileUnitId && *cell.mobileUnitId != self);
+        });
+    }
+
+    bool PathFindingSnapshot::isCollisionAt(const DiscreteRect& rect, const std::vector<UnitId>& ignoredUnits) const
+    {
+        auto region = cells.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        return cells.any(*region, [&](const auto& cell) {
+            return cell.staticCollision || (cell.mobileUnitId && !std::binary_search(ignoredUnits.begin(), ignoredUnits.end(), *cell.mobileUnitId));
+        });
+    }
+
+    bool PathFindingSnapshot::isStaticCollisionAt(const DiscreteRect& rect) const
+    {
+        auto region = cells.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        return cells.any(*region, [&](const auto& cell) {
+            return cell.staticCollision;
+        });
+    }
+
+    bool PathFindingSnapshot::isAdjacentToObstacle(const DiscreteRect& rect) const
+    {
+        auto edges = getAdjacentEdges(rect);
+        return std::any_of(edges.begin(), edges.end(), [&](const auto& edge) { return isCollisionAt(edge); });
+    }
+
+    bool PathFindingSnapshot::isAdjacentToStaticObstacle(const DiscreteRect& rect) const
+    {
+        auto edges = getAdjacentEdges(rect);
+        return std::any_of(edges.begin(), edges.end(), [&](const auto& edge) { return isStaticCollisionAt(edge); });
+    }
+
+    std::array<DiscreteRect, 4> PathFindingSnapshot::getAdjacentEdges(const DiscreteRect& rect)
+    {
+        // These are the same edges that GameSimulation::isAdjacentToObstacle checks,
+        // so that paths are unchanged by searching a snapshot.
+        return {
+            DiscreteRect(rect.x - 1, rect.y - 1, rect.width + 2, 1),
+            DiscreteRect(rect.x - 1, rect.y + rect.width, rect.width + 2, 1),
+            DiscreteRect(rect.x - 1, rect.y, 1, rect.height),
+            DiscreteRect(rect.x + rect.width, rect.y, 1, rect.height),
+        };
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <rwe/grid/DiscreteRect.h>
+#include <rwe/grid/Grid.h>
+#include <rwe/sim/UnitId.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * A copy of the occupied grid, reduced to what path searches need.
+     *
+     * Path searches run on worker threads while the simulation carries on,
+     * so they read from a snapshot taken at the tick they were dispatched
+     * rather than from the live simulation.
+     * A snapshot is never modified after it is created.
+     */
+    class PathFindingSnapshot
+    {
+    public:
+        struct Cell
+        {
+            std::optional<UnitId> mobileUnitId;
+
+            /** True if the cell contains an impassable building or a blocking feature. */
+            bool staticCollision{false};
+        };
+
+    private:
+        Grid<Cell> cells;
+
+    public:
+        explicit PathFindingSnapshot(Grid<Cell>&& cells);
+
+        int getWidth() const;
+
+        int getHeight() const;
+
+        /** Equivalent to GameSimulation::isCollisionAt. */
+        bool isCollisionAt(const DiscreteRect& rect) const;
+
+        /** Equivalent to GameSimulation::isCollisionAt, ignoring the given unit. */
+        bool isCollisionAt(const DiscreteRect& rect, UnitId self) const;
+
+        /**
+         * Equivalent to GameSimulation::isCollisionAt, ignoring the given units.
+         * The units must be sorted.
+         */
+        bool isCollisionAt(const DiscreteRect& rect, const std::vector<UnitId>& ignoredUnits) const;
+
+        /**
+         * Returns true if the rect collides with a building or a blocking feature.
+         * Mobile units are ignored.
+         */
+        bool isStaticCollisionAt(const DiscreteRect& rect) const;
+
+        /** Equivalent to GameSimulation::isAdjacentToObstacle. */
+        bool isAdjacentToObstacle(const DiscreteRect& rect) const;
+
+        /**
+         * Like isAdjacentToObstacle, but only buildings and blocking features
+         * count as obstacles.
+         */
+        bool isAdjacentToStaticObstacle(const DiscreteRect& rect) const;
+
+    private:
+        static std::array<DiscreteRect, 4> getAdjacentEdges(const DiscreteRect& rect);
+    };
+}
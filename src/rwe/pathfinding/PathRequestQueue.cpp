@@ -0,0 +1,123 @@
+#include "PathRequestQueue.h"
+#include <algorithm>
+
+namespace rwe
+{
+    bool PathRequestQueue::EntryComparator::operator()(const Entry& a, const Entry& b) const
+    {
+        // std::priority_queue puts the greatest element on top,
+        // so the comparison is reversed to serve the lowest key first.
+        if (a.sortKey != b.sortKey)
+        {
+            return a.sortKey > b.sortKey;
+        }
+
+        return a.sequenceNumber > b.sequenceNumber;
+    }
+
+    void PathRequestQueue::push(const PathRequest& request, GameTime currentTime)
+    {
+        auto sortKey = static_cast<std::int64_t>(currentTime.value);
+        if (request.reason == PathRequestReason::NewGoal)
+        {
+            sortKey -= NewGoalPriorityTicks;
+        }
+        if (request.combatUnit)
+        {
+            sortKey -= CombatUnitPriorityTicks;
+        }
+
+        auto sequenceNumber = nextSequenceNumber++;
+
+        // Any earlier request from this unit is now stale
+        // and will be skipped when it reaches the top of its queue.
+        liveRequests.insert_or_assign(request.unitId, sequenceNumber);
+        playerQueues[request.owner].push(Entry{sortKey, sequenceNumber, request});
+    }
+
+    std::vector<PathRequest> PathRequestQueue::takeBatch(std::size_t maxRequests)
+    {
+        std::vector<PathRequest> batch;
+        if (maxRequests == 0 || playerQueues.empty())
+        {
+            return batch;
+        }
+
+        std::vector<PlayerQueue*> players;
+        for (auto& entry : playerQueues)
+        {
+            players.push_back(&entry.second);
+        }
+        std::rotate(players.begin(), players.begin() + (nextFirstPlayer % players.size()), players.end());
+        nextFirstPlayer += 1;
+
+        auto madeProgress = true;
+        while (madeProgress && batch.size() < maxRequests)
+        {
+            madeProgress = false;
+            for (auto& player : players)
+            {
+                if (batch.size() >= maxRequests)
+                {
+                    break;
+                }
+
+                auto request = popLive(*player);
+                if (!request)
+                {
+                    continue;
+                }
+
+                batch.push_back(*request);
+                madeProgress = true;
+            }
+        }
+
+        for (auto it = playerQueues.begin(); it != playerQueues.end();)
+        {
+            if (it->second.empty())
+            {
+                it = playerQueues.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        return batch;
+    }
+
+    bool PathRequestQueue::contains(UnitId unitId) const
+    {
+        return liveRequests.find(unitId) != liveRequests.end();
+    }
+
+    bool PathRequestQueue::empty() const
+    {
+        return liveRequests.empty();
+    }
+
+    std::size_t PathRequestQueue::size() const
+    {
+        return liveRequests.size();
+    }
+
+    std::optional<PathRequest> PathRequestQueue::popLive(PlayerQueue& queue)
+    {
+        while (!queue.empty())
+        {
+            auto entry = queue.top();
+            queue.pop();
+
+            auto it = liveRequests.find(entry.request.unitId);
+            if (it != liveRequests.end() && it->second == entry.sequenceNumber)
+            {
+                liveRequests.erase(it);
+                return entry.request;
+            }
+        }
+
+        return std::nullopt;
+    }
+}
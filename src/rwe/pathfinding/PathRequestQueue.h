@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <queue>
+#include <rwe/pathfinding/PathSearchAlgorithm.h>
+#include <rwe/sim/GameTime.h>
+#include <rwe/sim/PlayerId.h>
+#include <rwe/sim/UnitId.h>
+#include <unordered_map>
+#include <vector>
+
+namespace rwe
+{
+    enum class PathRequestReason
+    {
+        /** The unit's path was blocked or incomplete and it wants a better one. */
+        Replan,
+
+        /** The unit was given a new place to go and is waiting for a path to start moving. */
+        NewGoal,
+
+        /** The unit's path is blocked and it wants a way around the blockage. */
+        Repair
+    };
+
+    struct PathRequest
+    {
+        UnitId unitId;
+        PlayerId owner;
+        PathSearchAlgorithm algorithm;
+        PathRequestReason reason;
+
+        /** True if the unit has weapons. */
+        bool combatUnit;
+    };
+
+    /**
+     * Queue of units waiting for a path.
+     *
+     * Each player's requests are served oldest first,
+     * except that new goals and combat units are treated
+     * as if they had asked a little earlier than they did.
+     * Since the boost is a fixed number of ticks,
+     * an old request always gets served eventually.
+     *
+     * Players take turns when requests are taken from the queue,
+     * so one player ordering a large army around
+     * does not hold up the paths of everyone else.
+     *
+     * A unit has at most one request in the queue.
+     * A new request from the same unit replaces the old one
+     * and goes to the back of the queue.
+     * Replaced requests are left in place and skipped when reached.
+     */
+    class PathRequestQueue
+    {
+    private:
+        struct Entry
+        {
+            /** Lower is served first. */
+            std::int64_t sortKey;
+            std::uint64_t sequenceNumber;
+            PathRequest request;
+        };
+
+        struct EntryComparator
+        {
+            bool operator()(const Entry& a, const Entry& b) const;
+        };
+
+        using PlayerQueue = std::priority_queue<Entry, std::vector<Entry>, EntryComparator>;
+
+        /** Ordered by player ID so that players take turns in a deterministic order. */
+        std::map<PlayerId, PlayerQueue> playerQueues;
+
+        /** The sequence number of each unit's live request. */
+        std::unordered_map<UnitId, std::uint64_t> liveRequests;
+
+        std::uint64_t nextSequenceNumber{0};
+
+        /** Rotates which player goes first each time a batch is taken. */
+        std::size_t nextFirstPlayer{0};
+
+    public:
+        /** The number of ticks earlier than its real time that a new goal request is treated as. */
+        static constexpr unsigned int NewGoalPriorityTicks = 15;
+
+        /** The number of ticks earlier than its real time that a combat unit's request is treated as. */
+        static constexpr unsigned int CombatUnitPriorityTicks = 8;
+
+        void push(const PathRequest& request, GameTime currentTime);
+
+        /**
+         * Removes and returns up to maxRequests requests.
+         * Players take turns one request at a time.
+         */
+        std::vector<PathRequest> takeBatch(std::size_t maxRequests);
+
+        bool contains(UnitId unitId) const;
+
+        bool empty() const;
+
+        /** The number of live requests in the queue. */
+        std::size_t size() const;
+
+    private:
+        std::optional<PathRequest> popLive(PlayerQueue& queue);
+    };
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <rwe/pathfinding/PathRequestQueue.h>
+
+namespace rwe
+{
+    static PathRequest pathRequestTestRequest(unsigned int unitId, unsigned int owner, PathRequestReason reason = PathRequestReason::Replan, bool combatUnit = false)
+    {
+        return PathRequest{UnitId(unitId), PlayerId(owner), PathSearchAlgorithm::AStar, reason, combatUnit};
+    }
+
+    static std::vector<unsigned int> pathRequestTestUnitIds(const std::vector<PathRequest>& requests)
+    {
+        std::vector<unsigned int> ids;
+        for (const auto& r : requests)
+        {
+            ids.push_back(r.unitId.value);
+        }
+        return ids;
+    }
+
+    TEST_CASE("PathRequestQueue")
+    {
+        PathRequestQueue queue;
+
+        SECTION("serves a player's requests oldest first")
+        {
+            queue.push(pathRequestTestRequest(1, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(2, 0), GameTime(11));
+            queue.push(pathRequestTestRequest(3, 0), GameTime(11));
+
+            REQUIRE(pathRequestTestUnitIds(queue.takeBatch(10)) == std::vector<unsigned int>{1, 2, 3});
+            REQUIRE(queue.empty());
+        }
+
+        SECTION("replaces a unit's earlier request and moves it to the back")
+        {
+            queue.push(pathRequestTestRequest(1, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(2, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(1, 0), GameTime(12));
+
+            REQUIRE(queue.size() == 2);
+            REQUIRE(pathRequestTestUnitIds(queue.takeBatch(10)) == std::vector<unsigned int>{2, 1});
+            REQUIRE(!queue.contains(UnitId(1)));
+        }
+
+        SECTION("serves new goals and combat units ahead of slightly older replans")
+        {
+            queue.push(pathRequestTestRequest(1, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(2, 0, PathRequestReason::Replan, true), GameTime(12));
+            queue.push(pathRequestTestRequest(3, 0, PathRequestReason::NewGoal), GameTime(14));
+
+            REQUIRE(pathRequestTestUnitIds(queue.takeBatch(10)) == std::vector<unsigned int>{3, 2, 1});
+        }
+
+        SECTION("still serves replans that have waited long enough")
+        {
+            queue.push(pathRequestTestRequest(1, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(2, 0, PathRequestReason::NewGoal, true), GameTime(10 + PathRequestQueue::NewGoalPriorityTicks + PathRequestQueue::CombatUnitPriorityTicks + 1));
+
+            REQUIRE(pathRequestTestUnitIds(queue.takeBatch(1)) == std::vector<unsigned int>{1});
+        }
+
+        SECTION("players take turns")
+        {
+            for (unsigned int i = 0; i < 100; ++i)
+            {
+                queue.push(pathRequestTestRequest(i, 0), GameTime(10));
+            }
+            queue.push(pathRequestTestRequest(100, 1), GameTime(20));
+            queue.push(pathRequestTestRequest(101, 1), GameTime(20));
+
+            auto batch = queue.takeBatch(4);
+            REQUIRE(batch.size() == 4);
+            auto player1Count = std::count_if(batch.begin(), batch.end(), [](const auto& r) { return r.owner == PlayerId(1); });
+            REQUIRE(player1Count == 2);
+            REQUIRE(queue.size() == 98);
+        }
+
+        SECTION("lets a lone player fill the whole batch")
+        {
+            for (unsigned int i = 0; i < 10; ++i)
+            {
+                queue.push(pathRequestTestRequest(i, 0), GameTime(10));
+            }
+
+            REQUIRE(queue.takeBatch(8).size() == 8);
+            REQUIRE(queue.size() == 2);
+        }
+
+        SECTION("skips requests replaced after the unit changed owner")
+        {
+            queue.push(pathRequestTestRequest(1, 0), GameTime(10));
+            queue.push(pathRequestTestRequest(1, 1), GameTime(11));
+
+            REQUIRE(queue.size() == 1);
+            auto batch = queue.takeBatch(10);
+            REQUIRE(batch.size() == 1);
+            REQUIRE(batch[0].owner == PlayerId(1));
+            REQUIRE(queue.empty());
+        }
+
+        SECTION("takes the same batches given the same requests")
+        {
+            PathRequestQueue other;
+            for (unsigned int i = 0; i < 30; ++i)
+            {
+                auto request = pathRequestTestRequest(i % 20, i % 3, i % 4 == 0 ? PathRequestReason::NewGoal : PathRequestReason::Replan, i % 5 == 0);
+                queue.push(request, GameTime(i / 2));
+                other.push(request, GameTime(i / 2));
+            }
+
+            while (!queue.empty())
+            {
+                REQUIRE(pathRequestTestUnitIds(queue.takeBatch(5)) == pathRequestTestUnitIds(other.takeBatch(5)));
+            }
+            REQUIRE(other.empty());
+        }
+    }
+}
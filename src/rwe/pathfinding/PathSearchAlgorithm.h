@@ -0,0 +1,13 @@
+#pragma once
+
+namespace rwe
+{
+    enum class PathSearchAlgorithm
+    {
+        /** Plain A*, which expands every cell it reaches. */
+        AStar,
+
+        /** Jump point search, which skips across open areas of uniform cost. */
+        JumpPoint
+    };
+}
@@ -0,0 +1,99 @@
+#include "PathSearchWorkerPool.h"
+#include <stdexcept>
+
+namespace rwe
+{
+    PathSearchWorkerPool::Batch::Batch(std::function<void()>&& prepare, std::vector<Task>&& tasks)
+        : prepare(std::move(prepare)), tasks(std::move(tasks)), remainingTasks(this->tasks.size())
+    {
+    }
+
+    PathSearchWorkerPool::PathSearchWorkerPool(unsigned int threadCount)
+    {
+        if (threadCount == 0)
+        {
+            throw std::logic_error("Worker pool requires at least one thread");
+        }
+
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    PathSearchWorkerPool::~PathSearchWorkerPool()
+    {
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::shared_ptr<PathSearchWorkerPool::Batch> PathSearchWorkerPool::submit(std::function<void()> prepare, std::vector<Task> tasks)
+    {
+        if (tasks.empty())
+        {
+            throw std::logic_error("Cannot submit an empty batch");
+        }
+
+        auto batch = std::make_shared<Batch>(std::move(prepare), std::move(tasks));
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            batches.push_back(batch);
+        }
+        workAvailable.notify_all();
+        return batch;
+    }
+
+    void PathSearchWorkerPool::wait(const Batch& batch)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchFinished.wait(lock, [&]() { return batch.finished; });
+    }
+
+    void PathSearchWorkerPool::run()
+    {
+        PathSearcher searcher;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            workAvailable.wait(lock, [&]() {
+                return stopping || (!batches.empty() && batches.front()->nextTask < batches.front()->tasks.size());
+            });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            auto batch = batches.front();
+            if (batch->nextTask == 0 && batch->prepare)
+            {
+                // Run while holding the lock so that no other worker
+                // can start one of this batch's tasks in the meantime.
+                batch->prepare();
+            }
+
+            auto taskIndex = batch->nextTask++;
+
+            lock.unlock();
+            batch->tasks[taskIndex](searcher);
+            lock.lock();
+
+            if (--batch->remainingTasks == 0)
+            {
+                batch->finished = true;
+                batches.pop_front();
+                batchFinished.notify_all();
+                workAvailable.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <rwe/pathfinding/PathSearcher.h>
+#include <thread>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Runs batches of path searches on a fixed set of worker threads.
+     *
+     * Batches are run one at a time in the order they were submitted.
+     * A batch's prepare function is run before any of its tasks,
+     * and only once every task of the previous batch has finished.
+     * The tasks within a batch run in parallel,
+     * each given the PathSearcher belonging to the worker running it.
+     */
+    class PathSearchWorkerPool
+    {
+    public:
+        using Task = std::function<void(PathSearcher&)>;
+
+        class Batch
+        {
+        private:
+            friend class PathSearchWorkerPool;
+
+            std::function<void()> prepare;
+            std::vector<Task> tasks;
+            std::size_t nextTask{0};
+            std::size_t remainingTasks;
+            bool finished{false};
+
+        public:
+            Batch(std::function<void()>&& prepare, std::vector<Task>&& tasks);
+        };
+
+    private:
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable batchFinished;
+        std::deque<std::shared_ptr<Batch>> batches;
+        bool stopping{false};
+        std::vector<std::thread> threads;
+
+    public:
+        explicit PathSearchWorkerPool(unsigned int threadCount);
+
+        PathSearchWorkerPool(const PathSearchWorkerPool&) = delete;
+        PathSearchWorkerPool& operator=(const PathSearchWorkerPool&) = delete;
+
+        /**
+         * Waits for any running tasks to finish and stops the workers.
+         * Batches that have not yet started are abandoned.
+         */
+        ~PathSearchWorkerPool();
+
+        /** The batch must contain at least one task. */
+        std::shared_ptr<Batch> submit(std::function<void()> prepare, std::vector<Task> tasks);
+
+        /** Blocks until every task in the batch has finished. */
+        void wait(const Batch& batch);
+
+    private:
+        void run();
+    };
+}
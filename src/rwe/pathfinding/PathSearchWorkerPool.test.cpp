@@ -0,0 +1,73 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <rwe/pathfinding/PathSearchWorkerPool.h>
+#include <string>
+
+namespace rwe
+{
+    TEST_CASE("PathSearchWorkerPool")
+    {
+        PathSearchWorkerPool pool(4);
+
+        SECTION("runs every task in a batch")
+        {
+            std::vector<int> results(100, 0);
+            std::vector<PathSearchWorkerPool::Task> tasks;
+            for (int i = 0; i < 100; ++i)
+            {
+                tasks.emplace_back([&results, i](PathSearcher&) { results[i] = i * 2; });
+            }
+
+            auto batch = pool.submit(nullptr, std::move(tasks));
+            pool.wait(*batch);
+
+            for (int i = 0; i < 100; ++i)
+            {
+                REQUIRE(results[i] == i * 2);
+            }
+        }
+
+        SECTION("runs prepare before the batch's tasks and after the previous batch's tasks")
+        {
+            std::mutex mutex;
+            std::vector<std::string> log;
+            auto record = [&](const std::string& entry) {
+                std::scoped_lock<std::mutex> lock(mutex);
+                log.push_back(entry);
+            };
+
+            std::vector<std::shared_ptr<PathSearchWorkerPool::Batch>> batches;
+            for (int b = 0; b < 10; ++b)
+            {
+                std::vector<PathSearchWorkerPool::Task> tasks;
+                for (int i = 0; i < 8; ++i)
+                {
+                    tasks.emplace_back([&record, b](PathSearcher&) { record("task " + std::to_string(b)); });
+                }
+                batches.push_back(pool.submit([&record, b]() { record("prepare " + std::to_string(b)); }, std::move(tasks)));
+            }
+
+            pool.wait(*batches.back());
+
+            std::vector<std::string> expected;
+            for (int b = 0; b < 10; ++b)
+            {
+                expected.push_back("prepare " + std::to_string(b));
+                for (int i = 0; i < 8; ++i)
+                {
+                    expected.push_back("task " + std::to_string(b));
+                }
+            }
+            REQUIRE(log == expected);
+        }
+
+        SECTION("wait returns immediately for a finished batch")
+        {
+            std::atomic<int> count{0};
+            auto batch = pool.submit(nullptr, {[&count](PathSearcher&) { ++count; }});
+            pool.wait(*batch);
+            pool.wait(*batch);
+            REQUIRE(count == 1);
+        }
+    }
+}
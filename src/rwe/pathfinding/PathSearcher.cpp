@@ -0,0 +1,342 @@
+#include "PathSearcher.h"
+#include <algorithm>
+#include <rwe/pathfinding/UnitJumpPointPathFinder.h>
+#include <rwe/pathfinding/UnitPathFinder.h>
+#include <rwe/pathfinding/UnitPathRepairer.h>
+#include <rwe/pathfinding/UnitPerimeterPathFinder.h>
+#include <rwe/pathfinding/pathfinding_utils.h>
+#include <rwe/util/match.h>
+
+namespace rwe
+{
+    /**
+     * Searches where the goal is at least this many cells away
+     * are routed through the hierarchical graph first.
+     */
+    static const int HierarchicalSearchMinDistance = 2 * HierarchicalPathGraph::ClusterSize;
+
+    PathSearchResult PathSearcher::search(const PathSearchContext& context, const PathSearchJob& job)
+    {
+        PathSearchResult result;
+        result.path = match(
+            job.destination,
+            [&](const SimVector& destination) {
+                return findPath(context, job, destination, result.debugInfo);
+            },
+            [&](const DiscreteRect&) {
+                return findPerimeterPath(context, job, result.debugInfo);
+            });
+        return result;
+    }
+
+    UnitPath PathSearcher::findPerimeterPath(const PathSearchContext& context, const PathSearchJob& job, PathFindingDebugInfo& debugInfo)
+    {
+        const auto& start = job.start;
+
+        UnitPerimeterPathFinder pathFinder(&searchWorkspace, context.snapshot, context.collisionService, job.unitId, job.movementClassId, start.width, start.height, job.goal);
+
+        auto path = pathFinder.findPath(Point(start.x, start.y));
+        recordDebugInfo(path, debugInfo);
+
+        assert(path.path.size() >= 1);
+
+        if (path.path.size() == 1)
+        {
+            // The path is trivial, we are already at the goal.
+            return UnitPath{std::vector<SimVector>{job.startPosition}};
+        }
+
+        auto simplifiedPath = runSimplifyPath(path.path);
+
+        std::vector<SimVector> waypoints;
+        for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
+        {
+            waypoints.push_back(getWorldCenter(*context.terrain, DiscreteRect(it->x, it->y, start.width, start.height)));
+        }
+
+        return UnitPath{std::move(waypoints)};
+    }
+
+    UnitPath PathSearcher::findPath(const PathSearchContext& context, const PathSearchJob& job, const SimVector& destination, PathFindingDebugInfo& debugInfo)
+    {
+        const auto& start = job.start;
+        const auto& goal = job.goal;
+
+        Point startPoint(start.x, start.y);
+        Point goalPoint(goal.x, goal.y);
+
+        std::optional<GridAStarPathInfo<PathCost>> foundPath;
+        if (!job.repairCells.empty())
+        {
+            foundPath = repairPath(context, job, debugInfo);
+        }
+
+        if (!foundPath && job.movementClassId && startPoint.maxSingleDimensionDistance(goalPoint) >= HierarchicalSearchMinDistance)
+        {
+            foundPath = findHierarchicalPath(context, job, *job.movementClassId, debugInfo);
+        }
+
+        if (!foundPath)
+        {
+            unsigned int scannedCellCount = 0;
+            foundPath = findDirectPath(context, job, start, goalPoint, scannedCellCount);
+            recordDebugInfo(*foundPath, debugInfo);
+            debugInfo.scannedCellCount = scannedCellCount;
+        }
+
+        auto& path = *foundPath;
+
+        if (path.type == AStarPathType::Partial)
+        {
+            path.path.emplace_back(goal.x, goal.y);
+        }
+
+        auto unitPath = toUnitPath(*context.terrain, job, path.path, destination);
+        if (path.type == AStarPathType::Partial)
+        {
+            // The last step jumps straight to the goal,
+            // so there is no real path to repair.
+            unitPath.cells.clear();
+        }
+
+        return unitPath;
+    }
+
+    std::optional<GridAStarPathInfo<PathCost>> PathSearcher::repairPath(const PathSearchContext& context, const PathSearchJob& job, PathFindingDebugInfo& debugInfo)
+    {
+        // The path no longer leads to the goal if the destination has moved.
+        auto cells = fillPathGaps(job.repairCells);
+        if (cells.back() != Point(job.goal.x, job.goal.y))
+        {
+            return std::nullopt;
+        }
+
+        const auto& start = job.start;
+        UnitPathRepairer repairer(&searchWorkspace, context.snapshot, context.collisionService, job.unitId, job.movementClassId, start.width, start.height);
+        auto path = repairer.repairPath(Point(start.x, start.y), cells);
+        if (!path)
+        {
+            return std::nullopt;
+        }
+
+        recordDebugInfo(*path, debugInfo);
+        debugInfo.repaired = true;
+        return path;
+    }
+
+    PathSearchGroupResult PathSearcher::searchGroup(const PathSearchContext& context, const std::vector<PathSearchJob>& jobs, std::shared_ptr<const FlowField> flowField)
+    {
+        PathSearchGroupResult result;
+        result.results.reserve(jobs.size());
+
+        // The cost of computing the field is shared by every unit that uses it.
+        unsigned int expandedVertexCount = 0;
+        if (!flowField)
+        {
+            flowField = std::make_shared<const FlowField>(computeFlowField(context, jobs));
+            expandedVertexCount = flowField->getReachedCellCount();
+        }
+
+        for (const auto& job : jobs)
+        {
+            const auto& destination = std::get<SimVector>(job.destination);
+            auto cells = flowField->findPath(Point(job.start.x, job.start.y));
+            if (!cells)
+            {
+                result.results.push_back(search(context, job));
+                continue;
+            }
+
+            PathSearchResult jobResult;
+            jobResult.debugInfo.path = *cells;
+            jobResult.debugInfo.expandedVertexCount = expandedVertexCount;
+            jobResult.path = toUnitPath(*context.terrain, job, *cells, destination);
+            result.results.push_back(std::move(jobResult));
+        }
+
+        result.flowField = std::move(flowField);
+        return result;
+    }
+
+    FlowField PathSearcher::computeFlowField(const PathSearchContext& context, const std::vector<PathSearchJob>& jobs)
+    {
+        const auto& firstJob = jobs.front();
+        auto movementClassId = *firstJob.movementClassId;
+        auto footprintX = firstJob.start.width;
+        auto footprintZ = firstJob.start.height;
+
+        // Units in the group do not block each other,
+        // since they will all move off along the field together.
+        std::vector<UnitId> groupUnits;
+        for (const auto& job : jobs)
+        {
+            groupUnits.push_back(job.unitId);
+        }
+        std::sort(groupUnits.begin(), groupUnits.end());
+
+        auto isWalkable = [&](const Point& p) {
+            return context.collisionService->isWalkable(movementClassId, p)
+                && !context.snapshot->isCollisionAt(DiscreteRect(p.x, p.y, footprintX, footprintZ), groupUnits);
+        };
+        auto isRoughTerrain = [&](const Point& p) {
+            return context.snapshot->isAdjacentToStaticObstacle(DiscreteRect(p.x, p.y, footprintX, footprintZ));
+        };
+
+        std::vector<Point> starts;
+        for (const auto& job : jobs)
+        {
+            starts.emplace_back(job.start.x, job.start.y);
+        }
+
+        return FlowField::compute(
+            context.snapshot->getWidth(),
+            context.snapshot->getHeight(),
+            Point(firstJob.goal.x, firstJob.goal.y),
+            starts,
+            isWalkable,
+            isRoughTerrain);
+    }
+
+    UnitPath PathSearcher::toUnitPath(const MapTerrain& terrain, const PathSearchJob& job, const std::vector<Point>& cells, const SimVector& destination)
+    {
+        assert(cells.size() >= 1);
+
+        if (cells.size() == 1)
+        {
+            // The path is trivial, we are already at the goal.
+            return UnitPath{std::vector<SimVector>{destination}};
+        }
+
+        auto simplifiedPath = runSimplifyPath(cells);
+
+        std::vector<SimVector> waypoints;
+        for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
+        {
+            waypoints.push_back(getWorldCenter(terrain, DiscreteRect(it->x, it->y, job.start.width, job.start.height)));
+        }
+        waypoints.back() = destination;
+
+        return UnitPath{std::move(waypoints), std::move(simplifiedPath)};
+    }
+
+    GridAStarPathInfo<PathCost> PathSearcher::findDirectPath(
+        const PathSearchContext& context,
+        const PathSearchJob& job,
+        const DiscreteRect& start,
+        const Point& goal,
+        unsigned int& scannedCellCount)
+    {
+        Point startPoint(start.x, start.y);
+
+        if (job.algorithm == PathSearchAlgorithm::JumpPoint)
+        {
+            UnitJumpPointPathFinder pathFinder(&searchWorkspace, context.snapshot, context.collisionService, job.unitId, job.movementClassId, start.width, start.height, goal);
+            auto path = pathFinder.findPath(startPoint);
+            path.path = fillPathGaps(path.path);
+            scannedCellCount += pathFinder.getScannedCellCount();
+            return path;
+        }
+
+        UnitPathFinder pathFinder(&searchWorkspace, context.snapshot, context.collisionService, job.unitId, job.movementClassId, start.width, start.height, goal);
+        return pathFinder.findPath(startPoint);
+    }
+
+    std::optional<GridAStarPathInfo<PathCost>> PathSearcher::findHierarchicalPath(const PathSearchContext& context, const PathSearchJob& job, MovementClassId movementClassId, PathFindingDebugInfo& debugInfo)
+    {
+        const auto& start = job.start;
+        Point goal(job.goal.x, job.goal.y);
+
+        // The abstract graph only considers terrain and static obstacles.
+        // Mobile units are avoided when the route is refined.
+        auto isWalkable = [&](const Point& p) {
+            return context.collisionService->isWalkable(movementClassId, p)
+                && !context.snapshot->isStaticCollisionAt(DiscreteRect(p.x, p.y, start.width, start.height));
+        };
+
+        std::optional<std::vector<Point>> route;
+        {
+            // The graph builds clusters as the search reaches them,
+            // so searches sharing it must take turns.
+            std::scoped_lock<std::mutex> lock(context.hierarchicalGraphs->mutex);
+            auto& graphs = context.hierarchicalGraphs->graphs;
+            auto it = graphs.find(movementClassId);
+            if (it == graphs.end())
+            {
+                const auto& walkableGrid = context.collisionService->getGrid(movementClassId);
+                it = graphs.try_emplace(movementClassId, walkableGrid.getWidth(), walkableGrid.getHeight(), start.width, start.height).first;
+            }
+
+            route = it->second.findPath(Point(start.x, start.y), goal, isWalkable);
+        }
+
+        if (!route)
+        {
+            return std::nullopt;
+        }
+
+        GridAStarPathInfo<PathCost> result{AStarPathType::Complete, std::vector<Point>{route->front()}, 0};
+        unsigned int scannedCellCount = 0;
+        debugInfo.expandedEdges.clear();
+
+        for (auto it = ++route->cbegin(); it != route->cend(); ++it)
+        {
+            auto from = result.path.back();
+            if (from.maxSingleDimensionDistance(*it) <= 1)
+            {
+                // a single step across a cluster border
+                result.path.push_back(*it);
+                continue;
+            }
+
+            auto segment = findDirectPath(context, job, DiscreteRect(from.x, from.y, start.width, start.height), *it, scannedCellCount);
+            appendDebugEdges(debugInfo);
+            result.expandedVertexCount += segment.expandedVertexCount;
+            result.path.insert(result.path.end(), ++segment.path.cbegin(), segment.path.cend());
+
+            if (segment.type == AStarPathType::Partial)
+            {
+                result.type = AStarPathType::Partial;
+                break;
+            }
+        }
+
+        debugInfo.type = result.type;
+        debugInfo.path = result.path;
+        debugInfo.expandedVertexCount = result.expandedVertexCount;
+        debugInfo.scannedCellCount = scannedCellCount;
+
+        return result;
+    }
+
+    void PathSearcher::recordDebugInfo(const GridAStarPathInfo<PathCost>& pathInfo, PathFindingDebugInfo& debugInfo) const
+    {
+        debugInfo.type = pathInfo.type;
+        debugInfo.path = pathInfo.path;
+        debugInfo.expandedVertexCount = pathInfo.expandedVertexCount;
+        debugInfo.scannedCellCount = 0;
+        debugInfo.expandedEdges.clear();
+        appendDebugEdges(debugInfo);
+    }
+
+    void PathSearcher::appendDebugEdges(PathFindingDebugInfo& debugInfo) const
+    {
+        searchWorkspace.forEachClosedVertex([&](const Point& vertex, const std::optional<Point>& predecessor) {
+            if (predecessor)
+            {
+                debugInfo.expandedEdges.emplace_back(*predecessor, vertex);
+            }
+        });
+    }
+
+    SimVector PathSearcher::getWorldCenter(const MapTerrain& terrain, const DiscreteRect& rect)
+    {
+        auto corner = terrain.heightmapIndexToWorldCorner(rect.x, rect.y);
+
+        auto halfWorldWidth = (SimScalar(rect.width) * MapTerrain::HeightTileWidthInWorldUnits) / 2_ss;
+        auto halfWorldHeight = (SimScalar(rect.height) * MapTerrain::HeightTileHeightInWorldUnits) / 2_ss;
+
+        auto center = corner + SimVector(halfWorldWidth, 0_ss, halfWorldHeight);
+        center.y = terrain.getHeightAt(center.x, center.z);
+        return center;
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <rwe/grid/DiscreteRect.h>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/FlowField.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/HierarchicalPathGraph.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
+#include <rwe/pathfinding/PathSearchAlgorithm.h>
+#include <rwe/pathfinding/UnitPath.h>
+#include <rwe/sim/MapTerrain.h>
+#include <rwe/sim/MovementClassCollisionService.h>
+#include <rwe/sim/MovementClassId.h>
+#include <rwe/sim/SimVector.h>
+#include <rwe/sim/UnitId.h>
+#include <rwe/sim/UnitState.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rwe
+{
+    struct PathFindingDebugInfo
+    {
+        AStarPathType type{AStarPathType::Complete};
+        std::vector<Point> path;
+
+        /** Each vertex expanded by the search, paired with the vertex it was reached from. */
+        std::vector<std::pair<Point, Point>> expandedEdges;
+
+        unsigned int expandedVertexCount{0};
+
+        /** The number of cells examined while jumping, for jump point searches. */
+        unsigned int scannedCellCount{0};
+
+        /** True if the path was made by repairing the unit's previous path. */
+        bool repaired{false};
+    };
+
+    /**
+     * Everything a search needs to know about the requesting unit,
+     * captured on the simulation thread when the search is dispatched.
+     */
+    struct PathSearchJob
+    {
+        UnitId unitId;
+        PathDestination destination;
+        SimVector startPosition;
+
+        /** The unit's footprint at its current position. */
+        DiscreteRect start;
+
+        /**
+         * For a position destination, the footprint at the destination.
+         * For a rect destination, the rect expanded by the unit's footprint.
+         */
+        DiscreteRect goal;
+
+        std::optional<MovementClassId> movementClassId;
+        PathSearchAlgorithm algorithm;
+
+        /**
+         * The rest of the unit's current path, as in UnitPath::cells,
+         * from the last cell it turned at.
+         * If not empty, the search first tries to repair this path.
+         */
+        std::vector<Point> repairCells{};
+    };
+
+    struct PathSearchResult
+    {
+        UnitPath path;
+        PathFindingDebugInfo debugInfo;
+    };
+
+    struct PathSearchGroupResult
+    {
+        /** The results for each job, in the order the jobs were given. */
+        std::vector<PathSearchResult> results;
+
+        /** The flow field that paths were read from. */
+        std::shared_ptr<const FlowField> flowField;
+    };
+
+    /**
+     * Abstract graphs for long distance searches, created on first use
+     * and shared by every searcher.
+     */
+    struct HierarchicalPathGraphs
+    {
+        std::mutex mutex;
+        std::unordered_map<MovementClassId, HierarchicalPathGraph> graphs;
+    };
+
+    /**
+     * The read-only state that searches run against.
+     * The collision service and terrain never change during a game,
+     * so they can be read from any thread.
+     */
+    struct PathSearchContext
+    {
+        const PathFindingSnapshot* snapshot;
+        const MovementClassCollisionService* collisionService;
+        const MapTerrain* terrain;
+        HierarchicalPathGraphs* hierarchicalGraphs;
+    };
+
+    /**
+     * Runs path searches for units.
+     * A searcher may be used by only one thread at a time.
+     */
+    class PathSearcher
+    {
+    private:
+        /** Search state reused between searches to avoid allocating per search. */
+        GridAStarWorkspace<PathCost> searchWorkspace;
+
+    public:
+        PathSearchResult search(const PathSearchContext& context, const PathSearchJob& job);
+
+        /**
+         * Searches for paths for a group of units of the same movement class
+         * heading to the same position destination.
+         * Paths are read from the given flow field, or from a new one if none is given.
+         * Units that the field does not reach are searched for individually.
+         */
+        PathSearchGroupResult searchGroup(const PathSearchContext& context, const std::vector<PathSearchJob>& jobs, std::shared_ptr<const FlowField> flowField);
+
+        static SimVector getWorldCenter(const MapTerrain& terrain, const DiscreteRect& discreteRect);
+
+        /** Converts a path of cells into waypoints ending at the destination. */
+        static UnitPath toUnitPath(const MapTerrain& terrain, const PathSearchJob& job, const std::vector<Point>& cells, const SimVector& destination);
+
+    private:
+        /**
+         * Computes a flow field towards the goal of the given jobs
+         * that reaches the start of each job if possible.
+         * Mobile units other than those of the jobs block the field.
+         */
+        static FlowField computeFlowField(const PathSearchContext& context, const std::vector<PathSearchJob>& jobs);
+
+        UnitPath findPath(const PathSearchContext& context, const PathSearchJob& job, const SimVector& destination, PathFindingDebugInfo& debugInfo);
+
+        /**
+         * Repairs the job's previous path with UnitPathRepairer.
+         * Returns nullopt if it cannot be repaired.
+         */
+        std::optional<GridAStarPathInfo<PathCost>> repairPath(const PathSearchContext& context, const PathSearchJob& job, PathFindingDebugInfo& debugInfo);
+
+        UnitPath findPerimeterPath(const PathSearchContext& context, const PathSearchJob& job, PathFindingDebugInfo& debugInfo);
+
+        /**
+         * Searches for a path with the given algorithm.
+         * Jump point paths are filled in so that consecutive cells are adjacent.
+         * The number of cells scanned by a jump point search is added to scannedCellCount.
+         */
+        GridAStarPathInfo<PathCost> findDirectPath(
+            const PathSearchContext& context,
+            const PathSearchJob& job,
+            const DiscreteRect& start,
+            const Point& goal,
+            unsigned int& scannedCellCount);
+
+        /**
+         * Finds a route through the movement class's abstract graph
+         * and refines it by searching between consecutive portals.
+         * Returns nullopt if the abstract graph has no route to the goal.
+         */
+        std::optional<GridAStarPathInfo<PathCost>> findHierarchicalPath(const PathSearchContext& context, const PathSearchJob& job, MovementClassId movementClassId, PathFindingDebugInfo& debugInfo);
+
+        void recordDebugInfo(const GridAStarPathInfo<PathCost>& pathInfo, PathFindingDebugInfo& debugInfo) const;
+
+        void appendDebugEdges(PathFindingDebugInfo& debugInfo) const;
+    };
+}
@@ -0,0 +1,52 @@
+#include "UnitJumpPointPathFinder.h"
+
+namespace rwe
+{
+    bool UnitJumpPointPathFinder::Terrain::isWalkable(const Point& p) const
+    {
+        return finder->isWalkable(p);
+    }
+
+    bool UnitJumpPointPathFinder::Terrain::isRoughTerrain(const Point& p) const
+    {
+        return finder->isRoughTerrain(p);
+    }
+
+    bool UnitJumpPointPathFinder::Terrain::isGoal(const Point& p) const
+    {
+        return finder->isGoal(p);
+    }
+
+    UnitJumpPointPathFinder::UnitJumpPointPathFinder(
+        Workspace* workspace,
+        const PathFindingSnapshot* snapshot,
+        const MovementClassCollisionService* collisionService,
+        UnitId self,
+        std::optional<MovementClassId> movementClass,
+        unsigned int footprintX,
+        unsigned int footprintZ,
+        const Point& goal)
+        : UnitPathFinder(
+            workspace,
+            snapshot,
+            collisionService,
+            self,
+            movementClass,
+            footprintX,
+            footprintZ,
+            goal),
+          terrain{this},
+          successorGenerator(&terrain)
+    {
+    }
+
+    unsigned int UnitJumpPointPathFinder::getScannedCellCount() const
+    {
+        return successorGenerator.getScannedCellCount();
+    }
+
+    void UnitJumpPointPathFinder::getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors)
+    {
+        successorGenerator.getSuccessors(vertex, predecessor, costToReach, successors);
+    }
+}
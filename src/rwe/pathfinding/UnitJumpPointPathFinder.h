@@ -0,0 +1,53 @@
+#pragma once
+
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/JumpPointSearch.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
+#include <rwe/pathfinding/UnitPathFinder.h>
+#include <rwe/sim/MovementClassCollisionService.h>
+#include <rwe/sim/UnitId.h>
+
+namespace rwe
+{
+    /**
+     * Unit pathfinder that uses jump point search
+     * to skip across open areas of uniform cost.
+     * Consecutive vertices of the returned path may be several cells apart,
+     * see fillPathGaps.
+     */
+    class UnitJumpPointPathFinder : public UnitPathFinder
+    {
+    private:
+        struct Terrain
+        {
+            UnitJumpPointPathFinder* finder;
+
+            bool isWalkable(const Point& p) const;
+
+            bool isRoughTerrain(const Point& p) const;
+
+            bool isGoal(const Point& p) const;
+        };
+
+        Terrain terrain;
+        JumpPointSuccessorGenerator<Terrain> successorGenerator;
+
+    public:
+        UnitJumpPointPathFinder(
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
+            const MovementClassCollisionService* collisionService,
+            UnitId self,
+            std::optional<MovementClassId> movementClass,
+            unsigned int footprintX,
+            unsigned int footprintZ,
+            const Point& goal);
+
+        /** The number of cells examined while jumping. */
+        unsigned int getScannedCellCount() const;
+
+    protected:
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override;
+    };
+}
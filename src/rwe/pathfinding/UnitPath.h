@@ -1,11 +1,22 @@
 #pragma once
 
+#include <rwe/grid/Point.h>
 #include <rwe/sim/SimVector.h>
+#include <vector>
 
 namespace rwe
 {
     struct UnitPath
     {
         std::vector<SimVector> waypoints;
+
+        /**
+         * The cells of the path where it changes direction,
+         * beginning with the cell it starts from,
+         * so that waypoints[i] is the waypoint for cells[i + 1].
+         * Empty if the path cannot be repaired,
+         * such as when it is only a partial path.
+         */
+        std::vector<Point> cells{};
     };
 }
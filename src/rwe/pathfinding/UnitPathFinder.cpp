@@ -3,7 +3,8 @@
 namespace rwe
 {
     UnitPathFinder::UnitPathFinder(
-        const GameSimulation* simulation,
+        Workspace* workspace,
+        const PathFindingSnapshot* snapshot,
         const MovementClassCollisionService* collisionService,
         UnitId self,
         std::optional<MovementClassId> movementClass,
@@ -11,7 +12,8 @@ namespace rwe
         unsigned int footprintZ,
         const Point& goal)
         : AbstractUnitPathFinder(
-            simulation,
+            workspace,
+            snapshot,
             collisionService,
             self,
             movementClass,
@@ -3,7 +3,7 @@
 #include <rwe/grid/Point.h>
 #include <rwe/pathfinding/AbstractUnitPathFinder.h>
 #include <rwe/pathfinding/PathCost.h>
-#include <rwe/sim/GameSimulation.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
 #include <rwe/sim/MovementClassCollisionService.h>
 #include <rwe/sim/UnitId.h>
 
@@ -19,7 +19,8 @@ namespace rwe
 
     public:
         UnitPathFinder(
-            const GameSimulation* simulation,
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
             const MovementClassCollisionService* collisionService,
             UnitId self,
             std::optional<MovementClassId> movementClass,
@@ -0,0 +1,143 @@
+#include "UnitPathRepairer.h"
+#include <algorithm>
+#include <rwe/pathfinding/UnitPathFinder.h>
+
+namespace rwe
+{
+    /**
+     * Unit pathfinder that never leaves a window of the grid.
+     */
+    class WindowedUnitPathFinder : public UnitPathFinder
+    {
+    private:
+        const DiscreteRect window;
+
+    public:
+        WindowedUnitPathFinder(
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
+            const MovementClassCollisionService* collisionService,
+            UnitId self,
+            std::optional<MovementClassId> movementClass,
+            unsigned int footprintX,
+            unsigned int footprintZ,
+            const Point& goal,
+            const DiscreteRect& window)
+            : UnitPathFinder(workspace, snapshot, collisionService, self, movementClass, footprintX, footprintZ, goal),
+              window(window)
+        {
+        }
+
+    protected:
+        void getSuccessors(const Point& vertex, const std::optional<Point>& predecessor, const PathCost& costToReach, Successors& successors) override
+        {
+            Successors unbounded;
+            UnitPathFinder::getSuccessors(vertex, predecessor, costToReach, unbounded);
+            for (const auto& s : unbounded)
+            {
+                if (window.contains(s.vertex))
+                {
+                    successors.push(s.vertex, s.costToReach);
+                }
+            }
+        }
+    };
+
+    UnitPathRepairer::UnitPathRepairer(
+        Workspace* workspace,
+        const PathFindingSnapshot* snapshot,
+        const MovementClassCollisionService* collisionService,
+        UnitId self,
+        std::optional<MovementClassId> movementClass,
+        unsigned int footprintX,
+        unsigned int footprintZ)
+        : workspace(workspace),
+          snapshot(snapshot),
+          collisionService(collisionService),
+          self(self),
+          movementClass(movementClass),
+          footprintX(footprintX),
+          footprintZ(footprintZ)
+    {
+    }
+
+    std::optional<GridAStarPathInfo<PathCost>> UnitPathRepairer::repairPath(const Point& start, const std::vector<Point>& path)
+    {
+        if (path.empty())
+        {
+            return std::nullopt;
+        }
+
+        // the cell on the path closest to the unit, furthest along on ties
+        auto distanceSquared = [&](const Point& p) {
+            auto d = p - start;
+            return (d.x * d.x) + (d.y * d.y);
+        };
+        std::size_t nearest = 0;
+        for (std::size_t i = 1; i < path.size(); ++i)
+        {
+            if (distanceSquared(path[i]) <= distanceSquared(path[nearest]))
+            {
+                nearest = i;
+            }
+        }
+
+        if (path[nearest].maxSingleDimensionDistance(start) > MaxStartDistance)
+        {
+            return std::nullopt;
+        }
+
+        std::size_t rejoin;
+        auto blocked = std::find_if(path.begin() + nearest + 1, path.end(), [&](const auto& p) { return !isWalkable(p); });
+        if (blocked == path.end())
+        {
+            // Nothing on the rest of the path is in the way,
+            // so the unit only needs to get back onto it.
+            rejoin = std::min(nearest + 1, path.size() - 1);
+        }
+        else
+        {
+            auto blockedIndex = static_cast<std::size_t>(blocked - path.begin());
+            auto last = std::min(blockedIndex + MaxDetourLength, path.size() - 1);
+            auto clear = std::find_if(path.begin() + blockedIndex + 1, path.begin() + last + 1, [&](const auto& p) { return isWalkable(p); });
+            if (clear == path.begin() + last + 1)
+            {
+                return std::nullopt;
+            }
+            rejoin = clear - path.begin();
+        }
+
+        auto minX = start.x;
+        auto minY = start.y;
+        auto maxX = start.x;
+        auto maxY = start.y;
+        for (auto i = nearest; i <= rejoin; ++i)
+        {
+            minX = std::min(minX, path[i].x);
+            minY = std::min(minY, path[i].y);
+            maxX = std::max(maxX, path[i].x);
+            maxY = std::max(maxY, path[i].y);
+        }
+        DiscreteRect window(
+            minX - WindowMargin,
+            minY - WindowMargin,
+            (maxX - minX) + 1 + (2 * WindowMargin),
+            (maxY - minY) + 1 + (2 * WindowMargin));
+
+        WindowedUnitPathFinder pathFinder(workspace, snapshot, collisionService, self, movementClass, footprintX, footprintZ, path[rejoin], window);
+        auto result = pathFinder.findPath(start);
+        if (result.type != AStarPathType::Complete)
+        {
+            return std::nullopt;
+        }
+
+        result.path.insert(result.path.end(), path.begin() + rejoin + 1, path.end());
+        return result;
+    }
+
+    bool UnitPathRepairer::isWalkable(const Point& p) const
+    {
+        DiscreteRect rect(p.x, p.y, footprintX, footprintZ);
+        return (movementClass ? collisionService->isWalkable(*movementClass, p) : true) && !snapshot->isCollisionAt(rect, self);
+    }
+}
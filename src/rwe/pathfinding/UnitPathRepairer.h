@@ -0,0 +1,73 @@
+#pragma once
+
+#include <optional>
+#include <rwe/grid/Point.h>
+#include <rwe/pathfinding/GridAStarPathFinder.h>
+#include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
+#include <rwe/sim/MovementClassCollisionService.h>
+#include <rwe/sim/MovementClassId.h>
+#include <rwe/sim/UnitId.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Repairs a unit's existing path when something gets in its way,
+     * rather than searching again from scratch.
+     *
+     * The unit's path is followed from the cell nearest the unit
+     * until the first cell that is no longer walkable.
+     * A search is then run from the unit to the first walkable cell beyond the blockage,
+     * confined to a window around the stretch of path being replaced,
+     * and the rest of the old path is kept as it was.
+     * If the unit has wandered away from its path,
+     * or no way around the blockage is found inside the window,
+     * the path cannot be repaired and the unit should search again.
+     */
+    class UnitPathRepairer
+    {
+    public:
+        using Workspace = GridAStarWorkspace<PathCost>;
+
+        /** The unit must be within this many cells of its path for the path to be repaired. */
+        static constexpr int MaxStartDistance = 3;
+
+        /** The furthest along the path past the first blocked cell that the path may be rejoined. */
+        static constexpr std::size_t MaxDetourLength = 32;
+
+        /** The number of cells around the replaced stretch of path that the search may use. */
+        static constexpr int WindowMargin = 8;
+
+    private:
+        Workspace* const workspace;
+        const PathFindingSnapshot* const snapshot;
+        const MovementClassCollisionService* const collisionService;
+        const UnitId self;
+        const std::optional<MovementClassId> movementClass;
+        const unsigned int footprintX;
+        const unsigned int footprintZ;
+
+    public:
+        UnitPathRepairer(
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
+            const MovementClassCollisionService* collisionService,
+            UnitId self,
+            std::optional<MovementClassId> movementClass,
+            unsigned int footprintX,
+            unsigned int footprintZ);
+
+        /**
+         * Repairs the path for a unit at the given start position.
+         * Consecutive cells of the path must be adjacent.
+         * Returns the whole repaired path, beginning at start,
+         * with the number of vertices expanded by the search around the blockage,
+         * or nullopt if the path cannot be repaired.
+         */
+        std::optional<GridAStarPathInfo<PathCost>> repairPath(const Point& start, const std::vector<Point>& path);
+
+    private:
+        bool isWalkable(const Point& p) const;
+    };
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <rwe/grid/Grid.h>
+#include <rwe/pathfinding/UnitPathRepairer.h>
+
+namespace rwe
+{
+    static std::vector<Point> unitPathRepairerTestLine(int y, int fromX, int toX)
+    {
+        std::vector<Point> path;
+        for (int x = fromX; x <= toX; ++x)
+        {
+            path.emplace_back(x, y);
+        }
+        return path;
+    }
+
+    static bool unitPathRepairerTestIsValidPath(const Grid<PathFindingSnapshot::Cell>& cells, const std::vector<Point>& path)
+    {
+        for (std::size_t i = 0; i < path.size(); ++i)
+        {
+            if (cells.get(path[i].x, path[i].y).staticCollision)
+            {
+                return false;
+            }
+            if (i > 0 && path[i - 1].maxSingleDimensionDistance(path[i]) != 1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TEST_CASE("UnitPathRepairer")
+    {
+        GridAStarWorkspace<PathCost> workspace;
+        MovementClassCollisionService collisionService;
+        Grid<PathFindingSnapshot::Cell> cells(64, 64);
+        auto path = unitPathRepairerTestLine(20, 2, 40);
+
+        auto repair = [&](const Point& start) {
+            auto cellsCopy = cells;
+            PathFindingSnapshot snapshot(std::move(cellsCopy));
+            UnitPathRepairer repairer(&workspace, &snapshot, &collisionService, UnitId(1), std::nullopt, 1, 1);
+            return repairer.repairPath(start, path);
+        };
+
+        SECTION("routes around a blockage and keeps the rest of the path")
+        {
+            for (int y = 18; y <= 22; ++y)
+            {
+                for (int x = 10; x <= 12; ++x)
+                {
+                    cells.set(x, y, PathFindingSnapshot::Cell{std::nullopt, true});
+                }
+            }
+
+            auto result = repair(Point(2, 20));
+            REQUIRE(result);
+            REQUIRE(result->type == AStarPathType::Complete);
+            REQUIRE(result->path.front() == Point(2, 20));
+            REQUIRE(result->path.back() == Point(40, 20));
+            REQUIRE(unitPathRepairerTestIsValidPath(cells, result->path));
+
+            // the end of the old path is kept as it was
+            auto tail = unitPathRepairerTestLine(20, 13, 40);
+            REQUIRE(std::equal(tail.rbegin(), tail.rend(), result->path.rbegin()));
+
+            // only the area around the blockage is searched
+            REQUIRE(result->expandedVertexCount < 200);
+        }
+
+        SECTION("leads back onto the path when nothing is in the way")
+        {
+            auto result = repair(Point(5, 22));
+            REQUIRE(result);
+            REQUIRE(result->path.front() == Point(5, 22));
+            REQUIRE(result->path.back() == Point(40, 20));
+            REQUIRE(unitPathRepairerTestIsValidPath(cells, result->path));
+            REQUIRE(result->path.size() < path.size());
+        }
+
+        SECTION("gives up when the unit is far from its path")
+        {
+            REQUIRE(!repair(Point(20, 40)));
+        }
+
+        SECTION("gives up when the path is blocked for too long")
+        {
+            for (int x = 5; x <= 5 + static_cast<int>(UnitPathRepairer::MaxDetourLength); ++x)
+            {
+                cells.set(x, 20, PathFindingSnapshot::Cell{std::nullopt, true});
+            }
+
+            REQUIRE(!repair(Point(2, 20)));
+        }
+
+        SECTION("gives up when there is no way around inside the window")
+        {
+            for (int y = 0; y < 64; ++y)
+            {
+                cells.set(10, y, PathFindingSnapshot::Cell{std::nullopt, true});
+            }
+
+            REQUIRE(!repair(Point(2, 20)));
+        }
+
+        SECTION("treats other units as obstacles but not itself")
+        {
+            cells.set(2, 20, PathFindingSnapshot::Cell{UnitId(1), false});
+            cells.set(8, 20, PathFindingSnapshot::Cell{UnitId(2), false});
+
+            auto result = repair(Point(2, 20));
+            REQUIRE(result);
+            REQUIRE(result->path.front() == Point(2, 20));
+            REQUIRE(std::find(result->path.begin(), result->path.end(), Point(8, 20)) == result->path.end());
+            REQUIRE(result->path.back() == Point(40, 20));
+        }
+    }
+}
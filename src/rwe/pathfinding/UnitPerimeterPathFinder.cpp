@@ -3,14 +3,16 @@
 namespace rwe
 {
     UnitPerimeterPathFinder::UnitPerimeterPathFinder(
-        const GameSimulation* simulation,
+        Workspace* workspace,
+        const PathFindingSnapshot* snapshot,
         const MovementClassCollisionService* collisionService,
         const UnitId& self,
         const std::optional<MovementClassId>& movementClass,
         unsigned int footprintX,
         unsigned int footprintZ,
         const DiscreteRect& goalRect)
-        : AbstractUnitPathFinder(simulation,
+        : AbstractUnitPathFinder(workspace,
+            snapshot,
             collisionService,
             self,
             movementClass,
@@ -17,7 +17,8 @@ namespace rwe
     protected:
     public:
         UnitPerimeterPathFinder(
-            const GameSimulation* simulation,
+            Workspace* workspace,
+            const PathFindingSnapshot* snapshot,
             const MovementClassCollisionService* collisionService,
             const UnitId& self,
             const std::optional<MovementClassId>& movementClass,
@@ -11,6 +11,28 @@ namespace rwe
         return output;
     }
 
+    std::vector<Point> fillPathGaps(const std::vector<Point>& input)
+    {
+        std::vector<Point> output;
+        if (input.empty())
+        {
+            return output;
+        }
+
+        output.push_back(input.front());
+        for (auto it = ++input.cbegin(); it != input.cend(); ++it)
+        {
+            auto delta = *it - output.back();
+            Point step((delta.x > 0) - (delta.x < 0), (delta.y > 0) - (delta.y < 0));
+            while (output.back() != *it)
+            {
+                output.push_back(output.back() + step);
+            }
+        }
+
+        return output;
+    }
+
     OctileDistance octileDistance(const Point& start, const Point& goal)
     {
         auto deltaX = static_cast<unsigned int>(std::abs(goal.x - start.x));
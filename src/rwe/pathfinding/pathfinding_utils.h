@@ -51,5 +51,11 @@ namespace rwe
 
     std::vector<Point> runSimplifyPath(const std::vector<Point>& input);
 
+    /**
+     * Inserts the cells between each pair of consecutive points.
+     * Consecutive points must lie on a common straight or diagonal line.
+     */
+    std::vector<Point> fillPathGaps(const std::vector<Point>& input);
+
     OctileDistance octileDistance(const Point& a, const Point& b);
 }
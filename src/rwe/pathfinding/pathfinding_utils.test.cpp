@@ -89,6 +89,30 @@ namespace rwe
         }
     }
 
+    TEST_CASE("fillPathGaps")
+    {
+        SECTION("fills in straight and diagonal segments")
+        {
+            std::vector<Point> v{
+                Point(0, 0),
+                Point(3, 0),
+                Point(1, 2),
+                Point(1, 2),
+            };
+
+            std::vector<Point> expected{
+                Point(0, 0),
+                Point(1, 0),
+                Point(2, 0),
+                Point(3, 0),
+                Point(2, 1),
+                Point(1, 2),
+            };
+
+            REQUIRE(fillPathGaps(v) == expected);
+        }
+    }
+
     TEST_CASE("octileDistance")
     {
         SECTION("returns octile distance between points")
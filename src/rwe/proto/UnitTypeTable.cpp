@@ -0,0 +1,54 @@
+#include "UnitTypeTable.h"
+#include <algorithm>
+#include <boost/crc.hpp>
+
+namespace rwe
+{
+    UnitTypeTable::UnitTypeTable(std::vector<std::string> names) : names(std::move(names))
+    {
+        std::sort(this->names.begin(), this->names.end());
+        this->names.erase(std::unique(this->names.begin(), this->names.end()), this->names.end());
+
+        for (unsigned int i = 0; i < this->names.size(); ++i)
+        {
+            ids.insert({this->names[i], i});
+        }
+    }
+
+    std::optional<unsigned int> UnitTypeTable::tryGetId(const std::string& name) const
+    {
+        auto it = ids.find(name);
+        if (it == ids.end())
+        {
+            return std::nullopt;
+        }
+
+        return it->second;
+    }
+
+    const std::string* UnitTypeTable::tryGetName(unsigned int id) const
+    {
+        if (id >= names.size())
+        {
+            return nullptr;
+        }
+
+        return &names[id];
+    }
+
+    const std::vector<std::string>& UnitTypeTable::getNames() const
+    {
+        return names;
+    }
+
+    std::uint32_t UnitTypeTable::computeChecksum() const
+    {
+        boost::crc_32_type crc;
+        for (const auto& name : names)
+        {
+            // include the terminator so that names cannot run together
+            crc.process_bytes(name.c_str(), name.size() + 1);
+        }
+        return crc.checksum();
+    }
+}
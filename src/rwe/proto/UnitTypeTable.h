@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Numbers the unit types of a game so that commands can refer to them
+     * by a small ID rather than by name when they are encoded.
+     *
+     * The names are sorted, so every peer that builds a table
+     * from the same unit definitions gives each type the same ID
+     * without the table having to be sent.
+     * Peers compare checksums at game start to make sure this is so.
+     */
+    class UnitTypeTable
+    {
+    private:
+        /** Sorted, indexed by ID. */
+        std::vector<std::string> names;
+
+        std::unordered_map<std::string, unsigned int> ids;
+
+    public:
+        UnitTypeTable() = default;
+
+        /** The names may be in any order. Duplicates are ignored. */
+        explicit UnitTypeTable(std::vector<std::string> names);
+
+        std::optional<unsigned int> tryGetId(const std::string& name) const;
+
+        /** Returns null if no unit type has the ID. */
+        const std::string* tryGetName(unsigned int id) const;
+
+        /** The names in ID order. */
+        const std::vector<std::string>& getNames() const;
+
+        /** A checksum of the names in ID order, for checking that two tables agree. */
+        std::uint32_t computeChecksum() const;
+    };
+}
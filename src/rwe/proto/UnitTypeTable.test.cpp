@@ -0,0 +1,35 @@
+#include <catch2/catch.hpp>
+#include <rwe/proto/UnitTypeTable.h>
+
+namespace rwe
+{
+    TEST_CASE("UnitTypeTable")
+    {
+        SECTION("numbers types in name order, whatever order they are given in")
+        {
+            UnitTypeTable a({"ARMSOLAR", "ARMCOM", "CORAK", "ARMCOM"});
+            UnitTypeTable b({"CORAK", "ARMSOLAR", "ARMCOM"});
+
+            REQUIRE(a.getNames() == std::vector<std::string>{"ARMCOM", "ARMSOLAR", "CORAK"});
+            REQUIRE(a.tryGetId("ARMCOM") == std::optional<unsigned int>(0));
+            REQUIRE(a.tryGetId("CORAK") == std::optional<unsigned int>(2));
+            REQUIRE(b.tryGetId("CORAK") == a.tryGetId("CORAK"));
+            REQUIRE(a.computeChecksum() == b.computeChecksum());
+        }
+
+        SECTION("looks up names by ID")
+        {
+            UnitTypeTable table({"ARMCOM", "CORAK"});
+            REQUIRE(*table.tryGetName(1) == "CORAK");
+            REQUIRE(table.tryGetName(2) == nullptr);
+            REQUIRE(!table.tryGetId("ARMPW"));
+        }
+
+        SECTION("tables with different types have different checksums")
+        {
+            UnitTypeTable a({"ARMCOM", "CORAK"});
+            UnitTypeTable b({"ARMCO", "MCORAK"});
+            REQUIRE(a.computeChecksum() != b.computeChecksum());
+        }
+    }
+}
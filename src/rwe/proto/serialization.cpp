@@ -1,332 +1,542 @@
 #include "serialization.h"
-
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <variant>
 
 namespace rwe
 {
-    class WriteAttackTargetVisitor
+    enum class CommandKind : unsigned int
     {
-    private:
-        proto::AttackOrder* cmd;
+        Pause = 0,
+        Unpause = 1,
+        Move = 2,
+        AttackUnit = 3,
+        AttackGround = 4,
+        Build = 5,
+        CompleteBuild = 6,
+        Guard = 7,
+        ModifyBuildQueue = 8,
+        Stop = 9,
+        SetFireOrders = 10,
+        SetOnOff = 11,
+    };
 
-    public:
-        explicit WriteAttackTargetVisitor(proto::AttackOrder& cmd) : cmd(&cmd) {}
+    // header byte layout
+    static const unsigned int KindMask = 0x0fu;
+    static const unsigned int FlagsShift = 4u;
+    static const unsigned int FlagsMask = 0x07u;
+    static const unsigned int RepeatBit = 0x80u;
 
-        void operator()(const SimVector& v)
-        {
-            auto& out = *cmd->mutable_ground();
-            serializeVector(v, out);
-        }
+    // issue order flags
+    static const unsigned int QueuedFlag = 0x01u;
+
+    // set on build and build queue commands whose unit type is written by name
+    static const unsigned int NamedUnitTypeFlag = 0x02u;
+
+    static unsigned int encodeZigzag(int value)
+    {
+        return (static_cast<unsigned int>(value) << 1u) ^ static_cast<unsigned int>(value >> 31);
+    }
+
+    static int decodeZigzag(unsigned int value)
+    {
+        return static_cast<int>((value >> 1u) ^ (~(value & 1u) + 1u));
+    }
 
-        void operator()(const UnitId& u)
+    std::size_t getVarintSize(unsigned int value)
+    {
+        std::size_t size = 1;
+        while (value >= 0x80u)
         {
-            cmd->set_unit(u.value);
+            value >>= 7u;
+            size += 1;
         }
-    };
+        return size;
+    }
 
-    class WriteUnitOrderVisitor
+    class CommandWriter
     {
     private:
-        proto::PlayerUnitCommand::IssueOrder* cmd;
+        std::string* out;
 
     public:
-        explicit WriteUnitOrderVisitor(proto::PlayerUnitCommand::IssueOrder& cmd) : cmd(&cmd) {}
+        explicit CommandWriter(std::string& out) : out(&out) {}
 
-        void operator()(const MoveOrder& o)
+        void writeByte(unsigned int value)
         {
-            auto& out = *cmd->mutable_move();
-            auto& dest = *out.mutable_destination();
-            serializeVector(o.destination, dest);
+            out->push_back(static_cast<char>(value & 0xffu));
         }
 
-        void operator()(const AttackOrder& o)
+        void writeVarint(unsigned int value)
         {
-            auto& out = *cmd->mutable_attack();
-            WriteAttackTargetVisitor visitor(out);
-            std::visit(visitor, o.target);
+            while (value >= 0x80u)
+            {
+                writeByte((value & 0x7fu) | 0x80u);
+                value >>= 7u;
+            }
+            writeByte(value);
         }
 
-        void operator()(const BuildOrder& o)
+        void writeSignedVarint(int value)
         {
-            auto& out = *cmd->mutable_build();
-            out.set_unit_type(o.unitType);
-            auto& pos = *out.mutable_position();
-            serializeVector(o.position, pos);
+            writeVarint(encodeZigzag(value));
         }
 
-        void operator()(const BuggerOffOrder&)
+        void writeString(const std::string& value)
         {
-            throw std::logic_error("Cannot serialize BuggerOffOrder");
+            writeVarint(static_cast<unsigned int>(value.size()));
+            out->append(value);
         }
 
-        void operator()(const CompleteBuildOrder& o)
+        /** Writes the ID if there is one, otherwise the name. */
+        void writeUnitType(const std::optional<unsigned int>& id, const std::string& name)
         {
-            auto& out = *cmd->mutable_complete_build();
-            out.set_unit(o.target.value);
+            if (id)
+            {
+                writeVarint(*id);
+            }
+            else
+            {
+                writeString(name);
+            }
         }
 
-        void operator()(const GuardOrder& o)
+        void writeVector(const SimVector& v)
+        {
+            const float components[3]{simScalarToFloat(v.x), simScalarToFloat(v.y), simScalarToFloat(v.z)};
+
+            unsigned int integralMask = 0;
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                if (isSmallInteger(components[i]))
+                {
+                    integralMask |= 1u << i;
+                }
+            }
+
+            writeByte(integralMask);
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                if (integralMask & (1u << i))
+                {
+                    writeSignedVarint(static_cast<int>(components[i]));
+                }
+                else
+                {
+                    writeFloat(components[i]);
+                }
+            }
+        }
+
+    private:
+        /** True if the value survives a round trip through an int, including its sign. */
+        static bool isSmallInteger(float f)
+        {
+            return std::trunc(f) == f
+                && std::abs(f) < 1048576.0f
+                && !(f == 0.0f && std::signbit(f));
+        }
+
+        void writeFloat(float f)
         {
-            auto& out = *cmd->mutable_guard();
-            out.set_unit(o.target.value);
+            std::uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            writeByte(bits);
+            writeByte(bits >> 8u);
+            writeByte(bits >> 16u);
+            writeByte(bits >> 24u);
         }
     };
 
-    class WriteUnitCommandVisitor
+    class CommandReader
     {
     private:
-        proto::PlayerUnitCommand* cmd;
+        const char* data;
+        std::size_t size;
+        std::size_t position{0};
 
     public:
-        explicit WriteUnitCommandVisitor(proto::PlayerUnitCommand& cmd) : cmd(&cmd) {}
+        CommandReader(const char* data, std::size_t size) : data(data), size(size) {}
 
-    public:
-        void operator()(const PlayerUnitCommand::IssueOrder& c)
+        bool atEnd() const
         {
-            auto& out = *cmd->mutable_order();
-            out.set_issue_kind(serializeIssueKind(c.issueKind));
-            WriteUnitOrderVisitor visitor(out);
-            std::visit(visitor, c.order);
+            return position == size;
         }
 
-        void operator()(const PlayerUnitCommand::ModifyBuildQueue& c)
+        unsigned int readByte()
         {
-            auto& out = *cmd->mutable_modify_build_queue();
-            out.set_count(c.count);
-            out.set_unit_type(c.unitType);
+            if (position >= size)
+            {
+                throw std::runtime_error("Unexpected end of command data");
+            }
+            return static_cast<unsigned char>(data[position++]);
         }
 
-        void operator()(const PlayerUnitCommand::Stop&)
+        unsigned int readVarint()
         {
-            cmd->mutable_stop();
+            unsigned int value = 0;
+            for (unsigned int shift = 0; shift < 35; shift += 7)
+            {
+                auto b = readByte();
+                value |= (b & 0x7fu) << shift;
+                if ((b & 0x80u) == 0)
+                {
+                    return value;
+                }
+            }
+
+            throw std::runtime_error("Varint in command data is too long");
         }
 
-        void operator()(const PlayerUnitCommand::SetFireOrders& c)
+        int readSignedVarint()
         {
-            auto& out = *cmd->mutable_set_fire_orders();
-            out.set_orders(serializeFireOrders(c.orders));
+            return decodeZigzag(readVarint());
         }
 
-        void operator()(const PlayerUnitCommand::SetOnOff& c)
+        std::string readString()
         {
-            auto& out = *cmd->mutable_set_on_off();
-            out.set_ison(c.on);
+            auto length = readVarint();
+            if (length > size - position)
+            {
+                throw std::runtime_error("String in command data runs past the end");
+            }
+            std::string value(data + position, length);
+            position += length;
+            return value;
         }
-    };
-
-    class WritePlayerCommandVisitor
-    {
-    private:
-        proto::PlayerCommand* cmd;
-
-    public:
-        explicit WritePlayerCommandVisitor(proto::PlayerCommand& cmd) : cmd(&cmd) {}
 
-    public:
-        void operator()(const PlayerUnitCommand& c)
+        std::string readUnitType(const UnitTypeTable& unitTypes, bool named)
         {
-            auto& out = *cmd->mutable_unit_command();
-            out.set_unit(c.unit.value);
-            WriteUnitCommandVisitor visitor(out);
-            std::visit(visitor, c.command);
+            if (named)
+            {
+                return readString();
+            }
+
+            auto name = unitTypes.tryGetName(readVarint());
+            if (name == nullptr)
+            {
+                throw std::runtime_error("Unknown unit type ID in command data");
+            }
+            return *name;
         }
 
-        void operator()(const PlayerPauseGameCommand&)
+        SimVector readVector()
         {
-            cmd->mutable_pause();
+            auto integralMask = readByte();
+            float components[3];
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                if (integralMask & (1u << i))
+                {
+                    components[i] = static_cast<float>(readSignedVarint());
+                }
+                else
+                {
+                    components[i] = readFloat();
+                }
+            }
+
+            return SimVector(floatToSimScalar(components[0]), floatToSimScalar(components[1]), floatToSimScalar(components[2]));
         }
 
-        void operator()(const PlayerUnpauseGameCommand&)
+    private:
+        float readFloat()
         {
-            cmd->mutable_unpause();
+            std::uint32_t bits = readByte();
+            bits |= readByte() << 8u;
+            bits |= readByte() << 16u;
+            bits |= readByte() << 24u;
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
         }
     };
 
-    void serializeVector(const SimVector& v, proto::SimVector& out)
+    static unsigned int makeHeader(CommandKind kind, unsigned int flags = 0)
     {
-        out.set_x(simScalarToFloat(v.x));
-        out.set_y(simScalarToFloat(v.y));
-        out.set_z(simScalarToFloat(v.z));
+        return static_cast<unsigned int>(kind) | ((flags & FlagsMask) << FlagsShift);
     }
 
-    proto::PlayerUnitCommand::IssueOrder::IssueKind
-    serializeIssueKind(const PlayerUnitCommand::IssueOrder::IssueKind& kind)
-    {
-        switch (kind)
-        {
-            case PlayerUnitCommand::IssueOrder::IssueKind::Immediate:
-                return proto::PlayerUnitCommand::IssueOrder::Immediate;
-            case PlayerUnitCommand::IssueOrder::IssueKind::Queued:
-                return proto::PlayerUnitCommand::IssueOrder::Queued;
-            default:
-                throw std::logic_error("Invalid IssueKind value");
-        }
-    }
-
-    proto::PlayerUnitCommand::SetFireOrders::FireOrders serializeFireOrders(const UnitFireOrders& orders)
+    static unsigned int serializeFireOrders(UnitFireOrders orders)
     {
         switch (orders)
         {
             case UnitFireOrders::HoldFire:
-                return proto::PlayerUnitCommand::SetFireOrders::HoldFire;
+                return 0;
             case UnitFireOrders::ReturnFire:
-                return proto::PlayerUnitCommand::SetFireOrders::ReturnFire;
+                return 1;
             case UnitFireOrders::FireAtWill:
-                return proto::PlayerUnitCommand::SetFireOrders::FireAtWill;
+                return 2;
             default:
                 throw std::logic_error("Invalid UnitFireOrders value");
         }
     }
 
-    void serializePlayerCommand(const PlayerCommand& command, proto::PlayerCommand& out)
+    static UnitFireOrders deserializeFireOrders(unsigned int orders)
     {
-        WritePlayerCommandVisitor visitor(out);
-        std::visit(visitor, command);
+        switch (orders)
+        {
+            case 0:
+                return UnitFireOrders::HoldFire;
+            case 1:
+                return UnitFireOrders::ReturnFire;
+            case 2:
+                return UnitFireOrders::FireAtWill;
+            default:
+                throw std::runtime_error("Failed to deserialize fire orders");
+        }
     }
 
-    std::vector<PlayerCommand> deserializeCommandSet(const proto::GameUpdateMessage_PlayerCommandSet& set)
+    class WriteUnitOrderVisitor
     {
-        std::vector<PlayerCommand> out;
+    private:
+        CommandWriter* writer;
+        const UnitTypeTable* unitTypes;
+        unsigned int flags;
+
+    public:
+        WriteUnitOrderVisitor(CommandWriter& writer, const UnitTypeTable& unitTypes, unsigned int flags) : writer(&writer), unitTypes(&unitTypes), flags(flags) {}
 
-        for (int i = 0; i < set.command_size(); ++i)
+        void operator()(const MoveOrder& o)
         {
-            out.push_back(deserializeCommand(set.command(i)));
+            writer->writeByte(makeHeader(CommandKind::Move, flags));
+            writer->writeVector(o.destination);
         }
 
-        return out;
-    }
+        void operator()(const AttackOrder& o)
+        {
+            if (auto unit = std::get_if<UnitId>(&o.target); unit != nullptr)
+            {
+                writer->writeByte(makeHeader(CommandKind::AttackUnit, flags));
+                writer->writeVarint(unit->value);
+            }
+            else
+            {
+                writer->writeByte(makeHeader(CommandKind::AttackGround, flags));
+                writer->writeVector(std::get<SimVector>(o.target));
+            }
+        }
 
-    PlayerCommand deserializeCommand(const proto::PlayerCommand& cmd)
-    {
-        if (cmd.has_pause())
+        void operator()(const BuildOrder& o)
         {
-            return PlayerPauseGameCommand();
+            auto id = unitTypes->tryGetId(o.unitType);
+            writer->writeByte(makeHeader(CommandKind::Build, flags | (id ? 0u : NamedUnitTypeFlag)));
+            writer->writeUnitType(id, o.unitType);
+            writer->writeVector(o.position);
         }
 
-        if (cmd.has_unpause())
+        void operator()(const BuggerOffOrder&)
         {
-            return PlayerUnpauseGameCommand();
+            throw std::logic_error("Cannot serialize BuggerOffOrder");
         }
 
-        if (cmd.has_unit_command())
+        void operator()(const CompleteBuildOrder& o)
         {
-            return deserializeUnitCommand(cmd.unit_command());
+            writer->writeByte(makeHeader(CommandKind::CompleteBuild, flags));
+            writer->writeVarint(o.target.value);
         }
 
-        throw std::runtime_error("Failed to deserialize command");
-    }
+        void operator()(const GuardOrder& o)
+        {
+            writer->writeByte(makeHeader(CommandKind::Guard, flags));
+            writer->writeVarint(o.target.value);
+        }
+    };
 
-    PlayerUnitCommand deserializeUnitCommand(const proto::PlayerUnitCommand& cmd)
+    class WriteUnitCommandVisitor
     {
-        if (cmd.has_order())
+    private:
+        CommandWriter* writer;
+        const UnitTypeTable* unitTypes;
+
+    public:
+        WriteUnitCommandVisitor(CommandWriter& writer, const UnitTypeTable& unitTypes) : writer(&writer), unitTypes(&unitTypes) {}
+
+        void operator()(const PlayerUnitCommand::IssueOrder& c)
         {
-            return PlayerUnitCommand(UnitId(cmd.unit()), deserializeIssueOrder(cmd.order()));
+            auto flags = c.issueKind == PlayerUnitCommand::IssueOrder::IssueKind::Queued ? QueuedFlag : 0u;
+            WriteUnitOrderVisitor visitor(*writer, *unitTypes, flags);
+            std::visit(visitor, c.order);
         }
 
-        if (cmd.has_modify_build_queue())
+        void operator()(const PlayerUnitCommand::ModifyBuildQueue& c)
         {
-            const auto& mod = cmd.modify_build_queue();
-            return PlayerUnitCommand(UnitId(cmd.unit()), PlayerUnitCommand::ModifyBuildQueue{mod.count(), mod.unit_type()});
+            auto id = unitTypes->tryGetId(c.unitType);
+            writer->writeByte(makeHeader(CommandKind::ModifyBuildQueue, id ? 0u : NamedUnitTypeFlag));
+            writer->writeSignedVarint(c.count);
+            writer->writeUnitType(id, c.unitType);
         }
 
-        if (cmd.has_stop())
+        void operator()(const PlayerUnitCommand::Stop&)
         {
-            return PlayerUnitCommand(UnitId(cmd.unit()), PlayerUnitCommand::Stop());
+            writer->writeByte(makeHeader(CommandKind::Stop));
         }
 
-        if (cmd.has_set_fire_orders())
+        void operator()(const PlayerUnitCommand::SetFireOrders& c)
         {
-            return PlayerUnitCommand(UnitId(cmd.unit()), PlayerUnitCommand::SetFireOrders{deserializeFireOrders(cmd.set_fire_orders().orders())});
+            writer->writeByte(makeHeader(CommandKind::SetFireOrders, serializeFireOrders(c.orders)));
         }
 
-        if (cmd.has_set_on_off())
+        void operator()(const PlayerUnitCommand::SetOnOff& c)
         {
-            return PlayerUnitCommand(UnitId(cmd.unit()), PlayerUnitCommand::SetOnOff{cmd.set_on_off().ison()});
+            writer->writeByte(makeHeader(CommandKind::SetOnOff, c.on ? 1u : 0u));
         }
+    };
 
-        throw std::runtime_error("Failed to deserialize unit command");
-    }
-
-    PlayerUnitCommand::IssueOrder deserializeIssueOrder(const proto::PlayerUnitCommand::IssueOrder& cmd)
-    {
-        return PlayerUnitCommand::IssueOrder(deserializeUnitOrder(cmd), deserializeIssueKind(cmd.issue_kind()));
-    }
-
-    PlayerUnitCommand::IssueOrder::IssueKind
-    deserializeIssueKind(const proto::PlayerUnitCommand::IssueOrder::IssueKind& kind)
+    static PlayerUnitCommand::Command readUnitCommandBody(CommandReader& reader, const UnitTypeTable& unitTypes, CommandKind kind, unsigned int flags)
     {
+        auto namedUnitType = (flags & NamedUnitTypeFlag) != 0;
+        auto issueKind = (flags & QueuedFlag) ? PlayerUnitCommand::IssueOrder::IssueKind::Queued : PlayerUnitCommand::IssueOrder::IssueKind::Immediate;
         switch (kind)
         {
-            case proto::PlayerUnitCommand::IssueOrder::Immediate:
-                return PlayerUnitCommand::IssueOrder::IssueKind::Immediate;
-            case proto::PlayerUnitCommand::IssueOrder::Queued:
-                return PlayerUnitCommand::IssueOrder::IssueKind::Queued;
+            case CommandKind::Move:
+                return PlayerUnitCommand::IssueOrder(MoveOrder(reader.readVector()), issueKind);
+            case CommandKind::AttackUnit:
+                return PlayerUnitCommand::IssueOrder(AttackOrder(UnitId(reader.readVarint())), issueKind);
+            case CommandKind::AttackGround:
+                return PlayerUnitCommand::IssueOrder(AttackOrder(reader.readVector()), issueKind);
+            case CommandKind::Build:
+            {
+                auto unitType = reader.readUnitType(unitTypes, namedUnitType);
+                auto position = reader.readVector();
+                return PlayerUnitCommand::IssueOrder(BuildOrder(unitType, position), issueKind);
+            }
+            case CommandKind::CompleteBuild:
+                return PlayerUnitCommand::IssueOrder(CompleteBuildOrder(UnitId(reader.readVarint())), issueKind);
+            case CommandKind::Guard:
+                return PlayerUnitCommand::IssueOrder(GuardOrder(UnitId(reader.readVarint())), issueKind);
+            case CommandKind::ModifyBuildQueue:
+            {
+                auto count = reader.readSignedVarint();
+                auto unitType = reader.readUnitType(unitTypes, namedUnitType);
+                return PlayerUnitCommand::ModifyBuildQueue{count, unitType};
+            }
+            case CommandKind::Stop:
+                return PlayerUnitCommand::Stop();
+            case CommandKind::SetFireOrders:
+                return PlayerUnitCommand::SetFireOrders{deserializeFireOrders(flags)};
+            case CommandKind::SetOnOff:
+                return PlayerUnitCommand::SetOnOff{(flags & 1u) != 0};
             default:
-                throw std::runtime_error("Failed to deserialize issue kind");
+                throw std::runtime_error("Failed to deserialize unit command");
         }
     }
 
-    UnitFireOrders deserializeFireOrders(const proto::PlayerUnitCommand::SetFireOrders::FireOrders& orders)
+    std::string serializeCommandSet(const std::vector<PlayerCommand>& commands, const UnitTypeTable& unitTypes)
     {
-        switch (orders)
+        std::string out;
+        CommandWriter writer(out);
+        writer.writeVarint(static_cast<unsigned int>(commands.size()));
+
+        unsigned int previousUnit = 0;
+        std::string previousBody;
+        std::string body;
+        for (const auto& command : commands)
         {
-            case proto::PlayerUnitCommand::SetFireOrders::HoldFire:
-                return UnitFireOrders::HoldFire;
-            case proto::PlayerUnitCommand::SetFireOrders::ReturnFire:
-                return UnitFireOrders::ReturnFire;
-            case proto::PlayerUnitCommand::SetFireOrders::FireAtWill:
-                return UnitFireOrders::FireAtWill;
-            default:
-                throw std::runtime_error("Failed to deserialize fire orders");
+            if (std::holds_alternative<PlayerPauseGameCommand>(command))
+            {
+                writer.writeByte(makeHeader(CommandKind::Pause));
+                continue;
+            }
+
+            if (std::holds_alternative<PlayerUnpauseGameCommand>(command))
+            {
+                writer.writeByte(makeHeader(CommandKind::Unpause));
+                continue;
+            }
+
+            const auto& unitCommand = std::get<PlayerUnitCommand>(command);
+
+            body.clear();
+            CommandWriter bodyWriter(body);
+            WriteUnitCommandVisitor visitor(bodyWriter, unitTypes);
+            std::visit(visitor, unitCommand.command);
+
+            auto unitDelta = static_cast<int>(unitCommand.unit.value - previousUnit);
+            previousUnit = unitCommand.unit.value;
+
+            if (body == previousBody)
+            {
+                writer.writeByte(RepeatBit);
+                writer.writeSignedVarint(unitDelta);
+                continue;
+            }
+
+            // the header byte goes before the unit ID, the rest of the body after it
+            writer.writeByte(static_cast<unsigned char>(body[0]));
+            writer.writeSignedVarint(unitDelta);
+            out.append(body, 1, std::string::npos);
+            std::swap(body, previousBody);
         }
+
+        return out;
     }
 
-    UnitOrder deserializeUnitOrder(const proto::PlayerUnitCommand::IssueOrder& cmd)
+    void deserializeCommandSet(const char* data, std::size_t size, const UnitTypeTable& unitTypes, std::vector<PlayerCommand>& out)
     {
-        if (cmd.has_move())
+        out.clear();
+
+        CommandReader reader(data, size);
+        auto count = reader.readVarint();
+        if (count > size)
         {
-            const auto& move = cmd.move();
-            return MoveOrder(deserializeVector(move.destination()));
+            // every command takes at least one byte
+            throw std::runtime_error("Command set claims more commands than it has bytes");
         }
 
-        if (cmd.has_attack())
+        out.reserve(count);
+
+        unsigned int previousUnit = 0;
+        std::optional<PlayerUnitCommand::Command> previousCommand;
+        for (unsigned int i = 0; i < count; ++i)
         {
-            const auto& attack = cmd.attack();
-            if (attack.has_unit())
+            auto header = reader.readByte();
+
+            if (header & RepeatBit)
             {
-                return AttackOrder(UnitId(attack.unit()));
+                if (!previousCommand)
+                {
+                    throw std::runtime_error("Repeated command has nothing to repeat");
+                }
+
+                previousUnit += static_cast<unsigned int>(reader.readSignedVarint());
+                out.emplace_back(PlayerUnitCommand(UnitId(previousUnit), *previousCommand));
+                continue;
             }
 
-            if (attack.has_ground())
+            auto kind = static_cast<CommandKind>(header & KindMask);
+            auto flags = (header >> FlagsShift) & FlagsMask;
+
+            if (kind == CommandKind::Pause)
             {
-                return AttackOrder(deserializeVector(attack.ground()));
+                out.emplace_back(PlayerPauseGameCommand());
+                continue;
             }
 
-            throw std::runtime_error("Failed to deserialize attack order");
-        }
-
-        if (cmd.has_build())
-        {
-            const auto& build = cmd.build();
-            return BuildOrder(build.unit_type(), deserializeVector(build.position()));
-        }
+            if (kind == CommandKind::Unpause)
+            {
+                out.emplace_back(PlayerUnpauseGameCommand());
+                continue;
+            }
 
-        if (cmd.has_complete_build())
-        {
-            const auto& build = cmd.complete_build();
-            return CompleteBuildOrder(UnitId(build.unit()));
+            previousUnit += static_cast<unsigned int>(reader.readSignedVarint());
+            previousCommand = readUnitCommandBody(reader, unitTypes, kind, flags);
+            out.emplace_back(PlayerUnitCommand(UnitId(previousUnit), *previousCommand));
         }
 
-        if (cmd.has_guard())
+        if (!reader.atEnd())
         {
-            const auto& guard = cmd.guard();
-            return GuardOrder(UnitId(guard.unit()));
+            throw std::runtime_error("Unexpected data after end of command set");
         }
-
-        throw std::runtime_error("Failed to deserlialize unit order");
     }
 
-    SimVector deserializeVector(const proto::SimVector& v)
+    std::vector<PlayerCommand> deserializeCommandSet(const std::string& data, const UnitTypeTable& unitTypes)
     {
-        return SimVector(SimScalar(v.x()), SimScalar(v.y()), SimScalar(v.z()));
+        std::vector<PlayerCommand> out;
+        deserializeCommandSet(data.data(), data.size(), unitTypes, out);
+        return out;
     }
 }
@@ -1,33 +1,44 @@
 #pragma once
 
-#include <network.pb.h>
+#include <cstddef>
 #include <rwe/game/PlayerCommand.h>
-#include <rwe/sim/UnitFireOrders.h>
+#include <rwe/proto/UnitTypeTable.h>
+#include <string>
 #include <vector>
 
 namespace rwe
 {
-    void serializeVector(const SimVector& v, proto::SimVector& out);
-
-    proto::PlayerUnitCommand::IssueOrder::IssueKind serializeIssueKind(const PlayerUnitCommand::IssueOrder::IssueKind& kind);
-
-    proto::PlayerUnitCommand::SetFireOrders::FireOrders serializeFireOrders(const UnitFireOrders& orders);
-
-    void serializePlayerCommand(const PlayerCommand& command, proto::PlayerCommand& out);
-
-    std::vector<PlayerCommand> deserializeCommandSet(const proto::GameUpdateMessage_PlayerCommandSet& set);
-
-    PlayerCommand deserializeCommand(const proto::PlayerCommand& cmd);
-
-    PlayerUnitCommand deserializeUnitCommand(const proto::PlayerUnitCommand& cmd);
-
-    PlayerUnitCommand::IssueOrder deserializeIssueOrder(const proto::PlayerUnitCommand::IssueOrder& cmd);
-
-    PlayerUnitCommand::IssueOrder::IssueKind deserializeIssueKind(const proto::PlayerUnitCommand::IssueOrder::IssueKind& kind);
-
-    UnitFireOrders deserializeFireOrders(const proto::PlayerUnitCommand::SetFireOrders::FireOrders& orders);
-
-    UnitOrder deserializeUnitOrder(const proto::PlayerUnitCommand::IssueOrder& cmd);
-
-    SimVector deserializeVector(const proto::SimVector& v);
+    /**
+     * Encodes a set of player commands in a compact binary format
+     * for sending over the network.
+     *
+     * Each command starts with a one byte header holding the kind of command
+     * and any small fields (issue kind, fire orders, on/off) packed into spare bits.
+     * Unit IDs of consecutive unit commands are delta encoded as zigzag varints,
+     * and a command identical to the previous unit command apart from its unit
+     * is written as just the header and the unit ID delta.
+     * An order given to many selected units therefore costs
+     * only a few bytes per unit after the first.
+     *
+     * Vector components that hold whole numbers, as is usual for positions
+     * snapped to the map grid, are written as varints. Others are written as raw floats.
+     * Unit types are written as their ID in the table, or by name if they are not in it.
+     * Decoding always reproduces the original values exactly.
+     */
+    std::string serializeCommandSet(const std::vector<PlayerCommand>& commands, const UnitTypeTable& unitTypes);
+
+    /**
+     * Decodes a set of commands written by serializeCommandSet with the same table,
+     * replacing the contents of out.
+     * Decoding into a vector that has held a set before reuses its storage,
+     * so once warmed up this does not allocate, as unit type names fit in std::string's small buffer.
+     * Throws std::runtime_error if the data is malformed.
+     */
+    void deserializeCommandSet(const char* data, std::size_t size, const UnitTypeTable& unitTypes, std::vector<PlayerCommand>& out);
+
+    /** As above, returning a new vector. */
+    std::vector<PlayerCommand> deserializeCommandSet(const std::string& data, const UnitTypeTable& unitTypes);
+
+    /** The number of bytes needed to write the value as a varint. */
+    std::size_t getVarintSize(unsigned int value);
 }
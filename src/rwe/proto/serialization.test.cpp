@@ -0,0 +1,260 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <rwe/proto/serialization.h>
+
+namespace rwe
+{
+    static bool commandsEqual(const std::vector<PlayerCommand>& a, const std::vector<PlayerCommand>& b)
+    {
+        // Commands have no equality operator,
+        // but the encoding is canonical so equal commands encode the same.
+        UnitTypeTable unitTypes;
+        return serializeCommandSet(a, unitTypes) == serializeCommandSet(b, unitTypes);
+    }
+
+    TEST_CASE("serializeCommandSet")
+    {
+        using IssueKind = PlayerUnitCommand::IssueOrder::IssueKind;
+
+        UnitTypeTable unitTypes({"ARMSOLAR", "ARMPW", "ARMCOM"});
+
+        SECTION("round trips every kind of command")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerPauseGameCommand(),
+                PlayerUnitCommand(UnitId(7), PlayerUnitCommand::IssueOrder(MoveOrder(SimVector(100_ss, 25.5_ssf, -48_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(3), PlayerUnitCommand::IssueOrder(AttackOrder(UnitId(900)), IssueKind::Immediate)),
+                PlayerUnitCommand(UnitId(3), PlayerUnitCommand::IssueOrder(AttackOrder(SimVector(1_ss, 2_ss, 3_ss)), IssueKind::Immediate)),
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("ARMSOLAR", SimVector(0.25_ssf, 0_ss, 64_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(5), PlayerUnitCommand::IssueOrder(CompleteBuildOrder(UnitId(12)), IssueKind::Immediate)),
+                PlayerUnitCommand(UnitId(6), PlayerUnitCommand::IssueOrder(GuardOrder(UnitId(13)), IssueKind::Immediate)),
+                PlayerUnitCommand(UnitId(8), PlayerUnitCommand::ModifyBuildQueue{-5, "ARMPW"}),
+                PlayerUnitCommand(UnitId(8), PlayerUnitCommand::Stop()),
+                PlayerUnitCommand(UnitId(9), PlayerUnitCommand::SetFireOrders{UnitFireOrders::ReturnFire}),
+                PlayerUnitCommand(UnitId(10), PlayerUnitCommand::SetOnOff{true}),
+                PlayerUnpauseGameCommand(),
+            };
+
+            auto decoded = deserializeCommandSet(serializeCommandSet(commands, unitTypes), unitTypes);
+            REQUIRE(decoded.size() == commands.size());
+            REQUIRE(commandsEqual(decoded, commands));
+
+            const auto& build = std::get<PlayerUnitCommand>(decoded[4]);
+            REQUIRE(build.unit == UnitId(4));
+            const auto& buildOrder = std::get<BuildOrder>(std::get<PlayerUnitCommand::IssueOrder>(build.command).order);
+            REQUIRE(buildOrder.unitType == "ARMSOLAR");
+            REQUIRE(buildOrder.position.x.value == 0.25f);
+            REQUIRE(buildOrder.position.z.value == 64.0f);
+            REQUIRE(std::get<PlayerUnitCommand::IssueOrder>(build.command).issueKind == IssueKind::Queued);
+        }
+
+        SECTION("preserves the sign of zero")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(1), PlayerUnitCommand::IssueOrder(MoveOrder(SimVector(SimScalar(-0.0f), 0_ss, 0_ss)), IssueKind::Immediate)),
+            };
+
+            auto decoded = deserializeCommandSet(serializeCommandSet(commands, unitTypes), unitTypes);
+            const auto& move = std::get<MoveOrder>(std::get<PlayerUnitCommand::IssueOrder>(std::get<PlayerUnitCommand>(decoded[0]).command).order);
+            REQUIRE(std::signbit(move.destination.x.value));
+            REQUIRE(!std::signbit(move.destination.y.value));
+        }
+
+        SECTION("encodes a move order to 200 units in a few bytes per unit")
+        {
+            std::vector<PlayerCommand> commands;
+            for (unsigned int i = 0; i < 200; ++i)
+            {
+                // a scattered selection, as after units have died and been replaced
+                auto unit = UnitId(1000 + (i * 37));
+                commands.emplace_back(PlayerUnitCommand(unit, PlayerUnitCommand::IssueOrder(MoveOrder(SimVector(1234.5_ssf, 80_ss, 2000_ss)), IssueKind::Immediate)));
+            }
+
+            auto encoded = serializeCommandSet(commands, unitTypes);
+            REQUIRE(encoded.size() < 200 * 3);
+            REQUIRE(commandsEqual(deserializeCommandSet(encoded, unitTypes), commands));
+        }
+
+        SECTION("writes unit types in the table as IDs")
+        {
+            std::vector<PlayerCommand> known{
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("ARMSOLAR", SimVector(0_ss, 0_ss, 0_ss)), IssueKind::Immediate)),
+            };
+            std::vector<PlayerCommand> unknown{
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("CORSOLAR", SimVector(0_ss, 0_ss, 0_ss)), IssueKind::Immediate)),
+            };
+
+            auto knownEncoded = serializeCommandSet(known, unitTypes);
+            auto unknownEncoded = serializeCommandSet(unknown, unitTypes);
+            REQUIRE(knownEncoded.find("ARMSOLAR") == std::string::npos);
+            REQUIRE(unknownEncoded.find("CORSOLAR") != std::string::npos);
+            REQUIRE(knownEncoded.size() < unknownEncoded.size());
+
+            // types not in the table are written by name, so decode with any table
+            auto decoded = deserializeCommandSet(unknownEncoded, UnitTypeTable());
+            REQUIRE(std::get<BuildOrder>(std::get<PlayerUnitCommand::IssueOrder>(std::get<PlayerUnitCommand>(decoded[0]).command).order).unitType == "CORSOLAR");
+        }
+
+        SECTION("rejects unit type IDs not in the table")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(8), PlayerUnitCommand::ModifyBuildQueue{1, "ARMPW"}),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+            REQUIRE_THROWS_AS(deserializeCommandSet(encoded, UnitTypeTable()), std::runtime_error);
+        }
+
+        SECTION("decodes into an existing vector, replacing its contents")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(1), PlayerUnitCommand::Stop()),
+                PlayerUnitCommand(UnitId(2), PlayerUnitCommand::Stop()),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+
+            std::vector<PlayerCommand> out{PlayerPauseGameCommand(), PlayerPauseGameCommand(), PlayerPauseGameCommand()};
+            out.reserve(16);
+            auto storage = out.data();
+            deserializeCommandSet(encoded.data(), encoded.size(), unitTypes, out);
+            REQUIRE(commandsEqual(out, commands));
+            REQUIRE(out.data() == storage);
+        }
+
+        SECTION("rejects truncated data")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("ARMSOLAR", SimVector(0.25_ssf, 0_ss, 64_ss)), IssueKind::Queued)),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+            for (std::size_t i = 0; i < encoded.size(); ++i)
+            {
+                REQUIRE_THROWS_AS(deserializeCommandSet(encoded.substr(0, i), unitTypes), std::runtime_error);
+            }
+        }
+
+        SECTION("rejects trailing data")
+        {
+            auto encoded = serializeCommandSet({PlayerPauseGameCommand()}, unitTypes);
+            encoded.push_back(0);
+            REQUIRE_THROWS_AS(deserializeCommandSet(encoded, unitTypes), std::runtime_error);
+        }
+
+        SECTION("rejects a repeat with nothing to repeat")
+        {
+            // one command: a repeat of unit delta +1
+            REQUIRE_THROWS_AS(deserializeCommandSet(std::string("\x01\x80\x02", 3), unitTypes), std::runtime_error);
+
+            // pausing is not a unit command, so it cannot be repeated
+            auto encoded = serializeCommandSet({PlayerPauseGameCommand()}, unitTypes);
+            encoded[0] = 2;
+            encoded += std::string("\x80\x02", 2);
+            REQUIRE_THROWS_AS(deserializeCommandSet(encoded, unitTypes), std::runtime_error);
+        }
+
+        SECTION("rejects varints that are too long")
+        {
+            REQUIRE_THROWS_AS(deserializeCommandSet(std::string("\xff\xff\xff\xff\xff\x01", 6), unitTypes), std::runtime_error);
+
+            // a stop order whose zigzag unit delta never ends
+            auto encoded = serializeCommandSet({PlayerUnitCommand(UnitId(1), PlayerUnitCommand::Stop())}, unitTypes);
+            REQUIRE(encoded.size() == 3);
+            encoded.replace(2, 1, std::string(6, '\xff'));
+            REQUIRE_THROWS_AS(deserializeCommandSet(encoded, unitTypes), std::runtime_error);
+        }
+
+        SECTION("decodes extreme zigzag unit deltas")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(0xffffffffu), PlayerUnitCommand::Stop()),
+                PlayerUnitCommand(UnitId(0), PlayerUnitCommand::Stop()),
+                PlayerUnitCommand(UnitId(0x80000000u), PlayerUnitCommand::SetOnOff{true}),
+                PlayerUnitCommand(UnitId(0x7fffffffu), PlayerUnitCommand::SetOnOff{true}),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+            REQUIRE(commandsEqual(deserializeCommandSet(encoded, unitTypes), commands));
+        }
+
+        SECTION("rejects a set split into fragments until every fragment is present")
+        {
+            // Command sets too big for one packet are sent in fragments,
+            // so the decoder must cope with being given only some of them.
+            std::vector<PlayerCommand> commands;
+            for (unsigned int i = 0; i < 300; ++i)
+            {
+                auto position = SimVector(SimScalar(static_cast<float>(i) + 0.5f), 80_ss, SimScalar(static_cast<float>(i) * 3.25f));
+                commands.emplace_back(PlayerUnitCommand(UnitId(i * 37), PlayerUnitCommand::IssueOrder(MoveOrder(position), IssueKind::Immediate)));
+            }
+
+            auto encoded = serializeCommandSet(commands, unitTypes);
+            const std::size_t fragmentSize = 1024;
+            REQUIRE(encoded.size() > fragmentSize * 2);
+
+            std::vector<std::string> fragments;
+            for (std::size_t i = 0; i < encoded.size(); i += fragmentSize)
+            {
+                fragments.push_back(encoded.substr(i, fragmentSize));
+            }
+
+            std::string prefix;
+            for (std::size_t i = 0; i < fragments.size(); ++i)
+            {
+                REQUIRE_THROWS_AS(deserializeCommandSet(fragments[i], unitTypes), std::runtime_error);
+                if (i + 1 < fragments.size())
+                {
+                    prefix += fragments[i];
+                    REQUIRE_THROWS_AS(deserializeCommandSet(prefix, unitTypes), std::runtime_error);
+                }
+            }
+
+            REQUIRE_THROWS_AS(deserializeCommandSet(fragments.front() + fragments.back(), unitTypes), std::runtime_error);
+            REQUIRE(commandsEqual(deserializeCommandSet(prefix + fragments.back(), unitTypes), commands));
+        }
+
+        SECTION("decodes or rejects corrupted data without failing in other ways")
+        {
+            std::vector<PlayerCommand> commands{
+                PlayerUnitCommand(UnitId(7), PlayerUnitCommand::IssueOrder(MoveOrder(SimVector(100_ss, 25.5_ssf, -48_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(8), PlayerUnitCommand::IssueOrder(MoveOrder(SimVector(100_ss, 25.5_ssf, -48_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("ARMSOLAR", SimVector(0.25_ssf, 0_ss, 64_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(4), PlayerUnitCommand::IssueOrder(BuildOrder("CORSOLAR", SimVector(0_ss, 0_ss, 0_ss)), IssueKind::Queued)),
+                PlayerUnitCommand(UnitId(8), PlayerUnitCommand::ModifyBuildQueue{-5, "ARMPW"}),
+                PlayerUnitCommand(UnitId(9), PlayerUnitCommand::SetFireOrders{UnitFireOrders::ReturnFire}),
+                PlayerPauseGameCommand(),
+            };
+            auto encoded = serializeCommandSet(commands, unitTypes);
+
+            const unsigned char replacements[] = {0x00, 0x01, 0x0f, 0x7f, 0x80, 0x8f, 0xff};
+            std::vector<PlayerCommand> out;
+            for (std::size_t i = 0; i < encoded.size(); ++i)
+            {
+                for (auto replacement : replacements)
+                {
+                    auto corrupted = encoded;
+                    corrupted[i] = static_cast<char>(replacement);
+                    try
+                    {
+                        deserializeCommandSet(corrupted.data(), corrupted.size(), unitTypes, out);
+                    }
+                    catch (const std::runtime_error&)
+                    {
+                        // expected for most corruptions
+                    }
+                }
+            }
+
+            // the output vector is still usable afterwards
+            deserializeCommandSet(encoded.data(), encoded.size(), unitTypes, out);
+            REQUIRE(commandsEqual(out, commands));
+        }
+    }
+
+    TEST_CASE("getVarintSize")
+    {
+        REQUIRE(getVarintSize(0) == 1);
+        REQUIRE(getVarintSize(127) == 1);
+        REQUIRE(getVarintSize(128) == 2);
+        REQUIRE(getVarintSize(16383) == 2);
+        REQUIRE(getVarintSize(16384) == 3);
+        REQUIRE(getVarintSize(0xffffffffu) == 5);
+    }
+}
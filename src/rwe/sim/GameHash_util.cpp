@@ -230,4 +230,41 @@ namespace rwe
             simulation.units,
             simulation.projectiles);
     }
+
+    GameHash GameHashBreakdown::total() const
+    {
+        return gameTime + players + units + projectiles;
+    }
+
+    void computeHashBreakdown(const GameSimulation& simulation, GameHashBreakdown& breakdown)
+    {
+        breakdown.gameTime = computeHashOf(simulation.gameTime);
+
+        breakdown.players = GameHash(0);
+        breakdown.playerHashes.clear();
+        for (const auto& player : simulation.players)
+        {
+            auto hash = computeHashOf(player);
+            breakdown.playerHashes.push_back(hash);
+            breakdown.players += hash;
+        }
+
+        breakdown.units = GameHash(0);
+        breakdown.unitHashes.clear();
+        for (const auto& entry : simulation.units)
+        {
+            auto hash = computeHashOf(entry);
+            breakdown.unitHashes.emplace_back(entry.first, hash);
+            breakdown.units += hash;
+        }
+
+        breakdown.projectiles = GameHash(0);
+        breakdown.projectileHashes.clear();
+        for (const auto& entry : simulation.projectiles)
+        {
+            auto hash = computeHashOf(entry);
+            breakdown.projectileHashes.emplace_back(entry.first, hash);
+            breakdown.projectiles += hash;
+        }
+    }
 }
@@ -60,6 +60,37 @@ namespace rwe
 
     GameHash computeHashOf(const GameSimulation& simulation);
 
+    /**
+     * The hash of a simulation split up by subsystem and by entity,
+     * for finding where two simulations that should be the same differ.
+     * The subsystem hashes add up to the simulation's hash,
+     * and each subsystem's entity hashes add up to its hash.
+     */
+    struct GameHashBreakdown
+    {
+        GameHash gameTime{0};
+        GameHash players{0};
+        GameHash units{0};
+        GameHash projectiles{0};
+
+        /** Indexed by player ID. */
+        std::vector<GameHash> playerHashes;
+
+        /** In ID order. */
+        std::vector<std::pair<UnitId, GameHash>> unitHashes;
+
+        /** In ID order. */
+        std::vector<std::pair<ProjectileId, GameHash>> projectileHashes;
+
+        GameHash total() const;
+    };
+
+    /**
+     * Computes the breakdown of the simulation's hash,
+     * reusing the storage of the breakdown's entity hashes.
+     */
+    void computeHashBreakdown(const GameSimulation& simulation, GameHashBreakdown& breakdown);
+
     template <typename... Ts>
     GameHash combineHashes(const Ts&... items);
 
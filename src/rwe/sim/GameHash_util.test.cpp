@@ -87,6 +87,42 @@ namespace rwe
         }
     }
 
+    TEST_CASE("computeHashBreakdown")
+    {
+        GameSimulation simulation(MapTerrain(Grid<unsigned char>(65, 65, 0), 0_ss), 0, 0, 20);
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            GamePlayerInfo info{"Player " + std::to_string(i), GamePlayerType::Human, PlayerColorIndex(i), GamePlayerStatus::Alive, "ARM", Metal(1000), Energy(1000), Metal(1000), Energy(1000), Metal(1000), Energy(1000)};
+            simulation.addPlayer(info);
+        }
+
+        SECTION("adds up to the simulation's hash")
+        {
+            GameHashBreakdown breakdown;
+            computeHashBreakdown(simulation, breakdown);
+            REQUIRE(breakdown.total() == computeHashOf(simulation));
+            REQUIRE(breakdown.playerHashes.size() == 3);
+            REQUIRE(breakdown.playerHashes[0] + breakdown.playerHashes[1] + breakdown.playerHashes[2] == breakdown.players);
+        }
+
+        SECTION("shows which entity changed")
+        {
+            GameHashBreakdown before;
+            computeHashBreakdown(simulation, before);
+
+            simulation.players[1].metal += Metal(1);
+            GameHashBreakdown after;
+            computeHashBreakdown(simulation, after);
+
+            REQUIRE(after.gameTime == before.gameTime);
+            REQUIRE(after.players != before.players);
+            REQUIRE(after.playerHashes[0] == before.playerHashes[0]);
+            REQUIRE(after.playerHashes[1] != before.playerHashes[1]);
+            REQUIRE(after.playerHashes[2] == before.playerHashes[2]);
+            REQUIRE(after.units == before.units);
+        }
+    }
+
     TEST_CASE("combineHashes")
     {
         SECTION("combines hashes")
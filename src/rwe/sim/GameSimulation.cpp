@@ -1,4 +1,5 @@
 #include "GameSimulation.h"
+#include <algorithm>
 #include <rwe/sim/GameHash_util.h>
 #include <rwe/sim/SimScalar.h>
 #include <rwe/sim/SimTicksPerSecond.h>
@@ -73,16 +74,6 @@ namespace rwe
         }
     }
 
-    bool PathRequest::operator==(const PathRequest& rhs) const
-    {
-        return unitId == rhs.unitId;
-    }
-
-    bool PathRequest::operator!=(const PathRequest& rhs) const
-    {
-        return !(rhs == *this);
-    }
-
     GameSimulation::GameSimulation(MapTerrain&& terrain, unsigned char surfaceMetal, int minWindSpeed, int maxWindSpeed)
         : terrain(std::move(terrain)),
           occupiedGrid(this->terrain.getHeightMap().getWidth() - 1, this->terrain.getHeightMap().getHeight() - 1, OccupiedCell()),
@@ -113,6 +104,11 @@ namespace rwe
             cell.featureId = featureId;
         });
 
+        if (featureDefinition.blocking)
+        {
+            pathFindingService.notifyStaticObstaclesChanged(footprintRegion);
+        }
+
         if (!featureDefinition.blocking && featureDefinition.indestructible && featureDefinition.metal)
         {
             metalGrid.set(metalGrid.clipRegion(footprintRegion), featureDefinition.metal);
@@ -303,6 +299,7 @@ namespace rwe
         if (unitDefinition.isMobile)
         {
             occupiedGrid.forEach(*footprintRegion, [unitId](auto& cell) { cell.mobileUnitId = unitId; });
+            pathFindingService.notifyOccupancyChanged(footprintRect);
         }
         else
         {
@@ -310,6 +307,7 @@ namespace rwe
             occupiedGrid.forEach2(footprintRegion->x, footprintRegion->y, *unitDefinition.yardMap, [&](auto& cell, const auto& yardMapCell) {
                 cell.buildingInfo = OccupiedCellBuildingInfo{unitId, isPassable(yardMapCell, insertedUnit.yardOpen)};
             });
+            pathFindingService.notifyStaticObstaclesChanged(footprintRect);
         }
 
         return unitId;
@@ -442,6 +440,31 @@ namespace rwe
         });
     }
 
+    PathFindingSnapshot GameSimulation::createPathFindingSnapshot() const
+    {
+        auto cells = Grid<PathFindingSnapshot::Cell>::from(occupiedGrid.getWidth(), occupiedGrid.getHeight(), [&](const GridCoordinates& c) {
+            const auto& cell = occupiedGrid.get(c);
+            PathFindingSnapshot::Cell snapshotCell;
+            snapshotCell.mobileUnitId = cell.mobileUnitId;
+            if (cell.buildingInfo && !cell.buildingInfo->passable)
+            {
+                snapshotCell.staticCollision = true;
+            }
+            if (cell.featureId)
+            {
+                const auto& f = getFeature(*cell.featureId);
+                const auto& def = getFeatureDefinition(f.featureName);
+                if (def.blocking)
+                {
+                    snapshotCell.staticCollision = true;
+                }
+            }
+            return snapshotCell;
+        });
+
+        return PathFindingSnapshot(std::move(cells));
+    }
+
     bool GameSimulation::isYardmapBlocked(unsigned int x, unsigned int y, const Grid<YardMapCell>& yardMap, bool open, UnitId self) const
     {
         return occupiedGrid.any2(x, y, yardMap, [&](const auto& cell, const auto& yardMapCell) {
@@ -605,32 +628,32 @@ namespace rwe
 
     void GameSimulation::moveObject(UnitId unitId, const std::string& name, SimAxis axis, SimScalar position, SimScalar speed)
     {
-        getUnitState(unitId).moveObject(name, axis, position, speed);
+        getUnitState(unitId).moveObject(pieceAnimations, name, axis, position, speed);
     }
 
     void GameSimulation::moveObjectNow(UnitId unitId, const std::string& name, SimAxis axis, SimScalar position)
     {
-        getUnitState(unitId).moveObjectNow(name, axis, position);
+        getUnitState(unitId).moveObjectNow(pieceAnimations, name, axis, position);
     }
 
     void GameSimulation::turnObject(UnitId unitId, const std::string& name, SimAxis axis, SimAngle angle, SimScalar speed)
     {
-        getUnitState(unitId).turnObject(name, axis, angle, speed);
+        getUnitState(unitId).turnObject(pieceAnimations, name, axis, angle, speed);
     }
 
     void GameSimulation::turnObjectNow(UnitId unitId, const std::string& name, SimAxis axis, SimAngle angle)
     {
-        getUnitState(unitId).turnObjectNow(name, axis, angle);
+        getUnitState(unitId).turnObjectNow(pieceAnimations, name, axis, angle);
     }
 
     void GameSimulation::spinObject(UnitId unitId, const std::string& name, SimAxis axis, SimScalar speed, SimScalar acceleration)
     {
-        getUnitState(unitId).spinObject(name, axis, speed, acceleration);
+        getUnitState(unitId).spinObject(pieceAnimations, name, axis, speed, acceleration);
     }
 
     void GameSimulation::stopSpinObject(UnitId unitId, const std::string& name, SimAxis axis, SimScalar deceleration)
     {
-        getUnitState(unitId).stopSpinObject(name, axis, deceleration);
+        getUnitState(unitId).stopSpinObject(pieceAnimations, name, axis, deceleration);
     }
 
     bool GameSimulation::isPieceMoving(UnitId unitId, const std::string& name, SimAxis axis) const
@@ -657,23 +680,21 @@ namespace rwe
 
         occupiedGrid.forEach(*oldRegion, [](auto& cell) { cell.mobileUnitId = std::nullopt; });
         occupiedGrid.forEach(*newRegion, [unitId](auto& cell) { cell.mobileUnitId = unitId; });
+
+        pathFindingService.notifyOccupancyChanged(oldRect);
+        pathFindingService.notifyOccupancyChanged(newRect);
     }
 
-    void GameSimulation::requestPath(UnitId unitId)
+    void GameSimulation::requestPath(UnitId unitId, PathSearchAlgorithm algorithm, PathRequestReason reason)
     {
-        PathRequest request{unitId};
+        const auto& unit = getUnitState(unitId);
+        auto combatUnit = std::any_of(unit.weapons.begin(), unit.weapons.end(), [](const auto& w) { return w.has_value(); });
 
         // If the unit is already in the queue for a path,
         // we'll assume that they no longer care about their old request
         // and that their new request is for some new path,
-        // so we'll move them to the back of the queue for fairness.
-        auto it = std::find(pathRequests.begin(), pathRequests.end(), request);
-        if (it != pathRequests.end())
-        {
-            pathRequests.erase(it);
-        }
-
-        pathRequests.push_back(PathRequest{unitId});
+        // so the new request replaces it at the back of the queue for fairness.
+        pathRequests.push(PathRequest{unitId, unit.owner, algorithm, reason, combatUnit}, gameTime);
     }
 
     Projectile GameSimulation::createProjectileFromWeapon(
@@ -788,6 +809,7 @@ namespace rwe
         occupiedGrid.forEach2(footprintRegion->x, footprintRegion->y, *unitDefinition.yardMap, [&](auto& cell, const auto& yardMapCell) {
             cell.buildingInfo = OccupiedCellBuildingInfo{unitId, isPassable(yardMapCell, open)};
         });
+        pathFindingService.notifyStaticObstaclesChanged(footprintRect);
 
         unit.yardOpen = open;
 
@@ -1559,6 +1581,7 @@ namespace rwe
                 else
                 {
                     occupiedGrid.forEach(*footprintRegion, [](auto& cell) { cell.mobileUnitId = std::nullopt; });
+                    pathFindingService.notifyOccupancyChanged(footprintRect);
                 }
             }
             else
@@ -1568,6 +1591,12 @@ namespace rwe
                   {
                       cell.buildingInfo = std::nullopt;
                   } });
+                pathFindingService.notifyStaticObstaclesChanged(footprintRect);
+            }
+
+            for (auto& piece : it->second.pieces)
+            {
+                pieceAnimations.removePiece(piece);
             }
 
             it = units.erase(it);
@@ -1656,7 +1685,6 @@ namespace rwe
 
         pathFindingService.update(*this);
 
-        // run unit scripts
         for (auto& entry : units)
         {
             auto unitId = entry.first;
@@ -1666,10 +1694,17 @@ namespace rwe
 
             for (auto& piece : unit.pieces)
             {
-                piece.update(SimScalar(SimMillisecondsPerTick) / 1000_ss);
+                piece.savePreviousPose();
             }
+        }
+
+        pieceAnimations.update(SimScalar(SimMillisecondsPerTick) / 1000_ss);
 
-            runUnitCobScripts(*this, unitId);
+        // run unit scripts
+        cobThreadsWokenThisTick = 0;
+        for (const auto& entry : units)
+        {
+            runUnitCobScripts(*this, entry.first);
         }
 
         updateProjectiles();
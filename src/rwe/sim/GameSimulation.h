@@ -1,12 +1,15 @@
 #pragma once
 
 #include <random>
+#include <rwe/cob/CobProfiler.h>
 #include <rwe/cob/CobUnitId.h>
 #include <rwe/collections/SimpleVectorMap.h>
 #include <rwe/collections/VectorMap.h>
 #include <rwe/game/PlayerColorIndex.h>
 #include <rwe/geometry/BoundingBox3x.h>
 #include <rwe/pathfinding/PathFindingService.h>
+#include <rwe/pathfinding/PathFindingSnapshot.h>
+#include <rwe/pathfinding/PathRequestQueue.h>
 #include <rwe/sim/FeatureDefinition.h>
 #include <rwe/sim/FeatureId.h>
 #include <rwe/sim/GameHash.h>
@@ -17,6 +20,7 @@
 #include <rwe/sim/MovementClassDatabase.h>
 #include <rwe/sim/MovementClassId.h>
 #include <rwe/sim/OccupiedGrid.h>
+#include <rwe/sim/PieceAnimationStore.h>
 #include <rwe/sim/PlayerId.h>
 #include <rwe/sim/Projectile.h>
 #include <rwe/sim/ProjectileId.h>
@@ -83,15 +87,6 @@ namespace rwe
         void acceptResource(const Metal& metal);
     };
 
-    struct PathRequest
-    {
-        UnitId unitId;
-
-        bool operator==(const PathRequest& rhs) const;
-
-        bool operator!=(const PathRequest& rhs) const;
-    };
-
     struct WinStatusWon
     {
         PlayerId winner;
@@ -274,9 +269,12 @@ namespace rwe
 
         VectorMap<UnitState, UnitIdTag> units;
 
+        /** Piece animations in progress for all units. */
+        PieceAnimationStore pieceAnimations;
+
         VectorMap<Projectile, ProjectileIdTag> projectiles;
 
-        std::deque<PathRequest> pathRequests;
+        PathRequestQueue pathRequests;
 
         std::deque<UnitId> unitCreationRequests;
 
@@ -284,6 +282,21 @@ namespace rwe
 
         std::vector<GameEvent> events;
 
+#ifdef RWE_COB_PROFILING
+        /**
+         * Collects per-function COB script statistics.
+         * This is not part of the simulation state and is not hashed.
+         */
+        CobProfiler cobProfiler;
+#endif
+
+        /**
+         * The number of sleeping COB threads that woke up during the current tick,
+         * across all units.
+         * This is not part of the simulation state and is not hashed.
+         */
+        unsigned int cobThreadsWokenThisTick{0};
+
         SimScalar currentWindGenerationFactor{0_ss};
 
         const int minWindSpeed;
@@ -329,6 +342,9 @@ namespace rwe
 
         bool isCollisionAt(const DiscreteRect& rect, UnitId self) const;
 
+        /** Copies the occupied grid into a snapshot for path searches to run against. */
+        PathFindingSnapshot createPathFindingSnapshot() const;
+
         bool isYardmapBlocked(unsigned int x, unsigned int y, const Grid<YardMapCell>& yardMap, bool open, UnitId self) const;
 
         bool isAdjacentToObstacle(const DiscreteRect& rect) const;
@@ -389,7 +405,7 @@ namespace rwe
 
         void moveUnitOccupiedArea(const DiscreteRect& oldRect, const DiscreteRect& newRect, UnitId unitId);
 
-        void requestPath(UnitId unitId);
+        void requestPath(UnitId unitId, PathSearchAlgorithm algorithm = PathSearchAlgorithm::AStar, PathRequestReason reason = PathRequestReason::Replan);
 
         Projectile createProjectileFromWeapon(PlayerId owner, const UnitWeapon& weapon, const SimVector& position, const SimVector& direction, SimScalar distanceToTarget, std::optional<UnitId> targetUnit);
 
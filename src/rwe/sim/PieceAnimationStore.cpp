@@ -0,0 +1,391 @@
+#include "PieceAnimationStore.h"
+#include <cmath>
+
+namespace rwe
+{
+    template <typename T>
+    void swapRemove(std::vector<T>& v, unsigned int index)
+    {
+        v[index] = v.back();
+        v.pop_back();
+    }
+
+    unsigned int toAxisIndex(SimAxis axis)
+    {
+        return static_cast<unsigned int>(axis);
+    }
+
+    SimScalar& getOffsetComponent(UnitMesh& piece, unsigned int axis)
+    {
+        switch (axis)
+        {
+            case 0:
+                return piece.offset.x;
+            case 1:
+                return piece.offset.y;
+            default:
+                return piece.offset.z;
+        }
+    }
+
+    SimAngle& getRotationComponent(UnitMesh& piece, unsigned int axis)
+    {
+        switch (axis)
+        {
+            case 0:
+                return piece.rotationX;
+            case 1:
+                return piece.rotationY;
+            default:
+                return piece.rotationZ;
+        }
+    }
+
+    /** Equivalent to SimAngle(frameSpeed) when positive, -SimAngle(-frameSpeed) otherwise. */
+    uint16_t advanceAngle(uint16_t angle, float frameSpeed)
+    {
+        auto forward = static_cast<uint16_t>(angle + static_cast<uint16_t>(frameSpeed > 0.0f ? frameSpeed : 0.0f));
+        auto backward = static_cast<uint16_t>(angle - static_cast<uint16_t>(frameSpeed > 0.0f ? 0.0f : -frameSpeed));
+        return frameSpeed > 0.0f ? forward : backward;
+    }
+
+    void PieceAnimationStore::MovePool::remove(unsigned int index)
+    {
+        swapRemove(owners, index);
+        swapRemove(position, index);
+        swapRemove(targetPosition, index);
+        swapRemove(speed, index);
+    }
+
+    void PieceAnimationStore::TurnPool::remove(unsigned int index)
+    {
+        swapRemove(owners, index);
+        swapRemove(angle, index);
+        swapRemove(targetAngle, index);
+        swapRemove(speed, index);
+    }
+
+    void PieceAnimationStore::SpinPool::remove(unsigned int index)
+    {
+        swapRemove(owners, index);
+        swapRemove(angle, index);
+        swapRemove(currentSpeed, index);
+        swapRemove(targetSpeed, index);
+        swapRemove(acceleration, index);
+    }
+
+    void PieceAnimationStore::StopSpinPool::remove(unsigned int index)
+    {
+        swapRemove(owners, index);
+        swapRemove(angle, index);
+        swapRemove(currentSpeed, index);
+        swapRemove(deceleration, index);
+    }
+
+    void PieceAnimationStore::move(UnitMesh& piece, SimAxis axis, SimScalar targetPosition, SimScalar speed)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        if (auto slot = piece.moveSlots[axisIndex]; slot)
+        {
+            moves.targetPosition[*slot] = targetPosition.value;
+            moves.speed[*slot] = speed.value;
+            return;
+        }
+
+        piece.moveSlots[axisIndex] = static_cast<unsigned int>(moves.owners.size());
+        moves.owners.push_back(Owner{&piece, axisIndex});
+        moves.position.push_back(getOffsetComponent(piece, axisIndex).value);
+        moves.targetPosition.push_back(targetPosition.value);
+        moves.speed.push_back(speed.value);
+    }
+
+    void PieceAnimationStore::moveNow(UnitMesh& piece, SimAxis axis, SimScalar position)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        cancelMove(piece, axisIndex);
+        getOffsetComponent(piece, axisIndex) = position;
+    }
+
+    void PieceAnimationStore::turn(UnitMesh& piece, SimAxis axis, SimAngle targetAngle, SimScalar speed)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        cancelTurn(piece, axisIndex);
+
+        piece.turnSlots[axisIndex] = PieceTurnSlot{PieceTurnKind::Turn, static_cast<unsigned int>(turns.owners.size())};
+        turns.owners.push_back(Owner{&piece, axisIndex});
+        turns.angle.push_back(getRotationComponent(piece, axisIndex).value);
+        turns.targetAngle.push_back(targetAngle.value);
+        turns.speed.push_back(speed.value);
+    }
+
+    void PieceAnimationStore::turnNow(UnitMesh& piece, SimAxis axis, SimAngle angle)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        cancelTurn(piece, axisIndex);
+        getRotationComponent(piece, axisIndex) = angle;
+    }
+
+    void PieceAnimationStore::spin(UnitMesh& piece, SimAxis axis, SimScalar targetSpeed, SimScalar acceleration)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        cancelTurn(piece, axisIndex);
+
+        piece.turnSlots[axisIndex] = PieceTurnSlot{PieceTurnKind::Spin, static_cast<unsigned int>(spins.owners.size())};
+        spins.owners.push_back(Owner{&piece, axisIndex});
+        spins.angle.push_back(getRotationComponent(piece, axisIndex).value);
+        spins.currentSpeed.push_back(acceleration == 0_ss ? targetSpeed.value : 0.0f);
+        spins.targetSpeed.push_back(targetSpeed.value);
+        spins.acceleration.push_back(acceleration.value);
+    }
+
+    void PieceAnimationStore::stopSpin(UnitMesh& piece, SimAxis axis, SimScalar deceleration)
+    {
+        auto axisIndex = toAxisIndex(axis);
+        const auto& slot = piece.turnSlots[axisIndex];
+        if (!slot || slot->kind != PieceTurnKind::Spin)
+        {
+            return;
+        }
+
+        auto currentSpeed = spins.currentSpeed[slot->index];
+        cancelTurn(piece, axisIndex);
+
+        if (deceleration == 0_ss)
+        {
+            return;
+        }
+
+        piece.turnSlots[axisIndex] = PieceTurnSlot{PieceTurnKind::StopSpin, static_cast<unsigned int>(stopSpins.owners.size())};
+        stopSpins.owners.push_back(Owner{&piece, axisIndex});
+        stopSpins.angle.push_back(getRotationComponent(piece, axisIndex).value);
+        stopSpins.currentSpeed.push_back(currentSpeed);
+        stopSpins.deceleration.push_back(deceleration.value);
+    }
+
+    void PieceAnimationStore::removePiece(UnitMesh& piece)
+    {
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            cancelMove(piece, axis);
+            cancelTurn(piece, axis);
+        }
+    }
+
+    void PieceAnimationStore::update(SimScalar dt)
+    {
+        updateMoves(dt.value);
+        updateTurns(dt.value);
+        updateSpins(dt.value);
+        updateStopSpins(dt.value);
+    }
+
+    unsigned int PieceAnimationStore::getActiveOperationCount() const
+    {
+        return moves.owners.size() + turns.owners.size() + spins.owners.size() + stopSpins.owners.size();
+    }
+
+    void PieceAnimationStore::removeMove(unsigned int index)
+    {
+        auto& owner = moves.owners[index];
+        owner.piece->moveSlots[owner.axis] = std::nullopt;
+
+        moves.remove(index);
+        if (index < moves.owners.size())
+        {
+            const auto& moved = moves.owners[index];
+            moved.piece->moveSlots[moved.axis] = index;
+        }
+    }
+
+    template <typename Pool>
+    void removeFromTurnPool(Pool& pool, PieceTurnKind kind, unsigned int index)
+    {
+        auto& owner = pool.owners[index];
+        owner.piece->turnSlots[owner.axis] = std::nullopt;
+
+        pool.remove(index);
+        if (index < pool.owners.size())
+        {
+            const auto& moved = pool.owners[index];
+            moved.piece->turnSlots[moved.axis] = PieceTurnSlot{kind, index};
+        }
+    }
+
+    void PieceAnimationStore::removeTurnSlot(const PieceTurnSlot& slot)
+    {
+        switch (slot.kind)
+        {
+            case PieceTurnKind::Turn:
+                removeFromTurnPool(turns, slot.kind, slot.index);
+                break;
+            case PieceTurnKind::Spin:
+                removeFromTurnPool(spins, slot.kind, slot.index);
+                break;
+            case PieceTurnKind::StopSpin:
+                removeFromTurnPool(stopSpins, slot.kind, slot.index);
+                break;
+        }
+    }
+
+    void PieceAnimationStore::cancelMove(UnitMesh& piece, unsigned int axis)
+    {
+        if (auto slot = piece.moveSlots[axis]; slot)
+        {
+            removeMove(*slot);
+        }
+    }
+
+    void PieceAnimationStore::cancelTurn(UnitMesh& piece, unsigned int axis)
+    {
+        if (auto slot = piece.turnSlots[axis]; slot)
+        {
+            removeTurnSlot(*slot);
+        }
+    }
+
+    void PieceAnimationStore::updateMoves(float dt)
+    {
+        auto count = static_cast<unsigned int>(moves.owners.size());
+        finished.resize(count);
+
+        auto position = moves.position.data();
+        auto targetPosition = moves.targetPosition.data();
+        auto speed = moves.speed.data();
+        auto done = finished.data();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            auto remaining = targetPosition[i] - position[i];
+            auto frameSpeed = speed[i] * dt;
+            auto arrived = std::abs(remaining) <= frameSpeed;
+            done[i] = arrived;
+
+            // Written as an unconditional store followed by a conditional one
+            // so that the compiler can vectorize the loop
+            // without relaxing floating point semantics.
+            position[i] += remaining > 0.0f ? frameSpeed : -frameSpeed;
+            if (arrived)
+            {
+                position[i] = targetPosition[i];
+            }
+        }
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const auto& owner = moves.owners[i];
+            getOffsetComponent(*owner.piece, owner.axis) = SimScalar(position[i]);
+        }
+
+        // Walk backwards so that the operation swapped into a removed slot
+        // has always been visited already.
+        for (auto i = count; i-- > 0;)
+        {
+            if (finished[i])
+            {
+                removeMove(i);
+            }
+        }
+    }
+
+    void PieceAnimationStore::updateTurns(float dt)
+    {
+        auto count = static_cast<unsigned int>(turns.owners.size());
+        finished.resize(count);
+
+        auto angle = turns.angle.data();
+        auto targetAngle = turns.targetAngle.data();
+        auto speed = turns.speed.data();
+        auto done = finished.data();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            // see turnTowards and angleBetweenWithDirection
+            auto turn = static_cast<uint16_t>(targetAngle[i] - angle[i]);
+            auto anticlockwise = turn <= HalfTurn.value;
+            auto delta = anticlockwise ? turn : static_cast<uint16_t>(-turn);
+            auto maxTurn = static_cast<uint16_t>(speed[i] * dt);
+            auto arrived = delta <= maxTurn;
+            auto next = static_cast<uint16_t>(anticlockwise ? angle[i] + maxTurn : angle[i] - maxTurn);
+            angle[i] = arrived ? targetAngle[i] : next;
+            done[i] = arrived;
+        }
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const auto& owner = turns.owners[i];
+            getRotationComponent(*owner.piece, owner.axis) = SimAngle(angle[i]);
+        }
+
+        for (auto i = count; i-- > 0;)
+        {
+            if (finished[i])
+            {
+                removeFromTurnPool(turns, PieceTurnKind::Turn, i);
+            }
+        }
+    }
+
+    void PieceAnimationStore::updateSpins(float dt)
+    {
+        auto count = static_cast<unsigned int>(spins.owners.size());
+
+        auto angle = spins.angle.data();
+        auto currentSpeed = spins.currentSpeed.data();
+        auto targetSpeed = spins.targetSpeed.data();
+        auto acceleration = spins.acceleration.data();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            auto remaining = targetSpeed[i] - currentSpeed[i];
+            auto reached = std::abs(remaining) <= acceleration[i];
+            currentSpeed[i] += remaining > 0.0f ? acceleration[i] : -acceleration[i];
+            if (reached)
+            {
+                currentSpeed[i] = targetSpeed[i];
+            }
+            angle[i] = advanceAngle(angle[i], currentSpeed[i] * dt);
+        }
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const auto& owner = spins.owners[i];
+            getRotationComponent(*owner.piece, owner.axis) = SimAngle(angle[i]);
+        }
+    }
+
+    void PieceAnimationStore::updateStopSpins(float dt)
+    {
+        auto count = static_cast<unsigned int>(stopSpins.owners.size());
+        finished.resize(count);
+
+        auto angle = stopSpins.angle.data();
+        auto currentSpeed = stopSpins.currentSpeed.data();
+        auto deceleration = stopSpins.deceleration.data();
+        auto done = finished.data();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            // once stopped the piece stays where it is
+            auto stopped = std::abs(currentSpeed[i]) <= deceleration[i];
+            done[i] = stopped;
+
+            auto nextSpeed = currentSpeed[i] - (currentSpeed[i] > 0.0f ? deceleration[i] : -deceleration[i]);
+            auto nextAngle = advanceAngle(angle[i], nextSpeed * dt);
+            if (!stopped)
+            {
+                currentSpeed[i] = nextSpeed;
+                angle[i] = nextAngle;
+            }
+        }
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const auto& owner = stopSpins.owners[i];
+            getRotationComponent(*owner.piece, owner.axis) = SimAngle(angle[i]);
+        }
+
+        for (auto i = count; i-- > 0;)
+        {
+            if (finished[i])
+            {
+                removeFromTurnPool(stopSpins, PieceTurnKind::StopSpin, i);
+            }
+        }
+    }
+}
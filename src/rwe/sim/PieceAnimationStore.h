@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <rwe/sim/SimAngle.h>
+#include <rwe/sim/SimAxis.h>
+#include <rwe/sim/SimScalar.h>
+#include <rwe/sim/UnitMesh.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Holds every piece move, turn, spin and stop spin operation
+     * in progress across all units in the simulation.
+     *
+     * Each kind of operation is stored in its own pool
+     * as a structure of arrays, so that advancing all operations
+     * of one kind is a tight loop without data-dependent branches
+     * that the compiler is able to vectorize.
+     * After each update the new values are written back
+     * to the pieces that own the operations.
+     *
+     * Pieces are referenced by address, so a piece must not move in memory
+     * while it has operations in progress, and removePiece must be called
+     * before it is destroyed.
+     */
+    class PieceAnimationStore
+    {
+    private:
+        struct Owner
+        {
+            UnitMesh* piece;
+            unsigned int axis;
+        };
+
+        struct MovePool
+        {
+            std::vector<Owner> owners;
+            std::vector<float> position;
+            std::vector<float> targetPosition;
+            std::vector<float> speed;
+
+            void remove(unsigned int index);
+        };
+
+        struct TurnPool
+        {
+            std::vector<Owner> owners;
+            std::vector<uint16_t> angle;
+            std::vector<uint16_t> targetAngle;
+            std::vector<float> speed;
+
+            void remove(unsigned int index);
+        };
+
+        struct SpinPool
+        {
+            std::vector<Owner> owners;
+            std::vector<uint16_t> angle;
+            std::vector<float> currentSpeed;
+            std::vector<float> targetSpeed;
+            std::vector<float> acceleration;
+
+            void remove(unsigned int index);
+        };
+
+        struct StopSpinPool
+        {
+            std::vector<Owner> owners;
+            std::vector<uint16_t> angle;
+            std::vector<float> currentSpeed;
+            std::vector<float> deceleration;
+
+            void remove(unsigned int index);
+        };
+
+        MovePool moves;
+        TurnPool turns;
+        SpinPool spins;
+        StopSpinPool stopSpins;
+
+        /** Scratch space marking the operations that completed this update. */
+        std::vector<uint8_t> finished;
+
+    public:
+        void move(UnitMesh& piece, SimAxis axis, SimScalar targetPosition, SimScalar speed);
+
+        void moveNow(UnitMesh& piece, SimAxis axis, SimScalar position);
+
+        void turn(UnitMesh& piece, SimAxis axis, SimAngle targetAngle, SimScalar speed);
+
+        void turnNow(UnitMesh& piece, SimAxis axis, SimAngle angle);
+
+        void spin(UnitMesh& piece, SimAxis axis, SimScalar targetSpeed, SimScalar acceleration);
+
+        /**
+         * Begins slowing down the piece's spin around the given axis.
+         * Does nothing if the piece is not spinning around that axis.
+         */
+        void stopSpin(UnitMesh& piece, SimAxis axis, SimScalar deceleration);
+
+        /** Cancels all operations in progress on the piece. */
+        void removePiece(UnitMesh& piece);
+
+        /** Advances all operations in progress by dt seconds. */
+        void update(SimScalar dt);
+
+        unsigned int getActiveOperationCount() const;
+
+    private:
+        void removeMove(unsigned int index);
+
+        void removeTurnSlot(const PieceTurnSlot& slot);
+
+        void cancelMove(UnitMesh& piece, unsigned int axis);
+
+        void cancelTurn(UnitMesh& piece, unsigned int axis);
+
+        void updateMoves(float dt);
+
+        void updateTurns(float dt);
+
+        void updateSpins(float dt);
+
+        void updateStopSpins(float dt);
+    };
+}
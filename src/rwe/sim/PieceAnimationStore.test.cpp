@@ -0,0 +1,133 @@
+#include <catch2/catch.hpp>
+#include <rwe/sim/PieceAnimationStore.h>
+
+namespace rwe
+{
+    TEST_CASE("PieceAnimationStore")
+    {
+        PieceAnimationStore store;
+        UnitMesh piece{"foo"};
+
+        SECTION("moves a piece towards its target at the given speed")
+        {
+            store.move(piece, SimAxis::Y, 10_ss, 4_ss);
+            REQUIRE(piece.moveSlots[1].has_value());
+
+            store.update(1_ss);
+            REQUIRE(piece.offset.y == 4_ss);
+            store.update(1_ss);
+            REQUIRE(piece.offset.y == 8_ss);
+            REQUIRE(piece.moveSlots[1].has_value());
+
+            store.update(1_ss);
+            REQUIRE(piece.offset.y == 10_ss);
+            REQUIRE(!piece.moveSlots[1].has_value());
+            REQUIRE(store.getActiveOperationCount() == 0);
+        }
+
+        SECTION("moves in the negative direction")
+        {
+            store.move(piece, SimAxis::X, -3_ss, 2_ss);
+            store.update(1_ss);
+            REQUIRE(piece.offset.x == -2_ss);
+            store.update(1_ss);
+            REQUIRE(piece.offset.x == -3_ss);
+            REQUIRE(!piece.moveSlots[0].has_value());
+        }
+
+        SECTION("moveNow cancels the move in progress")
+        {
+            store.move(piece, SimAxis::Z, 10_ss, 1_ss);
+            store.moveNow(piece, SimAxis::Z, 5_ss);
+            REQUIRE(piece.offset.z == 5_ss);
+            REQUIRE(!piece.moveSlots[2].has_value());
+
+            store.update(1_ss);
+            REQUIRE(piece.offset.z == 5_ss);
+        }
+
+        SECTION("turns the short way around")
+        {
+            piece.rotationY = SimAngle(100);
+            store.turn(piece, SimAxis::Y, SimAngle(65000), 300_ss);
+
+            store.update(1_ss);
+            REQUIRE(piece.rotationY == SimAngle(65336));
+            store.update(1_ss);
+            REQUIRE(piece.rotationY == SimAngle(65036));
+            store.update(1_ss);
+            REQUIRE(piece.rotationY == SimAngle(65000));
+            REQUIRE(!piece.turnSlots[1].has_value());
+        }
+
+        SECTION("spins up, then stops spinning")
+        {
+            store.spin(piece, SimAxis::X, 100_ss, 40_ss);
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(40));
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(120));
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(220));
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(320));
+
+            store.stopSpin(piece, SimAxis::X, 60_ss);
+            REQUIRE(piece.turnSlots[0]->kind == PieceTurnKind::StopSpin);
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(360));
+            store.update(1_ss);
+            REQUIRE(piece.rotationX == SimAngle(360));
+            REQUIRE(!piece.turnSlots[0].has_value());
+        }
+
+        SECTION("spins backwards with a negative speed")
+        {
+            store.spin(piece, SimAxis::Z, -50_ss, 0_ss);
+            store.update(1_ss);
+            REQUIRE(piece.rotationZ == SimAngle(65486));
+        }
+
+        SECTION("stopSpin does nothing to a piece that is not spinning")
+        {
+            store.turn(piece, SimAxis::X, SimAngle(1000), 1_ss);
+            store.stopSpin(piece, SimAxis::X, 1_ss);
+            REQUIRE(piece.turnSlots[0]->kind == PieceTurnKind::Turn);
+        }
+
+        SECTION("keeps slots consistent when operations complete out of order")
+        {
+            UnitMesh a{"a"};
+            UnitMesh b{"b"};
+            UnitMesh c{"c"};
+            store.move(a, SimAxis::X, 1_ss, 1_ss);
+            store.move(b, SimAxis::X, 5_ss, 1_ss);
+            store.move(c, SimAxis::X, 1_ss, 1_ss);
+
+            store.update(1_ss);
+            REQUIRE(!a.moveSlots[0].has_value());
+            REQUIRE(!c.moveSlots[0].has_value());
+            REQUIRE(b.moveSlots[0] == std::optional<unsigned int>(0));
+
+            store.update(1_ss);
+            REQUIRE(a.offset.x == 1_ss);
+            REQUIRE(b.offset.x == 2_ss);
+            REQUIRE(c.offset.x == 1_ss);
+        }
+
+        SECTION("removePiece cancels all of its operations")
+        {
+            UnitMesh other{"other"};
+            store.move(piece, SimAxis::X, 10_ss, 1_ss);
+            store.spin(piece, SimAxis::Y, 10_ss, 1_ss);
+            store.turn(other, SimAxis::Y, SimAngle(1000), 1_ss);
+
+            store.removePiece(piece);
+            REQUIRE(store.getActiveOperationCount() == 1);
+
+            store.update(1_ss);
+            REQUIRE(piece.offset.x == 0_ss);
+            REQUIRE(other.rotationY == SimAngle(1));
+        }
+    }
+}
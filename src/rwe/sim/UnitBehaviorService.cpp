@@ -1,5 +1,4 @@
 #include "UnitBehaviorService.h"
-#include <rwe/cob/CobExecutionContext.h>
 #include <rwe/sim/SimTicksPerSecond.h>
 #include <rwe/sim/UnitBehaviorService_util.h>
 #include <rwe/sim/cob.h>
@@ -752,20 +751,7 @@ namespace rwe
     std::optional<int> UnitBehaviorService::runCobQuery(UnitId id, const std::string& name)
     {
         auto& unit = sim->getUnitState(id);
-        auto thread = unit.cobEnvironment->createNonScheduledThread(name, {0});
-        if (!thread)
-        {
-            return std::nullopt;
-        }
-        CobExecutionContext context(unit.cobEnvironment.get(), &*thread);
-        auto status = context.execute();
-        if (std::get_if<CobEnvironment::FinishedStatus>(&status) == nullptr)
-        {
-            throw std::runtime_error("Synchronous cob query thread blocked before completion");
-        }
-
-        auto result = thread->returnLocals[0];
-        return result;
+        return rwe::runCobQuery(*sim, *unit.cobEnvironment, name);
     }
 
     SimVector UnitBehaviorService::getAimingPoint(UnitId id, unsigned int weaponIndex)
@@ -1215,7 +1201,7 @@ namespace rwe
         {
             // request a path to follow
             unitInfo.state->navigationState.state = NavigationStateMoving{goal, resolvePathDestination(*unitInfo.state, goal), std::nullopt, true};
-            sim->requestPath(unitInfo.id);
+            sim->requestPath(unitInfo.id, PathSearchAlgorithm::JumpPoint, PathRequestReason::NewGoal);
             return;
         }
 
@@ -1229,7 +1215,7 @@ namespace rwe
             // we can still continue following it
             // while we wait for a new path to be computed.
             movingState->pathDestination = resolvedDestination;
-            sim->requestPath(unitInfo.id);
+            sim->requestPath(unitInfo.id, PathSearchAlgorithm::JumpPoint);
             movingState->pathRequested = true;
         }
 
@@ -1237,10 +1223,12 @@ namespace rwe
         if (unitInfo.state->inCollision && !movingState->pathRequested)
         {
             // only request a new path if we don't have one yet,
-            // or we've already had our current one for a bit
+            // or we've already had our current one for a bit.
+            // These searches are short and crowded, so plain A* is used,
+            // and a path we already have is repaired around the blockage if possible.
             if (!movingState->path || (sim->gameTime - movingState->path->pathCreationTime) >= GameTime(30))
             {
-                sim->requestPath(unitInfo.id);
+                sim->requestPath(unitInfo.id, PathSearchAlgorithm::AStar, movingState->path ? PathRequestReason::Repair : PathRequestReason::Replan);
                 movingState->pathRequested = true;
             }
         }
@@ -1472,6 +1460,7 @@ namespace rwe
         sim->occupiedGrid.forEach(*footprintRegion, [](auto& cell) {
             cell.mobileUnitId = std::nullopt;
         });
+        sim->pathFindingService.notifyOccupancyChanged(footprintRect);
         sim->flyingUnitsSet.insert(unitInfo.id);
     }
 
@@ -1489,6 +1478,7 @@ namespace rwe
         sim->occupiedGrid.forEach(*footprintRegion, [&](auto& cell) {
             cell.mobileUnitId = unitInfo.id;
         });
+        sim->pathFindingService.notifyOccupancyChanged(footprintRect);
         sim->flyingUnitsSet.erase(unitInfo.id);
 
         unitInfo.state->physics = UnitPhysicsInfoGround();
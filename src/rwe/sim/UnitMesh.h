@@ -1,60 +1,38 @@
 #pragma once
 
+#include <array>
 #include <optional>
 #include <rwe/sim/SimAngle.h>
 #include <rwe/sim/SimScalar.h>
 #include <rwe/sim/SimVector.h>
-#include <variant>
+#include <string>
 
 
 namespace rwe
 {
-    struct UnitMesh
+    enum class PieceTurnKind
     {
-        struct MoveOperation
-        {
-            SimScalar targetPosition;
-            SimScalar speed;
-
-            MoveOperation(SimScalar targetPosition, SimScalar speed);
-        };
-
-        struct TurnOperation
-        {
-            SimAngle targetAngle;
-            SimScalar speed;
-
-            TurnOperation(SimAngle targetAngle, SimScalar speed);
-        };
-
-        struct SpinOperation
-        {
-            SimScalar currentSpeed;
-            SimScalar targetSpeed;
-            SimScalar acceleration;
-
-            SpinOperation(SimScalar currentSpeed, SimScalar targetSpeed, SimScalar acceleration)
-                : currentSpeed(currentSpeed),
-                  targetSpeed(targetSpeed),
-                  acceleration(acceleration)
-            {
-            }
-        };
-
-        struct StopSpinOperation
-        {
-            SimScalar currentSpeed;
-            SimScalar deceleration;
-
-            StopSpinOperation(SimScalar currentSpeed, SimScalar deceleration)
-                : currentSpeed(currentSpeed),
-                  deceleration(deceleration)
-            {
-            }
-        };
+        Turn,
+        Spin,
+        StopSpin
+    };
 
-        using TurnOperationUnion = std::variant<TurnOperation, SpinOperation, StopSpinOperation>;
+    /** Identifies an animation in PieceAnimationStore. */
+    struct PieceTurnSlot
+    {
+        PieceTurnKind kind;
+        unsigned int index;
+    };
 
+    /**
+     * The current pose of a piece of a unit's model.
+     *
+     * Moves, turns and spins in progress are advanced by the simulation's
+     * PieceAnimationStore, which writes the results back into the piece.
+     * The piece only records where its animations live in the store.
+     */
+    struct UnitMesh
+    {
         std::string name;
         bool visible{true};
         bool shaded{true};
@@ -67,14 +45,13 @@ namespace rwe
         SimAngle rotationY{0};
         SimAngle rotationZ{0};
 
-        std::optional<MoveOperation> xMoveOperation;
-        std::optional<MoveOperation> yMoveOperation;
-        std::optional<MoveOperation> zMoveOperation;
+        /** Slots of the move operations in progress, indexed by axis. */
+        std::array<std::optional<unsigned int>, 3> moveSlots{};
 
-        std::optional<TurnOperationUnion> xTurnOperation;
-        std::optional<TurnOperationUnion> yTurnOperation;
-        std::optional<TurnOperationUnion> zTurnOperation;
+        /** Slots of the turn, spin or stop spin operations in progress, indexed by axis. */
+        std::array<std::optional<PieceTurnSlot>, 3> turnSlots{};
 
-        void update(SimScalar dt);
+        /** Records the current pose as the previous pose, for interpolation. */
+        void savePreviousPose();
     };
 }
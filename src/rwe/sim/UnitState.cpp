@@ -172,7 +172,7 @@ namespace rwe
         return buildTimeCompleted == unitDefinition.buildTime;
     }
 
-    void UnitState::moveObject(const std::string& pieceName, SimAxis axis, SimScalar targetPosition, SimScalar speed)
+    void UnitState::moveObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar targetPosition, SimScalar speed)
     {
         auto piece = findPiece(pieceName);
         if (!piece)
@@ -180,23 +180,10 @@ namespace rwe
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        UnitMesh::MoveOperation op(targetPosition, speed);
-
-        switch (axis)
-        {
-            case SimAxis::X:
-                piece->get().xMoveOperation = op;
-                break;
-            case SimAxis::Y:
-                piece->get().yMoveOperation = op;
-                break;
-            case SimAxis::Z:
-                piece->get().zMoveOperation = op;
-                break;
-        }
+        animations.move(*piece, axis, targetPosition, speed);
     }
 
-    void UnitState::moveObjectNow(const std::string& pieceName, SimAxis axis, SimScalar targetPosition)
+    void UnitState::moveObjectNow(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar targetPosition)
     {
         auto piece = findPiece(pieceName);
         if (!piece)
@@ -204,24 +191,10 @@ namespace rwe
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        switch (axis)
-        {
-            case SimAxis::X:
-                piece->get().offset.x = targetPosition;
-                piece->get().xMoveOperation = std::nullopt;
-                break;
-            case SimAxis::Y:
-                piece->get().offset.y = targetPosition;
-                piece->get().yMoveOperation = std::nullopt;
-                break;
-            case SimAxis::Z:
-                piece->get().offset.z = targetPosition;
-                piece->get().zMoveOperation = std::nullopt;
-                break;
-        }
+        animations.moveNow(*piece, axis, targetPosition);
     }
 
-    void UnitState::turnObject(const std::string& pieceName, SimAxis axis, SimAngle targetAngle, SimScalar speed)
+    void UnitState::turnObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimAngle targetAngle, SimScalar speed)
     {
         auto piece = findPiece(pieceName);
         if (!piece)
@@ -229,23 +202,10 @@ namespace rwe
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        UnitMesh::TurnOperation op(targetAngle, speed);
-
-        switch (axis)
-        {
-            case SimAxis::X:
-                piece->get().xTurnOperation = op;
-                break;
-            case SimAxis::Y:
-                piece->get().yTurnOperation = op;
-                break;
-            case SimAxis::Z:
-                piece->get().zTurnOperation = op;
-                break;
-        }
+        animations.turn(*piece, axis, targetAngle, speed);
     }
 
-    void UnitState::turnObjectNow(const std::string& pieceName, SimAxis axis, SimAngle targetAngle)
+    void UnitState::turnObjectNow(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimAngle targetAngle)
     {
         auto piece = findPiece(pieceName);
         if (!piece)
@@ -253,24 +213,10 @@ namespace rwe
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        switch (axis)
-        {
-            case SimAxis::X:
-                piece->get().rotationX = targetAngle;
-                piece->get().xTurnOperation = std::nullopt;
-                break;
-            case SimAxis::Y:
-                piece->get().rotationY = targetAngle;
-                piece->get().yTurnOperation = std::nullopt;
-                break;
-            case SimAxis::Z:
-                piece->get().rotationZ = targetAngle;
-                piece->get().zTurnOperation = std::nullopt;
-                break;
-        }
+        animations.turnNow(*piece, axis, targetAngle);
     }
 
-    void UnitState::spinObject(const std::string& pieceName, SimAxis axis, SimScalar speed, SimScalar acceleration)
+    void UnitState::spinObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar speed, SimScalar acceleration)
     {
         auto piece = findPiece(pieceName);
         if (!piece)
@@ -278,64 +224,18 @@ namespace rwe
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        UnitMesh::SpinOperation op(acceleration == 0_ss ? speed : 0_ss, speed, acceleration);
-
-        switch (axis)
-        {
-            case SimAxis::X:
-                piece->get().xTurnOperation = op;
-                break;
-            case SimAxis::Y:
-                piece->get().yTurnOperation = op;
-                break;
-            case SimAxis::Z:
-                piece->get().zTurnOperation = op;
-                break;
-        }
-    }
-
-    void setStopSpinOp(std::optional<UnitMesh::TurnOperationUnion>& existingOp, SimScalar deceleration)
-    {
-        if (!existingOp)
-        {
-            return;
-        }
-        auto spinOp = std::get_if<UnitMesh::SpinOperation>(&*existingOp);
-        if (spinOp == nullptr)
-        {
-            return;
-        }
-
-        if (deceleration == 0_ss)
-        {
-            existingOp = std::nullopt;
-            return;
-        }
-
-        existingOp = UnitMesh::StopSpinOperation(spinOp->currentSpeed, deceleration);
+        animations.spin(*piece, axis, speed, acceleration);
     }
 
-    void UnitState::stopSpinObject(const std::string& pieceName, SimAxis axis, SimScalar deceleration)
+    void UnitState::stopSpinObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar deceleration)
     {
-
         auto piece = findPiece(pieceName);
         if (!piece)
         {
             throw std::runtime_error("Invalid piece name: " + pieceName);
         }
 
-        switch (axis)
-        {
-            case SimAxis::X:
-                setStopSpinOp(piece->get().xTurnOperation, deceleration);
-                break;
-            case SimAxis::Y:
-                setStopSpinOp(piece->get().yTurnOperation, deceleration);
-                break;
-            case SimAxis::Z:
-                setStopSpinOp(piece->get().zTurnOperation, deceleration);
-                break;
-        }
+        animations.stopSpin(*piece, axis, deceleration);
     }
 
     bool UnitState::isMoveInProgress(const std::string& pieceName, SimAxis axis) const
@@ -349,11 +249,11 @@ namespace rwe
         switch (axis)
         {
             case SimAxis::X:
-                return !!(piece->get().xMoveOperation);
+                return piece->get().moveSlots[0].has_value();
             case SimAxis::Y:
-                return !!(piece->get().yMoveOperation);
+                return piece->get().moveSlots[1].has_value();
             case SimAxis::Z:
-                return !!(piece->get().zMoveOperation);
+                return piece->get().moveSlots[2].has_value();
         }
 
         throw std::logic_error("Invalid axis");
@@ -370,11 +270,11 @@ namespace rwe
         switch (axis)
         {
             case SimAxis::X:
-                return !!(piece->get().xTurnOperation);
+                return piece->get().turnSlots[0].has_value();
             case SimAxis::Y:
-                return !!(piece->get().yTurnOperation);
+                return piece->get().turnSlots[1].has_value();
             case SimAxis::Z:
-                return !!(piece->get().zTurnOperation);
+                return piece->get().turnSlots[2].has_value();
         }
 
         throw std::logic_error("Invalid axis");
@@ -9,6 +9,7 @@
 #include <rwe/pathfinding/UnitPath.h>
 #include <rwe/sim/Energy.h>
 #include <rwe/sim/Metal.h>
+#include <rwe/sim/PieceAnimationStore.h>
 #include <rwe/sim/PlayerId.h>
 #include <rwe/sim/SimAngle.h>
 #include <rwe/sim/SimAxis.h>
@@ -299,17 +300,17 @@ namespace rwe
 
         bool addBuildProgress(const UnitDefinition& unitDefinition, unsigned int buildTimeContribution);
 
-        void moveObject(const std::string& pieceName, SimAxis axis, SimScalar targetPosition, SimScalar speed);
+        void moveObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar targetPosition, SimScalar speed);
 
-        void moveObjectNow(const std::string& pieceName, SimAxis axis, SimScalar targetPosition);
+        void moveObjectNow(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar targetPosition);
 
-        void turnObject(const std::string& pieceName, SimAxis axis, SimAngle targetAngle, SimScalar speed);
+        void turnObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimAngle targetAngle, SimScalar speed);
 
-        void turnObjectNow(const std::string& pieceName, SimAxis axis, SimAngle targetAngle);
+        void turnObjectNow(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimAngle targetAngle);
 
-        void spinObject(const std::string& pieceName, SimAxis axis, SimScalar speed, SimScalar acceleration);
+        void spinObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar speed, SimScalar acceleration);
 
-        void stopSpinObject(const std::string& pieceName, SimAxis axis, SimScalar deceleration);
+        void stopSpinObject(PieceAnimationStore& animations, const std::string& pieceName, SimAxis axis, SimScalar deceleration);
 
         bool isMoveInProgress(const std::string& pieceName, SimAxis axis) const;
 
@@ -1,4 +1,6 @@
 #include "cob.h"
+#include <algorithm>
+#include <cstdint>
 #include <optional>
 #include <rwe/cob/CobAxis.h>
 #include <rwe/cob/CobExecutionContext.h>
@@ -7,6 +9,7 @@
 #include <rwe/cob/cob_util.h>
 #include <rwe/sim/SimAxis.h>
 #include <rwe/sim/SimScalar.h>
+#include <stdexcept>
 
 namespace rwe
 {
@@ -50,6 +53,17 @@ namespace rwe
         return CobTime(time.value + duration.value);
     }
 
+    /**
+     * Returns the first tick after the current tick
+     * on which the cob time will have reached the given wake time.
+     */
+    GameTime toWakeTick(GameTime currentTick, CobTime wakeTime)
+    {
+        // toCobTime(t) >= w exactly when t >= ceil(w * 30 / 1000)
+        auto wakeTick = GameTime(static_cast<unsigned int>((static_cast<uint64_t>(std::max(wakeTime.value, 0)) * 30 + 999) / 1000));
+        return std::max(wakeTick, GameTime(currentTick.value + 1));
+    }
+
     SimAxis toSimAxis(CobAxis axis)
     {
         switch (axis)
@@ -87,13 +101,17 @@ namespace rwe
 
     using InterruptedReason = std::variant<CobEnvironment::PieceCommandStatus, CobEnvironment::QueryStatus, CobEnvironment::SetQueryStatus>;
 
-    std::optional<InterruptedReason> executeThreads(CobEnvironment& env, UnitId unitId, GameTime gameTime)
+    std::optional<InterruptedReason> executeThreads(GameSimulation& simulation, CobEnvironment& env)
     {
         while (!env.readyQueue.empty())
         {
             auto thread = env.readyQueue.front();
 
+#ifdef RWE_COB_PROFILING
+            CobExecutionContext context(&env, thread, &simulation.cobProfiler);
+#else
             CobExecutionContext context(&env, thread);
+#endif
 
             auto result = match(
                 context.execute(),
@@ -103,9 +121,9 @@ namespace rwe
                     return std::optional<InterruptedReason>();
                 },
                 [&](const CobEnvironment::SleepStatus& status) {
-                    auto wakeTime = addDuration(toCobTime(gameTime), status.duration);
+                    auto wakeTime = addDuration(toCobTime(simulation.gameTime), status.duration);
                     env.readyQueue.pop_front();
-                    env.sleepingQueue.emplace_back(wakeTime, thread);
+                    env.sleepingQueue.push(toWakeTick(simulation.gameTime, wakeTime).value, thread);
                     return std::optional<InterruptedReason>();
                 },
                 [&](const CobEnvironment::FinishedStatus&) {
@@ -446,27 +464,18 @@ namespace rwe
             }
         }
 
-        // check if any sleeping threads can be moved into the ready queue
-        auto cobTime = toCobTime(simulation.gameTime);
-        for (auto it = env.sleepingQueue.begin(); it != env.sleepingQueue.end();)
+        // move any sleeping threads that are due to wake into the ready queue
+        while (!env.sleepingQueue.empty() && env.sleepingQueue.top().wakeTick <= simulation.gameTime.value)
         {
-            const auto& pair = *it;
-            const auto& wakeTime = pair.first;
-            if (cobTime >= wakeTime)
-            {
-                env.readyQueue.push_back(pair.second);
-                it = env.sleepingQueue.erase(it);
-            }
-            else
-            {
-                ++it;
-            }
+            env.readyQueue.push_back(env.sleepingQueue.top().thread);
+            env.sleepingQueue.pop();
+            ++simulation.cobThreadsWokenThisTick;
         }
 
         assert(env.isNotCorrupt());
 
         // execute ready threads
-        while (auto result = executeThreads(env, unitId, simulation.gameTime))
+        while (auto result = executeThreads(simulation, env))
         {
             match(
                 *result,
@@ -484,4 +493,52 @@ namespace rwe
 
         assert(env.isNotCorrupt());
     }
+
+    std::optional<int> runCobQuery(GameSimulation& simulation, CobEnvironment& env, const std::string& name)
+    {
+        // Query functions cannot read anything but statics
+        // without yielding to the engine, which is an error here,
+        // so a result stays valid until a static is written.
+        // Threads are checked too, in case the script's behaviour depends on them.
+        auto staticsVersion = env.getStaticsVersion();
+        auto threadsVersion = env.getThreadsVersion();
+        if (auto it = env.queryCache.find(name); it != env.queryCache.end())
+        {
+            const auto& entry = it->second;
+            if (entry.tick == simulation.gameTime.value && entry.staticsVersion == staticsVersion && entry.threadsVersion == threadsVersion)
+            {
+                return entry.result;
+            }
+        }
+
+        auto thread = env.createNonScheduledThread(name, {0});
+        if (!thread)
+        {
+            env.queryCache.insert_or_assign(name, CobEnvironment::QueryCacheEntry{simulation.gameTime.value, staticsVersion, threadsVersion, std::nullopt});
+            return std::nullopt;
+        }
+#ifdef RWE_COB_PROFILING
+        CobExecutionContext context(&env, &*thread, &simulation.cobProfiler);
+#else
+        CobExecutionContext context(&env, &*thread);
+#endif
+        auto status = context.execute();
+        if (std::get_if<CobEnvironment::FinishedStatus>(&status) == nullptr)
+        {
+            throw std::runtime_error("Synchronous cob query thread blocked before completion");
+        }
+
+        auto result = thread->returnLocals[0];
+
+        // If the query wrote to a static (e.g. to alternate between barrels)
+        // then calling it again may give a different answer,
+        // and if it started or killed any threads then skipping it would lose that,
+        // so don't cache it.
+        if (env.getStaticsVersion() == staticsVersion && env.getThreadsVersion() == threadsVersion)
+        {
+            env.queryCache.insert_or_assign(name, CobEnvironment::QueryCacheEntry{simulation.gameTime.value, staticsVersion, threadsVersion, result});
+        }
+
+        return result;
+    }
 }
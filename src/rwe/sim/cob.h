@@ -1,8 +1,11 @@
 #pragma once
 
+#include <optional>
 #include <rwe/cob/CobAngle.h>
+#include <rwe/cob/CobEnvironment.h>
 #include <rwe/sim/GameSimulation.h>
 #include <rwe/sim/UnitId.h>
+#include <string>
 
 namespace rwe
 {
@@ -11,4 +14,15 @@ namespace rwe
     CobSpeed toCobSpeed(SimScalar speed);
 
     void runUnitCobScripts(GameSimulation& simulation, UnitId unitId);
+
+    /**
+     * Runs a query function to completion, passing it a single parameter,
+     * and returns the value the function left in that parameter.
+     * Returns nullopt if the script has no such function.
+     *
+     * The result is remembered in the environment's query cache
+     * and returned again for the rest of the tick,
+     * unless a static is written or a thread is created or killed in the meantime.
+     */
+    std::optional<int> runCobQuery(GameSimulation& simulation, CobEnvironment& env, const std::string& name);
 }
@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+#include <rwe/cob/CobOpCode.h>
+#include <rwe/sim/cob.h>
+
+namespace rwe
+{
+    static uint32_t cobQueryTestOp(OpCode opCode)
+    {
+        return static_cast<uint32_t>(opCode);
+    }
+
+    TEST_CASE("runCobQuery")
+    {
+        GameSimulation simulation(MapTerrain(Grid<unsigned char>(65, 65, 0), 0_ss), 0, 0, 20);
+
+        // QueryPrimary(piece) sets piece to 5.
+        // StartIdle(piece) starts Idle and sets piece to 5.
+        // SetPrimary(piece) writes static 0 and sets piece to 5.
+        CobScript script;
+        script.staticVariableCount = 1;
+        auto& code = script.instructions;
+
+        script.functions.push_back(CobFunctionInfo{"Idle", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 0, cobQueryTestOp(OpCode::RETURN)});
+
+        script.functions.push_back(CobFunctionInfo{"QueryPrimary", static_cast<unsigned int>(code.size())});
+        auto queryConstant = code.size() + 1;
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 5, cobQueryTestOp(OpCode::POP_LOCAL_VAR), 0});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 0, cobQueryTestOp(OpCode::RETURN)});
+
+        script.functions.push_back(CobFunctionInfo{"StartIdle", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::START_SCRIPT), 0, 0});
+        auto startIdleConstant = code.size() + 1;
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 5, cobQueryTestOp(OpCode::POP_LOCAL_VAR), 0});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 0, cobQueryTestOp(OpCode::RETURN)});
+
+        script.functions.push_back(CobFunctionInfo{"SetPrimary", static_cast<unsigned int>(code.size())});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 1, cobQueryTestOp(OpCode::POP_STATIC), 0});
+        auto setPrimaryConstant = code.size() + 1;
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 5, cobQueryTestOp(OpCode::POP_LOCAL_VAR), 0});
+        code.insert(code.end(), {cobQueryTestOp(OpCode::PUSH_CONSTANT), 0, cobQueryTestOp(OpCode::RETURN)});
+
+        CobEnvironment env(&script, nullptr);
+
+        // The tests change the script between queries,
+        // so a query that runs again gives a different answer from one that was cached.
+
+        SECTION("returns the cached result when asked again in the same tick")
+        {
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 5);
+            code[queryConstant] = 7;
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 5);
+        }
+
+        SECTION("runs the query again on the next tick")
+        {
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 5);
+            code[queryConstant] = 7;
+            simulation.gameTime = simulation.gameTime + GameTime(1);
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 7);
+        }
+
+        SECTION("runs the query again after a static is written")
+        {
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 5);
+            code[queryConstant] = 7;
+            env.setStatic(0, 3);
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 7);
+        }
+
+        SECTION("runs the query again after a thread is created")
+        {
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 5);
+            code[queryConstant] = 7;
+            env.createThread("Idle");
+            REQUIRE(runCobQuery(simulation, env, "QueryPrimary") == 7);
+        }
+
+        SECTION("does not cache queries that write statics")
+        {
+            REQUIRE(runCobQuery(simulation, env, "SetPrimary") == 5);
+            code[setPrimaryConstant] = 7;
+            REQUIRE(runCobQuery(simulation, env, "SetPrimary") == 7);
+        }
+
+        SECTION("does not cache queries that start threads")
+        {
+            REQUIRE(runCobQuery(simulation, env, "StartIdle") == 5);
+            code[startIdleConstant] = 7;
+            REQUIRE(runCobQuery(simulation, env, "StartIdle") == 7);
+            REQUIRE(env.threads.size() == 2);
+        }
+
+        SECTION("caches missing functions")
+        {
+            REQUIRE(!runCobQuery(simulation, env, "QuerySecondary"));
+            REQUIRE(env.queryCache.at("QuerySecondary").tick == simulation.gameTime.value);
+            REQUIRE(!runCobQuery(simulation, env, "QuerySecondary"));
+        }
+    }
+}
@@ -1,2 +1,12 @@
-#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_RUNNER
 #include <catch2/catch.hpp>
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+int main(int argc, char* argv[])
+{
+    // The game creates this logger at startup and code under test logs to it.
+    spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+
+    return Catch::Session().run(argc, argv);
+}